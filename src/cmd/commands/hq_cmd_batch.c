@@ -0,0 +1,128 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "hq_cmd.h"
+#include "hq_cmd_internal.h"
+#include "osal_task.h"
+
+/* Printed as milliseconds with microsecond digits */
+#define BATCH_MS(us) (unsigned)((us) / 1000U), (unsigned)((us) % 1000U)
+
+static void hq_cmd_batch_run(hq_cmd_cli_t *cli, char *args, void *context)
+{
+    int32_t run;
+
+    (void)cli;
+    (void)context;
+
+    if (args == NULL)
+    {
+        hq_cmd_print("Usage: run <path>");
+        return;
+    }
+
+    run = hq_cmd_exec_script(args);
+    if (run >= 0 && hq_cmd_cancelled())
+    {
+        hq_cmd_printf("Stopped after %d commands", (int)run);
+    }
+}
+
+static void hq_cmd_batch_repeat(hq_cmd_cli_t *cli, char *args, void *context)
+{
+    uint64_t total_us = 0U;
+    uint64_t min_us = UINT64_MAX;
+    uint64_t max_us = 0U;
+    unsigned long count;
+    uint32_t done;
+    char *line;
+
+    (void)cli;
+    (void)context;
+
+    count = (args != NULL) ? strtoul(args, &line, 10) : 0U;
+    if (count == 0U || count > UINT32_MAX || *line != ' ')
+    {
+        hq_cmd_print("Usage: repeat <count> <command>");
+        return;
+    }
+
+    for (done = 0U; done < (uint32_t)count && !hq_cmd_cancelled(); done++)
+    {
+        uint64_t start = osal_task_get_time_us();
+        uint64_t elapsed;
+
+        if (hq_cmd_exec_line(line) != 0)
+        {
+            break;
+        }
+        elapsed = osal_task_get_time_us() - start;
+        total_us += elapsed;
+        min_us = (elapsed < min_us) ? elapsed : min_us;
+        max_us = (elapsed > max_us) ? elapsed : max_us;
+    }
+
+    if (done > 0U)
+    {
+        uint64_t avg_us = total_us / done;
+
+        hq_cmd_printf("%u runs in %u.%03u ms: avg %u.%03u ms, min %u.%03u ms, max %u.%03u ms",
+                      (unsigned)done, BATCH_MS(total_us), BATCH_MS(avg_us), BATCH_MS(min_us),
+                      BATCH_MS(max_us));
+    }
+}
+
+static void hq_cmd_batch_time(hq_cmd_cli_t *cli, char *args, void *context)
+{
+    uint64_t start;
+    uint64_t elapsed;
+
+    (void)cli;
+    (void)context;
+
+    if (args == NULL)
+    {
+        hq_cmd_print("Usage: time <command>");
+        return;
+    }
+
+    start = osal_task_get_time_us();
+    if (hq_cmd_exec_line(args) == 0)
+    {
+        elapsed = osal_task_get_time_us() - start;
+        hq_cmd_printf("Took %u.%03u ms", BATCH_MS(elapsed));
+    }
+}
+
+void hq_cmd_register_batch_commands(void)
+{
+    /* Arguments are command lines, passed on untokenized; on a worker so
+     * long batches can be stopped with Ctrl-C */
+    static const hq_cmd_binding_t bindings[] = {
+        {
+            .name = "run",
+            .help = "Run the commands in a file: run <path>",
+            .handler = hq_cmd_batch_run,
+            .run_in_worker = true,
+        },
+        {
+            .name = "repeat",
+            .help = "Run a command several times and report its latency: repeat <count> <command>",
+            .handler = hq_cmd_batch_repeat,
+            .run_in_worker = true,
+        },
+        {
+            .name = "time",
+            .help = "Run a command and report how long it took: time <command>",
+            .handler = hq_cmd_batch_time,
+            .run_in_worker = true,
+        },
+    };
+
+    for (size_t i = 0; i < sizeof(bindings) / sizeof(bindings[0]); i++)
+    {
+        (void)hq_cmd_register(&bindings[i]);
+    }
+}
@@ -0,0 +1,271 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hq_config.h"
+#include "hq_cmd.h"
+#include "hq_cmd_internal.h"
+#include "osal_bin_sem.h"
+#include "osal_mutex.h"
+#include "osal_queue.h"
+#include "osal_task.h"
+
+#define BENCH_DEFAULT_ITERATIONS 10000U
+/* Iterations between checks for Ctrl-C */
+#define BENCH_CANCEL_CHECK       1024U
+
+typedef bool (*bench_fn_t)(uint32_t iterations, uint64_t *elapsed_us);
+
+/* Ping-pong partner for the context switch benchmark */
+typedef struct
+{
+    osal_bin_sem_id_t ping;
+    osal_bin_sem_id_t pong;
+    bool stop;
+} bench_switch_t;
+
+static bool bench_mutex(uint32_t iterations, uint64_t *elapsed_us)
+{
+    osal_mutex_id_t mutex;
+    uint64_t start;
+    uint32_t i;
+
+    if (osal_mutex_create(&mutex, "bench_mutex") != OSAL_SUCCESS)
+    {
+        return false;
+    }
+
+    start = osal_task_get_time_us();
+    for (i = 0; i < iterations; i++)
+    {
+        (void)osal_mutex_take(mutex);
+        (void)osal_mutex_give(mutex);
+        if ((i % BENCH_CANCEL_CHECK) == 0U && hq_cmd_cancelled())
+        {
+            break;
+        }
+    }
+    *elapsed_us = osal_task_get_time_us() - start;
+
+    (void)osal_mutex_delete(mutex);
+    return i == iterations;
+}
+
+static bool bench_sem(uint32_t iterations, uint64_t *elapsed_us)
+{
+    osal_bin_sem_id_t sem;
+    uint64_t start;
+    uint32_t i;
+
+    if (osal_bin_sem_create(&sem, "bench_sem", OSAL_SEM_EMPTY) != OSAL_SUCCESS)
+    {
+        return false;
+    }
+
+    start = osal_task_get_time_us();
+    for (i = 0; i < iterations; i++)
+    {
+        (void)osal_bin_sem_give(sem);
+        (void)osal_bin_sem_take(sem);
+        if ((i % BENCH_CANCEL_CHECK) == 0U && hq_cmd_cancelled())
+        {
+            break;
+        }
+    }
+    *elapsed_us = osal_task_get_time_us() - start;
+
+    (void)osal_bin_sem_delete(sem);
+    return i == iterations;
+}
+
+static bool bench_queue(uint32_t iterations, uint64_t *elapsed_us)
+{
+    osal_queue_id_t queue;
+    uint32_t item = 0U;
+    uint64_t start;
+    uint32_t i;
+
+    if (osal_queue_create(&queue, "bench_queue", 1U, sizeof(item)) != OSAL_SUCCESS)
+    {
+        return false;
+    }
+
+    start = osal_task_get_time_us();
+    for (i = 0; i < iterations; i++)
+    {
+        (void)osal_queue_send(queue, &i, 0U);
+        (void)osal_queue_receive(queue, &item, 0U);
+        if ((i % BENCH_CANCEL_CHECK) == 0U && hq_cmd_cancelled())
+        {
+            break;
+        }
+    }
+    *elapsed_us = osal_task_get_time_us() - start;
+
+    (void)osal_queue_delete(queue);
+    return i == iterations;
+}
+
+static void bench_pong_task(void *arg)
+{
+    bench_switch_t *sw = (bench_switch_t *)arg;
+
+    for (;;)
+    {
+        (void)osal_bin_sem_take(sw->ping);
+        if (__atomic_load_n(&sw->stop, __ATOMIC_ACQUIRE))
+        {
+            break;
+        }
+        (void)osal_bin_sem_give(sw->pong);
+    }
+
+    /* Park until deleted; the last pong tells the benchmark we are out of
+     * the semaphores, and returning is not allowed on every OSAL port */
+    (void)osal_bin_sem_give(sw->pong);
+    for (;;)
+    {
+        osal_task_delay_ms(1000U);
+    }
+}
+
+/* Each round trip is two switches between tasks of the same priority */
+static bool bench_switch(uint32_t iterations, uint64_t *elapsed_us)
+{
+    bench_switch_t sw;
+    osal_task_id_t pong_task;
+    osal_task_attr_t attr;
+    uint64_t start;
+    uint32_t i;
+
+    sw.stop = false;
+    if (osal_bin_sem_create(&sw.ping, "bench_ping", OSAL_SEM_EMPTY) != OSAL_SUCCESS)
+    {
+        return false;
+    }
+    if (osal_bin_sem_create(&sw.pong, "bench_pong", OSAL_SEM_EMPTY) != OSAL_SUCCESS)
+    {
+        (void)osal_bin_sem_delete(sw.ping);
+        return false;
+    }
+    (void)osal_task_attributes_init(&attr);
+    if (osal_task_create(&pong_task, "bench_pong", bench_pong_task, &sw, NULL,
+                         (size_t)CONFIG_CMD_WORKER_TASK_STACK_SIZE,
+                         (osal_priority_t)CONFIG_CMD_WORKER_TASK_PRIORITY, &attr) != OSAL_SUCCESS)
+    {
+        (void)osal_bin_sem_delete(sw.pong);
+        (void)osal_bin_sem_delete(sw.ping);
+        return false;
+    }
+
+    start = osal_task_get_time_us();
+    for (i = 0; i < iterations; i++)
+    {
+        (void)osal_bin_sem_give(sw.ping);
+        (void)osal_bin_sem_take(sw.pong);
+        if ((i % BENCH_CANCEL_CHECK) == 0U && hq_cmd_cancelled())
+        {
+            break;
+        }
+    }
+    *elapsed_us = osal_task_get_time_us() - start;
+
+    /* Deleting the partner while it waits on ping would leave the
+     * semaphore in use; let it out first */
+    __atomic_store_n(&sw.stop, true, __ATOMIC_RELEASE);
+    (void)osal_bin_sem_give(sw.ping);
+    (void)osal_bin_sem_take(sw.pong);
+    (void)osal_task_delete(pong_task);
+    (void)osal_bin_sem_delete(sw.pong);
+    (void)osal_bin_sem_delete(sw.ping);
+
+    /* Per switch rather than per round trip */
+    *elapsed_us /= 2U;
+    return i == iterations;
+}
+
+static const struct
+{
+    const char *name;
+    const char *what;
+    bench_fn_t fn;
+} g_benches[] = {
+    { "mutex",  "take + give, uncontended",  bench_mutex },
+    { "sem",    "binary give + take",        bench_sem },
+    { "queue",  "send + receive, 4 bytes",   bench_queue },
+    { "switch", "task switch via semaphore", bench_switch },
+};
+
+static void hq_cmd_bench_handler(hq_cmd_cli_t *cli, char *args, void *context)
+{
+    const char *which = (args != NULL) ? hq_cmd_get_token(args, 1) : NULL;
+    const char *count = (args != NULL) ? hq_cmd_get_token(args, 2) : NULL;
+    uint32_t iterations = BENCH_DEFAULT_ITERATIONS;
+    bool found = false;
+
+    (void)cli;
+    (void)context;
+
+    if (which == NULL)
+    {
+        hq_cmd_print("Usage: bench <mutex|sem|queue|switch|all> [iterations]");
+        return;
+    }
+    if (count != NULL)
+    {
+        char *end;
+        unsigned long value = strtoul(count, &end, 10);
+
+        if (*end != '\0' || value == 0U || value > UINT32_MAX)
+        {
+            hq_cmd_print("Iterations must be a positive number");
+            return;
+        }
+        iterations = (uint32_t)value;
+    }
+
+    for (size_t i = 0; i < sizeof(g_benches) / sizeof(g_benches[0]); i++)
+    {
+        uint64_t elapsed_us = 0U;
+        uint64_t ns_per_op;
+
+        if (strcmp(which, "all") != 0 && strcmp(which, g_benches[i].name) != 0)
+        {
+            continue;
+        }
+        found = true;
+
+        if (!g_benches[i].fn(iterations, &elapsed_us))
+        {
+            hq_cmd_printf("%-7s %s", g_benches[i].name, hq_cmd_cancelled() ? "cancelled" : "failed to set up");
+            return;
+        }
+
+        ns_per_op = (elapsed_us * 1000U) / iterations;
+        hq_cmd_printf("%-7s %8u.%03u us/op  (%s, %u iterations)", g_benches[i].name,
+                      (unsigned)(ns_per_op / 1000U), (unsigned)(ns_per_op % 1000U),
+                      g_benches[i].what, (unsigned)iterations);
+        hq_cmd_flush();
+    }
+
+    if (!found)
+    {
+        hq_cmd_printf("Unknown primitive: %s", which);
+    }
+}
+
+void hq_cmd_register_bench_command(void)
+{
+    hq_cmd_binding_t bench_binding = {
+        .name = "bench",
+        .help = "Time OSAL primitives: bench <mutex|sem|queue|switch|all> [iterations]",
+        .tokenize_args = true,
+        .context = NULL,
+        .handler = hq_cmd_bench_handler,
+        .run_in_worker = true,
+    };
+
+    (void)hq_cmd_register(&bench_binding);
+}
@@ -0,0 +1,387 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hq_cmd.h"
+#include "hq_cmd_internal.h"
+#include "osal_file.h"
+#include "osal_heap.h"
+#include "osal_mount.h"
+#include "osal_mutex.h"
+#include "osal_queue.h"
+#include "osal_task.h"
+#include "osal_timer.h"
+
+/* Objects listed per command; the rest are left out */
+#define DIAG_MAX_ENTRIES     32U
+/* CPU sampling interval limit for "tasks <ms>" */
+#define DIAG_MAX_INTERVAL_MS 60000U
+#define DIAG_SLEEP_STEP_MS   100U
+
+static const char *diag_name(const char *name)
+{
+    return (name[0] != '\0') ? name : "-";
+}
+
+static uint32_t diag_arg_u32(char *args, uint16_t pos, uint32_t fallback)
+{
+    const char *token = (args != NULL) ? hq_cmd_get_token(args, pos) : NULL;
+    char *end;
+    unsigned long value;
+
+    if (token == NULL)
+    {
+        return fallback;
+    }
+    value = strtoul(token, &end, 10);
+    return (*end == '\0' && value <= UINT32_MAX) ? (uint32_t)value : fallback;
+}
+
+/* ── tasks ─────────────────────────────────────────────────────────── */
+
+static bool diag_sleep(uint32_t ms)
+{
+    while (ms > 0U)
+    {
+        uint32_t step = (ms < DIAG_SLEEP_STEP_MS) ? ms : DIAG_SLEEP_STEP_MS;
+
+        if (hq_cmd_cancelled())
+        {
+            return false;
+        }
+        (void)osal_task_delay_ms(step);
+        ms -= step;
+    }
+    return !hq_cmd_cancelled();
+}
+
+/* Task names need not be unique; each earlier entry is matched once. */
+static const osal_task_stats_t *diag_find_task(const osal_task_stats_t *tasks, uint32_t count,
+                                               bool *used, const char *name)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (!used[i] && strcmp(tasks[i].name, name) == 0)
+        {
+            used[i] = true;
+            return &tasks[i];
+        }
+    }
+    return NULL;
+}
+
+static void hq_cmd_diag_tasks(hq_cmd_cli_t *cli, char *args, void *context)
+{
+    uint32_t interval_ms = diag_arg_u32(args, 1, 0U);
+    osal_task_stats_t *before = NULL;
+    osal_task_stats_t *after;
+    bool used[DIAG_MAX_ENTRIES] = { false };
+    uint32_t before_count = 0U;
+    uint32_t count = 0U;
+    osal_status_t status;
+
+    (void)cli;
+    (void)context;
+
+    if (interval_ms > DIAG_MAX_INTERVAL_MS)
+    {
+        interval_ms = DIAG_MAX_INTERVAL_MS;
+    }
+
+    after = (osal_task_stats_t *)malloc(2U * DIAG_MAX_ENTRIES * sizeof(*after));
+    if (after == NULL)
+    {
+        hq_cmd_print("Out of memory");
+        return;
+    }
+
+    if (interval_ms > 0U)
+    {
+        before = after + DIAG_MAX_ENTRIES;
+        if (osal_task_get_stats(before, DIAG_MAX_ENTRIES, &before_count) != OSAL_SUCCESS ||
+            !diag_sleep(interval_ms))
+        {
+            free(after);
+            return;
+        }
+    }
+
+    status = osal_task_get_stats(after, DIAG_MAX_ENTRIES, &count);
+    if (status != OSAL_SUCCESS)
+    {
+        hq_cmd_printf("Task statistics not available: %s", osal_get_status_name(status));
+        free(after);
+        return;
+    }
+
+    hq_cmd_printf("%-20s %4s %8s %8s %10s%s", "NAME", "PRIO", "STACK", "STK-FREE", "CPU-MS",
+                  (interval_ms > 0U) ? "   CPU%" : "");
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const osal_task_stats_t *task = &after[i];
+        char stack[12] = "-";
+        char stack_free[12] = "-";
+        char load[12] = "";
+
+        if (task->stack_size > 0U)
+        {
+            snprintf(stack, sizeof(stack), "%u", (unsigned)task->stack_size);
+        }
+        if (task->stack_free_min > 0U)
+        {
+            snprintf(stack_free, sizeof(stack_free), "%u", (unsigned)task->stack_free_min);
+        }
+        if (before != NULL)
+        {
+            const osal_task_stats_t *prev = diag_find_task(before, before_count, used, task->name);
+            uint64_t busy_us = task->cpu_time_us - ((prev != NULL) ? prev->cpu_time_us : 0U);
+            uint64_t tenths = (busy_us * 1000U) / ((uint64_t)interval_ms * 1000U);
+
+            snprintf(load, sizeof(load), " %5u.%u", (unsigned)(tenths / 10U), (unsigned)(tenths % 10U));
+        }
+
+        hq_cmd_printf("%-20s %4u %8s %8s %10" PRIu64 "%s", diag_name(task->name), (unsigned)task->priority,
+                      stack, stack_free, task->cpu_time_us / 1000U, load);
+    }
+
+    free(after);
+}
+
+/* ── queues ────────────────────────────────────────────────────────── */
+
+static void hq_cmd_diag_queues(hq_cmd_cli_t *cli, char *args, void *context)
+{
+    osal_queue_stats_t *queues;
+    uint32_t count = 0U;
+
+    (void)cli;
+    (void)args;
+    (void)context;
+
+    queues = (osal_queue_stats_t *)malloc(DIAG_MAX_ENTRIES * sizeof(*queues));
+    if (queues == NULL)
+    {
+        hq_cmd_print("Out of memory");
+        return;
+    }
+
+    (void)osal_queue_get_stats(queues, DIAG_MAX_ENTRIES, &count);
+    /* A queue that senders wait on or fail to send to is too small, or
+     * drained too slowly; receivers waiting is the normal idle state */
+    hq_cmd_printf("%-20s %5s %5s %5s %5s %10s %10s %8s %8s %10s %10s", "NAME", "DEPTH", "MAX", "HIGH", "ITEM",
+                  "SENDS", "RECEIVES", "FULL", "EMPTY", "SWAIT_MS", "RWAIT_MS");
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const osal_queue_stats_t *queue = &queues[i];
+
+        hq_cmd_printf("%-20s %5u %5u %5u %5u %10" PRIu64 " %10" PRIu64 " %8" PRIu64 " %8" PRIu64 " %10" PRIu64
+                      " %10" PRIu64, diag_name(queue->name), (unsigned)queue->count, (unsigned)queue->max_items,
+                      (unsigned)queue->high_water, (unsigned)queue->item_size, queue->sends, queue->receives,
+                      queue->send_full, queue->receive_empty, queue->send_wait_us / 1000U,
+                      queue->receive_wait_us / 1000U);
+    }
+
+    free(queues);
+}
+
+/* ── timers ────────────────────────────────────────────────────────── */
+
+static void hq_cmd_diag_timers(hq_cmd_cli_t *cli, char *args, void *context)
+{
+    osal_timer_stats_t *timers;
+    uint32_t count = 0U;
+
+    (void)cli;
+    (void)args;
+    (void)context;
+
+    timers = (osal_timer_stats_t *)malloc(DIAG_MAX_ENTRIES * sizeof(*timers));
+    if (timers == NULL)
+    {
+        hq_cmd_print("Out of memory");
+        return;
+    }
+
+    (void)osal_timer_get_stats(timers, DIAG_MAX_ENTRIES, &count);
+    hq_cmd_printf("%-20s %9s %4s %9s %9s %8s", "NAME", "PERIOD-MS", "MODE", "NEXT-MS", "EXPIRED", "OVERRUNS");
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const osal_timer_stats_t *timer = &timers[i];
+        char next[12] = "-";
+
+        if (timer->active)
+        {
+            snprintf(next, sizeof(next), "%u", (unsigned)timer->next_ms);
+        }
+        hq_cmd_printf("%-20s %9u %4s %9s %9u %8u", diag_name(timer->name), (unsigned)timer->period_ms,
+                      timer->auto_reload ? "auto" : "once", next, (unsigned)timer->expirations,
+                      (unsigned)timer->overruns);
+    }
+
+    free(timers);
+}
+
+/* ── locks ─────────────────────────────────────────────────────────── */
+
+static void hq_cmd_diag_locks(hq_cmd_cli_t *cli, char *args, void *context)
+{
+    osal_mutex_stats_t *locks;
+    uint32_t count = 0U;
+
+    (void)cli;
+    (void)args;
+    (void)context;
+
+    locks = (osal_mutex_stats_t *)malloc(DIAG_MAX_ENTRIES * sizeof(*locks));
+    if (locks == NULL)
+    {
+        hq_cmd_print("Out of memory");
+        return;
+    }
+
+    (void)osal_mutex_get_stats(locks, DIAG_MAX_ENTRIES, &count);
+
+    /* Most time spent waiting first */
+    for (uint32_t i = 1; i < count; i++)
+    {
+        osal_mutex_stats_t lock = locks[i];
+        uint32_t j = i;
+
+        while (j > 0U && locks[j - 1U].wait_us < lock.wait_us)
+        {
+            locks[j] = locks[j - 1U];
+            j--;
+        }
+        locks[j] = lock;
+    }
+
+    hq_cmd_printf("%-20s %10s %10s %10s %8s", "NAME", "TAKES", "CONTENDED", "WAIT-US", "MAX-US");
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const osal_mutex_stats_t *lock = &locks[i];
+
+        hq_cmd_printf("%-20s %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %8u", diag_name(lock->name), lock->takes,
+                      lock->contended, lock->wait_us, (unsigned)lock->wait_max_us);
+    }
+
+    free(locks);
+}
+
+/* ── fs ────────────────────────────────────────────────────────────── */
+
+static void hq_cmd_diag_fs(hq_cmd_cli_t *cli, char *args, void *context)
+{
+    osal_statvfs_t volume;
+    osal_blockdev_stats_t device;
+    osal_file_stats_t files;
+
+    (void)cli;
+    (void)args;
+    (void)context;
+
+    if (osal_filesys_stat_volume("/", &volume) == OSAL_SUCCESS && volume.total_blocks > 0U)
+    {
+        size_t used = volume.total_blocks - volume.blocks_free;
+
+        hq_cmd_printf("Volume: %u of %u blocks used (%u%%), %u bytes per block",
+                      (unsigned)used, (unsigned)volume.total_blocks,
+                      (unsigned)((used * 100U) / volume.total_blocks), (unsigned)volume.block_size);
+    }
+    else
+    {
+        hq_cmd_print("Volume: not mounted");
+    }
+
+    if (osal_filesys_get_blockdev_stats(&device) == OSAL_SUCCESS)
+    {
+        hq_cmd_printf("Device: %" PRIu64 " reads (%" PRIu64 " bytes), %" PRIu64 " programs (%" PRIu64 " bytes)",
+                      device.reads, device.read_bytes, device.progs, device.prog_bytes);
+        hq_cmd_printf("        %" PRIu64 " erases, %" PRIu64 " syncs", device.erases, device.syncs);
+    }
+
+    if (osal_file_get_stats(&files) == OSAL_SUCCESS)
+    {
+        hq_cmd_printf("Files:  %" PRIu64 " opens (%" PRIu64 " failed), %" PRIu64 " reads (%" PRIu64 " bytes)",
+                      files.opens, files.open_errors, files.reads, files.read_bytes);
+        hq_cmd_printf("        %" PRIu64 " writes (%" PRIu64 " bytes), %" PRIu64 " errors",
+                      files.writes, files.write_bytes, files.io_errors);
+    }
+}
+
+/* ── mem ───────────────────────────────────────────────────────────── */
+
+static void hq_cmd_diag_mem(hq_cmd_cli_t *cli, char *args, void *context)
+{
+    osal_heap_stats_t heap;
+    osal_status_t status;
+
+    (void)cli;
+    (void)args;
+    (void)context;
+
+    status = osal_heap_get_stats(&heap);
+    if (status != OSAL_SUCCESS)
+    {
+        hq_cmd_printf("Heap statistics not available: %s", osal_get_status_name(status));
+        return;
+    }
+
+    hq_cmd_printf("Heap: %u of %u bytes used (%u%%), %u free", (unsigned)heap.used, (unsigned)heap.total,
+                  (heap.total > 0U) ? (unsigned)(((uint64_t)heap.used * 100U) / heap.total) : 0U,
+                  (unsigned)heap.free);
+    if (heap.free_min > 0U)
+    {
+        hq_cmd_printf("Least free: %u bytes", (unsigned)heap.free_min);
+    }
+    if (heap.largest_free > 0U)
+    {
+        hq_cmd_printf("Largest free block: %u bytes", (unsigned)heap.largest_free);
+    }
+}
+
+void hq_cmd_register_diag_commands(void)
+{
+    static const hq_cmd_binding_t bindings[] = {
+        {
+            .name = "tasks",
+            .help = "List tasks; tasks <ms> also samples CPU use for that long",
+            .tokenize_args = true,
+            .handler = hq_cmd_diag_tasks,
+            .run_in_worker = true,
+        },
+        {
+            .name = "queues",
+            .help = "List queues with depth, high-water mark and throughput",
+            .handler = hq_cmd_diag_queues,
+        },
+        {
+            .name = "timers",
+            .help = "List timers with next expiry and overruns",
+            .handler = hq_cmd_diag_timers,
+        },
+        {
+            .name = "locks",
+            .help = "List mutexes by time spent waiting for them",
+            .handler = hq_cmd_diag_locks,
+        },
+        {
+            .name = "fs",
+            .help = "Show volume usage and file system I/O counters",
+            .handler = hq_cmd_diag_fs,
+        },
+        {
+            .name = "mem",
+            .help = "Show heap usage",
+            .handler = hq_cmd_diag_mem,
+        },
+    };
+
+    for (size_t i = 0; i < sizeof(bindings) / sizeof(bindings[0]); i++)
+    {
+        (void)hq_cmd_register(&bindings[i]);
+    }
+}
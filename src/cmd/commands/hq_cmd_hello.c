@@ -1,6 +1,7 @@
 #include <stddef.h>
 
 #include "hq_cmd.h"
+#include "hq_cmd_internal.h"
 
 static void hq_cmd_hello_handler(hq_cmd_cli_t *cli, char *args, void *context)
 {
@@ -33,4 +34,8 @@ void hq_cmd_register_builtin_commands(void)
     };
 
     (void)hq_cmd_register(&hello_binding);
+
+    hq_cmd_register_diag_commands();
+    hq_cmd_register_bench_command();
+    hq_cmd_register_batch_commands();
 }
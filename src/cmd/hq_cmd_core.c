@@ -1,6 +1,10 @@
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "hq_config.h"
 #include "hq_cmd.h"
@@ -8,12 +12,85 @@
 #include "osal_task.h"
 #include "osal_bin_sem.h"
 #include "osal_log.h"
+#include "osal_mutex.h"
+
+/* Bytes read per burst; at most half the RX buffer so none are dropped */
+#define CMD_INPUT_CHUNK   (CONFIG_CMD_RX_BUFFER_SIZE / 2)
+/* Upper bound on an input wait when the platform cannot be woken */
+#define CMD_INPUT_WAIT_MS 1000U
+/* Ctrl-C: cancels the session's worker command */
+#define CMD_CANCEL_CHAR   '\x03'
+/* Commands run from commands (run, repeat, time) nest at most this deep */
+#define CMD_EXEC_MAX_DEPTH 4U
+/* Slots of the command name index; kept at most half full so probes stay short */
+#define CMD_HASH_SIZE     (2U * CONFIG_CMD_MAX_BINDING_COUNT)
 
 static osal_task_id_t    g_input_task_id;
 static osal_bin_sem_id_t g_stop_done_sem;
 static osal_bin_sem_id_t g_stop_request_sem;
 
-static EmbeddedCli *g_cli = NULL;
+/* A command handed to a worker, with its arguments copied out of the
+ * line editor so the session can take new input meanwhile. */
+typedef struct
+{
+    bool busy;
+    bool cancel;    /* set by Ctrl-C or close, read by the worker */
+    hq_cmd_handler_t handler;
+    void *context;
+    char *args;     /* NULL or points into args_buf */
+    char args_buf[CONFIG_CMD_BUFFER_SIZE + 2];
+} hq_cmd_job_t;
+
+/* One line editor with its own output buffer; output is written in blocks
+ * instead of one call per character. The lock is held while input is
+ * processed and while a worker prints. */
+struct hq_cmd_session
+{
+    EmbeddedCli *cli;
+    hq_cmd_write_t write;
+    void *ctx;
+    osal_mutex_id_t lock;
+    uint32_t refs;      /* the owner, plus one while a job is queued or running */
+    bool closed;
+    hq_cmd_job_t job;
+    size_t out_len;
+    char out_buf[CONFIG_CMD_OUTPUT_BUFFER_SIZE];
+};
+
+/* Handler of a command registered with run_in_worker */
+typedef struct
+{
+    hq_cmd_handler_t handler;
+    void *context;
+    bool tokenize_args;
+} hq_cmd_worker_binding_t;
+
+static hq_cmd_session_t g_console;
+static EmbeddedCli *g_cli = NULL;    /* g_console.cli once initialised */
+
+/* Commands registered so far; copied into every session opened later */
+static CliCommandBinding g_bindings[CONFIG_CMD_MAX_BINDING_COUNT];
+static uint16_t g_binding_count;
+static hq_cmd_worker_binding_t g_worker_bindings[CONFIG_CMD_MAX_BINDING_COUNT];
+static bool g_workers_started;
+/* Open-addressed index of g_bindings by name: 0 is empty, else index + 1 */
+static uint16_t g_binding_index[CMD_HASH_SIZE];
+
+/* Where hq_cmd_execute() sends the output of the command it runs */
+typedef struct
+{
+    hq_cmd_write_t write;
+    void *ctx;
+} hq_cmd_capture_t;
+
+/* Session whose command this task is running; hq_cmd_print() goes there.
+ * Its lock is held unless the task is a worker, which has t_job set. */
+static __thread hq_cmd_session_t *t_session;
+static __thread hq_cmd_job_t *t_job;
+/* Nesting of hq_cmd_exec_line() on this task */
+static __thread uint32_t t_exec_depth;
+/* Set while hq_cmd_execute() runs a command on this task */
+static __thread const hq_cmd_capture_t *t_capture;
 
 static void hq_cmd_on_unknown(EmbeddedCli *cli, CliCommand *command)
 {
@@ -27,32 +104,211 @@ static void hq_cmd_on_unknown(EmbeddedCli *cli, CliCommand *command)
     hq_cmd_print("Unknown command. Use 'help' to list available commands.\r\n");
 }
 
+static void hq_cmd_session_flush(hq_cmd_session_t *session)
+{
+    if (session->out_len > 0U)
+    {
+        session->write(session->ctx, session->out_buf, session->out_len);
+        session->out_len = 0U;
+    }
+}
+
 static void hq_cmd_write_char_adapter(EmbeddedCli *cli, char c)
 {
-    (void)cli;
-    hq_cmd_platform_write_char(c);
+    hq_cmd_session_t *session = (hq_cmd_session_t *)cli->appContext;
+
+    session->out_buf[session->out_len++] = c;
+    if (session->out_len == sizeof(session->out_buf))
+    {
+        hq_cmd_session_flush(session);
+    }
 }
 
-static void hq_cmd_input_task(void *arg)
+static void hq_cmd_console_write(void *ctx, const char *data, size_t len)
 {
-    (void)arg;
+    (void)ctx;
+    hq_cmd_platform_write_buf(data, len);
+}
+
+/* FNV-1a */
+static uint32_t hq_cmd_hash(const char *name)
+{
+    uint32_t hash = 2166136261U;
+
+    while (*name != '\0')
+    {
+        hash = (hash ^ (uint8_t)*name++) * 16777619U;
+    }
+    return hash;
+}
+
+/* Slot holding @p name, or the empty slot where it would go */
+static uint32_t hq_cmd_index_slot(const char *name)
+{
+    uint32_t slot = hq_cmd_hash(name) % CMD_HASH_SIZE;
+
+    while (g_binding_index[slot] != 0U &&
+           strcmp(g_bindings[g_binding_index[slot] - 1U].name, name) != 0)
+    {
+        slot = (slot + 1U) % CMD_HASH_SIZE;
+    }
+    return slot;
+}
+
+static void hq_cmd_bindings_clear(void)
+{
+    g_binding_count = 0;
+    memset(g_binding_index, 0, sizeof(g_binding_index));
+}
+
+static EmbeddedCli *hq_cmd_new_cli(hq_cmd_session_t *session)
+{
+    EmbeddedCliConfig *cfg = embeddedCliDefaultConfig();
+    cfg->rxBufferSize = (uint16_t)CONFIG_CMD_RX_BUFFER_SIZE;
+    cfg->cmdBufferSize = (uint16_t)CONFIG_CMD_BUFFER_SIZE;
+    cfg->historyBufferSize = (uint16_t)CONFIG_CMD_HISTORY_BUFFER_SIZE;
+    cfg->maxBindingCount = (uint16_t)CONFIG_CMD_MAX_BINDING_COUNT;
+    cfg->enableAutoComplete = (CONFIG_CMD_ENABLE_AUTOCOMPLETE != 0);
+    cfg->invitation = CONFIG_CMD_INVITATION;
+
+    EmbeddedCli *cli = embeddedCliNew(cfg);
+    if (cli == NULL)
+    {
+        return NULL;
+    }
+
+    cli->appContext = session;
+    cli->writeChar = hq_cmd_write_char_adapter;
+    cli->onCommand = hq_cmd_on_unknown;
+    for (uint16_t i = 0; i < g_binding_count; i++)
+    {
+        (void)embeddedCliAddBinding(cli, g_bindings[i]);
+    }
+    return cli;
+}
+
+static void hq_cmd_session_release(hq_cmd_session_t *session)
+{
+    bool last;
+
+    (void)osal_mutex_take(session->lock);
+    last = (--session->refs == 0U);
+    (void)osal_mutex_give(session->lock);
+
+    if (last)
+    {
+        embeddedCliFree(session->cli);
+        (void)osal_mutex_delete(session->lock);
+        free(session);
+    }
+}
 
-    while (true)
+/* Called with the session locked */
+static void hq_cmd_session_receive(hq_cmd_session_t *session, char c)
+{
+    if (c != CMD_CANCEL_CHAR)
     {
-        if (osal_bin_sem_timed_wait(g_stop_request_sem, 0) == OSAL_SUCCESS)
+        embeddedCliReceiveChar(session->cli, c);
+    }
+    else if (session->job.busy && !__atomic_load_n(&session->job.cancel, __ATOMIC_RELAXED))
+    {
+        __atomic_store_n(&session->job.cancel, true, __ATOMIC_RELEASE);
+        embeddedCliPrint(session->cli, "^C");
+    }
+}
+
+/* Called with the session locked */
+static void hq_cmd_session_run(hq_cmd_session_t *session)
+{
+    /* Echo, handler output and the prompt go out together */
+    t_session = session;
+    embeddedCliProcess(session->cli);
+    t_session = NULL;
+    hq_cmd_session_flush(session);
+}
+
+static void hq_cmd_job_run(void *arg)
+{
+    hq_cmd_session_t *session = (hq_cmd_session_t *)arg;
+    hq_cmd_job_t *job = &session->job;
+
+    t_session = session;
+    t_job = job;
+    job->handler(session->cli, job->args, job->context);
+    t_job = NULL;
+    t_session = NULL;
+
+    (void)osal_mutex_take(session->lock);
+    if (!session->closed)
+    {
+        hq_cmd_session_flush(session);
+    }
+    job->busy = false;
+    (void)osal_mutex_give(session->lock);
+
+    hq_cmd_session_release(session);
+}
+
+/* Binding of every run_in_worker command: queues the job and returns, so the
+ * prompt comes back while the command runs */
+static void hq_cmd_worker_dispatch(EmbeddedCli *cli, char *args, void *context)
+{
+    hq_cmd_session_t *session = (hq_cmd_session_t *)cli->appContext;
+    const hq_cmd_worker_binding_t *binding = (const hq_cmd_worker_binding_t *)context;
+    hq_cmd_job_t *job = &session->job;
+
+    if (job->busy)
+    {
+        hq_cmd_print("Still running the previous command; Ctrl-C cancels it.");
+        return;
+    }
+
+    job->args = NULL;
+    if (args != NULL)
+    {
+        /* Tokenized arguments end with two NULs */
+        size_t len = strlen(args);
+        while (binding->tokenize_args && len + 1U < sizeof(job->args_buf) - 2U && args[len + 1U] != '\0')
         {
-            break;
+            len += 1U + strlen(&args[len + 1U]);
         }
-
-        int c = hq_cmd_platform_read_char();
-        if (c >= 0)
+        if (len > sizeof(job->args_buf) - 2U)
         {
-            hq_cmd_receive_char((char)c);
-            hq_cmd_process();
+            len = sizeof(job->args_buf) - 2U;
         }
-        else
+        memcpy(job->args_buf, args, len);
+        job->args_buf[len] = '\0';
+        job->args_buf[len + 1U] = '\0';
+        job->args = job->args_buf;
+    }
+    job->handler = binding->handler;
+    job->context = binding->context;
+    job->cancel = false;
+    job->busy = true;
+    session->refs++;
+
+    if (!hq_cmd_worker_post(hq_cmd_job_run, session))
+    {
+        job->busy = false;
+        session->refs--;
+        hq_cmd_print("All command workers are busy, try again later.");
+    }
+}
+
+static void hq_cmd_input_task(void *arg)
+{
+    char buf[CMD_INPUT_CHUNK];
+
+    (void)arg;
+
+    while (osal_bin_sem_timed_wait(g_stop_request_sem, 0) != OSAL_SUCCESS)
+    {
+        /* Sleeps until input arrives or hq_cmd_stop() wakes it; a pasted
+         * line is handled as one burst. */
+        size_t len = hq_cmd_platform_read(buf, sizeof(buf), CMD_INPUT_WAIT_MS);
+        if (len > 0U)
         {
-            osal_task_delay_ms(10);
+            hq_cmd_session_input(&g_console, buf, len);
         }
     }
 
@@ -60,6 +316,24 @@ static void hq_cmd_input_task(void *arg)
     (void)osal_task_delete(g_input_task_id);
 }
 
+static void hq_cmd_console_free(void)
+{
+    embeddedCliFree(g_cli);
+    g_cli = NULL;
+    g_console.cli = NULL;
+    (void)osal_mutex_delete(g_console.lock);
+}
+
+/* Stops the pool started by the first worker command, if any */
+static void hq_cmd_workers_stop(void)
+{
+    if (g_workers_started)
+    {
+        hq_cmd_worker_stop();
+        g_workers_started = false;
+    }
+}
+
 int32_t hq_cmd_init(void)
 {
     osal_status_t status;
@@ -68,33 +342,38 @@ int32_t hq_cmd_init(void)
         return 0;
     }
 
-    hq_cmd_platform_output_init();
+    hq_cmd_platform_init();
 
-    EmbeddedCliConfig *cfg = embeddedCliDefaultConfig();
-    cfg->rxBufferSize = (uint16_t)CONFIG_CMD_RX_BUFFER_SIZE;
-    cfg->cmdBufferSize = (uint16_t)CONFIG_CMD_BUFFER_SIZE;
-    cfg->historyBufferSize = (uint16_t)CONFIG_CMD_HISTORY_BUFFER_SIZE;
-    cfg->maxBindingCount = (uint16_t)CONFIG_CMD_MAX_BINDING_COUNT;
-    cfg->enableAutoComplete = (CONFIG_CMD_ENABLE_AUTOCOMPLETE != 0);
-    cfg->invitation = CONFIG_CMD_INVITATION;
-
-    g_cli = embeddedCliNew(cfg);
+    if ((status = osal_mutex_create(&g_console.lock, "cmd_console")) != OSAL_SUCCESS)
+    {
+        osal_log_error("Failed to create console lock %s", osal_get_status_name(status));
+        hq_cmd_platform_deinit();
+        return -1;
+    }
+    g_console.write = hq_cmd_console_write;
+    g_console.ctx = NULL;
+    g_console.refs = 1U;
+    g_console.closed = false;
+    g_console.out_len = 0U;
+    g_cli = hq_cmd_new_cli(&g_console);
     if (g_cli == NULL)
     {
         osal_log_error("Failed to create CLI instance");
+        (void)osal_mutex_delete(g_console.lock);
+        hq_cmd_platform_deinit();
         return -1;
     }
-
-    g_cli->writeChar = hq_cmd_write_char_adapter;
-    g_cli->onCommand = hq_cmd_on_unknown;
+    g_console.cli = g_cli;
 
     hq_cmd_register_builtin_commands();
 
     if ((status = osal_bin_sem_create(&g_stop_done_sem, "cmd_stop_done", OSAL_SEM_EMPTY)) != OSAL_SUCCESS)
     {
         osal_log_error("Failed to create stop done semaphore %s", osal_get_status_name(status));
-        embeddedCliFree(g_cli);
-        g_cli = NULL;
+        hq_cmd_workers_stop();
+        hq_cmd_console_free();
+        hq_cmd_bindings_clear();
+        hq_cmd_platform_deinit();
         return -1;
     }
 
@@ -102,8 +381,10 @@ int32_t hq_cmd_init(void)
     {
         osal_log_error("Failed to create stop request semaphore %s", osal_get_status_name(status));
         (void)osal_bin_sem_delete(g_stop_done_sem);
-        embeddedCliFree(g_cli);
-        g_cli = NULL;
+        hq_cmd_workers_stop();
+        hq_cmd_console_free();
+        hq_cmd_bindings_clear();
+        hq_cmd_platform_deinit();
         return -1;
     }
 
@@ -119,8 +400,10 @@ int32_t hq_cmd_init(void)
         osal_log_error("Failed to create input task %s", osal_get_status_name(status));
         (void)osal_bin_sem_delete(g_stop_request_sem);
         (void)osal_bin_sem_delete(g_stop_done_sem);
-        embeddedCliFree(g_cli);
-        g_cli = NULL;
+        hq_cmd_workers_stop();
+        hq_cmd_console_free();
+        hq_cmd_bindings_clear();
+        hq_cmd_platform_deinit();
         return -1;
     }
 
@@ -139,13 +422,22 @@ void hq_cmd_deinit(void)
     (void)osal_bin_sem_delete(g_stop_request_sem);
     (void)osal_bin_sem_delete(g_stop_done_sem);
 
-    embeddedCliFree(g_cli);
-    g_cli = NULL;
+    /* Ask a running console command to stop, then wait for every worker */
+    __atomic_store_n(&g_console.job.cancel, true, __ATOMIC_RELEASE);
+    hq_cmd_workers_stop();
+
+    hq_cmd_session_flush(&g_console);
+    hq_cmd_platform_deinit();
+    hq_cmd_console_free();
+
+    /* Registered again by the next hq_cmd_init() */
+    hq_cmd_bindings_clear();
 }
 
 void hq_cmd_stop(void)
 {
     (void)osal_bin_sem_give(g_stop_request_sem);
+    hq_cmd_platform_wake();
 }
 
 void hq_cmd_wait(void)
@@ -169,7 +461,9 @@ void hq_cmd_process(void)
         return;
     }
 
-    embeddedCliProcess(g_cli);
+    (void)osal_mutex_take(g_console.lock);
+    hq_cmd_session_run(&g_console);
+    (void)osal_mutex_give(g_console.lock);
 }
 
 void hq_cmd_receive_char(char c)
@@ -179,27 +473,340 @@ void hq_cmd_receive_char(char c)
         return;
     }
 
-    embeddedCliReceiveChar(g_cli, c);
+    (void)osal_mutex_take(g_console.lock);
+    hq_cmd_session_receive(&g_console, c);
+    (void)osal_mutex_give(g_console.lock);
+}
+
+/* Session hq_cmd_print() writes to, locked unless this task holds it
+ * already; NULL if there is nowhere to print. */
+static hq_cmd_session_t *hq_cmd_output_begin(void)
+{
+    hq_cmd_session_t *session = (t_session != NULL) ? t_session : &g_console;
+
+    if (session->cli == NULL)
+    {
+        return NULL;
+    }
+    if (t_session == NULL || t_job != NULL)
+    {
+        (void)osal_mutex_take(session->lock);
+        if (session->closed)
+        {
+            (void)osal_mutex_give(session->lock);
+            return NULL;
+        }
+    }
+    return session;
+}
+
+static void hq_cmd_output_end(hq_cmd_session_t *session, bool flush)
+{
+    if (t_session == NULL || t_job != NULL)
+    {
+        /* Outside command processing output goes out right away; a worker
+         * streams it as it prints */
+        hq_cmd_session_flush(session);
+        (void)osal_mutex_give(session->lock);
+    }
+    else if (flush)
+    {
+        hq_cmd_session_flush(session);
+    }
 }
 
 void hq_cmd_print(const char *text)
 {
-    if (g_cli == NULL || text == NULL)
+    hq_cmd_session_t *session;
+
+    if (text == NULL)
     {
         return;
     }
+    if (t_capture != NULL)
+    {
+        /* Plain lines for a program rather than a terminal */
+        if (t_capture->write != NULL)
+        {
+            t_capture->write(t_capture->ctx, text, strlen(text));
+            t_capture->write(t_capture->ctx, "\n", 1U);
+        }
+        return;
+    }
+    if ((session = hq_cmd_output_begin()) == NULL)
+    {
+        return;
+    }
+
+    embeddedCliPrint(session->cli, text);
+    hq_cmd_output_end(session, false);
+}
+
+void hq_cmd_printf(const char *fmt, ...)
+{
+    char line[HQ_CMD_PRINTF_MAX];
+    va_list ap;
+
+    if (fmt == NULL)
+    {
+        return;
+    }
+
+    va_start(ap, fmt);
+    (void)vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+
+    hq_cmd_print(line);
+}
+
+void hq_cmd_flush(void)
+{
+    hq_cmd_session_t *session;
+
+    /* Captured output is not buffered */
+    if (t_capture == NULL && (session = hq_cmd_output_begin()) != NULL)
+    {
+        hq_cmd_output_end(session, true);
+    }
+}
+
+bool hq_cmd_cancelled(void)
+{
+    return t_job != NULL && __atomic_load_n(&t_job->cancel, __ATOMIC_ACQUIRE);
+}
+
+hq_cmd_session_t *hq_cmd_session_open(hq_cmd_write_t write, void *ctx)
+{
+    hq_cmd_session_t *session;
+
+    if (write == NULL || (session = calloc(1, sizeof(*session))) == NULL)
+    {
+        return NULL;
+    }
+
+    session->write = write;
+    session->ctx = ctx;
+    session->refs = 1U;
+    if (osal_mutex_create(&session->lock, "cmd_session") != OSAL_SUCCESS)
+    {
+        free(session);
+        return NULL;
+    }
+    session->cli = hq_cmd_new_cli(session);
+    if (session->cli == NULL)
+    {
+        (void)osal_mutex_delete(session->lock);
+        free(session);
+        return NULL;
+    }
+
+    /* Show the prompt */
+    (void)osal_mutex_take(session->lock);
+    hq_cmd_session_run(session);
+    (void)osal_mutex_give(session->lock);
+    return session;
+}
+
+void hq_cmd_session_input(hq_cmd_session_t *session, const char *data, size_t len)
+{
+    if (session == NULL || data == NULL)
+    {
+        return;
+    }
+
+    /* In pieces the RX buffer can hold */
+    (void)osal_mutex_take(session->lock);
+    while (len > 0U)
+    {
+        size_t n = (len < CMD_INPUT_CHUNK) ? len : CMD_INPUT_CHUNK;
+
+        for (size_t i = 0; i < n; i++)
+        {
+            hq_cmd_session_receive(session, data[i]);
+        }
+        hq_cmd_session_run(session);
+        data += n;
+        len -= n;
+    }
+    (void)osal_mutex_give(session->lock);
+}
+
+void hq_cmd_session_close(hq_cmd_session_t *session)
+{
+    if (session == NULL)
+    {
+        return;
+    }
+
+    /* A worker still running a command of this session frees it when done */
+    (void)osal_mutex_take(session->lock);
+    session->closed = true;
+    __atomic_store_n(&session->job.cancel, true, __ATOMIC_RELEASE);
+    (void)osal_mutex_give(session->lock);
+
+    hq_cmd_session_release(session);
+}
+
+static const CliCommandBinding *hq_cmd_find_binding(const char *name)
+{
+    uint16_t entry = g_binding_index[hq_cmd_index_slot(name)];
+
+    return (entry != 0U) ? &g_bindings[entry - 1U] : NULL;
+}
+
+int32_t hq_cmd_exec_line(const char *line)
+{
+    /* Room for the second NUL that ends tokenized arguments */
+    char buf[CONFIG_CMD_BUFFER_SIZE + 2];
+    const CliCommandBinding *binding;
+    hq_cmd_session_t *session;
+    hq_cmd_handler_t handler;
+    void *context;
+    bool tokenize;
+    char *args;
+    size_t len;
+
+    if (line == NULL)
+    {
+        return -1;
+    }
+    while (*line == ' ')
+    {
+        line++;
+    }
+    len = strlen(line);
+    while (len > 0U && (line[len - 1U] == ' ' || line[len - 1U] == '\r' || line[len - 1U] == '\n'))
+    {
+        len--;
+    }
+    if (len == 0U)
+    {
+        return 0;
+    }
+    if (len > CONFIG_CMD_BUFFER_SIZE)
+    {
+        hq_cmd_print("Command line too long");
+        return -1;
+    }
+    if (t_exec_depth >= CMD_EXEC_MAX_DEPTH)
+    {
+        hq_cmd_print("Commands nested too deep");
+        return -1;
+    }
+
+    memcpy(buf, line, len);
+    buf[len] = '\0';
+    buf[len + 1U] = '\0';
+    args = strchr(buf, ' ');
+    if (args != NULL)
+    {
+        *args++ = '\0';
+        while (*args == ' ')
+        {
+            args++;
+        }
+        if (*args == '\0')
+        {
+            args = NULL;
+        }
+    }
 
-    embeddedCliPrint(g_cli, text);
+    binding = hq_cmd_find_binding(buf);
+    if (binding == NULL)
+    {
+        hq_cmd_printf("Unknown command: %s", buf);
+        return -1;
+    }
+    handler = binding->binding;
+    context = binding->context;
+    tokenize = binding->tokenizeArgs;
+    if (handler == hq_cmd_worker_dispatch)
+    {
+        /* The caller waits for the command anyway */
+        const hq_cmd_worker_binding_t *worker = (const hq_cmd_worker_binding_t *)context;
+        handler = worker->handler;
+        context = worker->context;
+        tokenize = worker->tokenize_args;
+    }
+    if (args != NULL && tokenize)
+    {
+        embeddedCliTokenizeArgs(args);
+    }
+
+    session = (t_session != NULL) ? t_session : &g_console;
+    t_exec_depth++;
+    handler(session->cli, args, context);
+    t_exec_depth--;
+    return 0;
+}
+
+int32_t hq_cmd_execute(const char *line, hq_cmd_write_t output, void *ctx)
+{
+    const hq_cmd_capture_t *outer = t_capture;
+    hq_cmd_capture_t capture = { output, ctx };
+    int32_t rc;
+
+    t_capture = &capture;
+    rc = hq_cmd_exec_line(line);
+    t_capture = outer;
+    return rc;
+}
+
+void hq_cmd_buffer_write(void *ctx, const char *data, size_t len)
+{
+    hq_cmd_buffer_t *buffer = (hq_cmd_buffer_t *)ctx;
+    size_t room;
+
+    if (buffer == NULL || buffer->data == NULL || buffer->size == 0U)
+    {
+        return;
+    }
+
+    room = buffer->size - 1U - buffer->len;
+    if (len > room)
+    {
+        len = room;
+        buffer->truncated = true;
+    }
+    memcpy(&buffer->data[buffer->len], data, len);
+    buffer->len += len;
+    buffer->data[buffer->len] = '\0';
+}
+
+bool hq_cmd_post(void (*fn)(void *arg), void *arg)
+{
+    if (!g_workers_started)
+    {
+        if (hq_cmd_worker_start() != 0)
+        {
+            return false;
+        }
+        g_workers_started = true;
+    }
+    return hq_cmd_worker_post(fn, arg);
 }
 
 int32_t hq_cmd_register_internal(const CliCommandBinding *binding)
 {
-    if (g_cli == NULL || binding == NULL)
+    if (binding == NULL || g_binding_count >= CONFIG_CMD_MAX_BINDING_COUNT)
+    {
+        return -1;
+    }
+
+    if (g_cli != NULL && !embeddedCliAddBinding(g_cli, *binding))
     {
         return -1;
     }
+    g_bindings[g_binding_count++] = *binding;
 
-    return embeddedCliAddBinding(g_cli, *binding) ? 0 : -1;
+    /* A name registered twice keeps finding the first binding, as in the
+     * line editor */
+    uint32_t slot = hq_cmd_index_slot(binding->name);
+    if (g_binding_index[slot] == 0U)
+    {
+        g_binding_index[slot] = g_binding_count;
+    }
+    return 0;
 }
 
 int32_t hq_cmd_register(const hq_cmd_binding_t *binding)
@@ -217,6 +824,30 @@ int32_t hq_cmd_register(const hq_cmd_binding_t *binding)
         .binding = binding->handler,
     };
 
+    if (binding->run_in_worker)
+    {
+        if (g_binding_count >= CONFIG_CMD_MAX_BINDING_COUNT)
+        {
+            return -1;
+        }
+        /* The pool starts with the first command that needs it */
+        if (!g_workers_started)
+        {
+            if (hq_cmd_worker_start() != 0)
+            {
+                return -1;
+            }
+            g_workers_started = true;
+        }
+
+        hq_cmd_worker_binding_t *worker = &g_worker_bindings[g_binding_count];
+        worker->handler = binding->handler;
+        worker->context = binding->context;
+        worker->tokenize_args = binding->tokenize_args;
+        cli_binding.context = worker;
+        cli_binding.binding = hq_cmd_worker_dispatch;
+    }
+
     return hq_cmd_register_internal(&cli_binding);
 }
 
@@ -0,0 +1,148 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hq_config.h"
+#include "hq_cmd.h"
+#include "hq_cmd_internal.h"
+#include "osal_file.h"
+
+/* Bytes read from the file at a time */
+#define CMD_SCRIPT_CHUNK 64U
+
+/* An open script: an OSAL file on the littlefs volume, or else a stdio one */
+typedef struct
+{
+    osal_file_id_t fd;
+    FILE *fp;
+} hq_cmd_script_t;
+
+static bool hq_cmd_script_open(hq_cmd_script_t *script, const char *path)
+{
+    script->fd = osal_open_create(path, OSAL_FILE_FLAG_NONE, OSAL_READ_ONLY);
+    script->fp = NULL;
+    if (script->fd >= 0)
+    {
+        return true;
+    }
+    script->fp = fopen(path, "r");
+    return script->fp != NULL;
+}
+
+static int32_t hq_cmd_script_read(hq_cmd_script_t *script, char *buf, size_t size)
+{
+    if (script->fp == NULL)
+    {
+        return osal_read(script->fd, buf, size);
+    }
+    size = fread(buf, 1, size, script->fp);
+    return (size > 0U || !ferror(script->fp)) ? (int32_t)size : -1;
+}
+
+static void hq_cmd_script_close(hq_cmd_script_t *script)
+{
+    if (script->fp == NULL)
+    {
+        (void)osal_close(script->fd);
+    }
+    else
+    {
+        (void)fclose(script->fp);
+    }
+}
+
+/* Returns 1 if the line ran a command, 0 if it holds none, -1 on failure */
+static int32_t hq_cmd_script_line(const char *path, uint32_t line_no, const char *line, bool too_long)
+{
+    while (*line == ' ' || *line == '\t')
+    {
+        line++;
+    }
+    if (too_long)
+    {
+        hq_cmd_printf("%s:%u: line too long", path, (unsigned)line_no);
+        return -1;
+    }
+    if (*line == '\0' || *line == '\r' || *line == '#')
+    {
+        return 0;
+    }
+    if (hq_cmd_exec_line(line) != 0)
+    {
+        hq_cmd_printf("%s:%u: script stopped", path, (unsigned)line_no);
+        return -1;
+    }
+    return 1;
+}
+
+int32_t hq_cmd_exec_script(const char *path)
+{
+    hq_cmd_script_t script;
+    char chunk[CMD_SCRIPT_CHUNK];
+    char *line;
+    size_t line_len = 0U;
+    bool too_long = false;
+    uint32_t line_no = 0U;
+    int32_t run = 0;
+    int32_t rc = 0;
+    int32_t n = 0;
+
+    if (path == NULL || !hq_cmd_script_open(&script, path))
+    {
+        hq_cmd_printf("Cannot read %s", (path != NULL) ? path : "(null)");
+        return -1;
+    }
+    line = (char *)malloc(CONFIG_CMD_BUFFER_SIZE + 1U);
+    if (line == NULL)
+    {
+        hq_cmd_script_close(&script);
+        hq_cmd_print("Out of memory");
+        return -1;
+    }
+
+    while (rc >= 0 && (n = hq_cmd_script_read(&script, chunk, sizeof(chunk))) > 0)
+    {
+        for (int32_t i = 0; i < n && rc >= 0; i++)
+        {
+            if (chunk[i] != '\n')
+            {
+                if (line_len < CONFIG_CMD_BUFFER_SIZE)
+                {
+                    line[line_len++] = chunk[i];
+                }
+                else
+                {
+                    too_long = true;
+                }
+                continue;
+            }
+
+            line[line_len] = '\0';
+            rc = hq_cmd_cancelled() ? -1 : hq_cmd_script_line(path, ++line_no, line, too_long);
+            run += (rc > 0) ? 1 : 0;
+            line_len = 0U;
+            too_long = false;
+        }
+    }
+    if (rc >= 0 && n < 0)
+    {
+        hq_cmd_printf("Cannot read %s", path);
+        rc = -1;
+    }
+    /* Last line without a newline */
+    if (rc >= 0 && (line_len > 0U || too_long) && !hq_cmd_cancelled())
+    {
+        line[line_len] = '\0';
+        rc = hq_cmd_script_line(path, ++line_no, line, too_long);
+        run += (rc > 0) ? 1 : 0;
+    }
+
+    free(line);
+    hq_cmd_script_close(&script);
+
+    /* Ctrl-C is not an error: report what ran */
+    return (rc < 0 && !hq_cmd_cancelled()) ? -1 : run;
+}
@@ -0,0 +1,121 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "hq_config.h"
+#include "hq_cmd_internal.h"
+#include "osal_bin_sem.h"
+#include "osal_log.h"
+#include "osal_queue.h"
+#include "osal_task.h"
+
+/* Jobs waiting for a free worker; each session has at most one */
+#define CMD_WORKER_QUEUE_SIZE 8U
+
+typedef struct
+{
+    hq_cmd_work_fn_t fn;    /* NULL tells a worker to exit */
+    void *arg;
+} hq_cmd_work_t;
+
+static osal_queue_id_t   g_queue;
+static osal_bin_sem_id_t g_exit_sem;
+static osal_task_id_t    g_tasks[CONFIG_CMD_WORKER_COUNT];
+static uint32_t          g_task_count;    /* 0 while stopped */
+
+static void hq_cmd_worker_task(void *arg)
+{
+    uint32_t index = (uint32_t)(uintptr_t)arg;
+    hq_cmd_work_t work;
+
+    for (;;)
+    {
+        if (osal_queue_receive(g_queue, &work, OSAL_MAX_DELAY) != OSAL_SUCCESS)
+        {
+            continue;
+        }
+        if (work.fn == NULL)
+        {
+            break;
+        }
+        work.fn(work.arg);
+    }
+
+    (void)osal_bin_sem_give(g_exit_sem);
+    (void)osal_task_delete(g_tasks[index]);
+}
+
+int32_t hq_cmd_worker_start(void)
+{
+    osal_status_t status;
+
+    if (g_task_count > 0U)
+    {
+        return 0;
+    }
+
+    if ((status = osal_queue_create(&g_queue, "cmd_jobs", CMD_WORKER_QUEUE_SIZE, sizeof(hq_cmd_work_t))) != OSAL_SUCCESS)
+    {
+        osal_log_error("Failed to create worker queue %s", osal_get_status_name(status));
+        return -1;
+    }
+    if ((status = osal_bin_sem_create(&g_exit_sem, "cmd_worker_exit", OSAL_SEM_EMPTY)) != OSAL_SUCCESS)
+    {
+        osal_log_error("Failed to create worker exit semaphore %s", osal_get_status_name(status));
+        (void)osal_queue_delete(g_queue);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < CONFIG_CMD_WORKER_COUNT; i++)
+    {
+        char name[16];
+        osal_task_attr_t attr;
+
+        snprintf(name, sizeof(name), "cmd_worker%u", (unsigned)i);
+        (void)osal_task_attributes_init(&attr);
+        if ((status = osal_task_create(&g_tasks[i], name, hq_cmd_worker_task, (void *)(uintptr_t)i, NULL,
+                                       (size_t)CONFIG_CMD_WORKER_TASK_STACK_SIZE,
+                                       (osal_priority_t)CONFIG_CMD_WORKER_TASK_PRIORITY, &attr)) != OSAL_SUCCESS)
+        {
+            osal_log_error("Failed to create worker task %s", osal_get_status_name(status));
+            break;
+        }
+        g_task_count++;
+    }
+
+    if (g_task_count == 0U)
+    {
+        (void)osal_bin_sem_delete(g_exit_sem);
+        (void)osal_queue_delete(g_queue);
+        return -1;
+    }
+    return 0;
+}
+
+void hq_cmd_worker_stop(void)
+{
+    static const hq_cmd_work_t exit_work = { NULL, NULL };
+
+    /* Queued jobs run first; each worker finishes its job before exiting */
+    while (g_task_count > 0U)
+    {
+        (void)osal_queue_send(g_queue, &exit_work, OSAL_MAX_DELAY);
+        (void)osal_bin_sem_take(g_exit_sem);
+        g_task_count--;
+    }
+
+    (void)osal_bin_sem_delete(g_exit_sem);
+    (void)osal_queue_delete(g_queue);
+}
+
+bool hq_cmd_worker_post(hq_cmd_work_fn_t fn, void *arg)
+{
+    hq_cmd_work_t work = { fn, arg };
+
+    if (g_task_count == 0U || fn == NULL)
+    {
+        return false;
+    }
+    return osal_queue_send(g_queue, &work, 0) == OSAL_SUCCESS;
+}
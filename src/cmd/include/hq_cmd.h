@@ -2,6 +2,7 @@
 #define HQ_CMD_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /** Opaque CLI instance type (hides the underlying EmbeddedCli library). */
@@ -23,6 +24,11 @@ typedef struct
 	bool tokenize_args;
 	void *context;
 	hq_cmd_handler_t handler;
+	/* Run on a worker task instead of the task that read the line: the
+	 * prompt comes back at once, output is streamed as it is printed and
+	 * Ctrl-C asks the command to stop (see hq_cmd_cancelled()). One such
+	 * command runs per session at a time. */
+	bool run_in_worker;
 } hq_cmd_binding_t;
 
 #ifdef __cplusplus
@@ -45,8 +51,116 @@ void hq_cmd_register_builtin_commands(void);
 
 /* ── Output ────────────────────────────────────────────────────────── */
 
+/**
+ * Print a line. Output is collected in a buffer of
+ * CONFIG_CMD_OUTPUT_BUFFER_SIZE bytes and written in blocks: inside a command
+ * handler when the handler returns and the prompt is shown, otherwise right
+ * away.
+ */
 void hq_cmd_print(const char *text);
 
+/**
+ * Print a printf-style formatted line; lines longer than
+ * HQ_CMD_PRINTF_MAX - 1 characters are cut short.
+ */
+#define HQ_CMD_PRINTF_MAX 128
+void hq_cmd_printf(const char *fmt, ...);
+
+/**
+ * Write out buffered output now, e.g. from a handler that prints progress
+ * before a long wait.
+ */
+void hq_cmd_flush(void);
+
+/**
+ * True once Ctrl-C was pressed or the session closed while this worker
+ * command runs. Long commands should check it between steps and return
+ * early; hq_cmd_deinit() waits for them. Always false for other commands.
+ */
+bool hq_cmd_cancelled(void);
+
+/* ── Scripts ───────────────────────────────────────────────────────── */
+
+/**
+ * Run the commands in a text file, one per line, on the calling task
+ * without going through the line editor. The file is looked up on the OSAL
+ * file system (the littlefs volume) first, then through stdio, which reaches
+ * host files on POSIX. Blank lines and lines starting with '#' are skipped
+ * and worker commands run inline; output goes where hq_cmd_print() goes.
+ * Stops at the first line that cannot run, or on Ctrl-C when called from a
+ * worker command.
+ *
+ * @return Number of commands run, or -1 if the file cannot be read or a line
+ *         cannot run.
+ */
+int32_t hq_cmd_exec_script(const char *path);
+
+/* ── Sessions ──────────────────────────────────────────────────────── */
+
+/**
+ * A CLI session besides the console, e.g. one per network client. Each has
+ * its own line editor, history and output buffer; hq_cmd_print() in a
+ * handler goes to the session that ran the command. Commands registered
+ * before a session is opened are available in it.
+ *
+ * Input, output from worker commands and close may come from different
+ * tasks. Sessions work without hq_cmd_init(); commands then come from
+ * hq_cmd_register() alone.
+ */
+typedef struct hq_cmd_session hq_cmd_session_t;
+
+/** Receives session output, one call per buffered block; called from a
+ * worker task for worker commands. */
+typedef void (*hq_cmd_write_t)(void *ctx, const char *data, size_t len);
+
+/** Open a session writing to @p write; shows the prompt. NULL if out of memory. */
+hq_cmd_session_t *hq_cmd_session_open(hq_cmd_write_t write, void *ctx);
+
+/** Feed received bytes; complete lines run their commands before this returns. */
+void hq_cmd_session_input(hq_cmd_session_t *session, const char *data, size_t len);
+
+/** Close a session; a worker command still running in it is cancelled and
+ * its output dropped. The write callback is not called after this returns. */
+void hq_cmd_session_close(hq_cmd_session_t *session);
+
+/* ── Programmatic execution ────────────────────────────────────────── */
+
+/**
+ * Run one command line from code, e.g. for a network API, on the calling
+ * task and without a line editor. Output the command prints goes to
+ * @p output as it is printed, one call per piece of a line followed by a
+ * "\n" call, never to a session; NULL drops it. Worker commands run inline
+ * and cannot be cancelled. Commands are found by hashed name lookup; the
+ * line editor built-ins such as 'help' are not available.
+ *
+ * @return 0, or -1 if the command is unknown or the line too long, after
+ *         writing why to @p output.
+ */
+int32_t hq_cmd_execute(const char *line, hq_cmd_write_t output, void *ctx);
+
+/** Caller buffer for hq_cmd_execute(): pass hq_cmd_buffer_write and a
+ * pointer to it. @c data stays NUL-terminated; output that does not fit is
+ * dropped and @c truncated set. Set @c len to 0 before reusing it. */
+typedef struct
+{
+	char *data;
+	size_t size;
+	size_t len;
+	bool truncated;
+} hq_cmd_buffer_t;
+
+void hq_cmd_buffer_write(void *ctx, const char *data, size_t len);
+
+/**
+ * Run @p fn(@p arg) on a task of the worker pool, e.g. to call
+ * hq_cmd_execute() without holding up a network task. Starts the pool if no
+ * worker command has yet; never blocks.
+ *
+ * @return false if the pool cannot start or every worker is busy with a
+ *         backlog; @p fn is not called then.
+ */
+bool hq_cmd_post(void (*fn)(void *arg), void *arg);
+
 /* ── Argument helpers ──────────────────────────────────────────────── */
 
 /**
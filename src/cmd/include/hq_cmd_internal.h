@@ -1,6 +1,8 @@
 #ifndef HQ_CMD_INTERNAL_H
 #define HQ_CMD_INTERNAL_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "embedded_cli.h"
@@ -10,9 +12,36 @@ extern "C" {
 #endif
 
 /* Platform HAL — implemented per target in platforms/<target>/ */
-void hq_cmd_platform_output_init(void);
-void hq_cmd_platform_write_char(char c);
-int  hq_cmd_platform_read_char(void);
+void hq_cmd_platform_init(void);
+void hq_cmd_platform_deinit(void);
+void hq_cmd_platform_write_buf(const char *buf, size_t len);
+
+/* Blocks until input arrives, hq_cmd_platform_wake() is called or
+ * timeout_ms passes. Returns the number of bytes read, 0 if none. */
+size_t hq_cmd_platform_read(char *buf, size_t size, uint32_t timeout_ms);
+
+/* Ends a pending hq_cmd_platform_read() early; callable from any task. */
+void hq_cmd_platform_wake(void);
+
+/* Worker pool for commands registered with run_in_worker */
+typedef void (*hq_cmd_work_fn_t)(void *arg);
+
+int32_t hq_cmd_worker_start(void);
+/* Waits for queued and running work to finish. */
+void hq_cmd_worker_stop(void);
+/* Returns false if the pool is stopped or every worker is busy with a
+ * backlog; never blocks. */
+bool hq_cmd_worker_post(hq_cmd_work_fn_t fn, void *arg);
+
+/* Runs one command line on the calling task without the line editor;
+ * worker commands run inline as well, cancelled along with the caller.
+ * Returns 0, or -1 after printing why the line could not run. */
+int32_t hq_cmd_exec_line(const char *line);
+
+/* Built-in command sets in commands/, see hq_cmd_register_builtin_commands() */
+void hq_cmd_register_diag_commands(void);
+void hq_cmd_register_bench_command(void);
+void hq_cmd_register_batch_commands(void);
 
 /* Internal registration using raw EmbeddedCli binding (core use only). */
 int32_t hq_cmd_register_internal(const CliCommandBinding *binding);
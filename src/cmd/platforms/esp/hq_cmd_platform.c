@@ -5,11 +5,22 @@
 
 #if CONFIG_CMD_ESP_OUTPUT_UART
 #include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "driver/uart.h"
 
+#define CMD_UART_EVENT_QUEUE_LEN 16
+
 static const uart_port_t g_cmd_uart_port = (uart_port_t)CONFIG_CMD_ESP_UART_NUM;
 
-void hq_cmd_platform_output_init(void)
+/* Driver events; hq_cmd_platform_wake() posts one of its own */
+static QueueHandle_t g_cmd_uart_queue;
+
+/* The driver drains this ring buffer from its interrupt, so a block write
+ * returns once it is copied instead of waiting for the FIFO. */
+#define CMD_UART_TX_BUFFER_SIZE (2 * CONFIG_CMD_OUTPUT_BUFFER_SIZE > 256 ? 2 * CONFIG_CMD_OUTPUT_BUFFER_SIZE : 256)
+
+void hq_cmd_platform_init(void)
 {
     const uart_config_t cfg = {
         .baud_rate  = CONFIG_CMD_ESP_UART_BAUDRATE,
@@ -20,34 +31,74 @@ void hq_cmd_platform_output_init(void)
         .source_clk = UART_SCLK_DEFAULT,
     };
 
-    (void)uart_driver_install(g_cmd_uart_port, 256, 0, 0, NULL, 0);
+    /* Fails after a deinit/init cycle; the queue from the first install stays valid */
+    (void)uart_driver_install(g_cmd_uart_port, 256, CMD_UART_TX_BUFFER_SIZE, CMD_UART_EVENT_QUEUE_LEN,
+                              &g_cmd_uart_queue, 0);
     (void)uart_param_config(g_cmd_uart_port, &cfg);
 }
 
-void hq_cmd_platform_write_char(char c)
+void hq_cmd_platform_deinit(void)
 {
-    uint8_t byte = (uint8_t)c;
-    (void)uart_write_bytes(g_cmd_uart_port, (const char *)&byte, 1);
 }
 
-int hq_cmd_platform_read_char(void)
+void hq_cmd_platform_write_buf(const char *buf, size_t len)
 {
-    uint8_t byte;
-    int len = uart_read_bytes(g_cmd_uart_port, &byte, 1, pdMS_TO_TICKS(100));
-    return (len > 0) ? (int)byte : -1;
+    (void)uart_write_bytes(g_cmd_uart_port, buf, len);
+}
+
+size_t hq_cmd_platform_read(char *buf, size_t size, uint32_t timeout_ms)
+{
+    size_t pending = 0U;
+    uart_event_t event;
+
+    /* Data left over from a burst larger than buf raises no new event */
+    (void)uart_get_buffered_data_len(g_cmd_uart_port, &pending);
+    if (pending == 0U)
+    {
+        if (g_cmd_uart_queue == NULL ||
+            xQueueReceive(g_cmd_uart_queue, &event, pdMS_TO_TICKS(timeout_ms)) != pdTRUE)
+        {
+            return 0U;
+        }
+        if (event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL)
+        {
+            (void)uart_flush_input(g_cmd_uart_port);
+            (void)xQueueReset(g_cmd_uart_queue);
+            return 0U;
+        }
+        if (event.type != UART_DATA)
+        {
+            return 0U;
+        }
+    }
+
+    int len = uart_read_bytes(g_cmd_uart_port, buf, (uint32_t)size, 0);
+    return (len > 0) ? (size_t)len : 0U;
+}
+
+void hq_cmd_platform_wake(void)
+{
+    uart_event_t event = { .type = UART_EVENT_MAX };
+
+    if (g_cmd_uart_queue != NULL)
+    {
+        (void)xQueueSend(g_cmd_uart_queue, &event, 0);
+    }
 }
 
 #else /* CMD_ESP_OUTPUT_CONSOLE — uses ESP-IDF stdio/console UART */
 
 #include <fcntl.h>
+#include <sys/select.h>
 #include <unistd.h>
 
-void hq_cmd_platform_output_init(void)
+void hq_cmd_platform_init(void)
 {
-    /* Disable stdout buffering so each writeChar is visible immediately. */
+    /* CLI output bypasses stdio; keep other stdout users unbuffered so
+     * their text stays in order with it. */
     setvbuf(stdout, NULL, _IONBF, 0);
 
-    /* Set stdin non-blocking so read_char returns immediately when idle. */
+    /* select() reports input; reads must still never block */
     int flags = fcntl(STDIN_FILENO, F_GETFL, 0);
     if (flags >= 0)
     {
@@ -55,19 +106,47 @@ void hq_cmd_platform_output_init(void)
     }
 }
 
-void hq_cmd_platform_write_char(char c)
+void hq_cmd_platform_deinit(void)
 {
-    (void)putchar((int)c);
 }
 
-int hq_cmd_platform_read_char(void)
+void hq_cmd_platform_write_buf(const char *buf, size_t len)
 {
-    uint8_t byte;
-    if (read(STDIN_FILENO, &byte, 1) == 1)
+    while (len > 0U)
     {
-        return (int)byte;
+        ssize_t n = write(STDOUT_FILENO, buf, len);
+        if (n <= 0)
+        {
+            return;
+        }
+        buf += n;
+        len -= (size_t)n;
     }
-    return -1;
+}
+
+size_t hq_cmd_platform_read(char *buf, size_t size, uint32_t timeout_ms)
+{
+    struct timeval tv = {
+        .tv_sec = (time_t)(timeout_ms / 1000U),
+        .tv_usec = (suseconds_t)((timeout_ms % 1000U) * 1000U),
+    };
+    fd_set rfds;
+
+    FD_ZERO(&rfds);
+    FD_SET(STDIN_FILENO, &rfds);
+    if (select(STDIN_FILENO + 1, &rfds, NULL, NULL, &tv) <= 0)
+    {
+        return 0U;
+    }
+
+    ssize_t len = read(STDIN_FILENO, buf, size);
+    return (len > 0) ? (size_t)len : 0U;
+}
+
+void hq_cmd_platform_wake(void)
+{
+    /* The console VFS has nothing to wake select() with; a stop request is
+     * seen when the wait times out. */
 }
 
 #endif
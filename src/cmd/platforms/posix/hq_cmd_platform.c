@@ -1,33 +1,124 @@
 #include <stdio.h>
+#include <stdbool.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 
 #include "hq_cmd_internal.h"
 
-void hq_cmd_platform_output_init(void)
+/* hq_cmd_platform_wake() writes a byte here to end a pending poll() */
+static int  g_wake_pipe[2] = { -1, -1 };
+static bool g_stdin_closed;
+
+static void hq_cmd_set_nonblock(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags >= 0)
+    {
+        (void)fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    }
+}
+
+void hq_cmd_platform_init(void)
 {
-    /* Make stdout unbuffered so character echo is immediate. */
+    /* CLI output bypasses stdio; keep other stdout users unbuffered so
+     * their text stays in order with it. */
     setvbuf(stdout, NULL, _IONBF, 0);
 
-    /* Set stdin non-blocking so read_char returns immediately when idle. */
-    int flags = fcntl(STDIN_FILENO, F_GETFL, 0);
-    if (flags >= 0)
+    /* poll() reports input; reads must still never block */
+    hq_cmd_set_nonblock(STDIN_FILENO);
+    g_stdin_closed = false;
+
+    if (pipe(g_wake_pipe) == 0)
+    {
+        hq_cmd_set_nonblock(g_wake_pipe[0]);
+        hq_cmd_set_nonblock(g_wake_pipe[1]);
+    }
+    else
+    {
+        g_wake_pipe[0] = -1;
+        g_wake_pipe[1] = -1;
+    }
+}
+
+void hq_cmd_platform_deinit(void)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (g_wake_pipe[i] >= 0)
+        {
+            (void)close(g_wake_pipe[i]);
+            g_wake_pipe[i] = -1;
+        }
+    }
+}
+
+void hq_cmd_platform_write_buf(const char *buf, size_t len)
+{
+    while (len > 0U)
     {
-        (void)fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK);
+        ssize_t n = write(STDOUT_FILENO, buf, len);
+        if (n > 0)
+        {
+            buf += n;
+            len -= (size_t)n;
+        }
+        else if (n < 0 && errno == EAGAIN)
+        {
+            /* A terminal shares the O_NONBLOCK set on stdin */
+            struct pollfd pfd = { .fd = STDOUT_FILENO, .events = POLLOUT };
+            (void)poll(&pfd, 1, 100);
+        }
+        else if (n == 0 || errno != EINTR)
+        {
+            return;
+        }
     }
 }
 
-void hq_cmd_platform_write_char(char c)
+size_t hq_cmd_platform_read(char *buf, size_t size, uint32_t timeout_ms)
 {
-    (void)putchar((int)c);
+    /* Negative descriptors are ignored by poll() */
+    struct pollfd pfd[2] = {
+        { .fd = g_stdin_closed ? -1 : STDIN_FILENO, .events = POLLIN },
+        { .fd = g_wake_pipe[0], .events = POLLIN },
+    };
+    char drain[16];
+
+    if (poll(pfd, 2, (int)timeout_ms) <= 0)
+    {
+        return 0U;
+    }
+
+    if (pfd[1].revents != 0)
+    {
+        while (read(g_wake_pipe[0], drain, sizeof(drain)) > 0)
+        {
+        }
+    }
+
+    if (pfd[0].revents != 0)
+    {
+        ssize_t n = read(STDIN_FILENO, buf, size);
+        if (n > 0)
+        {
+            return (size_t)n;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EINTR))
+        {
+            /* End of input: from now on only a wake-up ends the wait */
+            g_stdin_closed = true;
+        }
+    }
+    return 0U;
 }
 
-int hq_cmd_platform_read_char(void)
+void hq_cmd_platform_wake(void)
 {
-    uint8_t byte;
-    if (read(STDIN_FILENO, &byte, 1) == 1)
+    if (g_wake_pipe[1] >= 0)
     {
-        return (int)byte;
+        ssize_t n = write(g_wake_pipe[1], "w", 1);
+        (void)n;
     }
-    return -1;
 }
@@ -0,0 +1,636 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hq_json.h"
+
+#define HQ_JSON_PATH_MAX    128
+#define HQ_JSON_NUMBER_MAX  64
+
+typedef struct
+{
+    const char *s;
+    size_t len;
+    size_t pos;
+    const hq_json_field_t *fields;
+    size_t count;
+    uint32_t pending;      /* fields not extracted yet */
+    uint32_t found;
+    int32_t found_count;
+    uint32_t depth;
+    bool error;
+    char path[HQ_JSON_PATH_MAX];
+    size_t path_len;
+} hq_json_parser_t;
+
+static void skip_ws(hq_json_parser_t *p)
+{
+    while (p->pos < p->len)
+    {
+        char c = p->s[p->pos];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+        {
+            break;
+        }
+        p->pos++;
+    }
+}
+
+static bool expect(hq_json_parser_t *p, char c)
+{
+    skip_ws(p);
+    if (p->pos < p->len && p->s[p->pos] == c)
+    {
+        p->pos++;
+        return true;
+    }
+    p->error = true;
+    return false;
+}
+
+/*
+ * Classify the current path against the pending schema entries:
+ * returns a mask of fields whose path equals the current one and sets
+ * *descend when at least one pending path continues below it.
+ */
+static uint32_t match_path(const hq_json_parser_t *p, bool *descend)
+{
+    uint32_t exact = 0U;
+
+    *descend = false;
+    for (size_t i = 0U; i < p->count; i++)
+    {
+        const char *fp;
+
+        if ((p->pending & (1UL << i)) == 0U)
+        {
+            continue;
+        }
+
+        fp = p->fields[i].path;
+        if (strncmp(fp, p->path, p->path_len) != 0)
+        {
+            continue;
+        }
+
+        if (fp[p->path_len] == '\0')
+        {
+            exact |= 1UL << i;
+        }
+        else if (fp[p->path_len] == '.' || fp[p->path_len] == '[')
+        {
+            *descend = true;
+        }
+    }
+
+    return exact;
+}
+
+static void scan_string(hq_json_parser_t *p)
+{
+    /* Caller has verified the opening quote. */
+    p->pos++;
+    while (p->pos < p->len)
+    {
+        char c = p->s[p->pos++];
+        if (c == '"')
+        {
+            return;
+        }
+        if (c == '\\')
+        {
+            if (p->pos >= p->len)
+            {
+                break;
+            }
+            p->pos++;
+        }
+        else if ((unsigned char)c < 0x20U)
+        {
+            break;
+        }
+    }
+    p->error = true;
+}
+
+static void scan_literal(hq_json_parser_t *p, const char *lit)
+{
+    size_t n = strlen(lit);
+
+    if (p->len - p->pos >= n && memcmp(p->s + p->pos, lit, n) == 0)
+    {
+        p->pos += n;
+        return;
+    }
+    p->error = true;
+}
+
+static void scan_number(hq_json_parser_t *p)
+{
+    size_t start = p->pos;
+
+    while (p->pos < p->len)
+    {
+        char c = p->s[p->pos];
+        if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')
+        {
+            p->pos++;
+            continue;
+        }
+        break;
+    }
+
+    if (p->pos == start)
+    {
+        p->error = true;
+    }
+}
+
+static bool push_key(hq_json_parser_t *p, const char *key, size_t key_len)
+{
+    if (p->path_len + 1U + key_len >= sizeof(p->path))
+    {
+        return false;
+    }
+
+    p->path[p->path_len++] = '.';
+    memcpy(p->path + p->path_len, key, key_len);
+    p->path_len += key_len;
+    p->path[p->path_len] = '\0';
+    return true;
+}
+
+static bool push_index(hq_json_parser_t *p, uint32_t index)
+{
+    char tmp[12];
+    size_t n = sizeof(tmp);
+
+    do
+    {
+        tmp[--n] = (char)('0' + (index % 10U));
+        index /= 10U;
+    } while (index != 0U);
+
+    if (p->path_len + 2U + (sizeof(tmp) - n) >= sizeof(p->path))
+    {
+        return false;
+    }
+
+    p->path[p->path_len++] = '[';
+    memcpy(p->path + p->path_len, tmp + n, sizeof(tmp) - n);
+    p->path_len += sizeof(tmp) - n;
+    p->path[p->path_len++] = ']';
+    p->path[p->path_len] = '\0';
+    return true;
+}
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static bool read_u16(const char *s, uint32_t *out)
+{
+    uint32_t v = 0U;
+
+    for (int i = 0; i < 4; i++)
+    {
+        int d = hex_digit(s[i]);
+        if (d < 0)
+        {
+            return false;
+        }
+        v = (v << 4) | (uint32_t)d;
+    }
+    *out = v;
+    return true;
+}
+
+static size_t utf8_encode(uint32_t cp, char *out)
+{
+    if (cp < 0x80U)
+    {
+        out[0] = (char)cp;
+        return 1U;
+    }
+    if (cp < 0x800U)
+    {
+        out[0] = (char)(0xC0U | (cp >> 6));
+        out[1] = (char)(0x80U | (cp & 0x3FU));
+        return 2U;
+    }
+    if (cp < 0x10000U)
+    {
+        out[0] = (char)(0xE0U | (cp >> 12));
+        out[1] = (char)(0x80U | ((cp >> 6) & 0x3FU));
+        out[2] = (char)(0x80U | (cp & 0x3FU));
+        return 3U;
+    }
+    out[0] = (char)(0xF0U | (cp >> 18));
+    out[1] = (char)(0x80U | ((cp >> 12) & 0x3FU));
+    out[2] = (char)(0x80U | ((cp >> 6) & 0x3FU));
+    out[3] = (char)(0x80U | (cp & 0x3FU));
+    return 4U;
+}
+
+/* Unescape a quoted string token into out; fails if it does not fit. */
+static bool decode_string(const char *tok, size_t tok_len, char *out, size_t out_size)
+{
+    size_t o = 0U;
+    size_t i = 1U;
+
+    if (out == NULL || out_size == 0U || tok_len < 2U || tok[0] != '"')
+    {
+        return false;
+    }
+
+    while (i < tok_len - 1U)
+    {
+        char enc[4];
+        size_t n = 1U;
+        char c = tok[i++];
+
+        enc[0] = c;
+        if (c == '\\')
+        {
+            c = tok[i++];
+            switch (c)
+            {
+                case 'n': enc[0] = '\n'; break;
+                case 'r': enc[0] = '\r'; break;
+                case 't': enc[0] = '\t'; break;
+                case 'b': enc[0] = '\b'; break;
+                case 'f': enc[0] = '\f'; break;
+                case 'u':
+                {
+                    uint32_t cp;
+                    if (i + 4U > tok_len - 1U || !read_u16(tok + i, &cp))
+                    {
+                        return false;
+                    }
+                    i += 4U;
+                    if (cp >= 0xD800U && cp <= 0xDBFFU && i + 6U <= tok_len - 1U &&
+                        tok[i] == '\\' && tok[i + 1U] == 'u')
+                    {
+                        uint32_t lo;
+                        if (read_u16(tok + i + 2U, &lo) && lo >= 0xDC00U && lo <= 0xDFFFU)
+                        {
+                            cp = 0x10000U + ((cp - 0xD800U) << 10) + (lo - 0xDC00U);
+                            i += 6U;
+                        }
+                    }
+                    n = utf8_encode(cp, enc);
+                    break;
+                }
+                default:
+                    enc[0] = c;
+                    break;
+            }
+        }
+
+        if (o + n >= out_size)
+        {
+            return false;
+        }
+        memcpy(out + o, enc, n);
+        o += n;
+    }
+
+    out[o] = '\0';
+    return true;
+}
+
+static bool copy_number(const char *tok, size_t tok_len, char *buf)
+{
+    if (tok_len == 0U || tok_len >= HQ_JSON_NUMBER_MAX)
+    {
+        return false;
+    }
+    if (tok[0] != '-' && (tok[0] < '0' || tok[0] > '9'))
+    {
+        return false;
+    }
+    memcpy(buf, tok, tok_len);
+    buf[tok_len] = '\0';
+    return true;
+}
+
+static bool convert(const hq_json_field_t *f, const char *tok, size_t tok_len)
+{
+    char num[HQ_JSON_NUMBER_MAX];
+
+    if (f->out == NULL)
+    {
+        return false;
+    }
+
+    switch (f->type)
+    {
+        case HQ_JSON_TYPE_STRING:
+            return decode_string(tok, tok_len, (char *)f->out, f->out_size);
+
+        case HQ_JSON_TYPE_INT:
+        {
+            char *end = NULL;
+            if (!copy_number(tok, tok_len, num))
+            {
+                return false;
+            }
+            if (strpbrk(num, ".eE") != NULL)
+            {
+                double value = strtod(num, &end);
+
+                /* The cast is undefined outside the int64_t range; -2^63
+                 * is exact as a double, 2^63 is the first value past it */
+                if (!(value >= -9223372036854775808.0 && value < 9223372036854775808.0))
+                {
+                    return false;
+                }
+                *(int64_t *)f->out = (int64_t)value;
+            }
+            else
+            {
+                long long value;
+
+                errno = 0;
+                value = strtoll(num, &end, 10);
+                if (errno == ERANGE)
+                {
+                    return false;
+                }
+                *(int64_t *)f->out = (int64_t)value;
+            }
+            return end != NULL && *end == '\0';
+        }
+
+        case HQ_JSON_TYPE_DOUBLE:
+        {
+            char *end = NULL;
+            if (!copy_number(tok, tok_len, num))
+            {
+                return false;
+            }
+            *(double *)f->out = strtod(num, &end);
+            return end != NULL && *end == '\0';
+        }
+
+        case HQ_JSON_TYPE_BOOL:
+            if (tok_len == 4U && memcmp(tok, "true", 4U) == 0)
+            {
+                *(bool *)f->out = true;
+                return true;
+            }
+            if (tok_len == 5U && memcmp(tok, "false", 5U) == 0)
+            {
+                *(bool *)f->out = false;
+                return true;
+            }
+            return false;
+
+        case HQ_JSON_TYPE_SPAN:
+            ((hq_json_span_t *)f->out)->ptr = tok;
+            ((hq_json_span_t *)f->out)->len = tok_len;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static void parse_value(hq_json_parser_t *p, bool track);
+
+static void parse_object(hq_json_parser_t *p, bool track)
+{
+    size_t saved_len = p->path_len;
+
+    p->pos++;
+    skip_ws(p);
+    if (p->pos < p->len && p->s[p->pos] == '}')
+    {
+        p->pos++;
+        return;
+    }
+
+    while (!p->error && p->pending != 0U)
+    {
+        size_t key_start;
+        size_t key_len;
+        bool child_track;
+
+        skip_ws(p);
+        if (p->pos >= p->len || p->s[p->pos] != '"')
+        {
+            p->error = true;
+            return;
+        }
+
+        key_start = p->pos + 1U;
+        scan_string(p);
+        if (p->error)
+        {
+            return;
+        }
+        key_len = p->pos - key_start - 1U;
+
+        if (!expect(p, ':'))
+        {
+            return;
+        }
+
+        /* Keys are matched in their raw (escaped) form. */
+        child_track = track && push_key(p, p->s + key_start, key_len);
+
+        parse_value(p, child_track);
+        p->path_len = saved_len;
+        p->path[saved_len] = '\0';
+
+        if (p->error || p->pending == 0U)
+        {
+            return;
+        }
+
+        skip_ws(p);
+        if (p->pos < p->len && p->s[p->pos] == ',')
+        {
+            p->pos++;
+            continue;
+        }
+        expect(p, '}');
+        return;
+    }
+}
+
+static void parse_array(hq_json_parser_t *p, bool track)
+{
+    size_t saved_len = p->path_len;
+    uint32_t index = 0U;
+
+    p->pos++;
+    skip_ws(p);
+    if (p->pos < p->len && p->s[p->pos] == ']')
+    {
+        p->pos++;
+        return;
+    }
+
+    while (!p->error && p->pending != 0U)
+    {
+        bool child_track = track && push_index(p, index);
+
+        parse_value(p, child_track);
+        p->path_len = saved_len;
+        p->path[saved_len] = '\0';
+        index++;
+
+        if (p->error || p->pending == 0U)
+        {
+            return;
+        }
+
+        skip_ws(p);
+        if (p->pos < p->len && p->s[p->pos] == ',')
+        {
+            p->pos++;
+            continue;
+        }
+        expect(p, ']');
+        return;
+    }
+}
+
+static void parse_value(hq_json_parser_t *p, bool track)
+{
+    uint32_t exact = 0U;
+    bool descend = false;
+    size_t start;
+
+    if (track)
+    {
+        exact = match_path(p, &descend);
+    }
+
+    skip_ws(p);
+    if (p->pos >= p->len)
+    {
+        p->error = true;
+        return;
+    }
+
+    if (p->depth >= HQ_JSON_MAX_DEPTH)
+    {
+        p->error = true;
+        return;
+    }
+
+    start = p->pos;
+    p->depth++;
+    switch (p->s[p->pos])
+    {
+        case '{':
+            parse_object(p, descend);
+            break;
+        case '[':
+            parse_array(p, descend);
+            break;
+        case '"':
+            scan_string(p);
+            break;
+        case 't':
+            scan_literal(p, "true");
+            break;
+        case 'f':
+            scan_literal(p, "false");
+            break;
+        case 'n':
+            scan_literal(p, "null");
+            break;
+        default:
+            scan_number(p);
+            break;
+    }
+    p->depth--;
+
+    if (p->error || exact == 0U)
+    {
+        return;
+    }
+
+    /*
+     * The exact fields were still pending while this value was scanned, so
+     * a container is always consumed up to its closing bracket here. The
+     * first occurrence of a path wins, even if it fails to convert.
+     */
+    for (size_t i = 0U; i < p->count; i++)
+    {
+        uint32_t bit = 1UL << i;
+        if ((exact & bit) == 0U || (p->pending & bit) == 0U)
+        {
+            continue;
+        }
+        if (convert(&p->fields[i], p->s + start, p->pos - start))
+        {
+            p->found |= bit;
+            p->found_count++;
+        }
+        p->pending &= ~bit;
+    }
+}
+
+int32_t hq_json_parse(const char *json, size_t len,
+                      const hq_json_field_t *fields, size_t count,
+                      uint32_t *found)
+{
+    hq_json_parser_t p;
+
+    if (found != NULL)
+    {
+        *found = 0U;
+    }
+
+    if (json == NULL || fields == NULL || count == 0U || count > HQ_JSON_MAX_FIELDS)
+    {
+        return -1;
+    }
+
+    memset(&p, 0, sizeof(p));
+    p.s = json;
+    p.len = len;
+    p.fields = fields;
+    p.count = count;
+    p.pending = (count == 32U) ? 0xFFFFFFFFUL : ((1UL << count) - 1U);
+    p.path[0] = '$';
+    p.path_len = 1U;
+
+    for (size_t i = 0U; i < count; i++)
+    {
+        if (fields[i].path == NULL || fields[i].path[0] != '$')
+        {
+            return -1;
+        }
+    }
+
+    parse_value(&p, true);
+    if (p.error)
+    {
+        return -1;
+    }
+
+    if (found != NULL)
+    {
+        *found = p.found;
+    }
+
+    return p.found_count;
+}
@@ -0,0 +1,350 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "hq_json.h"
+
+static void hq_json_flush(hq_json_writer_t *w)
+{
+    if (w->sink != NULL && w->len > 0U)
+    {
+        w->sink(w->sink_ctx, w->buf, w->len);
+        w->len = 0U;
+    }
+}
+
+static void hq_json_put(hq_json_writer_t *w, const char *data, size_t n)
+{
+    w->total += n;
+
+    if (w->sink != NULL)
+    {
+        while (n > 0U)
+        {
+            size_t room = w->size - w->len;
+            size_t chunk = (n < room) ? n : room;
+
+            memcpy(w->buf + w->len, data, chunk);
+            w->len += chunk;
+            data += chunk;
+            n -= chunk;
+
+            if (w->len == w->size)
+            {
+                hq_json_flush(w);
+            }
+        }
+        return;
+    }
+
+    if (w->overflow || w->size == 0U || w->len + n >= w->size)
+    {
+        w->overflow = true;
+        return;
+    }
+
+    memcpy(w->buf + w->len, data, n);
+    w->len += n;
+    w->buf[w->len] = '\0';
+}
+
+static void hq_json_putc(hq_json_writer_t *w, char c)
+{
+    hq_json_put(w, &c, 1U);
+}
+
+static void hq_json_before_value(hq_json_writer_t *w)
+{
+    uint32_t bit;
+
+    if (w->after_key)
+    {
+        w->after_key = false;
+        return;
+    }
+
+    if (w->depth == 0U)
+    {
+        return;
+    }
+
+    bit = 1UL << (w->depth - 1U);
+    if (w->need_comma & bit)
+    {
+        hq_json_putc(w, ',');
+    }
+    w->need_comma |= bit;
+}
+
+static void hq_json_put_escaped(hq_json_writer_t *w, const char *s, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+    size_t run = 0U;
+
+    hq_json_putc(w, '"');
+
+    for (size_t i = 0U; i < len; i++)
+    {
+        unsigned char c = (unsigned char)s[i];
+        char esc[6];
+        size_t esc_len = 2U;
+
+        if (c >= 0x20U && c != '"' && c != '\\')
+        {
+            continue;
+        }
+
+        hq_json_put(w, s + run, i - run);
+        run = i + 1U;
+
+        esc[0] = '\\';
+        switch (c)
+        {
+            case '"':  esc[1] = '"';  break;
+            case '\\': esc[1] = '\\'; break;
+            case '\n': esc[1] = 'n';  break;
+            case '\r': esc[1] = 'r';  break;
+            case '\t': esc[1] = 't';  break;
+            case '\b': esc[1] = 'b';  break;
+            case '\f': esc[1] = 'f';  break;
+            default:
+                esc[1] = 'u';
+                esc[2] = '0';
+                esc[3] = '0';
+                esc[4] = hex[c >> 4];
+                esc[5] = hex[c & 0x0FU];
+                esc_len = 6U;
+                break;
+        }
+        hq_json_put(w, esc, esc_len);
+    }
+
+    hq_json_put(w, s + run, len - run);
+    hq_json_putc(w, '"');
+}
+
+static void hq_json_put_u64(hq_json_writer_t *w, uint64_t value, bool negative)
+{
+    char tmp[24];
+    size_t pos = sizeof(tmp);
+
+    do
+    {
+        tmp[--pos] = (char)('0' + (value % 10U));
+        value /= 10U;
+    } while (value != 0U);
+
+    if (negative)
+    {
+        tmp[--pos] = '-';
+    }
+
+    hq_json_put(w, tmp + pos, sizeof(tmp) - pos);
+}
+
+static void hq_json_open(hq_json_writer_t *w, char c)
+{
+    hq_json_before_value(w);
+    hq_json_putc(w, c);
+
+    if (w->depth >= HQ_JSON_MAX_DEPTH)
+    {
+        w->overflow = true;
+        return;
+    }
+
+    w->depth++;
+    w->need_comma &= ~(1UL << (w->depth - 1U));
+}
+
+static void hq_json_close(hq_json_writer_t *w, char c)
+{
+    if (w->depth == 0U)
+    {
+        w->overflow = true;
+        return;
+    }
+
+    w->depth--;
+    w->after_key = false;
+    hq_json_putc(w, c);
+}
+
+void hq_json_writer_init(hq_json_writer_t *w, char *buf, size_t size)
+{
+    memset(w, 0, sizeof(*w));
+    w->buf = buf;
+    w->size = size;
+
+    if (buf != NULL && size > 0U)
+    {
+        buf[0] = '\0';
+    }
+    else
+    {
+        w->size = 0U;
+    }
+}
+
+void hq_json_writer_init_sink(hq_json_writer_t *w, char *buf, size_t size,
+                              hq_json_sink_t sink, void *sink_ctx)
+{
+    hq_json_writer_init(w, buf, size);
+
+    if (w->size > 0U)
+    {
+        w->sink = sink;
+        w->sink_ctx = sink_ctx;
+    }
+}
+
+int32_t hq_json_writer_finish(hq_json_writer_t *w)
+{
+    hq_json_flush(w);
+
+    if (w->overflow || w->depth != 0U || w->total > (size_t)INT32_MAX)
+    {
+        return -1;
+    }
+
+    return (int32_t)w->total;
+}
+
+void hq_json_obj_begin(hq_json_writer_t *w)
+{
+    hq_json_open(w, '{');
+}
+
+void hq_json_obj_end(hq_json_writer_t *w)
+{
+    hq_json_close(w, '}');
+}
+
+void hq_json_arr_begin(hq_json_writer_t *w)
+{
+    hq_json_open(w, '[');
+}
+
+void hq_json_arr_end(hq_json_writer_t *w)
+{
+    hq_json_close(w, ']');
+}
+
+void hq_json_key(hq_json_writer_t *w, const char *key)
+{
+    hq_json_before_value(w);
+    hq_json_put_escaped(w, key, strlen(key));
+    hq_json_putc(w, ':');
+    w->after_key = true;
+}
+
+void hq_json_str(hq_json_writer_t *w, const char *value)
+{
+    if (value == NULL)
+    {
+        hq_json_null(w);
+        return;
+    }
+
+    hq_json_str_n(w, value, strlen(value));
+}
+
+void hq_json_str_n(hq_json_writer_t *w, const char *value, size_t len)
+{
+    hq_json_before_value(w);
+    hq_json_put_escaped(w, value, len);
+}
+
+void hq_json_int(hq_json_writer_t *w, int64_t value)
+{
+    hq_json_before_value(w);
+
+    if (value < 0)
+    {
+        hq_json_put_u64(w, (uint64_t)(-(value + 1)) + 1U, true);
+    }
+    else
+    {
+        hq_json_put_u64(w, (uint64_t)value, false);
+    }
+}
+
+void hq_json_uint(hq_json_writer_t *w, uint64_t value)
+{
+    hq_json_before_value(w);
+    hq_json_put_u64(w, value, false);
+}
+
+void hq_json_double(hq_json_writer_t *w, double value)
+{
+    char tmp[32];
+    int n;
+
+    /* NaN and infinities have no JSON representation. */
+    if (value != value || value > 1.7976931348623157e308 || value < -1.7976931348623157e308)
+    {
+        hq_json_null(w);
+        return;
+    }
+
+    hq_json_before_value(w);
+    n = snprintf(tmp, sizeof(tmp), "%.15g", value);
+    if (n > 0)
+    {
+        hq_json_put(w, tmp, (size_t)n);
+    }
+}
+
+void hq_json_bool(hq_json_writer_t *w, bool value)
+{
+    hq_json_before_value(w);
+    if (value)
+    {
+        hq_json_put(w, "true", 4U);
+    }
+    else
+    {
+        hq_json_put(w, "false", 5U);
+    }
+}
+
+void hq_json_null(hq_json_writer_t *w)
+{
+    hq_json_before_value(w);
+    hq_json_put(w, "null", 4U);
+}
+
+void hq_json_raw(hq_json_writer_t *w, const char *json, size_t len)
+{
+    hq_json_before_value(w);
+    hq_json_put(w, json, len);
+}
+
+void hq_json_kv_str(hq_json_writer_t *w, const char *key, const char *value)
+{
+    hq_json_key(w, key);
+    hq_json_str(w, value);
+}
+
+void hq_json_kv_int(hq_json_writer_t *w, const char *key, int64_t value)
+{
+    hq_json_key(w, key);
+    hq_json_int(w, value);
+}
+
+void hq_json_kv_uint(hq_json_writer_t *w, const char *key, uint64_t value)
+{
+    hq_json_key(w, key);
+    hq_json_uint(w, value);
+}
+
+void hq_json_kv_double(hq_json_writer_t *w, const char *key, double value)
+{
+    hq_json_key(w, key);
+    hq_json_double(w, value);
+}
+
+void hq_json_kv_bool(hq_json_writer_t *w, const char *key, bool value)
+{
+    hq_json_key(w, key);
+    hq_json_bool(w, value);
+}
@@ -0,0 +1,152 @@
+#ifndef HQ_JSON_H
+#define HQ_JSON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Maximum object/array nesting supported by the writer and the parser. */
+#define HQ_JSON_MAX_DEPTH   32
+
+/** Maximum number of fields in one hq_json_parse() schema. */
+#define HQ_JSON_MAX_FIELDS  32
+
+/**
+ * Output sink for a streaming writer.
+ *
+ * Called whenever the scratch buffer fills up and from hq_json_writer_finish().
+ * A sink appending to a Mongoose iobuf is a one-liner:
+ *
+ *     static void iobuf_sink(void *ctx, const char *data, size_t len)
+ *     {
+ *         struct mg_iobuf *io = ctx;
+ *         mg_iobuf_add(io, io->len, data, len);
+ *     }
+ */
+typedef void (*hq_json_sink_t)(void *ctx, const char *data, size_t len);
+
+/** Writer state. Treat as opaque; initialise with hq_json_writer_init*(). */
+typedef struct
+{
+    char *buf;
+    size_t size;
+    size_t len;
+    size_t total;
+    hq_json_sink_t sink;
+    void *sink_ctx;
+    uint32_t depth;
+    uint32_t need_comma;   /* bit N set: level N already holds an element */
+    bool after_key;
+    bool overflow;
+} hq_json_writer_t;
+
+typedef enum
+{
+    HQ_JSON_TYPE_STRING,   /**< out: char[out_size], unescaped, NUL-terminated */
+    HQ_JSON_TYPE_INT,      /**< out: int64_t */
+    HQ_JSON_TYPE_DOUBLE,   /**< out: double */
+    HQ_JSON_TYPE_BOOL,     /**< out: bool */
+    HQ_JSON_TYPE_SPAN      /**< out: hq_json_span_t pointing into the input */
+} hq_json_type_t;
+
+/** Zero-copy reference to a raw JSON token inside the parsed document. */
+typedef struct
+{
+    const char *ptr;
+    size_t len;
+} hq_json_span_t;
+
+/**
+ * One entry of a parse schema.
+ *
+ * @p path uses the same JSONPath subset as mg_json_get(): "$", "$.a.b",
+ * "$.list[2].name".
+ */
+typedef struct
+{
+    const char *path;
+    hq_json_type_t type;
+    void *out;
+    size_t out_size;
+} hq_json_field_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ── Writer ────────────────────────────────────────────────────────── */
+
+/**
+ * Initialise a writer producing into a fixed caller buffer.
+ * Output is NUL-terminated while it fits; on overflow the output is
+ * rejected and hq_json_writer_finish() returns -1.
+ */
+void hq_json_writer_init(hq_json_writer_t *w, char *buf, size_t size);
+
+/**
+ * Initialise a streaming writer. @p buf is scratch space that is handed to
+ * @p sink every time it fills up, so documents of any size can be produced
+ * with a small fixed buffer.
+ */
+void hq_json_writer_init_sink(hq_json_writer_t *w, char *buf, size_t size,
+                              hq_json_sink_t sink, void *sink_ctx);
+
+/**
+ * Flush pending output to the sink (if any).
+ * @return Total bytes produced, or -1 if the output did not fit or the
+ *         document nesting is invalid.
+ */
+int32_t hq_json_writer_finish(hq_json_writer_t *w);
+
+void hq_json_obj_begin(hq_json_writer_t *w);
+void hq_json_obj_end(hq_json_writer_t *w);
+void hq_json_arr_begin(hq_json_writer_t *w);
+void hq_json_arr_end(hq_json_writer_t *w);
+void hq_json_key(hq_json_writer_t *w, const char *key);
+
+void hq_json_str(hq_json_writer_t *w, const char *value);
+void hq_json_str_n(hq_json_writer_t *w, const char *value, size_t len);
+void hq_json_int(hq_json_writer_t *w, int64_t value);
+void hq_json_uint(hq_json_writer_t *w, uint64_t value);
+void hq_json_double(hq_json_writer_t *w, double value);
+void hq_json_bool(hq_json_writer_t *w, bool value);
+void hq_json_null(hq_json_writer_t *w);
+
+/** Emit an already-encoded JSON value verbatim. */
+void hq_json_raw(hq_json_writer_t *w, const char *json, size_t len);
+
+/* Key/value shortcuts for object members. */
+void hq_json_kv_str(hq_json_writer_t *w, const char *key, const char *value);
+void hq_json_kv_int(hq_json_writer_t *w, const char *key, int64_t value);
+void hq_json_kv_uint(hq_json_writer_t *w, const char *key, uint64_t value);
+void hq_json_kv_double(hq_json_writer_t *w, const char *key, double value);
+void hq_json_kv_bool(hq_json_writer_t *w, const char *key, bool value);
+
+/* ── Parser ────────────────────────────────────────────────────────── */
+
+/**
+ * Extract every field of @p fields from @p json in a single pass.
+ *
+ * Subtrees that no schema path can match are skipped without building
+ * paths, so the cost is one scan of the document regardless of how many
+ * fields are requested.
+ *
+ * @param json    Document (need not be NUL-terminated)
+ * @param len     Document length in bytes
+ * @param fields  Schema table
+ * @param count   Number of schema entries (<= HQ_JSON_MAX_FIELDS)
+ * @param found   Optional; bit i is set when fields[i] was extracted
+ * @return Number of fields extracted, or -1 on malformed input / bad schema.
+ *         A field whose JSON type does not match its schema type, or an
+ *         integer field whose value does not fit in int64_t, is not
+ *         counted as found.
+ */
+int32_t hq_json_parse(const char *json, size_t len,
+                      const hq_json_field_t *fields, size_t count,
+                      uint32_t *found);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HQ_JSON_H */
@@ -0,0 +1,530 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hq_metrics.h"
+#include "osal_mutex.h"
+#include "osal_task.h"
+
+struct hq_metric
+{
+    const char *name;
+    const char *labels;
+    const char *help;
+    hq_metric_type_t type;
+    uint32_t slot;          /* first slot in every shard row */
+    uint32_t bound_count;   /* histograms: buckets = bound_count + 1, then sum */
+    uint64_t bounds[HQ_METRICS_MAX_BUCKETS];
+    int64_t gauge;
+};
+
+struct hq_metrics_out
+{
+    hq_metrics_sink_t sink;
+    void *ctx;
+    size_t total;
+    const char *family;
+    /* Pieces of lines are collected here and handed to the sink in blocks */
+    size_t len;
+    char buf[256];
+};
+
+typedef struct
+{
+    hq_metrics_collector_t fn;
+    void *ctx;
+} hq_metrics_collector_entry_t;
+
+/*
+ * Each thread is bound to one shard row and only ever adds to it, so hot
+ * counters updated from several tasks do not bounce a shared cache line.
+ * Rows are summed at scrape time. More threads than shards simply share
+ * rows; the relaxed atomic adds keep that correct.
+ */
+static uint64_t g_slots[CONFIG_METRICS_SHARD_COUNT][CONFIG_METRICS_SLOT_COUNT]
+    __attribute__((aligned(64)));
+
+static struct hq_metric g_metrics[CONFIG_METRICS_MAX_COUNT];
+static uint32_t g_metric_count;
+static uint32_t g_slot_count;
+
+static hq_metrics_collector_entry_t g_collectors[CONFIG_METRICS_MAX_COLLECTORS];
+static uint32_t g_collector_count;
+
+static osal_mutex_id_t g_lock;
+static bool g_initialized;
+
+static uint32_t g_next_shard;
+static __thread uint32_t t_shard;   /* shard index + 1, 0 = unassigned */
+
+static uint64_t *hq_metrics_row(void)
+{
+    if (t_shard == 0U)
+    {
+        t_shard = (__atomic_fetch_add(&g_next_shard, 1U, __ATOMIC_RELAXED) %
+                   CONFIG_METRICS_SHARD_COUNT) + 1U;
+    }
+
+    return g_slots[t_shard - 1U];
+}
+
+static uint64_t hq_metrics_slot_sum(uint32_t slot)
+{
+    uint64_t sum = 0U;
+
+    for (uint32_t s = 0U; s < CONFIG_METRICS_SHARD_COUNT; s++)
+    {
+        sum += __atomic_load_n(&g_slots[s][slot], __ATOMIC_RELAXED);
+    }
+
+    return sum;
+}
+
+static bool hq_metrics_str_eq(const char *a, const char *b)
+{
+    if (a == NULL || b == NULL)
+    {
+        return a == b;
+    }
+
+    return strcmp(a, b) == 0;
+}
+
+static hq_metric_t *hq_metrics_register(hq_metric_type_t type, const char *name,
+                                        const char *labels, const char *help,
+                                        const uint64_t *bounds, uint32_t bound_count)
+{
+    hq_metric_t *metric = NULL;
+    uint32_t slots;
+
+    if (name == NULL || bound_count > HQ_METRICS_MAX_BUCKETS ||
+        (bound_count > 0U && bounds == NULL))
+    {
+        return NULL;
+    }
+
+    if (hq_metrics_init() != OSAL_SUCCESS)
+    {
+        return NULL;
+    }
+
+    switch (type)
+    {
+        case HQ_METRIC_COUNTER:   slots = 1U; break;
+        case HQ_METRIC_HISTOGRAM: slots = bound_count + 2U; break;
+        case HQ_METRIC_GAUGE:
+        default:                  slots = 0U; break;
+    }
+
+    (void)osal_mutex_take(g_lock);
+
+    for (uint32_t i = 0U; i < g_metric_count; i++)
+    {
+        if (strcmp(g_metrics[i].name, name) == 0 && hq_metrics_str_eq(g_metrics[i].labels, labels))
+        {
+            metric = (g_metrics[i].type == type) ? &g_metrics[i] : NULL;
+            (void)osal_mutex_give(g_lock);
+            return metric;
+        }
+    }
+
+    if (g_metric_count < CONFIG_METRICS_MAX_COUNT &&
+        g_slot_count + slots <= CONFIG_METRICS_SLOT_COUNT)
+    {
+        metric = &g_metrics[g_metric_count];
+        memset(metric, 0, sizeof(*metric));
+        metric->name = name;
+        metric->labels = labels;
+        metric->help = help;
+        metric->type = type;
+        metric->slot = g_slot_count;
+        metric->bound_count = bound_count;
+        if (bound_count > 0U)
+        {
+            memcpy(metric->bounds, bounds, bound_count * sizeof(bounds[0]));
+        }
+
+        g_slot_count += slots;
+        g_metric_count++;
+    }
+
+    (void)osal_mutex_give(g_lock);
+    return metric;
+}
+
+int32_t hq_metrics_init(void)
+{
+    static uint32_t init_flag;
+    osal_status_t status;
+
+    if (__atomic_load_n(&g_initialized, __ATOMIC_ACQUIRE))
+    {
+        return OSAL_SUCCESS;
+    }
+
+    /* Losers of the race wait for the winner to publish the lock. */
+    if (__atomic_exchange_n(&init_flag, 1U, __ATOMIC_ACQ_REL) != 0U)
+    {
+        while (!__atomic_load_n(&g_initialized, __ATOMIC_ACQUIRE))
+        {
+            (void)osal_task_delay_ms(1U);
+        }
+        return OSAL_SUCCESS;
+    }
+
+    status = osal_mutex_create(&g_lock, "metrics");
+    if (status != OSAL_SUCCESS)
+    {
+        __atomic_store_n(&init_flag, 0U, __ATOMIC_RELEASE);
+        return status;
+    }
+
+    __atomic_store_n(&g_initialized, true, __ATOMIC_RELEASE);
+    return OSAL_SUCCESS;
+}
+
+hq_metric_t *hq_metrics_counter(const char *name, const char *labels, const char *help)
+{
+    return hq_metrics_register(HQ_METRIC_COUNTER, name, labels, help, NULL, 0U);
+}
+
+hq_metric_t *hq_metrics_gauge(const char *name, const char *labels, const char *help)
+{
+    return hq_metrics_register(HQ_METRIC_GAUGE, name, labels, help, NULL, 0U);
+}
+
+hq_metric_t *hq_metrics_histogram(const char *name, const char *labels, const char *help,
+                                  const uint64_t *bounds, uint32_t bound_count)
+{
+    for (uint32_t i = 1U; i < bound_count; i++)
+    {
+        if (bounds[i] <= bounds[i - 1U])
+        {
+            return NULL;
+        }
+    }
+
+    return hq_metrics_register(HQ_METRIC_HISTOGRAM, name, labels, help, bounds, bound_count);
+}
+
+int32_t hq_metrics_register_collector(hq_metrics_collector_t collector, void *ctx)
+{
+    int32_t status = OSAL_ERROR;
+
+    if (collector == NULL)
+    {
+        return OSAL_INVALID_POINTER;
+    }
+
+    if (hq_metrics_init() != OSAL_SUCCESS)
+    {
+        return OSAL_ERROR;
+    }
+
+    (void)osal_mutex_take(g_lock);
+
+    for (uint32_t i = 0U; i < g_collector_count; i++)
+    {
+        if (g_collectors[i].fn == collector && g_collectors[i].ctx == ctx)
+        {
+            (void)osal_mutex_give(g_lock);
+            return OSAL_SUCCESS;
+        }
+    }
+
+    if (g_collector_count < CONFIG_METRICS_MAX_COLLECTORS)
+    {
+        g_collectors[g_collector_count].fn = collector;
+        g_collectors[g_collector_count].ctx = ctx;
+        g_collector_count++;
+        status = OSAL_SUCCESS;
+    }
+
+    (void)osal_mutex_give(g_lock);
+    return status;
+}
+
+void hq_metrics_inc(hq_metric_t *metric)
+{
+    hq_metrics_add(metric, 1U);
+}
+
+void hq_metrics_add(hq_metric_t *metric, uint64_t value)
+{
+    if (metric == NULL || metric->type != HQ_METRIC_COUNTER)
+    {
+        return;
+    }
+
+    __atomic_fetch_add(&hq_metrics_row()[metric->slot], value, __ATOMIC_RELAXED);
+}
+
+void hq_metrics_set(hq_metric_t *metric, int64_t value)
+{
+    if (metric == NULL || metric->type != HQ_METRIC_GAUGE)
+    {
+        return;
+    }
+
+    __atomic_store_n(&metric->gauge, value, __ATOMIC_RELAXED);
+}
+
+void hq_metrics_gauge_add(hq_metric_t *metric, int64_t delta)
+{
+    if (metric == NULL || metric->type != HQ_METRIC_GAUGE)
+    {
+        return;
+    }
+
+    __atomic_fetch_add(&metric->gauge, delta, __ATOMIC_RELAXED);
+}
+
+void hq_metrics_observe(hq_metric_t *metric, uint64_t value)
+{
+    uint64_t *row;
+    uint32_t bucket = 0U;
+
+    if (metric == NULL || metric->type != HQ_METRIC_HISTOGRAM)
+    {
+        return;
+    }
+
+    while (bucket < metric->bound_count && value > metric->bounds[bucket])
+    {
+        bucket++;
+    }
+
+    row = hq_metrics_row();
+    __atomic_fetch_add(&row[metric->slot + bucket], 1U, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&row[metric->slot + metric->bound_count + 1U], value, __ATOMIC_RELAXED);
+}
+
+int64_t hq_metrics_value(const hq_metric_t *metric)
+{
+    uint64_t count = 0U;
+
+    if (metric == NULL)
+    {
+        return 0;
+    }
+
+    switch (metric->type)
+    {
+        case HQ_METRIC_COUNTER:
+            return (int64_t)hq_metrics_slot_sum(metric->slot);
+
+        case HQ_METRIC_GAUGE:
+            return __atomic_load_n(&metric->gauge, __ATOMIC_RELAXED);
+
+        case HQ_METRIC_HISTOGRAM:
+        default:
+            for (uint32_t b = 0U; b <= metric->bound_count; b++)
+            {
+                count += hq_metrics_slot_sum(metric->slot + b);
+            }
+            return (int64_t)count;
+    }
+}
+
+/* ── Exposition ────────────────────────────────────────────────────── */
+
+static void hq_metrics_flush(hq_metrics_out_t *out)
+{
+    if (out->len > 0U)
+    {
+        out->sink(out->ctx, out->buf, out->len);
+        out->len = 0U;
+    }
+}
+
+static void hq_metrics_put(hq_metrics_out_t *out, const char *data, size_t len)
+{
+    out->total += len;
+    while (len > 0U)
+    {
+        size_t n = sizeof(out->buf) - out->len;
+
+        if (n > len)
+        {
+            n = len;
+        }
+        memcpy(out->buf + out->len, data, n);
+        out->len += n;
+        data += n;
+        len -= n;
+        if (out->len == sizeof(out->buf))
+        {
+            hq_metrics_flush(out);
+        }
+    }
+}
+
+/* Lines go out piece by piece, so no name, label set or help text is too
+ * long for them */
+static void hq_metrics_put_str(hq_metrics_out_t *out, const char *text)
+{
+    hq_metrics_put(out, text, strlen(text));
+}
+
+static const char *hq_metrics_type_name(hq_metric_type_t type)
+{
+    switch (type)
+    {
+        case HQ_METRIC_COUNTER:   return "counter";
+        case HQ_METRIC_HISTOGRAM: return "histogram";
+        case HQ_METRIC_GAUGE:
+        default:                  return "gauge";
+    }
+}
+
+/* HELP/TYPE once per family; samples of one family must be contiguous. */
+static void hq_metrics_family(hq_metrics_out_t *out, hq_metric_type_t type,
+                              const char *name, const char *help)
+{
+    if (out->family != NULL && strcmp(out->family, name) == 0)
+    {
+        return;
+    }
+
+    out->family = name;
+    if (help != NULL)
+    {
+        hq_metrics_put_str(out, "# HELP ");
+        hq_metrics_put_str(out, name);
+        hq_metrics_put_str(out, " ");
+        hq_metrics_put_str(out, help);
+        hq_metrics_put_str(out, "\n");
+    }
+    hq_metrics_put_str(out, "# TYPE ");
+    hq_metrics_put_str(out, name);
+    hq_metrics_put_str(out, " ");
+    hq_metrics_put_str(out, hq_metrics_type_name(type));
+    hq_metrics_put_str(out, "\n");
+}
+
+static void hq_metrics_sample(hq_metrics_out_t *out, const char *name, const char *suffix,
+                              const char *labels, const char *le, const char *value)
+{
+    bool has_labels = (labels != NULL && labels[0] != '\0');
+
+    hq_metrics_put_str(out, name);
+    hq_metrics_put_str(out, suffix);
+    if (has_labels || le != NULL)
+    {
+        hq_metrics_put_str(out, "{");
+        if (has_labels)
+        {
+            hq_metrics_put_str(out, labels);
+        }
+        if (le != NULL)
+        {
+            hq_metrics_put_str(out, has_labels ? ",le=\"" : "le=\"");
+            hq_metrics_put_str(out, le);
+            hq_metrics_put_str(out, "\"");
+        }
+        hq_metrics_put_str(out, "}");
+    }
+    hq_metrics_put_str(out, " ");
+    hq_metrics_put_str(out, value);
+    hq_metrics_put_str(out, "\n");
+}
+
+static void hq_metrics_render_metric(hq_metrics_out_t *out, const hq_metric_t *metric)
+{
+    char value[24];
+    char le[24];
+    uint64_t cumulative = 0U;
+
+    hq_metrics_family(out, metric->type, metric->name, metric->help);
+
+    if (metric->type != HQ_METRIC_HISTOGRAM)
+    {
+        snprintf(value, sizeof(value), "%" PRId64, hq_metrics_value(metric));
+        hq_metrics_sample(out, metric->name, "", metric->labels, NULL, value);
+        return;
+    }
+
+    for (uint32_t b = 0U; b <= metric->bound_count; b++)
+    {
+        cumulative += hq_metrics_slot_sum(metric->slot + b);
+        if (b < metric->bound_count)
+        {
+            snprintf(le, sizeof(le), "%" PRIu64, metric->bounds[b]);
+        }
+        else
+        {
+            snprintf(le, sizeof(le), "+Inf");
+        }
+        snprintf(value, sizeof(value), "%" PRIu64, cumulative);
+        hq_metrics_sample(out, metric->name, "_bucket", metric->labels, le, value);
+    }
+
+    snprintf(value, sizeof(value), "%" PRIu64,
+             hq_metrics_slot_sum(metric->slot + metric->bound_count + 1U));
+    hq_metrics_sample(out, metric->name, "_sum", metric->labels, NULL, value);
+    snprintf(value, sizeof(value), "%" PRIu64, cumulative);
+    hq_metrics_sample(out, metric->name, "_count", metric->labels, NULL, value);
+}
+
+void hq_metrics_emit(hq_metrics_out_t *out, hq_metric_type_t type, const char *name,
+                     const char *labels, const char *help, int64_t value)
+{
+    char text[24];
+
+    if (out == NULL || name == NULL || type == HQ_METRIC_HISTOGRAM)
+    {
+        return;
+    }
+
+    hq_metrics_family(out, type, name, help);
+    snprintf(text, sizeof(text), "%" PRId64, value);
+    hq_metrics_sample(out, name, "", labels, NULL, text);
+}
+
+int32_t hq_metrics_render(hq_metrics_sink_t sink, void *ctx)
+{
+    hq_metrics_out_t out;
+    bool done[CONFIG_METRICS_MAX_COUNT];
+
+    if (sink == NULL || !__atomic_load_n(&g_initialized, __ATOMIC_ACQUIRE))
+    {
+        return -1;
+    }
+
+    memset(&out, 0, sizeof(out));
+    out.sink = sink;
+    out.ctx = ctx;
+
+    (void)osal_mutex_take(g_lock);
+
+    /* Group series that share a name (label variants) under one family. */
+    memset(done, 0, sizeof(done));
+    for (uint32_t i = 0U; i < g_metric_count; i++)
+    {
+        if (done[i])
+        {
+            continue;
+        }
+
+        for (uint32_t j = i; j < g_metric_count; j++)
+        {
+            if (!done[j] && strcmp(g_metrics[j].name, g_metrics[i].name) == 0)
+            {
+                hq_metrics_render_metric(&out, &g_metrics[j]);
+                done[j] = true;
+            }
+        }
+    }
+
+    for (uint32_t i = 0U; i < g_collector_count; i++)
+    {
+        out.family = NULL;
+        g_collectors[i].fn(&out, g_collectors[i].ctx);
+    }
+    hq_metrics_flush(&out);
+
+    (void)osal_mutex_give(g_lock);
+
+    return (out.total > (size_t)INT32_MAX) ? INT32_MAX : (int32_t)out.total;
+}
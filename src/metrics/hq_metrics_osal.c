@@ -0,0 +1,34 @@
+#include "hq_metrics.h"
+#include "osal_file.h"
+
+static void hq_metrics_osal_file(hq_metrics_out_t *out, void *ctx)
+{
+    osal_file_stats_t stats;
+
+    (void)ctx;
+
+    if (osal_file_get_stats(&stats) != OSAL_SUCCESS)
+    {
+        return;
+    }
+
+    hq_metrics_emit(out, HQ_METRIC_COUNTER, "hq_osal_file_opens_total", NULL,
+                    "Files opened", (int64_t)stats.opens);
+    hq_metrics_emit(out, HQ_METRIC_COUNTER, "hq_osal_file_open_errors_total", NULL,
+                    "Failed file opens", (int64_t)stats.open_errors);
+    hq_metrics_emit(out, HQ_METRIC_COUNTER, "hq_osal_file_ops_total", "op=\"read\"",
+                    "File read/write calls", (int64_t)stats.reads);
+    hq_metrics_emit(out, HQ_METRIC_COUNTER, "hq_osal_file_ops_total", "op=\"write\"",
+                    NULL, (int64_t)stats.writes);
+    hq_metrics_emit(out, HQ_METRIC_COUNTER, "hq_osal_file_bytes_total", "op=\"read\"",
+                    "File bytes transferred", (int64_t)stats.read_bytes);
+    hq_metrics_emit(out, HQ_METRIC_COUNTER, "hq_osal_file_bytes_total", "op=\"write\"",
+                    NULL, (int64_t)stats.write_bytes);
+    hq_metrics_emit(out, HQ_METRIC_COUNTER, "hq_osal_file_io_errors_total", NULL,
+                    "Failed file reads and writes", (int64_t)stats.io_errors);
+}
+
+int32_t hq_metrics_register_osal(void)
+{
+    return hq_metrics_register_collector(hq_metrics_osal_file, NULL);
+}
@@ -0,0 +1,117 @@
+#ifndef HQ_METRICS_H
+#define HQ_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hq_config.h"
+
+#ifndef CONFIG_METRICS_MAX_COUNT
+#define CONFIG_METRICS_MAX_COUNT 64
+#endif
+
+#ifndef CONFIG_METRICS_SLOT_COUNT
+#define CONFIG_METRICS_SLOT_COUNT 256
+#endif
+
+#ifndef CONFIG_METRICS_SHARD_COUNT
+#define CONFIG_METRICS_SHARD_COUNT 2
+#endif
+
+#ifndef CONFIG_METRICS_MAX_COLLECTORS
+#define CONFIG_METRICS_MAX_COLLECTORS 8
+#endif
+
+/** Maximum number of finite bucket bounds in one histogram. */
+#define HQ_METRICS_MAX_BUCKETS 16
+
+typedef enum
+{
+    HQ_METRIC_COUNTER,
+    HQ_METRIC_GAUGE,
+    HQ_METRIC_HISTOGRAM
+} hq_metric_type_t;
+
+/** Registered metric handle. All update functions accept NULL as a no-op. */
+typedef struct hq_metric hq_metric_t;
+
+/** Render context handed to collectors. */
+typedef struct hq_metrics_out hq_metrics_out_t;
+
+/** Output sink for hq_metrics_render(). */
+typedef void (*hq_metrics_sink_t)(void *ctx, const char *data, size_t len);
+
+/**
+ * Collector for values that are cheaper to pull at scrape time than to
+ * push on every change (queue depths, connection counts, OSAL stats).
+ * Runs under the registry lock; must not register metrics.
+ */
+typedef void (*hq_metrics_collector_t)(hq_metrics_out_t *out, void *ctx);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ── Registry ──────────────────────────────────────────────────────── */
+
+/** Create the registry lock. Safe to call more than once. */
+int32_t hq_metrics_init(void);
+
+/**
+ * Register a metric, or return the existing one with the same name and
+ * labels so modules can be re-initialised without leaking slots.
+ *
+ * @param name    Prometheus metric name, e.g. "hq_http_requests_total"
+ * @param labels  Constant label set without braces, e.g. "code=\"2xx\"", or NULL
+ * @param help    One-line description, or NULL
+ *
+ * Strings are referenced, not copied, and must outlive the registry.
+ * @return Metric handle, or NULL if the registry is full.
+ */
+hq_metric_t *hq_metrics_counter(const char *name, const char *labels, const char *help);
+hq_metric_t *hq_metrics_gauge(const char *name, const char *labels, const char *help);
+
+/**
+ * Register a histogram with ascending finite upper bounds; the +Inf bucket
+ * is implicit. @p bounds is copied.
+ */
+hq_metric_t *hq_metrics_histogram(const char *name, const char *labels, const char *help,
+                                  const uint64_t *bounds, uint32_t bound_count);
+
+/** Register a pull collector. */
+int32_t hq_metrics_register_collector(hq_metrics_collector_t collector, void *ctx);
+
+/* ── Updates (lock-free) ───────────────────────────────────────────── */
+
+void hq_metrics_inc(hq_metric_t *metric);
+void hq_metrics_add(hq_metric_t *metric, uint64_t value);
+void hq_metrics_set(hq_metric_t *metric, int64_t value);
+void hq_metrics_gauge_add(hq_metric_t *metric, int64_t delta);
+void hq_metrics_observe(hq_metric_t *metric, uint64_t value);
+
+/* ── Reading ───────────────────────────────────────────────────────── */
+
+/** Counter total, gauge value or histogram observation count. */
+int64_t hq_metrics_value(const hq_metric_t *metric);
+
+/**
+ * Render every metric and collector in Prometheus text exposition format
+ * (version 0.0.4).
+ * @return Bytes produced, or -1 if the registry is not initialised.
+ */
+int32_t hq_metrics_render(hq_metrics_sink_t sink, void *ctx);
+
+/** Emit one sample from inside a collector. */
+void hq_metrics_emit(hq_metrics_out_t *out, hq_metric_type_t type, const char *name,
+                     const char *labels, const char *help, int64_t value);
+
+/* ── Built-in collectors ───────────────────────────────────────────── */
+
+/** Export OSAL layer statistics (file I/O counters). */
+int32_t hq_metrics_register_osal(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HQ_METRICS_H */
@@ -1,24 +1,115 @@
 #include "mongoose_process.h"
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 
 #include "hq_config.h"
+#include "hq_metrics.h"
+#include "osal_bin_sem.h"
+#include "osal_queue.h"
 #include "osal_task.h"
 
 #ifndef CONFIG_MONGOOSE_LOG_LEVEL
 #define CONFIG_MONGOOSE_LOG_LEVEL 2
 #endif
 
+#ifndef CONFIG_MONGOOSE_TASK_STACK_SIZE
+#define CONFIG_MONGOOSE_TASK_STACK_SIZE 16384
+#endif
+
+#ifndef CONFIG_MONGOOSE_CALL_QUEUE_SIZE
+#define CONFIG_MONGOOSE_CALL_QUEUE_SIZE 32
+#endif
+
+// No connection carries this id, so the wakeup only interrupts the poll.
+#define DOORBELL_CONN_ID ( ~0UL )
+#define CALL_TIMEOUT_MS  1000
+
+typedef struct
+{
+  MongooseProcessFn_t fn;
+  void* arg;
+  osal_bin_sem_id_t* done;
+  uint64_t postedUs;
+} call_t;
+
 struct mg_mgr mgr;
 static osal_task_id_t mongooseProcessId;
 static bool mongooseProcessRunning = false;
+static osal_queue_id_t callQueue;
+static __thread bool onPollTask;
+static hq_metric_t* pollMetric;
+static hq_metric_t* connectionsMetric;
+static hq_metric_t* callsMetric;
+// Poll task only
+static uint64_t polls;
+static uint64_t calls;
+static uint64_t callLatencySumUs;
+static uint32_t callLatencyMaxUs;
+
+static void _drain_calls( void )
+{
+  call_t call;
+
+  while ( osal_queue_receive( callQueue, &call, 0 ) == OSAL_SUCCESS )
+  {
+    uint64_t latencyUs = osal_task_get_time_us() - call.postedUs;
+
+    calls++;
+    callLatencySumUs += latencyUs;
+    if ( latencyUs > callLatencyMaxUs )
+    {
+      callLatencyMaxUs = ( latencyUs > UINT32_MAX ) ? UINT32_MAX : (uint32_t)latencyUs;
+    }
+
+    call.fn( call.arg );
+    if ( call.done != NULL )
+    {
+      (void)osal_bin_sem_give( *call.done );
+    }
+    hq_metrics_inc( callsMetric );
+  }
+}
+
+static bool _post( MongooseProcessFn_t fn, void* arg, osal_bin_sem_id_t* done )
+{
+  call_t call = { fn, arg, done, osal_task_get_time_us() };
+
+  if ( !mongooseProcessRunning || fn == NULL )
+  {
+    return false;
+  }
+
+  if ( osal_queue_send( callQueue, &call, CALL_TIMEOUT_MS ) != OSAL_SUCCESS )
+  {
+    return false;
+  }
+
+  // Reads of the wakeup pipe coalesce, so it is only a doorbell; the
+  // queue above carries the actual work.
+  mg_wakeup( &mgr, DOORBELL_CONN_ID, "", 0 );
+  return true;
+}
 
 static void _process( void* arg )
 {
   (void)arg;
+  onPollTask = true;
   while ( 1 )
   {
     mg_mgr_poll( &mgr, 1000 );
+    _drain_calls();
+
+    // The connection list is only safe to walk from the poll task.
+    int64_t connections = 0;
+    for ( struct mg_connection* c = mgr.conns; c != NULL; c = c->next )
+    {
+      connections++;
+    }
+    polls++;
+    hq_metrics_inc( pollMetric );
+    hq_metrics_set( connectionsMetric, connections );
   }
 }
 
@@ -32,15 +123,31 @@ void MongooseProcess_Init( void )
   mg_mgr_init( &mgr );
   mg_log_set( CONFIG_MONGOOSE_LOG_LEVEL );
 
+  if ( !mg_wakeup_init( &mgr ) ||
+       osal_queue_create( &callQueue, "mg_call", CONFIG_MONGOOSE_CALL_QUEUE_SIZE, sizeof( call_t ) ) != OSAL_SUCCESS )
+  {
+    mg_mgr_free( &mgr );
+    return;
+  }
+
+  pollMetric = hq_metrics_counter( "hq_mg_poll_total", NULL, "Mongoose event loop iterations" );
+  connectionsMetric = hq_metrics_gauge( "hq_mg_connections", NULL, "Open Mongoose connections" );
+  callsMetric = hq_metrics_counter( "hq_mg_calls_total", NULL, "Functions marshalled onto the Mongoose poll task" );
+  polls = 0;
+  calls = 0;
+  callLatencySumUs = 0;
+  callLatencyMaxUs = 0;
+
   if ( osal_task_create( &mongooseProcessId,
                          "mg_poll",
                          _process,
                          NULL,
                          NULL,
-                         16384,
+                         CONFIG_MONGOOSE_TASK_STACK_SIZE,
                          5,
                          NULL ) != OSAL_SUCCESS )
   {
+    (void)osal_queue_delete( callQueue );
     mg_mgr_free( &mgr );
     return;
   }
@@ -50,11 +157,79 @@ void MongooseProcess_Init( void )
 
 void MongooseProcess_Deinit( void )
 {
-  if ( mongooseProcessRunning )
+  if ( !mongooseProcessRunning )
   {
-    (void)osal_task_delete( mongooseProcessId );
-    mongooseProcessRunning = false;
+    return;
   }
 
+  mongooseProcessRunning = false;
+  (void)osal_task_delete( mongooseProcessId );
+  (void)osal_queue_delete( callQueue );
   mg_mgr_free( &mgr );
 }
+
+bool MongooseProcess_Call( MongooseProcessFn_t fn, void* arg )
+{
+  return _post( fn, arg, NULL );
+}
+
+bool MongooseProcess_CallWait( MongooseProcessFn_t fn, void* arg )
+{
+  osal_bin_sem_id_t done;
+  bool posted;
+
+  if ( onPollTask )
+  {
+    fn( arg );
+    return true;
+  }
+
+  if ( osal_bin_sem_create( &done, "mg_wait", 0 ) != OSAL_SUCCESS )
+  {
+    return false;
+  }
+
+  posted = _post( fn, arg, &done );
+  if ( posted )
+  {
+    // The poll task always drains its queue, so waiting cannot time out
+    // into a use-after-free of the semaphore.
+    (void)osal_bin_sem_take( done );
+  }
+
+  (void)osal_bin_sem_delete( done );
+  return posted;
+}
+
+bool MongooseProcess_IsPollTask( void )
+{
+  return onPollTask;
+}
+
+static void _collect_stats( void* arg )
+{
+  MongooseProcessStats_t* stats = (MongooseProcessStats_t*)arg;
+
+  memset( stats, 0, sizeof( *stats ) );
+  for ( struct mg_connection* c = mgr.conns; c != NULL; c = c->next )
+  {
+    stats->connections++;
+    stats->listeners += c->is_listening ? 1 : 0;
+    stats->tls += c->is_tls ? 1 : 0;
+    stats->recvBuffered += c->recv.len;
+    stats->sendBuffered += c->send.len;
+  }
+  stats->polls = polls;
+  stats->calls = calls;
+  stats->callLatencyAvgUs = ( calls > 0 ) ? (uint32_t)( callLatencySumUs / calls ) : 0;
+  stats->callLatencyMaxUs = callLatencyMaxUs;
+}
+
+bool MongooseProcess_GetStats( MongooseProcessStats_t* stats )
+{
+  if ( stats == NULL )
+  {
+    return false;
+  }
+  return MongooseProcess_CallWait( _collect_stats, stats );
+}
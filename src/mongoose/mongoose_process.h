@@ -1,10 +1,27 @@
 #ifndef MONGOOSE_PROCESS_H
 #define MONGOOSE_PROCESS_H
 
+#include <stdbool.h>
+
 #include "mongoose.h"
 
 extern struct mg_mgr mgr;
 
+typedef void ( *MongooseProcessFn_t )( void* arg );
+
+typedef struct
+{
+  uint32_t connections;        // Open connections, listeners included
+  uint32_t listeners;
+  uint32_t tls;                // Connections using TLS
+  size_t recvBuffered;         // Bytes received and not yet handled
+  size_t sendBuffered;         // Bytes waiting to be sent
+  uint64_t polls;              // Event loop iterations
+  uint64_t calls;              // Functions run through MongooseProcess_Call()
+  uint32_t callLatencyAvgUs;   // Time from posting a call to it running
+  uint32_t callLatencyMaxUs;
+} MongooseProcessStats_t;
+
 /**
  * @brief Initializes the mongoose process and manager.
  */
@@ -15,4 +32,32 @@ void MongooseProcess_Init( void );
  */
 void MongooseProcess_Deinit( void );
 
+/**
+ * @brief Runs fn(arg) on the poll task after the current poll iteration.
+ *
+ * Mongoose is not thread safe: every mg_* call on the shared manager has
+ * to happen on the poll task. Other tasks marshal work through here.
+ *
+ * @return false if the process is not running or the call queue stayed full.
+ */
+bool MongooseProcess_Call( MongooseProcessFn_t fn, void* arg );
+
+/**
+ * @brief Same as MongooseProcess_Call(), but blocks until fn has returned.
+ *        Runs fn inline when called from the poll task itself.
+ */
+bool MongooseProcess_CallWait( MongooseProcessFn_t fn, void* arg );
+
+/**
+ * @brief Returns true when called from the poll task.
+ */
+bool MongooseProcess_IsPollTask( void );
+
+/**
+ * @brief Fills stats with the state of the connections and the event loop.
+ *        Waits for the poll task like MongooseProcess_CallWait().
+ * @return false if the process is not running.
+ */
+bool MongooseProcess_GetStats( MongooseProcessStats_t* stats );
+
 #endif    // MONGOOSE_PROCESS_H
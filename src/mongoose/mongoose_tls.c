@@ -0,0 +1,167 @@
+#include "mongoose_tls.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "osal_file.h"
+#include "osal_log.h"
+
+#define MODULE_NAME "[TLS] "
+
+#if MG_TLS == MG_TLS_MBED
+
+#define SESSION_MAGIC 0x53544C48UL    // "HLTS"
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t len;
+  uint32_t crc;
+} session_header_t;
+
+// The last session of one path stays in RAM, so reconnects do not read the
+// file again; the scratch buffer takes a fresh session for comparison.
+static char cachedPath[OSAL_MAX_PATH_LEN];
+static uint8_t cached[MONGOOSE_TLS_SESSION_MAX];
+static size_t cachedLen;
+static uint8_t scratch[MONGOOSE_TLS_SESSION_MAX];
+
+static size_t _file_load( const char* path, uint8_t* buf )
+{
+  session_header_t hdr;
+  bool ok;
+  osal_file_id_t fd = osal_open_create( path, OSAL_FILE_FLAG_NONE, OSAL_READ_ONLY );
+
+  if ( fd < 0 )
+  {
+    return 0;
+  }
+  ok = osal_read( fd, &hdr, sizeof( hdr ) ) == (int32_t) sizeof( hdr ) && hdr.magic == SESSION_MAGIC &&
+       hdr.len > 0 && hdr.len <= MONGOOSE_TLS_SESSION_MAX && osal_read( fd, buf, hdr.len ) == (int32_t) hdr.len &&
+       mg_crc32( 0, (const char*) buf, hdr.len ) == hdr.crc;
+  osal_close( fd );
+  if ( !ok )
+  {
+    osal_log_warning( MODULE_NAME "Ignoring damaged %s\n", path );
+    return 0;
+  }
+  return hdr.len;
+}
+
+static void _file_store( const char* path, const uint8_t* buf, size_t len )
+{
+  char tmp[OSAL_MAX_PATH_LEN];
+  session_header_t hdr = { SESSION_MAGIC, (uint32_t) len, mg_crc32( 0, (const char*) buf, len ) };
+  bool ok;
+
+  if ( snprintf( tmp, sizeof( tmp ), "%s.tmp", path ) >= (int) sizeof( tmp ) )
+  {
+    return;
+  }
+  osal_file_id_t fd = osal_open_create( tmp, OSAL_FILE_FLAG_CREATE | OSAL_FILE_FLAG_TRUNCATE, OSAL_WRITE_ONLY );
+  if ( fd < 0 )
+  {
+    return;
+  }
+  ok = osal_write( fd, &hdr, sizeof( hdr ) ) == (int32_t) sizeof( hdr ) && osal_write( fd, buf, len ) == (int32_t) len;
+  osal_close( fd );
+
+  if ( !ok || osal_rename( tmp, path ) != OSAL_SUCCESS )
+  {
+    osal_remove( tmp );
+  }
+}
+
+static void _cache_select( const char* path )
+{
+  if ( strcmp( cachedPath, path ) != 0 )
+  {
+    snprintf( cachedPath, sizeof( cachedPath ), "%s", path );
+    cachedLen = _file_load( path, cached );
+  }
+}
+
+bool MongooseTls_Resume( struct mg_connection* c, const char* path )
+{
+  struct mg_tls* tls = (struct mg_tls*) c->tls;
+  mbedtls_ssl_session session;
+  bool ok;
+
+  if ( tls == NULL || !c->is_tls_hs )
+  {
+    return false;
+  }
+  _cache_select( path );
+  if ( cachedLen == 0 )
+  {
+    return false;
+  }
+
+  mbedtls_ssl_session_init( &session );
+  ok = mbedtls_ssl_session_load( &session, cached, cachedLen ) == 0 &&
+       mbedtls_ssl_set_session( &tls->ssl, &session ) == 0;
+  mbedtls_ssl_session_free( &session );
+  if ( !ok )
+  {
+    // Saved by another MbedTLS build or configuration
+    MongooseTls_Forget( path );
+  }
+  return ok;
+}
+
+void MongooseTls_Save( struct mg_connection* c, const char* path )
+{
+  struct mg_tls* tls = (struct mg_tls*) c->tls;
+  mbedtls_ssl_session session;
+  size_t len = 0;
+
+  if ( tls == NULL || c->is_tls_hs )
+  {
+    return;
+  }
+
+  mbedtls_ssl_session_init( &session );
+  if ( mbedtls_ssl_get_session( &tls->ssl, &session ) == 0 &&
+       mbedtls_ssl_session_save( &session, scratch, sizeof( scratch ), &len ) == 0 )
+  {
+    _cache_select( path );
+    if ( len != cachedLen || memcmp( scratch, cached, len ) != 0 )
+    {
+      memcpy( cached, scratch, len );
+      cachedLen = len;
+      _file_store( path, cached, cachedLen );
+    }
+  }
+  mbedtls_ssl_session_free( &session );
+}
+
+void MongooseTls_Forget( const char* path )
+{
+  if ( strcmp( cachedPath, path ) == 0 )
+  {
+    cachedLen = 0;
+  }
+  (void) osal_remove( path );
+}
+
+#else
+
+bool MongooseTls_Resume( struct mg_connection* c, const char* path )
+{
+  (void) c;
+  (void) path;
+  return false;
+}
+
+void MongooseTls_Save( struct mg_connection* c, const char* path )
+{
+  (void) c;
+  (void) path;
+}
+
+void MongooseTls_Forget( const char* path )
+{
+  (void) osal_remove( path );
+}
+
+#endif
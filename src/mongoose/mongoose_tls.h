@@ -0,0 +1,49 @@
+#ifndef MONGOOSE_TLS_H
+#define MONGOOSE_TLS_H
+
+#include <stdbool.h>
+
+#include "mongoose.h"
+
+// Largest serialized session kept; bigger ones are not cached
+#define MONGOOSE_TLS_SESSION_MAX 2048
+
+/**
+ * @brief TLS session resumption for client connections.
+ *
+ * A full handshake verifies the server certificate chain and runs the key
+ * exchange, which takes seconds on small targets. After one such handshake
+ * the negotiated session (an ID or ticket with its secrets) is saved to a
+ * file; the next connection to the same server offers it and the server may
+ * skip straight to an abbreviated handshake. A server that does not know the
+ * session anymore simply answers with a full one.
+ *
+ * The file holds the session master secret: keep it on storage that is as
+ * private as the device credentials. Sessions are only stored with MbedTLS;
+ * with the other TLS stacks these calls do nothing.
+ *
+ * Poll task only.
+ */
+
+/**
+ * @brief Offers the session saved in path on a connection whose
+ *        mg_tls_init() just ran, before any handshake data went out.
+ *
+ * @return true if a session was offered.
+ */
+bool MongooseTls_Resume( struct mg_connection* c, const char* path );
+
+/**
+ * @brief Saves the session of an established connection to path.
+ *
+ * Call once application data flowed: with TLS 1.3 the ticket only arrives
+ * after the handshake. An unchanged session is not written again.
+ */
+void MongooseTls_Save( struct mg_connection* c, const char* path );
+
+/**
+ * @brief Drops the session saved in path, e.g. when the server changed.
+ */
+void MongooseTls_Forget( const char* path );
+
+#endif    // MONGOOSE_TLS_H
@@ -12,6 +12,7 @@
 #include "lfs.h"
 #include "esp_littlefs.h"
 #include "littlefs_api.h"
+#include "osal_littlefs_backend.h"
 
 #ifdef CONFIG_LITTLEFS_WDT_RESET
 #include "esp_task_wdt.h"
@@ -27,6 +28,8 @@ int littlefs_esp_part_read_mmap(const struct lfs_config *c, lfs_block_t block,
         return LFS_ERR_IO;
     }
     memcpy(buffer, efs->mmap_data + part_off, size);
+    OSAL_LFS_BD_COUNT(reads, 1U);
+    OSAL_LFS_BD_COUNT(read_bytes, size);
     return 0;
 }
 #endif
@@ -45,6 +48,8 @@ int littlefs_esp_part_read(const struct lfs_config *c, lfs_block_t block,
         osal_log_error("failed to read addr %08x, size %08x, err %d", (unsigned int) part_off, (unsigned int) size, err);
         return LFS_ERR_IO;
     }
+    OSAL_LFS_BD_COUNT(reads, 1U);
+    OSAL_LFS_BD_COUNT(read_bytes, size);
     return 0;
 }
 
@@ -62,6 +67,8 @@ int littlefs_esp_part_write(const struct lfs_config *c, lfs_block_t block,
         osal_log_error("failed to write addr %08x, size %08x, err %d", (unsigned int) part_off, (unsigned int) size, err);
         return LFS_ERR_IO;
     }
+    OSAL_LFS_BD_COUNT(progs, 1U);
+    OSAL_LFS_BD_COUNT(prog_bytes, size);
     return 0;
 }
 
@@ -78,11 +85,13 @@ int littlefs_esp_part_erase(const struct lfs_config *c, lfs_block_t block) {
         osal_log_error("failed to erase addr %08x, size %08x, err %d", (unsigned int) part_off, (unsigned int) c->block_size, err);
         return LFS_ERR_IO;
     }
+    OSAL_LFS_BD_COUNT(erases, 1U);
     return 0;
 
 }
 
 int littlefs_esp_part_sync(const struct lfs_config *c) {
     /* Unnecessary for esp-idf */
+    OSAL_LFS_BD_COUNT(syncs, 1U);
     return 0;
 }
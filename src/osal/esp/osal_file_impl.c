@@ -21,6 +21,10 @@ typedef struct
 
 static osal_open_fd_t g_open_fds[OSAL_MAX_OPEN_FILES];
 
+static osal_file_stats_t g_file_stats;
+
+#define FILE_STAT_ADD(field, n) ((void)__atomic_fetch_add(&g_file_stats.field, (uint64_t)(n), __ATOMIC_RELAXED))
+
 static int32_t validate_path(const char *path)
 {
     if (path == NULL)
@@ -145,6 +149,7 @@ osal_file_id_t osal_open_create(const char *path, osal_file_flag_t flags, os_fil
     int fd = open(vfs_path, posix_flags, 0664);
     if (fd < 0)
     {
+        FILE_STAT_ADD(open_errors, 1);
         return (osal_file_id_t)OSAL_ERROR;
     }
 
@@ -152,9 +157,12 @@ osal_file_id_t osal_open_create(const char *path, osal_file_flag_t flags, os_fil
     if (slot < 0)
     {
         (void)close(fd);
+        FILE_STAT_ADD(open_errors, 1);
         return (osal_file_id_t)OSAL_ERR_NO_FREE_IDS;
     }
 
+    FILE_STAT_ADD(opens, 1);
+
     g_open_fds[slot].in_use = true;
     g_open_fds[slot].fd = fd;
     strncpy(g_open_fds[slot].path, vfs_path, sizeof(g_open_fds[slot].path) - 1);
@@ -200,9 +208,12 @@ int32_t osal_read(osal_file_id_t filedes, void *buffer, size_t nbytes)
     ssize_t result = read(filedes, buffer, nbytes);
     if (result < 0)
     {
+        FILE_STAT_ADD(io_errors, 1);
         return (errno == EBADF) ? OSAL_ERR_INVALID_ID : OSAL_ERROR;
     }
 
+    FILE_STAT_ADD(reads, 1);
+    FILE_STAT_ADD(read_bytes, result);
     return (int32_t)result;
 }
 
@@ -220,9 +231,12 @@ int32_t osal_write(osal_file_id_t filedes, const void *buffer, size_t nbytes)
     ssize_t result = write(filedes, buffer, nbytes);
     if (result < 0)
     {
+        FILE_STAT_ADD(io_errors, 1);
         return (errno == EBADF) ? OSAL_ERR_INVALID_ID : OSAL_ERROR;
     }
 
+    FILE_STAT_ADD(writes, 1);
+    FILE_STAT_ADD(write_bytes, result);
     return (int32_t)result;
 }
 
@@ -498,3 +512,21 @@ int32_t osal_file_open_check(const char *filename)
 
     return OSAL_ERROR;
 }
+
+int32_t osal_file_get_stats(osal_file_stats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return OSAL_INVALID_POINTER;
+    }
+
+    stats->opens = __atomic_load_n(&g_file_stats.opens, __ATOMIC_RELAXED);
+    stats->open_errors = __atomic_load_n(&g_file_stats.open_errors, __ATOMIC_RELAXED);
+    stats->reads = __atomic_load_n(&g_file_stats.reads, __ATOMIC_RELAXED);
+    stats->read_bytes = __atomic_load_n(&g_file_stats.read_bytes, __ATOMIC_RELAXED);
+    stats->writes = __atomic_load_n(&g_file_stats.writes, __ATOMIC_RELAXED);
+    stats->write_bytes = __atomic_load_n(&g_file_stats.write_bytes, __ATOMIC_RELAXED);
+    stats->io_errors = __atomic_load_n(&g_file_stats.io_errors, __ATOMIC_RELAXED);
+
+    return OSAL_SUCCESS;
+}
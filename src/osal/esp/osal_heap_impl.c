@@ -0,0 +1,24 @@
+#include <string.h>
+
+#include "esp_heap_caps.h"
+
+#include "osal_heap.h"
+#include "osal_assert.h"
+#include "osal_macro.h"
+
+osal_status_t osal_heap_get_stats(osal_heap_stats_t *stats)
+{
+    multi_heap_info_t info;
+
+    OSAL_CHECK_POINTER(stats);
+
+    heap_caps_get_info(&info, MALLOC_CAP_DEFAULT);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->total = heap_caps_get_total_size(MALLOC_CAP_DEFAULT);
+    stats->used = info.total_allocated_bytes;
+    stats->free = info.total_free_bytes;
+    stats->free_min = info.minimum_free_bytes;
+    stats->largest_free = info.largest_free_block;
+    return OSAL_SUCCESS;
+}
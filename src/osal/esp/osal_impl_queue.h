@@ -1,9 +1,8 @@
 #ifndef OSAL_IMPL_QUEUE_H
 #define OSAL_IMPL_QUEUE_H
 
-#include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
+struct osal_queue_internal;
 
-typedef QueueHandle_t osal_queue_id_t;
+typedef struct osal_queue_internal *osal_queue_id_t;
 
 #endif /* OSAL_IMPL_QUEUE_H */
@@ -6,6 +6,7 @@
 
 typedef SemaphoreHandle_t osal_bin_sem_id_t;
 typedef SemaphoreHandle_t osal_count_sem_id_t;
-typedef SemaphoreHandle_t osal_mutex_id_t;
+struct osal_mutex_internal;
+typedef struct osal_mutex_internal *osal_mutex_id_t;
 
 #endif /* OSAL_IMPL_SEM_H */
@@ -5,10 +5,17 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "osal_mount.h"
+
 extern bool g_osal_lfs_mounted;
+extern osal_blockdev_stats_t g_osal_lfs_bd_stats;
 extern char g_osal_lfs_mount_point[];
 extern char g_osal_lfs_partition_label[];
 
 int32_t osal_lfs_build_vfs_path(const char *in_path, char *out_path, size_t out_size);
 
+/* Adds to a g_osal_lfs_bd_stats counter from the block device callbacks */
+#define OSAL_LFS_BD_COUNT(field, n) \
+    ((void)__atomic_fetch_add(&g_osal_lfs_bd_stats.field, (uint64_t)(n), __ATOMIC_RELAXED))
+
 #endif /* OSAL_LITTLEFS_BACKEND_H */
@@ -10,6 +10,7 @@
 #include "esp_littlefs.h"
 
 bool g_osal_lfs_mounted = false;
+osal_blockdev_stats_t g_osal_lfs_bd_stats;
 char g_osal_lfs_mount_point[OSAL_MAX_PATH_LEN] = "/littlefs";
 char g_osal_lfs_partition_label[OSAL_MAX_PATH_LEN] = "storage";
 
@@ -275,3 +276,20 @@ int32_t osal_chkfs(const char *name, bool repair)
     (void)repair;
     return OSAL_ERR_NOT_IMPLEMENTED;
 }
+
+int32_t osal_filesys_get_blockdev_stats(osal_blockdev_stats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return OSAL_INVALID_POINTER;
+    }
+
+    stats->reads = __atomic_load_n(&g_osal_lfs_bd_stats.reads, __ATOMIC_RELAXED);
+    stats->read_bytes = __atomic_load_n(&g_osal_lfs_bd_stats.read_bytes, __ATOMIC_RELAXED);
+    stats->progs = __atomic_load_n(&g_osal_lfs_bd_stats.progs, __ATOMIC_RELAXED);
+    stats->prog_bytes = __atomic_load_n(&g_osal_lfs_bd_stats.prog_bytes, __ATOMIC_RELAXED);
+    stats->erases = __atomic_load_n(&g_osal_lfs_bd_stats.erases, __ATOMIC_RELAXED);
+    stats->syncs = __atomic_load_n(&g_osal_lfs_bd_stats.syncs, __ATOMIC_RELAXED);
+
+    return OSAL_SUCCESS;
+}
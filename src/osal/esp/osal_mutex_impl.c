@@ -1,13 +1,63 @@
+#include <stdint.h>
+#include <string.h>
+
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
 
 #include "osal_mutex.h"
 #include "osal_assert.h"
 #include "osal_macro.h"
+#include "osal_task.h"
+
+struct osal_mutex_internal
+{
+    SemaphoreHandle_t handle;
+    /* Updated by the holder of the mutex, read by osal_mutex_get_stats() */
+    uint64_t takes;
+    uint64_t contended;
+    uint64_t wait_us;
+    uint32_t wait_max_us;
+    char name[OSAL_MAX_NAME_LEN];
+    struct osal_mutex_internal *next;
+};
+
+/* Every mutex, for osal_mutex_get_stats() */
+static SemaphoreHandle_t osal_mutex_registry_mutex;
+static StaticSemaphore_t osal_mutex_registry_mutex_buf;
+static portMUX_TYPE osal_mutex_registry_spinlock = portMUX_INITIALIZER_UNLOCKED;
+static struct osal_mutex_internal *osal_mutex_registry_head;
+
+static void osal_mutex_registry_lock(void)
+{
+    if (osal_mutex_registry_mutex == NULL)
+    {
+        /* The first users may race; only one of them creates it */
+        taskENTER_CRITICAL(&osal_mutex_registry_spinlock);
+        if (osal_mutex_registry_mutex == NULL)
+        {
+            osal_mutex_registry_mutex = xSemaphoreCreateMutexStatic(&osal_mutex_registry_mutex_buf);
+        }
+        taskEXIT_CRITICAL(&osal_mutex_registry_spinlock);
+    }
+
+    if (osal_mutex_registry_mutex != NULL)
+    {
+        (void)xSemaphoreTake(osal_mutex_registry_mutex, portMAX_DELAY);
+    }
+}
+
+static void osal_mutex_registry_unlock(void)
+{
+    if (osal_mutex_registry_mutex != NULL)
+    {
+        (void)xSemaphoreGive(osal_mutex_registry_mutex);
+    }
+}
 
 osal_status_t osal_mutex_create(osal_mutex_id_t *mutex_id, const char *name)
 {
-    SemaphoreHandle_t mutex;
+    struct osal_mutex_internal *mutex;
 
     OSAL_CHECK_POINTER(mutex_id);
 
@@ -16,32 +66,86 @@ osal_status_t osal_mutex_create(osal_mutex_id_t *mutex_id, const char *name)
         OSAL_CHECK_STRING(name, OSAL_MAX_NAME_LEN, OSAL_ERR_NAME_TOO_LONG);
     }
 
-    mutex = xSemaphoreCreateMutex();
+    mutex = (struct osal_mutex_internal *)pvPortMalloc(sizeof(*mutex));
     if (mutex == NULL)
     {
         return OSAL_ERROR;
     }
 
+    memset(mutex, 0, sizeof(*mutex));
+    if (name != NULL)
+    {
+        strncpy(mutex->name, name, OSAL_MAX_NAME_LEN - 1U);
+    }
+
+    mutex->handle = xSemaphoreCreateMutex();
+    if (mutex->handle == NULL)
+    {
+        vPortFree(mutex);
+        return OSAL_ERROR;
+    }
+
+    osal_mutex_registry_lock();
+    mutex->next = osal_mutex_registry_head;
+    osal_mutex_registry_head = mutex;
+    osal_mutex_registry_unlock();
+
     *mutex_id = mutex;
     return OSAL_SUCCESS;
 }
 
 osal_status_t osal_mutex_delete(osal_mutex_id_t mutex_id)
 {
+    struct osal_mutex_internal **link;
+
     OSAL_CHECK_POINTER(mutex_id);
 
-    vSemaphoreDelete(mutex_id);
+    osal_mutex_registry_lock();
+    for (link = &osal_mutex_registry_head; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == mutex_id)
+        {
+            *link = mutex_id->next;
+            break;
+        }
+    }
+    osal_mutex_registry_unlock();
+
+    vSemaphoreDelete(mutex_id->handle);
+    vPortFree(mutex_id);
     return OSAL_SUCCESS;
 }
 
 osal_status_t osal_mutex_take(osal_mutex_id_t mutex_id)
 {
+    uint64_t start_us;
+    uint64_t waited_us;
+
     OSAL_CHECK_POINTER(mutex_id);
 
-    if (xSemaphoreTake(mutex_id, portMAX_DELAY) != pdTRUE)
+    /* Only contended takes pay for reading the clock */
+    if (xSemaphoreTake(mutex_id->handle, 0) == pdTRUE)
+    {
+        __atomic_store_n(&mutex_id->takes, mutex_id->takes + 1U, __ATOMIC_RELAXED);
+        return OSAL_SUCCESS;
+    }
+
+    start_us = osal_task_get_time_us();
+    if (xSemaphoreTake(mutex_id->handle, portMAX_DELAY) != pdTRUE)
     {
         return OSAL_SEM_FAILURE;
     }
+    waited_us = osal_task_get_time_us() - start_us;
+
+    __atomic_store_n(&mutex_id->takes, mutex_id->takes + 1U, __ATOMIC_RELAXED);
+    __atomic_store_n(&mutex_id->contended, mutex_id->contended + 1U, __ATOMIC_RELAXED);
+    __atomic_store_n(&mutex_id->wait_us, mutex_id->wait_us + waited_us, __ATOMIC_RELAXED);
+    if (waited_us > mutex_id->wait_max_us)
+    {
+        __atomic_store_n(&mutex_id->wait_max_us,
+                         (waited_us > UINT32_MAX) ? UINT32_MAX : (uint32_t)waited_us,
+                         __ATOMIC_RELAXED);
+    }
 
     return OSAL_SUCCESS;
 }
@@ -50,10 +154,37 @@ osal_status_t osal_mutex_give(osal_mutex_id_t mutex_id)
 {
     OSAL_CHECK_POINTER(mutex_id);
 
-    if (xSemaphoreGive(mutex_id) != pdTRUE)
+    if (xSemaphoreGive(mutex_id->handle) != pdTRUE)
     {
         return OSAL_SEM_FAILURE;
     }
 
     return OSAL_SUCCESS;
 }
+
+osal_status_t osal_mutex_get_stats(osal_mutex_stats_t *stats,
+                                   uint32_t max_count,
+                                   uint32_t *count)
+{
+    struct osal_mutex_internal *mutex;
+    uint32_t n = 0U;
+
+    OSAL_CHECK_POINTER(stats);
+    OSAL_CHECK_POINTER(count);
+
+    osal_mutex_registry_lock();
+    for (mutex = osal_mutex_registry_head; mutex != NULL && n < max_count; mutex = mutex->next)
+    {
+        osal_mutex_stats_t *entry = &stats[n++];
+
+        memcpy(entry->name, mutex->name, sizeof(entry->name));
+        entry->takes = __atomic_load_n(&mutex->takes, __ATOMIC_RELAXED);
+        entry->contended = __atomic_load_n(&mutex->contended, __ATOMIC_RELAXED);
+        entry->wait_us = __atomic_load_n(&mutex->wait_us, __ATOMIC_RELAXED);
+        entry->wait_max_us = __atomic_load_n(&mutex->wait_max_us, __ATOMIC_RELAXED);
+    }
+    osal_mutex_registry_unlock();
+
+    *count = n;
+    return OSAL_SUCCESS;
+}
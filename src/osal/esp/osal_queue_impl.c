@@ -1,10 +1,78 @@
+#include <stdint.h>
+#include <string.h>
+
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
 
 #include "osal_queue.h"
 #include "osal_assert.h"
 #include "osal_macro.h"
+#include "osal_task.h"
+
+struct osal_queue_internal
+{
+    QueueHandle_t handle;
+    uint32_t max_items;
+    uint32_t item_size;
+    uint32_t high_water;
+    uint64_t sends;
+    uint64_t receives;
+    uint64_t send_full;
+    uint64_t receive_empty;
+    uint64_t send_wait_us;
+    uint64_t receive_wait_us;
+    char name[OSAL_MAX_NAME_LEN];
+    struct osal_queue_internal *next;
+};
+
+/* Every queue, for osal_queue_get_stats() */
+static SemaphoreHandle_t osal_queue_registry_mutex;
+static StaticSemaphore_t osal_queue_registry_mutex_buf;
+static portMUX_TYPE osal_queue_registry_spinlock = portMUX_INITIALIZER_UNLOCKED;
+static struct osal_queue_internal *osal_queue_registry_head;
+
+static void osal_queue_registry_lock(void)
+{
+    if (osal_queue_registry_mutex == NULL)
+    {
+        /* The first users may race; only one of them creates it */
+        taskENTER_CRITICAL(&osal_queue_registry_spinlock);
+        if (osal_queue_registry_mutex == NULL)
+        {
+            osal_queue_registry_mutex = xSemaphoreCreateMutexStatic(&osal_queue_registry_mutex_buf);
+        }
+        taskEXIT_CRITICAL(&osal_queue_registry_spinlock);
+    }
+
+    if (osal_queue_registry_mutex != NULL)
+    {
+        (void)xSemaphoreTake(osal_queue_registry_mutex, portMAX_DELAY);
+    }
+}
+
+static void osal_queue_registry_unlock(void)
+{
+    if (osal_queue_registry_mutex != NULL)
+    {
+        (void)xSemaphoreGive(osal_queue_registry_mutex);
+    }
+}
+
+/* Senders update the counters without a common lock */
+static void osal_queue_count_send(struct osal_queue_internal *queue)
+{
+    uint32_t depth = (uint32_t)uxQueueMessagesWaitingFromISR(queue->handle);
+    uint32_t high = __atomic_load_n(&queue->high_water, __ATOMIC_RELAXED);
+
+    (void)__atomic_fetch_add(&queue->sends, 1U, __ATOMIC_RELAXED);
+    while (depth > high &&
+           !__atomic_compare_exchange_n(&queue->high_water, &high, depth, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
 
 static TickType_t osal_timeout_to_ticks(uint32_t timeout_ms)
 {
@@ -21,7 +89,7 @@ osal_status_t osal_queue_create(osal_queue_id_t *queue_id,
                                 uint32_t max_items,
                                 uint32_t item_size)
 {
-    QueueHandle_t queue;
+    struct osal_queue_internal *queue;
 
     OSAL_CHECK_POINTER(queue_id);
 
@@ -33,19 +101,39 @@ osal_status_t osal_queue_create(osal_queue_id_t *queue_id,
     ARGCHECK(max_items > 0U, OSAL_QUEUE_INVALID_SIZE);
     ARGCHECK(item_size > 0U, OSAL_QUEUE_INVALID_SIZE);
 
-    queue = xQueueCreate((UBaseType_t)max_items, (UBaseType_t)item_size);
+    queue = (struct osal_queue_internal *)pvPortMalloc(sizeof(*queue));
     if (queue == NULL)
     {
         return OSAL_ERROR;
     }
 
+    memset(queue, 0, sizeof(*queue));
+    queue->max_items = max_items;
+    queue->item_size = item_size;
+    if (name != NULL)
+    {
+        strncpy(queue->name, name, OSAL_MAX_NAME_LEN - 1U);
+    }
+
+    queue->handle = xQueueCreate((UBaseType_t)max_items, (UBaseType_t)item_size);
+    if (queue->handle == NULL)
+    {
+        vPortFree(queue);
+        return OSAL_ERROR;
+    }
+
 #if defined(configQUEUE_REGISTRY_SIZE) && (configQUEUE_REGISTRY_SIZE > 0)
     if (name != NULL)
     {
-        vQueueAddToRegistry(queue, name);
+        vQueueAddToRegistry(queue->handle, queue->name);
     }
 #endif
 
+    osal_queue_registry_lock();
+    queue->next = osal_queue_registry_head;
+    osal_queue_registry_head = queue;
+    osal_queue_registry_unlock();
+
     *queue_id = queue;
     return OSAL_SUCCESS;
 }
@@ -54,14 +142,23 @@ osal_status_t osal_queue_send(osal_queue_id_t queue_id,
                               const void *item,
                               uint32_t timeout_ms)
 {
-    TickType_t ticks;
+    uint64_t start_us;
+    BaseType_t sent;
 
     OSAL_CHECK_POINTER(queue_id);
     OSAL_CHECK_POINTER(item);
 
-    ticks = osal_timeout_to_ticks(timeout_ms);
-    if (xQueueSend(queue_id, item, ticks) != pdTRUE)
+    /* Only sends that find the queue full pay for reading the clock */
+    sent = xQueueSend(queue_id->handle, item, 0);
+    if (sent != pdTRUE && timeout_ms != 0U)
+    {
+        start_us = osal_task_get_time_us();
+        sent = xQueueSend(queue_id->handle, item, osal_timeout_to_ticks(timeout_ms));
+        (void)__atomic_fetch_add(&queue_id->send_wait_us, osal_task_get_time_us() - start_us, __ATOMIC_RELAXED);
+    }
+    if (sent != pdTRUE)
     {
+        (void)__atomic_fetch_add(&queue_id->send_full, 1U, __ATOMIC_RELAXED);
         if (timeout_ms == 0U)
         {
             return OSAL_QUEUE_FULL;
@@ -73,6 +170,7 @@ osal_status_t osal_queue_send(osal_queue_id_t queue_id,
         return OSAL_QUEUE_TIMEOUT;
     }
 
+    osal_queue_count_send(queue_id);
     return OSAL_SUCCESS;
 }
 
@@ -80,14 +178,22 @@ osal_status_t osal_queue_receive(osal_queue_id_t queue_id,
                                  void *buffer,
                                  uint32_t timeout_ms)
 {
-    TickType_t ticks;
+    uint64_t start_us;
+    BaseType_t received;
 
     OSAL_CHECK_POINTER(queue_id);
     OSAL_CHECK_POINTER(buffer);
 
-    ticks = osal_timeout_to_ticks(timeout_ms);
-    if (xQueueReceive(queue_id, buffer, ticks) != pdTRUE)
+    received = xQueueReceive(queue_id->handle, buffer, 0);
+    if (received != pdTRUE && timeout_ms != 0U)
+    {
+        start_us = osal_task_get_time_us();
+        received = xQueueReceive(queue_id->handle, buffer, osal_timeout_to_ticks(timeout_ms));
+        (void)__atomic_fetch_add(&queue_id->receive_wait_us, osal_task_get_time_us() - start_us, __ATOMIC_RELAXED);
+    }
+    if (received != pdTRUE)
     {
+        (void)__atomic_fetch_add(&queue_id->receive_empty, 1U, __ATOMIC_RELAXED);
         if (timeout_ms == 0U)
         {
             return OSAL_QUEUE_EMPTY;
@@ -99,18 +205,33 @@ osal_status_t osal_queue_receive(osal_queue_id_t queue_id,
         return OSAL_QUEUE_TIMEOUT;
     }
 
+    (void)__atomic_fetch_add(&queue_id->receives, 1U, __ATOMIC_RELAXED);
     return OSAL_SUCCESS;
 }
 
 osal_status_t osal_queue_delete(osal_queue_id_t queue_id)
 {
+    struct osal_queue_internal **link;
+
     OSAL_CHECK_POINTER(queue_id);
 
+    osal_queue_registry_lock();
+    for (link = &osal_queue_registry_head; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == queue_id)
+        {
+            *link = queue_id->next;
+            break;
+        }
+    }
+    osal_queue_registry_unlock();
+
 #if defined(configQUEUE_REGISTRY_SIZE) && (configQUEUE_REGISTRY_SIZE > 0)
-    vQueueUnregisterQueue(queue_id);
+    vQueueUnregisterQueue(queue_id->handle);
 #endif
 
-    vQueueDelete(queue_id);
+    vQueueDelete(queue_id->handle);
+    vPortFree(queue_id);
     return OSAL_SUCCESS;
 }
 
@@ -118,7 +239,66 @@ uint32_t osal_queue_get_count(osal_queue_id_t queue_id)
 {
     OSAL_CHECK_POINTER(queue_id);
 
-    return (uint32_t)uxQueueMessagesWaiting(queue_id);
+    return (uint32_t)uxQueueMessagesWaiting(queue_id->handle);
+}
+
+/* Called with the registry locked */
+static void osal_queue_fill_stats(struct osal_queue_internal *queue, osal_queue_stats_t *entry)
+{
+    memcpy(entry->name, queue->name, sizeof(entry->name));
+    entry->count = (uint32_t)uxQueueMessagesWaiting(queue->handle);
+    entry->max_items = queue->max_items;
+    entry->item_size = queue->item_size;
+    entry->high_water = __atomic_load_n(&queue->high_water, __ATOMIC_RELAXED);
+    entry->sends = __atomic_load_n(&queue->sends, __ATOMIC_RELAXED);
+    entry->receives = __atomic_load_n(&queue->receives, __ATOMIC_RELAXED);
+    entry->send_full = __atomic_load_n(&queue->send_full, __ATOMIC_RELAXED);
+    entry->receive_empty = __atomic_load_n(&queue->receive_empty, __ATOMIC_RELAXED);
+    entry->send_wait_us = __atomic_load_n(&queue->send_wait_us, __ATOMIC_RELAXED);
+    entry->receive_wait_us = __atomic_load_n(&queue->receive_wait_us, __ATOMIC_RELAXED);
+}
+
+osal_status_t osal_queue_get_stats(osal_queue_stats_t *stats,
+                                   uint32_t max_count,
+                                   uint32_t *count)
+{
+    struct osal_queue_internal *queue;
+    uint32_t n = 0U;
+
+    OSAL_CHECK_POINTER(stats);
+    OSAL_CHECK_POINTER(count);
+
+    osal_queue_registry_lock();
+    for (queue = osal_queue_registry_head; queue != NULL && n < max_count; queue = queue->next)
+    {
+        osal_queue_fill_stats(queue, &stats[n++]);
+    }
+    osal_queue_registry_unlock();
+
+    *count = n;
+    return OSAL_SUCCESS;
+}
+
+osal_status_t osal_queue_get_stats_by_name(const char *name,
+                                           osal_queue_stats_t *stats)
+{
+    struct osal_queue_internal *queue;
+
+    OSAL_CHECK_POINTER(name);
+    OSAL_CHECK_POINTER(stats);
+
+    osal_queue_registry_lock();
+    for (queue = osal_queue_registry_head; queue != NULL; queue = queue->next)
+    {
+        if (strcmp(queue->name, name) == 0)
+        {
+            osal_queue_fill_stats(queue, stats);
+            break;
+        }
+    }
+    osal_queue_registry_unlock();
+
+    return (queue != NULL) ? OSAL_SUCCESS : OSAL_ERR_NAME_NOT_FOUND;
 }
 
 osal_status_t osal_queue_send_from_isr(osal_queue_id_t queue_id, const void *item)
@@ -128,11 +308,13 @@ osal_status_t osal_queue_send_from_isr(osal_queue_id_t queue_id, const void *ite
     OSAL_CHECK_POINTER(queue_id);
     OSAL_CHECK_POINTER(item);
 
-    if (xQueueSendFromISR(queue_id, item, &higher_priority_task_woken) != pdTRUE)
+    if (xQueueSendFromISR(queue_id->handle, item, &higher_priority_task_woken) != pdTRUE)
     {
+        (void)__atomic_fetch_add(&queue_id->send_full, 1U, __ATOMIC_RELAXED);
         return OSAL_QUEUE_FULL;
     }
 
+    osal_queue_count_send(queue_id);
     portYIELD_FROM_ISR(higher_priority_task_woken);
     return OSAL_SUCCESS;
 }
@@ -144,11 +326,13 @@ osal_status_t osal_queue_receive_from_isr(osal_queue_id_t queue_id, void *buffer
     OSAL_CHECK_POINTER(queue_id);
     OSAL_CHECK_POINTER(buffer);
 
-    if (xQueueReceiveFromISR(queue_id, buffer, &higher_priority_task_woken) != pdTRUE)
+    if (xQueueReceiveFromISR(queue_id->handle, buffer, &higher_priority_task_woken) != pdTRUE)
     {
+        (void)__atomic_fetch_add(&queue_id->receive_empty, 1U, __ATOMIC_RELAXED);
         return OSAL_QUEUE_EMPTY;
     }
 
+    (void)__atomic_fetch_add(&queue_id->receives, 1U, __ATOMIC_RELAXED);
     portYIELD_FROM_ISR(higher_priority_task_woken);
     return OSAL_SUCCESS;
 }
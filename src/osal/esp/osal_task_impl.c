@@ -1,6 +1,7 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
@@ -18,13 +19,20 @@ struct osal_task_tcb_entry
 
 static SemaphoreHandle_t osal_task_registry_mutex;
 static StaticSemaphore_t osal_task_registry_mutex_buf;
+static portMUX_TYPE osal_task_registry_spinlock = portMUX_INITIALIZER_UNLOCKED;
 static struct osal_task_tcb_entry *osal_task_registry_head;
 
 static void osal_task_registry_lock(void)
 {
     if (osal_task_registry_mutex == NULL)
     {
-        osal_task_registry_mutex = xSemaphoreCreateMutexStatic(&osal_task_registry_mutex_buf);
+        /* The first users may race; only one of them creates it */
+        taskENTER_CRITICAL(&osal_task_registry_spinlock);
+        if (osal_task_registry_mutex == NULL)
+        {
+            osal_task_registry_mutex = xSemaphoreCreateMutexStatic(&osal_task_registry_mutex_buf);
+        }
+        taskEXIT_CRITICAL(&osal_task_registry_spinlock);
     }
 
     if (osal_task_registry_mutex != NULL)
@@ -269,3 +277,52 @@ uint32_t osal_task_get_time_ms(void)
 
     return (uint32_t)(ticks * portTICK_PERIOD_MS);
 }
+
+uint64_t osal_task_get_time_us(void)
+{
+    return (uint64_t)esp_timer_get_time();
+}
+
+osal_status_t osal_task_get_stats(osal_task_stats_t *stats, uint32_t max_count, uint32_t *count)
+{
+    OSAL_CHECK_POINTER(stats);
+    OSAL_CHECK_POINTER(count);
+
+#if defined(configUSE_TRACE_FACILITY) && (configUSE_TRACE_FACILITY == 1)
+    TaskStatus_t *status;
+    UBaseType_t total;
+    UBaseType_t filled;
+    uint32_t n = 0U;
+
+    /* Room for tasks created while the array is allocated */
+    total = uxTaskGetNumberOfTasks() + 4U;
+    status = (TaskStatus_t *)pvPortMalloc(total * sizeof(*status));
+    if (status == NULL)
+    {
+        return OSAL_ERROR;
+    }
+
+    filled = uxTaskGetSystemState(status, total, NULL);
+    for (UBaseType_t i = 0; i < filled && n < max_count; i++)
+    {
+        osal_task_stats_t *entry = &stats[n++];
+
+        memset(entry, 0, sizeof(*entry));
+        strncpy(entry->name, status[i].pcTaskName, OSAL_MAX_NAME_LEN - 1U);
+        entry->priority = (osal_priority_t)status[i].uxCurrentPriority;
+        entry->stack_free_min = (size_t)status[i].usStackHighWaterMark * sizeof(StackType_t);
+#if defined(configGENERATE_RUN_TIME_STATS) && (configGENERATE_RUN_TIME_STATS == 1)
+        /* Counted in esp_timer microseconds with the default clock source */
+        entry->cpu_time_us = (uint64_t)status[i].ulRunTimeCounter;
+#endif
+    }
+
+    vPortFree(status);
+    *count = n;
+    return OSAL_SUCCESS;
+#else
+    (void)max_count;
+    *count = 0U;
+    return OSAL_ERR_NOT_IMPLEMENTED;
+#endif
+}
@@ -3,6 +3,7 @@
 #include <string.h>
 
 #include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
 
@@ -15,8 +16,45 @@ struct osal_timer_meta
     void (*callback)(osal_timer_id_t);
     void *context;
     bool free_meta;
+    TimerHandle_t handle;
+    uint32_t expirations;
+    uint32_t overruns;
+    struct osal_timer_meta *next;
 };
 
+/* Every timer, for osal_timer_get_stats() */
+static SemaphoreHandle_t osal_timer_registry_mutex;
+static StaticSemaphore_t osal_timer_registry_mutex_buf;
+static portMUX_TYPE osal_timer_registry_spinlock = portMUX_INITIALIZER_UNLOCKED;
+static struct osal_timer_meta *osal_timer_registry_head;
+
+static void osal_timer_registry_lock(void)
+{
+    if (osal_timer_registry_mutex == NULL)
+    {
+        /* The first users may race; only one of them creates it */
+        taskENTER_CRITICAL(&osal_timer_registry_spinlock);
+        if (osal_timer_registry_mutex == NULL)
+        {
+            osal_timer_registry_mutex = xSemaphoreCreateMutexStatic(&osal_timer_registry_mutex_buf);
+        }
+        taskEXIT_CRITICAL(&osal_timer_registry_spinlock);
+    }
+
+    if (osal_timer_registry_mutex != NULL)
+    {
+        (void)xSemaphoreTake(osal_timer_registry_mutex, portMAX_DELAY);
+    }
+}
+
+static void osal_timer_registry_unlock(void)
+{
+    if (osal_timer_registry_mutex != NULL)
+    {
+        (void)xSemaphoreGive(osal_timer_registry_mutex);
+    }
+}
+
 static TickType_t osal_timeout_to_ticks(uint32_t timeout_ms)
 {
     if (timeout_ms == OSAL_MAX_DELAY)
@@ -43,6 +81,26 @@ static void osal_timer_callback(TimerHandle_t handle)
 {
     struct osal_timer_meta *meta = (struct osal_timer_meta *)pvTimerGetTimerID(handle);
 
+    if (meta != NULL)
+    {
+        TickType_t period = xTimerGetPeriod(handle);
+        TickType_t due = xTimerGetExpiryTime(handle);
+        TickType_t late;
+
+        /* An auto-reload timer is already rearmed for the next period */
+        if (uxTimerGetReloadMode(handle) != pdFALSE)
+        {
+            due -= period;
+        }
+        late = xTaskGetTickCount() - due;
+
+        meta->expirations++;
+        if (period > 0U && late >= period)
+        {
+            meta->overruns += (uint32_t)(late / period);
+        }
+    }
+
     if (meta != NULL && meta->callback != NULL)
     {
         meta->callback((osal_timer_id_t)handle);
@@ -150,6 +208,12 @@ osal_status_t osal_timer_create(osal_timer_id_t *timer_id,
         return OSAL_ERROR;
     }
 
+    meta->handle = timer;
+    osal_timer_registry_lock();
+    meta->next = osal_timer_registry_head;
+    osal_timer_registry_head = meta;
+    osal_timer_registry_unlock();
+
     *timer_id = (osal_timer_id_t)timer;
     return OSAL_SUCCESS;
 }
@@ -214,6 +278,22 @@ osal_status_t osal_timer_delete(osal_timer_id_t timer_id, uint32_t timeout_ms)
         return OSAL_TIMER_ERR_INTERNAL;
     }
 
+    if (meta != NULL)
+    {
+        struct osal_timer_meta **link;
+
+        osal_timer_registry_lock();
+        for (link = &osal_timer_registry_head; *link != NULL; link = &(*link)->next)
+        {
+            if (*link == meta)
+            {
+                *link = meta->next;
+                break;
+            }
+        }
+        osal_timer_registry_unlock();
+    }
+
     if (meta != NULL && meta->free_meta)
     {
         free(meta);
@@ -331,3 +411,43 @@ osal_status_t osal_timer_set_context(osal_timer_id_t timer_id, void *context)
     meta->context = context;
     return OSAL_SUCCESS;
 }
+
+osal_status_t osal_timer_get_stats(osal_timer_stats_t *stats,
+                                   uint32_t max_count,
+                                   uint32_t *count)
+{
+    struct osal_timer_meta *meta;
+    uint32_t n = 0U;
+
+    OSAL_CHECK_POINTER(stats);
+    OSAL_CHECK_POINTER(count);
+
+    osal_timer_registry_lock();
+    for (meta = osal_timer_registry_head; meta != NULL && n < max_count; meta = meta->next)
+    {
+        osal_timer_stats_t *entry = &stats[n++];
+        TimerHandle_t handle = meta->handle;
+
+        memset(entry, 0, sizeof(*entry));
+        strncpy(entry->name, pcTimerGetName(handle), OSAL_MAX_NAME_LEN - 1U);
+        entry->period_ms = (uint32_t)(xTimerGetPeriod(handle) * portTICK_PERIOD_MS);
+        entry->active = (xTimerIsTimerActive(handle) != pdFALSE);
+        entry->auto_reload = (uxTimerGetReloadMode(handle) != pdFALSE);
+        entry->expirations = meta->expirations;
+        entry->overruns = meta->overruns;
+        if (entry->active)
+        {
+            TickType_t left = xTimerGetExpiryTime(handle) - xTaskGetTickCount();
+
+            /* Wrapped: expiry is due and the timer task has not run yet */
+            if (left <= xTimerGetPeriod(handle))
+            {
+                entry->next_ms = (uint32_t)(left * portTICK_PERIOD_MS);
+            }
+        }
+    }
+    osal_timer_registry_unlock();
+
+    *count = n;
+    return OSAL_SUCCESS;
+}
@@ -63,6 +63,18 @@ enum
 /** @brief Access file stat time field as a whole number of seconds */
 #define OSAL_FILESTAT_TIME(x) (osal_time_get_total_seconds((x).file_time))
 
+/** @brief Cumulative file layer counters, see osal_file_get_stats() */
+typedef struct
+{
+    uint64_t opens;       /**< Successful osal_open_create() calls */
+    uint64_t open_errors; /**< Failed osal_open_create() calls */
+    uint64_t reads;       /**< Successful osal_read() calls */
+    uint64_t read_bytes;  /**< Bytes returned by osal_read() */
+    uint64_t writes;      /**< Successful osal_write() calls */
+    uint64_t write_bytes; /**< Bytes accepted by osal_write() */
+    uint64_t io_errors;   /**< Failed osal_read()/osal_write() calls */
+} osal_file_stats_t;
+
 /**
  * @brief Flags that can be used with opening of a file (bitmask)
  */
@@ -377,4 +389,18 @@ int32_t osal_fd_get_info(osal_file_id_t filedes, osal_file_prop_t *fd_prop);
  */
 int32_t osal_file_open_check(const char *filename);
 
+/**
+ * @brief Read the cumulative file layer counters
+ *
+ * Counters are updated with relaxed atomics on every open/read/write and
+ * are intended for monitoring; a snapshot is not taken atomically as a whole.
+ *
+ * @param[out] stats  Storage for the counters @nonnull
+ *
+ * @return Execution status, see osal_status_t
+ * @retval OSAL_SUCCESS on success
+ * @retval OSAL_INVALID_POINTER if the stats argument is NULL
+ */
+int32_t osal_file_get_stats(osal_file_stats_t *stats);
+
 #endif /* OSAL_FILE_H */
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef OSAL_HEAP_H
+#define OSAL_HEAP_H
+
+#include <stddef.h>
+#include "osal_common_type.h"
+#include "osal_error.h"
+
+/** @brief Heap usage, see osal_heap_get_stats() */
+typedef struct
+{
+    size_t total;         /**< Heap size in bytes */
+    size_t used;          /**< Bytes allocated */
+    size_t free;          /**< Bytes free */
+    size_t free_min;      /**< Least ever free since boot, 0 if unknown */
+    size_t largest_free;  /**< Largest block one allocation can get, 0 if unknown */
+} osal_heap_stats_t;
+
+/**
+ * @brief Read the current heap usage
+ *
+ * ESP-IDF reports the default-capability heap (MALLOC_CAP_DEFAULT); POSIX
+ * reports the process heap as seen by malloc.
+ *
+ * @param[out] stats  Storage for the usage
+ * @return OSAL status code
+ * @retval OSAL_SUCCESS              Usage read
+ * @retval OSAL_INVALID_POINTER      stats is NULL
+ * @retval OSAL_ERR_NOT_IMPLEMENTED  Not available with this C library
+ */
+osal_status_t osal_heap_get_stats(osal_heap_stats_t *stats);
+
+#endif /* OSAL_HEAP_H */
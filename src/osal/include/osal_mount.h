@@ -17,6 +17,22 @@ typedef struct
     size_t blocks_free;
 } osal_statvfs_t;
 
+/**
+ * @brief Block device operation counters
+ *
+ * Cumulative counts of the reads, programs, erases and syncs the file system
+ * issued to the underlying block device, see osal_filesys_get_blockdev_stats().
+ */
+typedef struct
+{
+    uint64_t reads;
+    uint64_t read_bytes;
+    uint64_t progs;
+    uint64_t prog_bytes;
+    uint64_t erases;
+    uint64_t syncs;
+} osal_blockdev_stats_t;
+
 /**
  * @brief Create a file system on the target
  *
@@ -162,4 +178,22 @@ int32_t osal_filesys_stat_volume(const char *name, osal_statvfs_t *stat_buf);
  */
 int32_t osal_chkfs(const char *name, bool repair);
 
+
+
+/**
+ * @brief Read the block device operation counters
+ *
+ * Counters are updated with relaxed atomics by the block device callbacks and
+ * cover every volume mounted since start; together with the file layer
+ * counters of osal_file_get_stats() they show how much device traffic the
+ * file operations cause.
+ *
+ * @param[out] stats  Storage for the counters @nonnull
+ *
+ * @return Execution status, see osal_status_t
+ * @retval OSAL_SUCCESS on success
+ * @retval OSAL_INVALID_POINTER if the stats argument is NULL
+ */
+int32_t osal_filesys_get_blockdev_stats(osal_blockdev_stats_t *stats);
+
 #endif /* OSAL_MOUNT_H */
\ No newline at end of file
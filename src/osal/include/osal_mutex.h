@@ -5,6 +5,16 @@
 #include "osal_error.h"
 #include "osal_impl_sem.h"
 
+/** @brief Snapshot of one mutex, see osal_mutex_get_stats() */
+typedef struct
+{
+    char name[OSAL_MAX_NAME_LEN];
+    uint64_t takes;        /**< Successful osal_mutex_take() calls */
+    uint64_t contended;    /**< Takes that found the mutex held and waited */
+    uint64_t wait_us;      /**< Time spent waiting in contended takes */
+    uint32_t wait_max_us;  /**< Longest single wait */
+} osal_mutex_stats_t;
+
 /**
  * @brief Create a mutex
  * @param[out] mutex_id  Returned mutex ID
@@ -46,4 +56,17 @@ osal_status_t osal_mutex_take(osal_mutex_id_t mutex_id);
  */
 osal_status_t osal_mutex_give(osal_mutex_id_t mutex_id);
 
+/**
+ * @brief Take a snapshot of every mutex
+ * @param[out] stats      Array to fill
+ * @param[in]  max_count  Number of entries in stats; further mutexes are left out
+ * @param[out] count      Number of entries filled
+ * @return OSAL status code
+ * @retval OSAL_SUCCESS          Snapshot taken
+ * @retval OSAL_INVALID_POINTER  stats or count is NULL
+ */
+osal_status_t osal_mutex_get_stats(osal_mutex_stats_t *stats,
+                                   uint32_t max_count,
+                                   uint32_t *count);
+
 #endif /* OSAL_MUTEX_H */
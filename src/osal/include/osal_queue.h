@@ -6,6 +6,22 @@
 #include "osal_error.h"
 #include "osal_impl_queue.h"
 
+/** @brief Snapshot of one queue, see osal_queue_get_stats() */
+typedef struct
+{
+    char name[OSAL_MAX_NAME_LEN];
+    uint32_t count;            /**< Items in the queue now */
+    uint32_t max_items;
+    uint32_t item_size;
+    uint32_t high_water;       /**< Most items ever in the queue at once */
+    uint64_t sends;            /**< Items sent since the queue was created */
+    uint64_t receives;         /**< Items received since the queue was created */
+    uint64_t send_full;        /**< Sends that failed on a full queue, timeouts included */
+    uint64_t receive_empty;    /**< Receives that failed on an empty queue, timeouts included */
+    uint64_t send_wait_us;     /**< Time senders spent waiting for room */
+    uint64_t receive_wait_us;  /**< Time receivers spent waiting for an item */
+} osal_queue_stats_t;
+
 /**
  * @brief Create a message queue
  * @param[out] queue_id    Returned queue ID
@@ -88,4 +104,31 @@ osal_status_t osal_queue_send_from_isr(osal_queue_id_t queue_id,
 osal_status_t osal_queue_receive_from_isr(osal_queue_id_t queue_id,
                                           void *buffer);
 
+/**
+ * @brief Take a snapshot of every queue
+ * @param[out] stats      Array to fill
+ * @param[in]  max_count  Number of entries in stats; further queues are left out
+ * @param[out] count      Number of entries filled
+ * @return OSAL status code
+ * @retval OSAL_SUCCESS          Snapshot taken
+ * @retval OSAL_INVALID_POINTER  stats or count is NULL
+ */
+osal_status_t osal_queue_get_stats(osal_queue_stats_t *stats,
+                                   uint32_t max_count,
+                                   uint32_t *count);
+
+/**
+ * @brief Take a snapshot of one queue, e.g. to check its depth against the
+ *        high-water mark it reaches in the field
+ * @param[in]  name   Queue name given to osal_queue_create(); the newest
+ *                    queue of that name if there are several
+ * @param[out] stats  Snapshot
+ * @return OSAL status code
+ * @retval OSAL_SUCCESS             Snapshot taken
+ * @retval OSAL_INVALID_POINTER     name or stats is NULL
+ * @retval OSAL_ERR_NAME_NOT_FOUND  No queue has that name
+ */
+osal_status_t osal_queue_get_stats_by_name(const char *name,
+                                           osal_queue_stats_t *stats);
+
 #endif /* OSAL_QUEUE_H */
@@ -16,6 +16,15 @@ typedef struct {
     uint32_t reserved[4];     /**< Reserved for future use. Must be zero. */
 } osal_task_attr_t;
 
+/** @brief Snapshot of one task, see osal_task_get_stats() */
+typedef struct {
+    char name[OSAL_MAX_NAME_LEN];
+    osal_priority_t priority;
+    size_t stack_size;        /**< Stack size in bytes, 0 if unknown */
+    size_t stack_free_min;    /**< Least stack ever left free in bytes, 0 if unknown */
+    uint64_t cpu_time_us;     /**< CPU time used so far, 0 if unknown */
+} osal_task_stats_t;
+
 /**
  * @brief Initialize task attributes with default values
  *
@@ -78,4 +87,27 @@ osal_status_t osal_task_delay_ms(uint32_t milliseconds);
  */
 uint32_t osal_task_get_time_ms(void);
 
+/**
+ * @brief Get current system time in microseconds since boot
+ * @return Time in microseconds, for measuring short intervals
+ */
+uint64_t osal_task_get_time_us(void);
+
+/**
+ * @brief Take a snapshot of the running tasks
+ *
+ * On POSIX only tasks created with osal_task_create() are listed; on ESP-IDF
+ * every FreeRTOS task is (requires CONFIG_FREERTOS_USE_TRACE_FACILITY, and
+ * CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS for the CPU time).
+ *
+ * @param[out] stats      Array to fill
+ * @param[in]  max_count  Number of entries in stats; further tasks are left out
+ * @param[out] count      Number of entries filled
+ * @return OSAL status code
+ * @retval OSAL_SUCCESS              Snapshot taken
+ * @retval OSAL_INVALID_POINTER      stats or count is NULL
+ * @retval OSAL_ERR_NOT_IMPLEMENTED  Not available in this build
+ */
+osal_status_t osal_task_get_stats(osal_task_stats_t *stats, uint32_t max_count, uint32_t *count);
+
 #endif /* OSAL_TASK_H */
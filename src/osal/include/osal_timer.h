@@ -9,6 +9,18 @@
 #include "osal_impl_timer.h"
 #include "osal_task.h"
 
+/** @brief Snapshot of one timer, see osal_timer_get_stats() */
+typedef struct
+{
+    char name[OSAL_MAX_NAME_LEN];
+    uint32_t period_ms;
+    bool active;
+    bool auto_reload;
+    uint32_t next_ms;      /**< Time left until the next expiry, 0 if not active */
+    uint32_t expirations;  /**< Callbacks run so far */
+    uint32_t overruns;     /**< Whole periods the callbacks ran late by, in total */
+} osal_timer_stats_t;
+
 /**
  * @brief Create a software timer
  * @param[out] timer_id       Returned timer ID
@@ -142,4 +154,17 @@ void *osal_timer_get_context(osal_timer_id_t timer_id);
  */
 osal_status_t osal_timer_set_context(osal_timer_id_t timer_id, void *context);
 
+/**
+ * @brief Take a snapshot of every timer
+ * @param[out] stats      Array to fill
+ * @param[in]  max_count  Number of entries in stats; further timers are left out
+ * @param[out] count      Number of entries filled
+ * @return OSAL status code
+ * @retval OSAL_SUCCESS          Snapshot taken
+ * @retval OSAL_INVALID_POINTER  stats or count is NULL
+ */
+osal_status_t osal_timer_get_stats(osal_timer_stats_t *stats,
+                                   uint32_t max_count,
+                                   uint32_t *count);
+
 #endif /* OSAL_TIMER_H */
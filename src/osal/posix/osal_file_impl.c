@@ -18,6 +18,10 @@ typedef struct
 
 static osal_lfs_open_file_t g_open_files[OSAL_LFS_MAX_OPEN_FILES];
 
+static osal_file_stats_t g_file_stats;
+
+#define FILE_STAT_ADD(field, n) ((void)__atomic_fetch_add(&g_file_stats.field, (uint64_t)(n), __ATOMIC_RELAXED))
+
 static int lfs_fd_to_slot(osal_file_id_t filedes)
 {
     int slot = (int)filedes - 1;
@@ -131,9 +135,12 @@ osal_file_id_t osal_open_create(const char *path, osal_file_flag_t flags, os_fil
     int err = lfs_file_open(&g_osal_lfs, &g_open_files[slot].file, norm_path, lfs_flags);
     if (err != 0)
     {
+        FILE_STAT_ADD(open_errors, 1);
         return (osal_file_id_t)osal_lfs_map_error(err);
     }
 
+    FILE_STAT_ADD(opens, 1);
+
     g_open_files[slot].in_use = true;
     strncpy(g_open_files[slot].path, norm_path, sizeof(g_open_files[slot].path) - 1);
     g_open_files[slot].path[sizeof(g_open_files[slot].path) - 1] = '\0';
@@ -173,9 +180,12 @@ int32_t osal_read(osal_file_id_t filedes, void *buffer, size_t nbytes)
     lfs_ssize_t res = lfs_file_read(&g_osal_lfs, &g_open_files[slot].file, buffer, nbytes);
     if (res < 0)
     {
+        FILE_STAT_ADD(io_errors, 1);
         return osal_lfs_map_error((int)res);
     }
 
+    FILE_STAT_ADD(reads, 1);
+    FILE_STAT_ADD(read_bytes, res);
     return (int32_t)res;
 }
 
@@ -196,9 +206,12 @@ int32_t osal_write(osal_file_id_t filedes, const void *buffer, size_t nbytes)
     lfs_ssize_t res = lfs_file_write(&g_osal_lfs, &g_open_files[slot].file, buffer, nbytes);
     if (res < 0)
     {
+        FILE_STAT_ADD(io_errors, 1);
         return osal_lfs_map_error((int)res);
     }
 
+    FILE_STAT_ADD(writes, 1);
+    FILE_STAT_ADD(write_bytes, res);
     return (int32_t)res;
 }
 
@@ -453,3 +466,21 @@ int32_t osal_file_open_check(const char *filename)
 
     return OSAL_ERROR;
 }
+
+int32_t osal_file_get_stats(osal_file_stats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return OSAL_INVALID_POINTER;
+    }
+
+    stats->opens = __atomic_load_n(&g_file_stats.opens, __ATOMIC_RELAXED);
+    stats->open_errors = __atomic_load_n(&g_file_stats.open_errors, __ATOMIC_RELAXED);
+    stats->reads = __atomic_load_n(&g_file_stats.reads, __ATOMIC_RELAXED);
+    stats->read_bytes = __atomic_load_n(&g_file_stats.read_bytes, __ATOMIC_RELAXED);
+    stats->writes = __atomic_load_n(&g_file_stats.writes, __ATOMIC_RELAXED);
+    stats->write_bytes = __atomic_load_n(&g_file_stats.write_bytes, __ATOMIC_RELAXED);
+    stats->io_errors = __atomic_load_n(&g_file_stats.io_errors, __ATOMIC_RELAXED);
+
+    return OSAL_SUCCESS;
+}
@@ -0,0 +1,27 @@
+#define _GNU_SOURCE
+
+#include <malloc.h>
+#include <string.h>
+
+#include "osal_heap.h"
+#include "osal_assert.h"
+#include "osal_macro.h"
+
+osal_status_t osal_heap_get_stats(osal_heap_stats_t *stats)
+{
+    OSAL_CHECK_POINTER(stats);
+
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+
+    memset(stats, 0, sizeof(*stats));
+    /* Large blocks are mapped separately and count as used */
+    stats->total = info.arena + info.hblkhd;
+    stats->used = info.uordblks + info.hblkhd;
+    stats->free = info.fordblks;
+    return OSAL_SUCCESS;
+#else
+    memset(stats, 0, sizeof(*stats));
+    return OSAL_ERR_NOT_IMPLEMENTED;
+#endif
+}
@@ -6,6 +6,7 @@
 
 typedef sem_t *osal_bin_sem_id_t;
 typedef sem_t *osal_count_sem_id_t;
-typedef pthread_mutex_t *osal_mutex_id_t;
+struct osal_mutex_internal;
+typedef struct osal_mutex_internal *osal_mutex_id_t;
 
 #endif /* OSAL_IMPL_SEM_H */
@@ -26,6 +26,10 @@ struct osal_timer_internal
 	void (*callback)(osal_timer_id_t);
 	void *context;
 	char name[OSAL_MAX_NAME_LEN];
+	struct timespec deadline;
+	uint32_t expirations;
+	uint32_t overruns;
+	struct osal_timer_internal *next;
 };
 
 #define OSAL_TIMER_STATIC_SIZE  (sizeof(struct osal_timer_internal))
@@ -5,6 +5,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "osal_mount.h"
+
 #include "lfs.h"
 #include "bd/lfs_filebd.h"
 
@@ -14,6 +16,7 @@ extern lfs_filebd_t g_osal_lfs_bd;
 extern struct lfs_filebd_config g_osal_lfs_bd_cfg;
 extern bool g_osal_lfs_configured;
 extern bool g_osal_lfs_mounted;
+extern osal_blockdev_stats_t g_osal_lfs_bd_stats;
 extern char g_osal_lfs_image_path[];
 extern char g_osal_lfs_mount_point[];
 extern char g_osal_lfs_devname[];
@@ -21,4 +24,8 @@ extern char g_osal_lfs_devname[];
 int32_t osal_lfs_path_normalize(const char *in_path, char *out_path, size_t out_size);
 int32_t osal_lfs_map_error(int err);
 
+/* Adds to a g_osal_lfs_bd_stats counter from the block device callbacks */
+#define OSAL_LFS_BD_COUNT(field, n) \
+    ((void)__atomic_fetch_add(&g_osal_lfs_bd_stats.field, (uint64_t)(n), __ATOMIC_RELAXED))
+
 #endif /* OSAL_LITTLEFS_BACKEND_H */
@@ -36,6 +36,7 @@ lfs_filebd_t g_osal_lfs_bd;
 struct lfs_filebd_config g_osal_lfs_bd_cfg;
 bool g_osal_lfs_configured = false;
 bool g_osal_lfs_mounted = false;
+osal_blockdev_stats_t g_osal_lfs_bd_stats;
 char g_osal_lfs_image_path[OSAL_MAX_PATH_LEN] = OSAL_LFS_DEFAULT_IMAGE;
 char g_osal_lfs_mount_point[OSAL_MAX_PATH_LEN] = "/";
 char g_osal_lfs_devname[OSAL_MAX_PATH_LEN] = "littlefs";
@@ -44,6 +45,34 @@ static uint8_t g_osal_lfs_read_buffer[OSAL_LFS_DEFAULT_BLOCK_SIZE];
 static uint8_t g_osal_lfs_prog_buffer[OSAL_LFS_DEFAULT_BLOCK_SIZE];
 static uint8_t g_osal_lfs_lookahead_buffer[128];
 
+static int osal_lfs_bd_read(const struct lfs_config *cfg, lfs_block_t block,
+                            lfs_off_t off, void *buffer, lfs_size_t size)
+{
+    OSAL_LFS_BD_COUNT(reads, 1U);
+    OSAL_LFS_BD_COUNT(read_bytes, size);
+    return lfs_filebd_read(cfg, block, off, buffer, size);
+}
+
+static int osal_lfs_bd_prog(const struct lfs_config *cfg, lfs_block_t block,
+                            lfs_off_t off, const void *buffer, lfs_size_t size)
+{
+    OSAL_LFS_BD_COUNT(progs, 1U);
+    OSAL_LFS_BD_COUNT(prog_bytes, size);
+    return lfs_filebd_prog(cfg, block, off, buffer, size);
+}
+
+static int osal_lfs_bd_erase(const struct lfs_config *cfg, lfs_block_t block)
+{
+    OSAL_LFS_BD_COUNT(erases, 1U);
+    return lfs_filebd_erase(cfg, block);
+}
+
+static int osal_lfs_bd_sync(const struct lfs_config *cfg)
+{
+    OSAL_LFS_BD_COUNT(syncs, 1U);
+    return lfs_filebd_sync(cfg);
+}
+
 int32_t osal_lfs_map_error(int err)
 {
     switch (err)
@@ -158,10 +187,10 @@ static int32_t osal_lfs_configure(const char *devname, const char *mount_point,
     }
 
     g_osal_lfs_cfg.context = &g_osal_lfs_bd;
-    g_osal_lfs_cfg.read = lfs_filebd_read;
-    g_osal_lfs_cfg.prog = lfs_filebd_prog;
-    g_osal_lfs_cfg.erase = lfs_filebd_erase;
-    g_osal_lfs_cfg.sync = lfs_filebd_sync;
+    g_osal_lfs_cfg.read = osal_lfs_bd_read;
+    g_osal_lfs_cfg.prog = osal_lfs_bd_prog;
+    g_osal_lfs_cfg.erase = osal_lfs_bd_erase;
+    g_osal_lfs_cfg.sync = osal_lfs_bd_sync;
     g_osal_lfs_cfg.read_size = g_osal_lfs_bd_cfg.read_size;
     g_osal_lfs_cfg.prog_size = g_osal_lfs_bd_cfg.prog_size;
     g_osal_lfs_cfg.block_size = g_osal_lfs_bd_cfg.erase_size;
@@ -358,3 +387,20 @@ int32_t osal_chkfs(const char *name, bool repair)
     (void)repair;
     return OSAL_ERR_NOT_IMPLEMENTED;
 }
+
+int32_t osal_filesys_get_blockdev_stats(osal_blockdev_stats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return OSAL_INVALID_POINTER;
+    }
+
+    stats->reads = __atomic_load_n(&g_osal_lfs_bd_stats.reads, __ATOMIC_RELAXED);
+    stats->read_bytes = __atomic_load_n(&g_osal_lfs_bd_stats.read_bytes, __ATOMIC_RELAXED);
+    stats->progs = __atomic_load_n(&g_osal_lfs_bd_stats.progs, __ATOMIC_RELAXED);
+    stats->prog_bytes = __atomic_load_n(&g_osal_lfs_bd_stats.prog_bytes, __ATOMIC_RELAXED);
+    stats->erases = __atomic_load_n(&g_osal_lfs_bd_stats.erases, __ATOMIC_RELAXED);
+    stats->syncs = __atomic_load_n(&g_osal_lfs_bd_stats.syncs, __ATOMIC_RELAXED);
+
+    return OSAL_SUCCESS;
+}
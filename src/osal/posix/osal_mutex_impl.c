@@ -2,14 +2,32 @@
 
 #include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "osal_mutex.h"
 #include "osal_assert.h"
 #include "osal_macro.h"
+#include "osal_task.h"
+
+struct osal_mutex_internal
+{
+    pthread_mutex_t mutex;
+    /* Updated by the holder of the mutex, read by osal_mutex_get_stats() */
+    uint64_t takes;
+    uint64_t contended;
+    uint64_t wait_us;
+    uint32_t wait_max_us;
+    char name[OSAL_MAX_NAME_LEN];
+    struct osal_mutex_internal *next;
+};
+
+/* Every mutex, for osal_mutex_get_stats() */
+static pthread_mutex_t osal_mutex_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct osal_mutex_internal *osal_mutex_registry_head;
 
 osal_status_t osal_mutex_create(osal_mutex_id_t *mutex_id, const char *name)
 {
-    pthread_mutex_t *mutex;
+    struct osal_mutex_internal *mutex;
 
     OSAL_CHECK_POINTER(mutex_id);
 
@@ -18,43 +36,89 @@ osal_status_t osal_mutex_create(osal_mutex_id_t *mutex_id, const char *name)
         OSAL_CHECK_STRING(name, OSAL_MAX_NAME_LEN, OSAL_ERR_NAME_TOO_LONG);
     }
 
-    mutex = (pthread_mutex_t *)malloc(sizeof(*mutex));
+    mutex = (struct osal_mutex_internal *)malloc(sizeof(*mutex));
     if (mutex == NULL)
     {
         return OSAL_ERROR;
     }
 
-    if (pthread_mutex_init(mutex, NULL) != 0)
+    memset(mutex, 0, sizeof(*mutex));
+    if (name != NULL)
+    {
+        strncpy(mutex->name, name, OSAL_MAX_NAME_LEN - 1U);
+    }
+
+    if (pthread_mutex_init(&mutex->mutex, NULL) != 0)
     {
         free(mutex);
         return OSAL_ERROR;
     }
 
+    pthread_mutex_lock(&osal_mutex_registry_mutex);
+    mutex->next = osal_mutex_registry_head;
+    osal_mutex_registry_head = mutex;
+    pthread_mutex_unlock(&osal_mutex_registry_mutex);
+
     *mutex_id = mutex;
     return OSAL_SUCCESS;
 }
 
 osal_status_t osal_mutex_delete(osal_mutex_id_t mutex_id)
 {
+    struct osal_mutex_internal **link;
+
     OSAL_CHECK_POINTER(mutex_id);
 
-    if (pthread_mutex_destroy(mutex_id) != 0)
+    if (pthread_mutex_destroy(&mutex_id->mutex) != 0)
     {
         return OSAL_ERR_INVALID_ID;
     }
 
+    pthread_mutex_lock(&osal_mutex_registry_mutex);
+    for (link = &osal_mutex_registry_head; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == mutex_id)
+        {
+            *link = mutex_id->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&osal_mutex_registry_mutex);
+
     free(mutex_id);
     return OSAL_SUCCESS;
 }
 
 osal_status_t osal_mutex_take(osal_mutex_id_t mutex_id)
 {
+    uint64_t start_us;
+    uint64_t waited_us;
+
     OSAL_CHECK_POINTER(mutex_id);
 
-    if (pthread_mutex_lock(mutex_id) != 0)
+    /* Only contended takes pay for reading the clock */
+    if (pthread_mutex_trylock(&mutex_id->mutex) == 0)
+    {
+        __atomic_store_n(&mutex_id->takes, mutex_id->takes + 1U, __ATOMIC_RELAXED);
+        return OSAL_SUCCESS;
+    }
+
+    start_us = osal_task_get_time_us();
+    if (pthread_mutex_lock(&mutex_id->mutex) != 0)
     {
         return OSAL_SEM_FAILURE;
     }
+    waited_us = osal_task_get_time_us() - start_us;
+
+    __atomic_store_n(&mutex_id->takes, mutex_id->takes + 1U, __ATOMIC_RELAXED);
+    __atomic_store_n(&mutex_id->contended, mutex_id->contended + 1U, __ATOMIC_RELAXED);
+    __atomic_store_n(&mutex_id->wait_us, mutex_id->wait_us + waited_us, __ATOMIC_RELAXED);
+    if (waited_us > mutex_id->wait_max_us)
+    {
+        __atomic_store_n(&mutex_id->wait_max_us,
+                         (waited_us > UINT32_MAX) ? UINT32_MAX : (uint32_t)waited_us,
+                         __ATOMIC_RELAXED);
+    }
 
     return OSAL_SUCCESS;
 }
@@ -63,10 +127,37 @@ osal_status_t osal_mutex_give(osal_mutex_id_t mutex_id)
 {
     OSAL_CHECK_POINTER(mutex_id);
 
-    if (pthread_mutex_unlock(mutex_id) != 0)
+    if (pthread_mutex_unlock(&mutex_id->mutex) != 0)
     {
         return OSAL_SEM_FAILURE;
     }
 
     return OSAL_SUCCESS;
 }
+
+osal_status_t osal_mutex_get_stats(osal_mutex_stats_t *stats,
+                                   uint32_t max_count,
+                                   uint32_t *count)
+{
+    struct osal_mutex_internal *mutex;
+    uint32_t n = 0U;
+
+    OSAL_CHECK_POINTER(stats);
+    OSAL_CHECK_POINTER(count);
+
+    pthread_mutex_lock(&osal_mutex_registry_mutex);
+    for (mutex = osal_mutex_registry_head; mutex != NULL && n < max_count; mutex = mutex->next)
+    {
+        osal_mutex_stats_t *entry = &stats[n++];
+
+        memcpy(entry->name, mutex->name, sizeof(entry->name));
+        entry->takes = __atomic_load_n(&mutex->takes, __ATOMIC_RELAXED);
+        entry->contended = __atomic_load_n(&mutex->contended, __ATOMIC_RELAXED);
+        entry->wait_us = __atomic_load_n(&mutex->wait_us, __ATOMIC_RELAXED);
+        entry->wait_max_us = __atomic_load_n(&mutex->wait_max_us, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&osal_mutex_registry_mutex);
+
+    *count = n;
+    return OSAL_SUCCESS;
+}
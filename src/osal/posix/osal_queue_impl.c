@@ -2,6 +2,7 @@
 
 #include <errno.h>
 #include <pthread.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,6 +11,7 @@
 #include "osal_queue.h"
 #include "osal_assert.h"
 #include "osal_macro.h"
+#include "osal_task.h"
 
 struct osal_queue_internal
 {
@@ -22,9 +24,27 @@ struct osal_queue_internal
     uint32_t head;
     uint32_t tail;
     uint32_t count;
+    uint32_t high_water;
+    uint64_t sends;
+    uint64_t receives;
+    uint64_t send_full;
+    uint64_t receive_empty;
+    uint64_t send_wait_us;
+    uint64_t receive_wait_us;
     char name[OSAL_MAX_NAME_LEN];
+    struct osal_queue_internal *next;
 };
 
+/* Every queue, for osal_queue_get_stats() */
+static pthread_mutex_t osal_queue_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct osal_queue_internal *osal_queue_registry_head;
+
+/* Counters change under the queue mutex and are read without it */
+static void osal_queue_add(uint64_t *counter, uint64_t n)
+{
+    __atomic_store_n(counter, *counter + n, __ATOMIC_RELAXED);
+}
+
 static void osal_timespec_add_ms(struct timespec *ts, uint32_t timeout_ms)
 {
     ts->tv_sec += (time_t)(timeout_ms / 1000U);
@@ -123,6 +143,11 @@ osal_status_t osal_queue_create(osal_queue_id_t *queue_id,
         return OSAL_ERROR;
     }
 
+    pthread_mutex_lock(&osal_queue_registry_mutex);
+    queue->next = osal_queue_registry_head;
+    osal_queue_registry_head = queue;
+    pthread_mutex_unlock(&osal_queue_registry_mutex);
+
     *queue_id = queue;
     return OSAL_SUCCESS;
 }
@@ -133,6 +158,8 @@ osal_status_t osal_queue_send(osal_queue_id_t queue_id,
 {
     struct osal_queue_internal *queue = queue_id;
     struct timespec deadline;
+    uint64_t start_us = 0U;
+    bool waited = false;
     int ret;
 
     OSAL_CHECK_POINTER(queue);
@@ -155,10 +182,18 @@ osal_status_t osal_queue_send(osal_queue_id_t queue_id,
     {
         if (timeout_ms == 0U)
         {
+            osal_queue_add(&queue->send_full, 1U);
             pthread_mutex_unlock(&queue->mutex);
             return OSAL_QUEUE_FULL;
         }
 
+        /* Only sends that wait pay for reading the clock */
+        if (!waited)
+        {
+            start_us = osal_task_get_time_us();
+            waited = true;
+        }
+
         if (timeout_ms == OSAL_MAX_DELAY)
         {
             ret = pthread_cond_wait(&queue->not_full, &queue->mutex);
@@ -170,6 +205,8 @@ osal_status_t osal_queue_send(osal_queue_id_t queue_id,
 
         if (ret == ETIMEDOUT)
         {
+            osal_queue_add(&queue->send_full, 1U);
+            osal_queue_add(&queue->send_wait_us, osal_task_get_time_us() - start_us);
             pthread_mutex_unlock(&queue->mutex);
             return OSAL_QUEUE_TIMEOUT;
         }
@@ -181,9 +218,19 @@ osal_status_t osal_queue_send(osal_queue_id_t queue_id,
         }
     }
 
+    if (waited)
+    {
+        osal_queue_add(&queue->send_wait_us, osal_task_get_time_us() - start_us);
+    }
+
     memcpy(queue->buffer + (queue->tail * queue->item_size), item, queue->item_size);
     queue->tail = (queue->tail + 1U) % queue->max_items;
     queue->count++;
+    osal_queue_add(&queue->sends, 1U);
+    if (queue->count > queue->high_water)
+    {
+        __atomic_store_n(&queue->high_water, queue->count, __ATOMIC_RELAXED);
+    }
 
     pthread_cond_signal(&queue->not_empty);
     pthread_mutex_unlock(&queue->mutex);
@@ -197,6 +244,8 @@ osal_status_t osal_queue_receive(osal_queue_id_t queue_id,
 {
     struct osal_queue_internal *queue = queue_id;
     struct timespec deadline;
+    uint64_t start_us = 0U;
+    bool waited = false;
     int ret;
 
     OSAL_CHECK_POINTER(queue);
@@ -219,10 +268,17 @@ osal_status_t osal_queue_receive(osal_queue_id_t queue_id,
     {
         if (timeout_ms == 0U)
         {
+            osal_queue_add(&queue->receive_empty, 1U);
             pthread_mutex_unlock(&queue->mutex);
             return OSAL_QUEUE_EMPTY;
         }
 
+        if (!waited)
+        {
+            start_us = osal_task_get_time_us();
+            waited = true;
+        }
+
         if (timeout_ms == OSAL_MAX_DELAY)
         {
             ret = pthread_cond_wait(&queue->not_empty, &queue->mutex);
@@ -234,6 +290,8 @@ osal_status_t osal_queue_receive(osal_queue_id_t queue_id,
 
         if (ret == ETIMEDOUT)
         {
+            osal_queue_add(&queue->receive_empty, 1U);
+            osal_queue_add(&queue->receive_wait_us, osal_task_get_time_us() - start_us);
             pthread_mutex_unlock(&queue->mutex);
             return OSAL_QUEUE_TIMEOUT;
         }
@@ -245,9 +303,15 @@ osal_status_t osal_queue_receive(osal_queue_id_t queue_id,
         }
     }
 
+    if (waited)
+    {
+        osal_queue_add(&queue->receive_wait_us, osal_task_get_time_us() - start_us);
+    }
+
     memcpy(buffer, queue->buffer + (queue->head * queue->item_size), queue->item_size);
     queue->head = (queue->head + 1U) % queue->max_items;
     queue->count--;
+    osal_queue_add(&queue->receives, 1U);
 
     pthread_cond_signal(&queue->not_full);
     pthread_mutex_unlock(&queue->mutex);
@@ -259,8 +323,21 @@ osal_status_t osal_queue_delete(osal_queue_id_t queue_id)
 {
     struct osal_queue_internal *queue = queue_id;
 
+    struct osal_queue_internal **link;
+
     OSAL_CHECK_POINTER(queue);
 
+    pthread_mutex_lock(&osal_queue_registry_mutex);
+    for (link = &osal_queue_registry_head; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == queue)
+        {
+            *link = queue->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&osal_queue_registry_mutex);
+
     if (pthread_cond_destroy(&queue->not_empty) != 0)
     {
         return OSAL_ERR_INVALID_ID;
@@ -300,6 +377,65 @@ uint32_t osal_queue_get_count(osal_queue_id_t queue_id)
     return count;
 }
 
+/* Called with the registry locked */
+static void osal_queue_fill_stats(struct osal_queue_internal *queue, osal_queue_stats_t *entry)
+{
+    memcpy(entry->name, queue->name, sizeof(entry->name));
+    entry->max_items = queue->max_items;
+    entry->item_size = (uint32_t)queue->item_size;
+    entry->count = osal_queue_get_count(queue);
+    entry->high_water = __atomic_load_n(&queue->high_water, __ATOMIC_RELAXED);
+    entry->sends = __atomic_load_n(&queue->sends, __ATOMIC_RELAXED);
+    entry->receives = __atomic_load_n(&queue->receives, __ATOMIC_RELAXED);
+    entry->send_full = __atomic_load_n(&queue->send_full, __ATOMIC_RELAXED);
+    entry->receive_empty = __atomic_load_n(&queue->receive_empty, __ATOMIC_RELAXED);
+    entry->send_wait_us = __atomic_load_n(&queue->send_wait_us, __ATOMIC_RELAXED);
+    entry->receive_wait_us = __atomic_load_n(&queue->receive_wait_us, __ATOMIC_RELAXED);
+}
+
+osal_status_t osal_queue_get_stats(osal_queue_stats_t *stats,
+                                   uint32_t max_count,
+                                   uint32_t *count)
+{
+    struct osal_queue_internal *queue;
+    uint32_t n = 0U;
+
+    OSAL_CHECK_POINTER(stats);
+    OSAL_CHECK_POINTER(count);
+
+    pthread_mutex_lock(&osal_queue_registry_mutex);
+    for (queue = osal_queue_registry_head; queue != NULL && n < max_count; queue = queue->next)
+    {
+        osal_queue_fill_stats(queue, &stats[n++]);
+    }
+    pthread_mutex_unlock(&osal_queue_registry_mutex);
+
+    *count = n;
+    return OSAL_SUCCESS;
+}
+
+osal_status_t osal_queue_get_stats_by_name(const char *name,
+                                           osal_queue_stats_t *stats)
+{
+    struct osal_queue_internal *queue;
+
+    OSAL_CHECK_POINTER(name);
+    OSAL_CHECK_POINTER(stats);
+
+    pthread_mutex_lock(&osal_queue_registry_mutex);
+    for (queue = osal_queue_registry_head; queue != NULL; queue = queue->next)
+    {
+        if (strcmp(queue->name, name) == 0)
+        {
+            osal_queue_fill_stats(queue, stats);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&osal_queue_registry_mutex);
+
+    return (queue != NULL) ? OSAL_SUCCESS : OSAL_ERR_NAME_NOT_FOUND;
+}
+
 osal_status_t osal_queue_send_from_isr(osal_queue_id_t queue_id, const void *item)
 {
     (void)queue_id;
@@ -14,16 +14,51 @@ struct osal_task_start
 {
     void (*routine)(void *);
     void *arg;
+    pthread_t thread;
+    osal_priority_t priority;
+    size_t stack_size;
+    char name[OSAL_MAX_NAME_LEN];
+    struct osal_task_start *next;
 };
 
-static void *osal_task_entry(void *param)
+/* Running tasks, for osal_task_get_stats(); each task adds itself on start
+ * and removes itself on return or cancellation. */
+static pthread_mutex_t osal_task_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct osal_task_start *osal_task_registry_head;
+
+static void osal_task_registry_remove(void *param)
 {
     struct osal_task_start *start = (struct osal_task_start *)param;
-    void (*routine)(void *) = start->routine;
-    void *arg = start->arg;
+    struct osal_task_start **link;
+
+    pthread_mutex_lock(&osal_task_registry_mutex);
+    for (link = &osal_task_registry_head; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == start)
+        {
+            *link = start->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&osal_task_registry_mutex);
 
     free(start);
-    routine(arg);
+}
+
+static void *osal_task_entry(void *param)
+{
+    struct osal_task_start *start = (struct osal_task_start *)param;
+
+    start->thread = pthread_self();
+    pthread_mutex_lock(&osal_task_registry_mutex);
+    start->next = osal_task_registry_head;
+    osal_task_registry_head = start;
+    pthread_mutex_unlock(&osal_task_registry_mutex);
+
+    /* osal_task_delete() cancels the thread, which runs the cleanup too */
+    pthread_cleanup_push(osal_task_registry_remove, start);
+    start->routine(start->arg);
+    pthread_cleanup_pop(1);
 
     return NULL;
 }
@@ -126,8 +161,12 @@ osal_status_t osal_task_create(osal_task_id_t *task_id,
         return OSAL_ERROR;
     }
 
+    memset(start, 0, sizeof(*start));
     start->routine = routine;
     start->arg = arg;
+    start->priority = priority;
+    start->stack_size = stack_size;
+    strncpy(start->name, task_name, OSAL_MAX_NAME_LEN - 1U);
 
     ret = pthread_attr_init(&thread_attr);
     if (ret != 0)
@@ -241,3 +280,49 @@ uint32_t osal_task_get_time_ms(void)
 
     return (uint32_t)((ts.tv_sec * 1000U) + (ts.tv_nsec / 1000000U));
 }
+
+uint64_t osal_task_get_time_us(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+    {
+        return 0U;
+    }
+
+    return ((uint64_t)ts.tv_sec * 1000000U) + ((uint64_t)ts.tv_nsec / 1000U);
+}
+
+osal_status_t osal_task_get_stats(osal_task_stats_t *stats, uint32_t max_count, uint32_t *count)
+{
+    struct osal_task_start *cur;
+    uint32_t n = 0U;
+
+    OSAL_CHECK_POINTER(stats);
+    OSAL_CHECK_POINTER(count);
+
+    pthread_mutex_lock(&osal_task_registry_mutex);
+    for (cur = osal_task_registry_head; cur != NULL && n < max_count; cur = cur->next)
+    {
+        osal_task_stats_t *entry = &stats[n++];
+        clockid_t clock_id;
+        struct timespec ts;
+
+        memcpy(entry->name, cur->name, sizeof(entry->name));
+        entry->priority = cur->priority;
+        entry->stack_size = cur->stack_size;
+        entry->stack_free_min = 0U;
+        entry->cpu_time_us = 0U;
+
+        /* Still valid: the thread removes itself before it ends */
+        if (pthread_getcpuclockid(cur->thread, &clock_id) == 0 &&
+            clock_gettime(clock_id, &ts) == 0)
+        {
+            entry->cpu_time_us = ((uint64_t)ts.tv_sec * 1000000U) + ((uint64_t)ts.tv_nsec / 1000U);
+        }
+    }
+    pthread_mutex_unlock(&osal_task_registry_mutex);
+
+    *count = n;
+    return OSAL_SUCCESS;
+}
@@ -23,6 +23,16 @@ static void osal_timespec_add_ms(struct timespec *ts, uint32_t ms)
     }
 }
 
+/* Every timer, for osal_timer_get_stats() */
+static pthread_mutex_t osal_timer_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct osal_timer_internal *osal_timer_registry_head;
+
+static int64_t osal_timespec_diff_ms(const struct timespec *later, const struct timespec *earlier)
+{
+    return ((int64_t)(later->tv_sec - earlier->tv_sec) * 1000) +
+           ((int64_t)(later->tv_nsec - earlier->tv_nsec) / 1000000);
+}
+
 static int osal_timer_get_deadline(struct osal_timer_internal *timer, struct timespec *ts)
 {
     if (clock_gettime(timer->clock_id, ts) != 0)
@@ -45,8 +55,6 @@ static void *osal_timer_thread(void *arg)
 
     while (!timer->stop_requested)
     {
-        struct timespec deadline;
-
         while (!timer->active && !timer->stop_requested)
         {
             pthread_cond_wait(&timer->cond, &timer->mutex);
@@ -57,7 +65,7 @@ static void *osal_timer_thread(void *arg)
             break;
         }
 
-        if (osal_timer_get_deadline(timer, &deadline) != 0)
+        if (osal_timer_get_deadline(timer, &timer->deadline) != 0)
         {
             timer->active = false;
             break;
@@ -65,12 +73,25 @@ static void *osal_timer_thread(void *arg)
 
         while (timer->active && !timer->stop_requested)
         {
-            int ret = pthread_cond_timedwait(&timer->cond, &timer->mutex, &deadline);
+            int ret = pthread_cond_timedwait(&timer->cond, &timer->mutex, &timer->deadline);
 
             if (ret == ETIMEDOUT)
             {
                 void (*callback)(osal_timer_id_t) = timer->callback;
                 osal_timer_id_t id = timer;
+                struct timespec now;
+
+                /* A wakeup a period or more late means expiries were missed */
+                timer->expirations++;
+                if (clock_gettime(timer->clock_id, &now) == 0)
+                {
+                    int64_t late_ms = osal_timespec_diff_ms(&now, &timer->deadline);
+
+                    if (late_ms >= (int64_t)timer->period_ms)
+                    {
+                        timer->overruns += (uint32_t)(late_ms / (int64_t)timer->period_ms);
+                    }
+                }
 
                 if (!timer->auto_reload)
                 {
@@ -78,7 +99,7 @@ static void *osal_timer_thread(void *arg)
                 }
                 else
                 {
-                    if (osal_timer_get_deadline(timer, &deadline) != 0)
+                    if (osal_timer_get_deadline(timer, &timer->deadline) != 0)
                     {
                         timer->active = false;
                     }
@@ -104,7 +125,7 @@ static void *osal_timer_thread(void *arg)
                 {
                     break;
                 }
-                if (osal_timer_get_deadline(timer, &deadline) != 0)
+                if (osal_timer_get_deadline(timer, &timer->deadline) != 0)
                 {
                     timer->active = false;
                     break;
@@ -234,6 +255,11 @@ osal_status_t osal_timer_create(osal_timer_id_t *timer_id,
         return OSAL_ERROR;
     }
 
+    pthread_mutex_lock(&osal_timer_registry_mutex);
+    timer->next = osal_timer_registry_head;
+    osal_timer_registry_head = timer;
+    pthread_mutex_unlock(&osal_timer_registry_mutex);
+
     *timer_id = timer;
     return OSAL_SUCCESS;
 }
@@ -298,10 +324,22 @@ osal_status_t osal_timer_stop(osal_timer_id_t timer_id, uint32_t timeout_ms)
 osal_status_t osal_timer_delete(osal_timer_id_t timer_id, uint32_t timeout_ms)
 {
     struct osal_timer_internal *timer = timer_id;
+    struct osal_timer_internal **link;
 
     (void)timeout_ms;
     OSAL_CHECK_POINTER(timer);
 
+    pthread_mutex_lock(&osal_timer_registry_mutex);
+    for (link = &osal_timer_registry_head; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == timer)
+        {
+            *link = timer->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&osal_timer_registry_mutex);
+
     if (pthread_mutex_lock(&timer->mutex) != 0)
     {
         return OSAL_ERROR;
@@ -427,3 +465,43 @@ osal_status_t osal_timer_set_context(osal_timer_id_t timer_id, void *context)
 
     return OSAL_SUCCESS;
 }
+
+osal_status_t osal_timer_get_stats(osal_timer_stats_t *stats,
+                                   uint32_t max_count,
+                                   uint32_t *count)
+{
+    struct osal_timer_internal *timer;
+    uint32_t n = 0U;
+
+    OSAL_CHECK_POINTER(stats);
+    OSAL_CHECK_POINTER(count);
+
+    pthread_mutex_lock(&osal_timer_registry_mutex);
+    for (timer = osal_timer_registry_head; timer != NULL && n < max_count; timer = timer->next)
+    {
+        osal_timer_stats_t *entry = &stats[n++];
+        struct timespec now;
+
+        memcpy(entry->name, timer->name, sizeof(entry->name));
+
+        pthread_mutex_lock(&timer->mutex);
+        entry->period_ms = timer->period_ms;
+        entry->active = timer->active;
+        entry->auto_reload = timer->auto_reload;
+        entry->expirations = timer->expirations;
+        entry->overruns = timer->overruns;
+        entry->next_ms = 0U;
+        /* The deadline is set once the timer thread picks up the start */
+        if (timer->active && timer->deadline.tv_sec != 0 && clock_gettime(timer->clock_id, &now) == 0)
+        {
+            int64_t left_ms = osal_timespec_diff_ms(&timer->deadline, &now);
+
+            entry->next_ms = (left_ms > 0) ? (uint32_t)left_ms : 0U;
+        }
+        pthread_mutex_unlock(&timer->mutex);
+    }
+    pthread_mutex_unlock(&osal_timer_registry_mutex);
+
+    *count = n;
+    return OSAL_SUCCESS;
+}
@@ -0,0 +1,243 @@
+#include "cmd_api.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cmd_remote.h"
+#include "hq_cmd.h"
+#include "hq_config.h"
+#include "http_server.h"
+#include "mongoose_process.h"
+#include "mqtt_app.h"
+#include "osal_log.h"
+
+#define MODULE_NAME "[CMD API] "
+
+#ifndef CONFIG_CMD_REMOTE_PASSWORD
+#define CONFIG_CMD_REMOTE_PASSWORD ""
+#endif
+
+#ifdef CONFIG_CMD_API
+
+#ifndef CONFIG_CMD_API_OUTPUT_SIZE
+#define CONFIG_CMD_API_OUTPUT_SIZE 2048
+#endif
+
+#ifndef CONFIG_CMD_API_TOPIC
+#define CONFIG_CMD_API_TOPIC "hq/cmd"
+#endif
+
+#define CMD_API_FILTER    CONFIG_CMD_API_TOPIC "/+"
+#define CMD_API_TOPIC_MAX 120    // Room for "/reply" in a 128-byte topic
+
+#define TEXT_HEADERS      "Content-Type: text/plain\r\n"
+
+// One command line on its way through a worker; freed after the reply
+typedef struct
+{
+  unsigned long conn_id;          // HTTP connection to answer, 0 for MQTT
+  char topic[CMD_API_TOPIC_MAX];  // MQTT topic the line came from
+  int32_t rc;
+  hq_cmd_buffer_t buffer;
+  char line[CONFIG_CMD_BUFFER_SIZE + 2];
+  char output[CONFIG_CMD_API_OUTPUT_SIZE];
+} cmd_api_job_t;
+
+// One command at a time; set on the poll task, cleared once answered
+static bool busy = false;
+
+static void _finish( cmd_api_job_t* job )
+{
+  free( job );
+  __atomic_store_n( &busy, false, __ATOMIC_RELEASE );
+}
+
+static void _reply_on_loop( void* arg )
+{
+  cmd_api_job_t* job = (cmd_api_job_t*) arg;
+
+  if ( job->conn_id != 0 )
+  {
+    HTTPServerResponse_t response = {
+      .code = ( job->rc == 0 ) ? 200 : 400,
+      .headers = job->buffer.truncated ? TEXT_HEADERS "X-Output-Truncated: 1\r\n" : TEXT_HEADERS,
+      .msg = job->output,
+    };
+    // Dropped if the client left in the meantime
+    (void) HTTPServer_Reply( job->conn_id, &response );
+  }
+  else
+  {
+    char reply[128];
+
+    snprintf( reply, sizeof( reply ), "%s/%s", job->topic, ( job->rc == 0 ) ? "reply" : "error" );
+    (void) MqttApp_PostData( reply, job->output, 0 );
+  }
+  _finish( job );
+}
+
+static void _run( void* arg )
+{
+  cmd_api_job_t* job = (cmd_api_job_t*) arg;
+
+  job->rc = hq_cmd_execute( job->line, hq_cmd_buffer_write, &job->buffer );
+
+  // Only the poll task may touch the connection or answer in order
+  if ( !MongooseProcess_Call( _reply_on_loop, job ) )
+  {
+    osal_log_error( MODULE_NAME "Reply to \"%s\" lost\n", job->line );
+    _finish( job );
+  }
+}
+
+// Copies a command line that is not NUL-terminated and hands it to a
+// worker; returns NULL once it is on its way, otherwise why not
+static const char* _start( const char* data, size_t len, unsigned long conn_id, const char* topic, size_t topic_len )
+{
+  cmd_api_job_t* job;
+
+  if ( __atomic_load_n( &busy, __ATOMIC_ACQUIRE ) )
+  {
+    return "Another command is running\n";
+  }
+
+  job = malloc( sizeof( *job ) );
+  if ( job == NULL )
+  {
+    return "Out of memory\n";
+  }
+
+  // One byte more than a command line may have, so a longer one is refused
+  if ( len > CONFIG_CMD_BUFFER_SIZE + 1U )
+  {
+    len = CONFIG_CMD_BUFFER_SIZE + 1U;
+  }
+  memcpy( job->line, data, len );
+  job->line[len] = '\0';
+  memcpy( job->topic, topic, topic_len );
+  job->topic[topic_len] = '\0';
+  job->conn_id = conn_id;
+  job->rc = -1;
+  job->output[0] = '\0';
+  job->buffer = (hq_cmd_buffer_t) { .data = job->output, .size = sizeof( job->output ) };
+
+  __atomic_store_n( &busy, true, __ATOMIC_RELEASE );
+  if ( !hq_cmd_post( _run, job ) )
+  {
+    _finish( job );
+    return "No worker free for the command\n";
+  }
+  return NULL;
+}
+
+static HTTPServerResponse_t _http_cmd( unsigned long conn_id, struct mg_http_message* hm, HTTPServerMethod_t method )
+{
+  HTTPServerResponse_t response = { 405, "Allow: POST\r\n", "Use POST with the command line as the body\n" };
+  struct mg_str* password = mg_http_get_header( hm, "X-Password" );
+
+  if ( method != HTTP_SERVER_METHOD_POST )
+  {
+    return response;
+  }
+  if ( CONFIG_CMD_REMOTE_PASSWORD[0] != '\0' &&
+       ( password == NULL || !CmdRemote_CheckPassword( password->buf, password->len ) ) )
+  {
+    return (HTTPServerResponse_t) { 401, TEXT_HEADERS, "Wrong or missing X-Password\n" };
+  }
+
+  response.msg = _start( hm->body.buf, hm->body.len, conn_id, "", 0 );
+  if ( response.msg == NULL )
+  {
+    return (HTTPServerResponse_t) { 0, NULL, NULL };    // Answered by _reply_on_loop()
+  }
+  response.code = 503;
+  response.headers = TEXT_HEADERS "Retry-After: 1\r\n";
+  return response;
+}
+
+// The payload is the command line, after a password line if one is set
+static void _mqtt_cmd( const char* topic, size_t topic_len, const char* message, size_t message_len, void* ctx )
+{
+  const char* error = NULL;
+  const char* line = message;
+  size_t line_len = message_len;
+  char reply[128];
+
+  (void) ctx;
+
+  if ( topic_len >= CMD_API_TOPIC_MAX )
+  {
+    return;
+  }
+
+  if ( CONFIG_CMD_REMOTE_PASSWORD[0] != '\0' )
+  {
+    const char* end = memchr( message, '\n', message_len );
+    size_t password_len = ( end != NULL ) ? (size_t) ( end - message ) : message_len;
+
+    if ( end == NULL || !CmdRemote_CheckPassword( message, password_len ) )
+    {
+      error = "Wrong or missing password line\n";
+    }
+    else
+    {
+      line = end + 1;
+      line_len = message_len - password_len - 1U;
+    }
+  }
+
+  if ( error == NULL && ( error = _start( line, line_len, 0, topic, topic_len ) ) == NULL )
+  {
+    return;
+  }
+
+  snprintf( reply, sizeof( reply ), "%.*s/error", (int) topic_len, topic );
+  (void) MqttApp_PostData( reply, error, 0 );
+}
+
+bool CmdApi_Init( void )
+{
+  static bool added = false;
+  HTTPServerApiToken_t token = { .api_name = "cmd", .deferred_cb = _http_cmd };
+
+  // The HTTP server cannot drop an API token
+  if ( !added )
+  {
+    HTTPServer_AddApiToken( &token );
+    added = true;
+  }
+  return true;
+}
+
+bool CmdApi_SubscribeMqtt( uint32_t timeout_ms )
+{
+  return MqttApp_SubscribeCtx( CMD_API_FILTER, 0, _mqtt_cmd, NULL, timeout_ms );
+}
+
+bool CmdApi_UnsubscribeMqtt( uint32_t timeout_ms )
+{
+  return MqttApp_UnsubscribeCtx( CMD_API_FILTER, _mqtt_cmd, NULL, timeout_ms );
+}
+
+#else
+
+bool CmdApi_Init( void )
+{
+  osal_log_warning( MODULE_NAME "Disabled, enable CONFIG_CMD_API\n" );
+  return false;
+}
+
+bool CmdApi_SubscribeMqtt( uint32_t timeout_ms )
+{
+  (void) timeout_ms;
+  return false;
+}
+
+bool CmdApi_UnsubscribeMqtt( uint32_t timeout_ms )
+{
+  (void) timeout_ms;
+  return false;
+}
+
+#endif
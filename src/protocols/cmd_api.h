@@ -0,0 +1,62 @@
+/**
+ *******************************************************************************
+ * @file    cmd_api.h
+ * @brief   Registered CLI commands over HTTP and MQTT
+ *******************************************************************************
+ *
+ * Runs one command line per request with hq_cmd_execute() and answers with
+ * its output, without a line editor or session. Only built with
+ * CONFIG_CMD_API; otherwise every call returns false.
+ *
+ * - HTTP: POST the command line as the body to /api/cmd. The reply is the
+ *   output as text/plain, with status 400 if the command is unknown and
+ *   "X-Output-Truncated: 1" if the output did not fit in
+ *   CONFIG_CMD_API_OUTPUT_SIZE bytes.
+ * - MQTT: publish the command line to CONFIG_CMD_API_TOPIC/<id>, where <id>
+ *   is any name chosen by the caller. The output is published to
+ *   CONFIG_CMD_API_TOPIC/<id>/reply, or to CONFIG_CMD_API_TOPIC/<id>/error
+ *   if the command is unknown or cannot run.
+ *
+ * With CONFIG_CMD_REMOTE_PASSWORD set, an HTTP request must carry it in an
+ * "X-Password" header (401 otherwise) and an MQTT payload must start with
+ * it on a line of its own. Traffic is not encrypted either way.
+ *
+ * Commands run on the command worker pool, so the Mongoose poll task keeps
+ * serving other traffic meanwhile; the reply is sent from the poll task when
+ * the command is done. One command runs at a time: a request arriving
+ * meanwhile is answered with 503, or on the error topic.
+ */
+
+/* Define to prevent recursive inclusion ------------------------------------*/
+
+#ifndef _CMD_API_H
+#define _CMD_API_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Public functions ----------------------------------------------------------*/
+
+/**
+ * @brief   Add the /api/cmd endpoint. Call before HTTPServer_Init(); the
+ *          endpoint stays until the program ends.
+ * @return  true - if added, false without CONFIG_CMD_API
+ */
+bool CmdApi_Init( void );
+
+/**
+ * @brief   Take command lines from CONFIG_CMD_API_TOPIC/+. Call once the
+ *          MQTT client is connected, not from the Mongoose poll task.
+ * @param   [in] timeout_ms - Timeout in milliseconds for the SUBACK.
+ * @return  true - if subscribed, otherwise false
+ */
+bool CmdApi_SubscribeMqtt( uint32_t timeout_ms );
+
+/**
+ * @brief   Stop taking command lines over MQTT.
+ * @param   [in] timeout_ms - Timeout in milliseconds for the UNSUBACK.
+ * @return  true - if unsubscribed, otherwise false
+ */
+bool CmdApi_UnsubscribeMqtt( uint32_t timeout_ms );
+
+#endif
@@ -0,0 +1,111 @@
+#include "cmd_net.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "hq_cmd.h"
+#include "mongoose.h"
+#include "mongoose_process.h"
+
+// Connections listed one by one; the totals count all of them
+#define NET_MAX_LISTED 16
+
+typedef struct
+{
+  unsigned long id;
+  char flags[5];
+  char peer[48];
+  size_t recv;
+  size_t send;
+} net_conn_t;
+
+typedef struct
+{
+  net_conn_t conns[NET_MAX_LISTED];
+  int count;
+} net_list_t;
+
+static void _list_connections( void* arg )
+{
+  net_list_t* list = (net_list_t*)arg;
+
+  list->count = 0;
+  for ( struct mg_connection* c = mgr.conns; c != NULL && list->count < NET_MAX_LISTED; c = c->next )
+  {
+    net_conn_t* conn = &list->conns[list->count++];
+    int n = 0;
+
+    conn->id = c->id;
+    conn->flags[n++] = c->is_listening ? 'L' : ( c->is_client ? 'C' : 'A' );
+    if ( c->is_tls )
+    {
+      conn->flags[n++] = 'T';
+    }
+    if ( c->is_websocket )
+    {
+      conn->flags[n++] = 'W';
+    }
+    if ( c->is_udp )
+    {
+      conn->flags[n++] = 'U';
+    }
+    conn->flags[n] = '\0';
+    mg_snprintf( conn->peer, sizeof( conn->peer ), "%M", mg_print_ip_port, c->is_listening ? &c->loc : &c->rem );
+    conn->recv = c->recv.len;
+    conn->send = c->send.len;
+  }
+}
+
+static void _net_handler( hq_cmd_cli_t* cli, char* args, void* context )
+{
+  MongooseProcessStats_t stats;
+  net_list_t* list;
+
+  (void)cli;
+  (void)args;
+  (void)context;
+
+  if ( !MongooseProcess_GetStats( &stats ) )
+  {
+    hq_cmd_print( "Mongoose is not running" );
+    return;
+  }
+
+  hq_cmd_printf( "Connections: %u (%u listening, %u TLS)", (unsigned)stats.connections, (unsigned)stats.listeners,
+                 (unsigned)stats.tls );
+  hq_cmd_printf( "Buffered: %u bytes received, %u bytes to send", (unsigned)stats.recvBuffered,
+                 (unsigned)stats.sendBuffered );
+  hq_cmd_printf( "Event loop: %" PRIu64 " polls, %" PRIu64 " calls, call latency %u us avg, %u us max", stats.polls,
+                 stats.calls, (unsigned)stats.callLatencyAvgUs, (unsigned)stats.callLatencyMaxUs );
+
+  list = (net_list_t*)malloc( sizeof( *list ) );
+  if ( list == NULL || !MongooseProcess_CallWait( _list_connections, list ) )
+  {
+    free( list );
+    return;
+  }
+
+  // L listener, A accepted, C client; T TLS, W WebSocket, U UDP
+  hq_cmd_printf( "%-8s %-5s %-40s %8s %8s", "ID", "FLAGS", "ADDRESS", "RECV", "SEND" );
+  for ( int i = 0; i < list->count; i++ )
+  {
+    const net_conn_t* conn = &list->conns[i];
+
+    hq_cmd_printf( "%-8lu %-5s %-40s %8u %8u", conn->id, conn->flags, conn->peer, (unsigned)conn->recv,
+                   (unsigned)conn->send );
+  }
+  free( list );
+}
+
+bool CmdNet_Register( void )
+{
+  hq_cmd_binding_t binding = {
+    .name = "net",
+    .help = "Show Mongoose connections and event loop latency",
+    .tokenize_args = false,
+    .context = NULL,
+    .handler = _net_handler,
+  };
+
+  return hq_cmd_register( &binding ) == 0;
+}
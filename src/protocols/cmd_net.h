@@ -0,0 +1,28 @@
+/**
+ *******************************************************************************
+ * @file    cmd_net.h
+ * @brief   "net" diagnostics command for the Mongoose event loop
+ *******************************************************************************
+ *
+ * Lists the open connections with their buffered bytes and shows the event
+ * loop counters of MongooseProcess_GetStats(), among them the time calls
+ * from other tasks wait for the poll task.
+ */
+
+/* Define to prevent recursive inclusion ------------------------------------*/
+
+#ifndef _CMD_NET_H
+#define _CMD_NET_H
+
+#include <stdbool.h>
+
+/* Public functions ----------------------------------------------------------*/
+
+/**
+ * @brief   Register the "net" command. Call after hq_cmd_init(), before
+ *          remote sessions are opened.
+ * @return  true - if registered, otherwise false
+ */
+bool CmdNet_Register( void );
+
+#endif
@@ -0,0 +1,474 @@
+#include "cmd_remote.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hq_cmd.h"
+#include "hq_config.h"
+#include "hq_metrics.h"
+#include "http_server.h"
+#include "mongoose.h"
+#include "mongoose_process.h"
+#include "osal_log.h"
+
+#define MODULE_NAME "[CMD remote] "
+
+#ifndef CONFIG_CMD_REMOTE_URL
+#define CONFIG_CMD_REMOTE_URL "tcp://0.0.0.0:2323"
+#endif
+
+#ifndef CONFIG_CMD_REMOTE_WS_PATH
+#define CONFIG_CMD_REMOTE_WS_PATH "/ws/cli"
+#endif
+
+#ifndef CONFIG_CMD_REMOTE_MAX_SESSIONS
+#define CONFIG_CMD_REMOTE_MAX_SESSIONS 2
+#endif
+
+#ifndef CONFIG_CMD_REMOTE_PASSWORD
+#define CONFIG_CMD_REMOTE_PASSWORD ""
+#endif
+
+#define LOGIN_LINE_MAX 64
+
+// Telnet commands and options (RFC 854, 857, 858)
+#define TELNET_SE   240
+#define TELNET_SB   250
+#define TELNET_WILL 251
+#define TELNET_DONT 254
+#define TELNET_IAC  255
+#define TELNET_OPT_ECHO 1
+#define TELNET_OPT_SGA  3
+
+// Output of a worker command, on its way to the poll task
+typedef struct
+{
+  unsigned long id;
+  size_t len;
+  char data[];
+} remote_output_t;
+
+typedef enum
+{
+  TELNET_DATA,
+  TELNET_COMMAND,
+  TELNET_OPTION,
+  TELNET_SUB,
+  TELNET_SUB_IAC
+} telnet_state_t;
+
+typedef struct
+{
+  struct mg_connection* c;       // NULL for a free slot
+  hq_cmd_session_t* session;     // NULL until logged in
+  bool websocket;
+  bool after_cr;
+  telnet_state_t telnet;
+  size_t login_len;
+  char login[LOGIN_LINE_MAX];
+} remote_session_t;
+
+static remote_session_t sessions[CONFIG_CMD_REMOTE_MAX_SESSIONS];
+static struct mg_connection* listener;
+static bool accepting;
+
+static struct
+{
+  hq_metric_t* sessions;
+  hq_metric_t* refused;
+} metrics;
+
+static remote_session_t* _find( struct mg_connection* c )
+{
+  for ( uint32_t i = 0; i < CONFIG_CMD_REMOTE_MAX_SESSIONS; i++ )
+  {
+    if ( sessions[i].c == c )
+    {
+      return &sessions[i];
+    }
+  }
+  return NULL;
+}
+
+static void _send( remote_session_t* rs, const char* data, size_t len )
+{
+  if ( rs->websocket )
+  {
+    mg_ws_send( rs->c, data, len, WEBSOCKET_OP_TEXT );
+    return;
+  }
+
+  // A 0xFF data byte is sent twice so it is not read as IAC
+  const char* iac;
+  while ( len > 0 && ( iac = memchr( data, TELNET_IAC, len ) ) != NULL )
+  {
+    size_t n = (size_t) ( iac - data ) + 1;
+    mg_send( rs->c, data, n );
+    mg_send( rs->c, iac, 1 );
+    data += n;
+    len -= n;
+  }
+  mg_send( rs->c, data, len );
+}
+
+static void _send_on_loop( void* arg )
+{
+  remote_output_t* out = (remote_output_t*) arg;
+
+  // Dropped if the client left in the meantime
+  for ( uint32_t i = 0; i < CONFIG_CMD_REMOTE_MAX_SESSIONS; i++ )
+  {
+    if ( sessions[i].c != NULL && sessions[i].c->id == out->id )
+    {
+      _send( &sessions[i], out->data, out->len );
+    }
+  }
+  free( out );
+}
+
+// Session output: one block per CLI flush, written out by the next poll
+static void _session_write( void* ctx, const char* data, size_t len )
+{
+  remote_session_t* rs = (remote_session_t*) ctx;
+  remote_output_t* out;
+
+  if ( MongooseProcess_IsPollTask() )
+  {
+    _send( rs, data, len );
+    return;
+  }
+
+  // A worker command: only the poll task may touch the connection. The slot
+  // stays put meanwhile, as closing the session waits for this call.
+  out = malloc( sizeof( *out ) + len );
+  if ( out == NULL )
+  {
+    return;
+  }
+  out->id = rs->c->id;
+  out->len = len;
+  memcpy( out->data, data, len );
+  if ( !MongooseProcess_Call( _send_on_loop, out ) )
+  {
+    free( out );
+  }
+}
+
+static bool _open_session( remote_session_t* rs )
+{
+  rs->session = hq_cmd_session_open( _session_write, rs );
+  if ( rs->session == NULL )
+  {
+    osal_log_error( MODULE_NAME "Out of memory for a session\n" );
+    rs->c->is_draining = 1;
+    return false;
+  }
+  return true;
+}
+
+// Collects the password line; returns the bytes it used
+static size_t _login( remote_session_t* rs, const char* data, size_t len )
+{
+  for ( size_t i = 0; i < len; i++ )
+  {
+    if ( data[i] != '\r' && data[i] != '\n' )
+    {
+      if ( rs->login_len < sizeof( rs->login ) )
+      {
+        rs->login[rs->login_len] = data[i];
+      }
+      rs->login_len++;
+      continue;
+    }
+
+    bool ok = rs->login_len <= sizeof( rs->login ) && CmdRemote_CheckPassword( rs->login, rs->login_len );
+    memset( rs->login, 0, sizeof( rs->login ) );
+    _send( rs, "\r\n", 2 );
+    if ( !ok )
+    {
+      osal_log_warning( MODULE_NAME "Wrong password from a remote client\n" );
+      _send( rs, "Access denied\r\n", 15 );
+      rs->c->is_draining = 1;
+      return len;
+    }
+    _open_session( rs );
+    // The line ending itself is not passed on
+    return i + 1;
+  }
+  return len;
+}
+
+static void _input( remote_session_t* rs, const char* data, size_t len )
+{
+  if ( rs->session == NULL )
+  {
+    size_t used = _login( rs, data, len );
+    data += used;
+    len -= used;
+  }
+  if ( rs->session != NULL && len > 0 )
+  {
+    hq_cmd_session_input( rs->session, data, len );
+  }
+}
+
+// Strips telnet negotiation in place; returns the data bytes left
+static size_t _telnet_filter( remote_session_t* rs, uint8_t* buf, size_t len )
+{
+  size_t out = 0;
+
+  for ( size_t i = 0; i < len; i++ )
+  {
+    uint8_t b = buf[i];
+
+    switch ( rs->telnet )
+    {
+      case TELNET_DATA:
+        if ( b == TELNET_IAC )
+        {
+          rs->telnet = TELNET_COMMAND;
+        }
+        else if ( !( b == 0 && rs->after_cr ) )    // CR NUL is a bare CR
+        {
+          buf[out++] = b;
+        }
+        rs->after_cr = ( b == '\r' );
+        break;
+      case TELNET_COMMAND:
+        if ( b == TELNET_IAC )
+        {
+          buf[out++] = b;
+          rs->telnet = TELNET_DATA;
+        }
+        else if ( b >= TELNET_WILL && b <= TELNET_DONT )
+        {
+          rs->telnet = TELNET_OPTION;
+        }
+        else
+        {
+          rs->telnet = ( b == TELNET_SB ) ? TELNET_SUB : TELNET_DATA;
+        }
+        break;
+      case TELNET_OPTION:
+        rs->telnet = TELNET_DATA;
+        break;
+      case TELNET_SUB:
+        if ( b == TELNET_IAC )
+        {
+          rs->telnet = TELNET_SUB_IAC;
+        }
+        break;
+      case TELNET_SUB_IAC:
+        rs->telnet = ( b == TELNET_SE ) ? TELNET_DATA : TELNET_SUB;
+        break;
+    }
+  }
+  return out;
+}
+
+static void _accept( struct mg_connection* c, bool websocket )
+{
+  static const char refused[] = "Too many sessions\r\n";
+  remote_session_t* rs = accepting ? _find( NULL ) : NULL;
+
+  if ( rs == NULL )
+  {
+    hq_metrics_inc( metrics.refused );
+    if ( websocket )
+    {
+      mg_ws_send( c, refused, sizeof( refused ) - 1, WEBSOCKET_OP_TEXT );
+    }
+    else
+    {
+      mg_send( c, refused, sizeof( refused ) - 1 );
+    }
+    c->is_draining = 1;
+    return;
+  }
+
+  memset( rs, 0, sizeof( *rs ) );
+  rs->c = c;
+  rs->websocket = websocket;
+  hq_metrics_gauge_add( metrics.sessions, 1 );
+
+  if ( !websocket )
+  {
+    // The CLI echoes, so the client should neither echo nor wait for lines
+    static const uint8_t negotiate[] = { TELNET_IAC, TELNET_WILL, TELNET_OPT_ECHO,
+                                         TELNET_IAC, TELNET_WILL, TELNET_OPT_SGA };
+    mg_send( c, negotiate, sizeof( negotiate ) );
+  }
+
+  if ( CONFIG_CMD_REMOTE_PASSWORD[0] == '\0' )
+  {
+    _open_session( rs );
+  }
+  else
+  {
+    _send( rs, "Password: ", 10 );
+  }
+}
+
+static void _release( struct mg_connection* c )
+{
+  remote_session_t* rs = _find( c );
+
+  if ( rs != NULL )
+  {
+    hq_cmd_session_close( rs->session );
+    memset( rs, 0, sizeof( *rs ) );
+    hq_metrics_gauge_add( metrics.sessions, -1 );
+  }
+}
+
+static void _telnet_fn( struct mg_connection* c, int ev, void* ev_data )
+{
+  (void) ev_data;
+
+  if ( ev == MG_EV_ACCEPT )
+  {
+    _accept( c, false );
+  }
+  else if ( ev == MG_EV_READ )
+  {
+    remote_session_t* rs = _find( c );
+
+    if ( rs != NULL )
+    {
+      size_t len = _telnet_filter( rs, c->recv.buf, c->recv.len );
+      _input( rs, (const char*) c->recv.buf, len );
+    }
+    c->recv.len = 0;
+  }
+  else if ( ev == MG_EV_CLOSE )
+  {
+    _release( c );
+    if ( c == listener )
+    {
+      listener = NULL;
+    }
+  }
+}
+
+static void _ws_open( struct mg_connection* c )
+{
+  _accept( c, true );
+}
+
+static void _ws_message( struct mg_connection* c, struct mg_str data )
+{
+  remote_session_t* rs = _find( c );
+
+  if ( rs != NULL )
+  {
+    _input( rs, data.buf, data.len );
+  }
+}
+
+static void _ws_close( struct mg_connection* c )
+{
+  _release( c );
+}
+
+static void _start_on_loop( void* arg )
+{
+  (void) arg;
+  accepting = true;
+  if ( listener == NULL )
+  {
+    listener = mg_listen( &mgr, CONFIG_CMD_REMOTE_URL, _telnet_fn, NULL );
+  }
+}
+
+static void _stop_on_loop( void* arg )
+{
+  (void) arg;
+  accepting = false;
+  if ( listener != NULL )
+  {
+    listener->is_closing = 1;
+    listener = NULL;
+  }
+  for ( uint32_t i = 0; i < CONFIG_CMD_REMOTE_MAX_SESSIONS; i++ )
+  {
+    if ( sessions[i].c != NULL )
+    {
+      sessions[i].c->is_closing = 1;
+    }
+  }
+}
+
+static void _count_on_loop( void* arg )
+{
+  uint32_t* count = (uint32_t*) arg;
+
+  *count = 0;
+  for ( uint32_t i = 0; i < CONFIG_CMD_REMOTE_MAX_SESSIONS; i++ )
+  {
+    if ( sessions[i].c != NULL )
+    {
+      ( *count )++;
+    }
+  }
+}
+
+bool CmdRemote_Init( void )
+{
+  static bool endpoint_added = false;
+  static const HTTPServerWsEndpoint_t endpoint = {
+    .path = CONFIG_CMD_REMOTE_WS_PATH,
+    .open = _ws_open,
+    .message = _ws_message,
+    .close = _ws_close,
+  };
+
+  metrics.sessions = hq_metrics_gauge( "hq_cmd_remote_sessions", NULL, "Remote CLI clients connected" );
+  metrics.refused = hq_metrics_counter( "hq_cmd_remote_refused_total", NULL, "Remote CLI clients turned away" );
+
+  // The HTTP server cannot drop an endpoint; Deinit only stops accepting
+  if ( !endpoint_added )
+  {
+    HTTPServer_AddWsEndpoint( &endpoint );
+    endpoint_added = true;
+  }
+
+  if ( !MongooseProcess_CallWait( _start_on_loop, NULL ) || listener == NULL )
+  {
+    osal_log_error( MODULE_NAME "Cannot listen on %s\n", CONFIG_CMD_REMOTE_URL );
+    return false;
+  }
+  osal_log_info( MODULE_NAME "Listening on %s and %s\n", CONFIG_CMD_REMOTE_URL, CONFIG_CMD_REMOTE_WS_PATH );
+  return true;
+}
+
+void CmdRemote_Deinit( void )
+{
+  (void) MongooseProcess_CallWait( _stop_on_loop, NULL );
+}
+
+bool CmdRemote_CheckPassword( const char* data, size_t len )
+{
+  const char* password = CONFIG_CMD_REMOTE_PASSWORD;
+  size_t expected = strlen( password );
+  uint8_t diff = (uint8_t) ( len != expected );
+
+  if ( expected == 0 )
+  {
+    return true;
+  }
+
+  // Same time for every wrong guess of the right length
+  for ( size_t i = 0; i < len && i < expected; i++ )
+  {
+    diff |= (uint8_t) ( data[i] ^ password[i] );
+  }
+  return diff == 0;
+}
+
+uint32_t CmdRemote_GetSessionCount( void )
+{
+  uint32_t count = 0;
+
+  (void) MongooseProcess_CallWait( _count_on_loop, &count );
+  return count;
+}
@@ -0,0 +1,58 @@
+/**
+ *******************************************************************************
+ * @file    cmd_remote.h
+ * @brief   Command line sessions over the network
+ *******************************************************************************
+ *
+ * Serves the CLI to telnet-style TCP clients on CONFIG_CMD_REMOTE_URL and to
+ * WebSocket clients on CONFIG_CMD_REMOTE_WS_PATH of the HTTP server, each
+ * client with a session of its own (see hq_cmd_session_open()). Up to
+ * CONFIG_CMD_REMOTE_MAX_SESSIONS clients are served at once; others are
+ * turned away.
+ *
+ * With CONFIG_CMD_REMOTE_PASSWORD set, the first line a client sends must be
+ * that password. Traffic is not encrypted either way: only listen on a
+ * management network.
+ *
+ * Commands run on the Mongoose poll task, so long ones hold up all other
+ * network traffic while they run; register those with run_in_worker.
+ */
+
+/* Define to prevent recursive inclusion ------------------------------------*/
+
+#ifndef _CMD_REMOTE_H
+#define _CMD_REMOTE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Public functions ----------------------------------------------------------*/
+
+/**
+ * @brief   Start the TCP listener and add the WebSocket endpoint. Call after
+ *          MongooseProcess_Init() and, for the endpoint, before
+ *          HTTPServer_Init(). Register the commands first.
+ * @return  true - if listening, otherwise false
+ */
+bool CmdRemote_Init( void );
+
+/**
+ * @brief   Stop listening and close every remote session.
+ */
+void CmdRemote_Deinit( void );
+
+/**
+ * @brief   Number of clients connected, logged in or not.
+ */
+uint32_t CmdRemote_GetSessionCount( void );
+
+/**
+ * @brief   Check a password against CONFIG_CMD_REMOTE_PASSWORD, in the same
+ *          time for every wrong guess of the right length. Also used by
+ *          the command API.
+ * @return  true - if it matches or no password is set, otherwise false
+ */
+bool CmdRemote_CheckPassword( const char* data, size_t len );
+
+#endif
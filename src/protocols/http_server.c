@@ -11,33 +11,32 @@
 
 #include "http_server.h"
 
-#include "app_config.h"
-#include "esp_system.h"
+#include <string.h>
+
+#include "hq_config.h"
+#include "hq_metrics.h"
 #include "mongoose.h"
-#include "mongoose_task.h"
+#include "mongoose_process.h"
+#include "osal_log.h"
+#include "osal_task.h"
 
 /* Private macros ------------------------------------------------------------*/
 #define MODULE_NAME "[HTTP SERV] "
-#define DEBUG_LVL   PRINT_INFO
-
-#if CONFIG_DEBUG_HTTP_SERVER
-#define LOG( _lvl, ... ) \
-  debug_printf( DEBUG_LVL, _lvl, MODULE_NAME __VA_ARGS__ )
-#else
-#define LOG( PRINT_INFO, ... )
-#endif
 
 #ifndef HTTP_URL
 #define HTTP_URL "http://0.0.0.0:8000"
 #endif
 
-#define ARRAY_SIZE( _array ) sizeof( _array ) / sizeof( _array[0] )
+#define ARRAY_SIZE( _array ) ( sizeof( _array ) / sizeof( _array[0] ) )
 #define CONNECTION_TIMEOUT   5000
 
 static struct mg_connection* nc;
 static HTTPServerApiToken_t tokens[16];
-static TickType_t last_msg_time;
+static HTTPServerWsEndpoint_t ws_endpoints[4];
+static uint32_t ws_endpoints_size;
+static uint32_t last_msg_time;
 static uint32_t tokens_size;
+static char static_root[128];
 static const char* method_names[] = {
   [HTTP_SERVER_METHOD_GET] = "GET",
   [HTTP_SERVER_METHOD_PUT] = "PUT",
@@ -51,6 +50,15 @@ static const char* method_names[] = {
 
 /* Private variables ---------------------------------------------------------*/
 
+static const uint64_t latency_bounds_ms[] = { 1, 5, 10, 25, 50, 100, 250, 500, 1000 };
+
+static struct
+{
+  hq_metric_t* requests[5]; /* by status class 1xx..5xx */
+  hq_metric_t* latency;
+  hq_metric_t* scrapes;
+} metrics;
+
 /* Private functions ---------------------------------------------------------*/
 
 static HTTPServerMethod_t _get_method( struct mg_str* name )
@@ -65,33 +73,167 @@ static HTTPServerMethod_t _get_method( struct mg_str* name )
   return HTTP_SERVER_METHOD_UNHALLOWED;
 }
 
+static void _count_response( uint32_t code, uint32_t start_ms )
+{
+  uint32_t cls = code / 100;
+
+  if ( cls >= 1 && cls <= 5 )
+  {
+    hq_metrics_inc( metrics.requests[cls - 1] );
+  }
+  hq_metrics_observe( metrics.latency, osal_task_get_time_ms() - start_ms );
+}
+
+static void _metrics_sink( void* ctx, const char* data, size_t len )
+{
+  struct mg_iobuf* io = (struct mg_iobuf*) ctx;
+  mg_iobuf_add( io, io->len, data, len );
+}
+
+static uint32_t _serve_metrics( struct mg_connection* c )
+{
+  struct mg_iobuf body = { NULL, 0, 0, 512 };
+
+  hq_metrics_inc( metrics.scrapes );
+  if ( hq_metrics_render( _metrics_sink, &body ) < 0 )
+  {
+    mg_iobuf_free( &body );
+    mg_http_reply( c, 503, "", "Metrics unavailable\n" );
+    return 503;
+  }
+
+  mg_printf( c,
+             "HTTP/1.1 200 OK\r\n"
+             "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+             "Content-Length: %lu\r\n\r\n",
+             (unsigned long) body.len );
+  mg_send( c, body.buf, body.len );
+  c->is_resp = 0;    // Response complete, keep-alive may carry the next request
+  mg_iobuf_free( &body );
+  return 200;
+}
+
+// Replies to an API token callback; code 0 leaves the request open
+static void _reply( struct mg_connection* c, const HTTPServerResponse_t* response, uint32_t start_ms )
+{
+  if ( response->code == 0 )
+  {
+    // Kept for the latency histogram; c->data[0] is for WebSocket endpoints
+    memcpy( &c->data[1], &start_ms, sizeof( start_ms ) );
+    return;
+  }
+  mg_http_reply( c, response->code, response->headers, "%s", response->msg );
+  _count_response( response->code, start_ms );
+}
+
+static uint32_t _serve_static( struct mg_connection* c, struct mg_http_message* hm )
+{
+  struct mg_http_serve_opts opts = { .root_dir = static_root };
+  size_t head = c->send.len;
+  uint32_t code = 0;
+
+  mg_http_serve_dir( c, hm, &opts );
+
+  // Recover the status from the response line for the request counters.
+  if ( c->send.len >= head + 12 && memcmp( c->send.buf + head, "HTTP/1.", 7 ) == 0 )
+  {
+    for ( size_t i = head + 9; i < head + 12; i++ )
+    {
+      code = code * 10 + (uint32_t) ( c->send.buf[i] - '0' );
+    }
+  }
+  return code;
+}
+
 static void fn( struct mg_connection* c, int ev, void* ev_data )
 {
   if ( ev == MG_EV_HTTP_MSG )
   {
-    last_msg_time = xTaskGetTickCount();
+    uint32_t start_ms = osal_task_get_time_ms();
+    last_msg_time = start_ms;
     struct mg_http_message* hm = (struct mg_http_message*) ev_data;
     struct mg_str caps[3];
+
+    if ( mg_match( hm->uri, mg_str( "/metrics" ), NULL ) )
+    {
+      _count_response( _serve_metrics( c ), start_ms );
+      return;
+    }
+
+    for ( uint32_t i = 0; i < ws_endpoints_size; i++ )
+    {
+      if ( mg_match( hm->uri, mg_str( ws_endpoints[i].path ), NULL ) )
+      {
+        c->data[0] = (char) ( i + 1 );    // Endpoint of the upgraded connection
+        mg_ws_upgrade( c, hm, NULL );
+        _count_response( 101, start_ms );
+        return;
+      }
+    }
+
     if ( mg_match( hm->uri, mg_str( "/api/#" ), caps ) )
     {
       for ( uint32_t i = 0; i < tokens_size; i++ )
       {
-        char buffer[128] = {};
+        char buffer[128] = { 0 };
         mg_snprintf( buffer, sizeof( buffer ), "/api/%s#", tokens[i].api_name );
 
         if ( mg_match( hm->uri, mg_str( buffer ), caps ) )
         {
           HTTPServerMethod_t method = _get_method( &hm->method );
-          HTTPServerResponse_t response = tokens[i].cb( &hm->uri, &hm->body, method );
-          mg_http_reply( c, response.code, response.headers, response.msg );
+          HTTPServerResponse_t response = ( tokens[i].deferred_cb != NULL )
+                                            ? tokens[i].deferred_cb( c->id, hm, method )
+                                            : tokens[i].cb( &hm->uri, &hm->body, method );
+          _reply( c, &response, start_ms );
           return;
         }
       }
     }
-    printf( "Warning: Request not implemented.\n\rURI %.*s\n\r BODY %.*s\n\r", (int) hm->uri.len, hm->uri.buf,
-            (int) hm->body.len, hm->body.buf );
+    else if ( static_root[0] != '\0' )
+    {
+      _count_response( _serve_static( c, hm ), start_ms );
+      return;
+    }
+
+    osal_log_warning( MODULE_NAME "Request not implemented: URI %.*s BODY %.*s\n", (int) hm->uri.len, hm->uri.buf,
+                      (int) hm->body.len, hm->body.buf );
     mg_http_reply( c, 400, "", "Unknown API" );
+    _count_response( 400, start_ms );
   }
+  else if ( c->data[0] != 0 )
+  {
+    const HTTPServerWsEndpoint_t* endpoint = &ws_endpoints[c->data[0] - 1];
+
+    if ( ev == MG_EV_WS_OPEN )
+    {
+      endpoint->open( c );
+    }
+    else if ( ev == MG_EV_WS_MSG )
+    {
+      endpoint->message( c, ( (struct mg_ws_message*) ev_data )->data );
+    }
+    else if ( ev == MG_EV_CLOSE && c->is_websocket )
+    {
+      endpoint->close( c );
+    }
+  }
+}
+
+static void _register_metrics( void )
+{
+  static const char* const class_labels[] = {
+    "code=\"1xx\"", "code=\"2xx\"", "code=\"3xx\"", "code=\"4xx\"", "code=\"5xx\"",
+  };
+
+  for ( uint32_t i = 0; i < ARRAY_SIZE( class_labels ); i++ )
+  {
+    metrics.requests[i] = hq_metrics_counter( "hq_http_requests_total", class_labels[i],
+                                              "HTTP requests by response status class" );
+  }
+  metrics.latency = hq_metrics_histogram( "hq_http_request_duration_ms", NULL,
+                                          "HTTP request handling time in milliseconds",
+                                          latency_bounds_ms, ARRAY_SIZE( latency_bounds_ms ) );
+  metrics.scrapes = hq_metrics_counter( "hq_http_metrics_scrapes_total", NULL, "Requests served by /metrics" );
 }
 
 /* Public functions ---------------------------------------------------------*/
@@ -100,7 +242,8 @@ void HTTPServer_Init( void )
 {
   if ( nc == NULL )
   {
-    LOG( PRINT_INFO, "Start listen %s\n", HTTP_URL );
+    _register_metrics();
+    osal_log_info( MODULE_NAME "Start listen %s\n", HTTP_URL );
     nc = mg_http_listen( &mgr, HTTP_URL, fn, &mgr );    // Setup listener
   }
 }
@@ -114,19 +257,60 @@ void HTTPServer_Deinit( void )
   nc = NULL;
 }
 
+bool HTTPServer_Reply( unsigned long conn_id, const HTTPServerResponse_t* response )
+{
+  for ( struct mg_connection* c = mgr.conns; c != NULL; c = c->next )
+  {
+    if ( c->id == conn_id && c->is_resp && !c->is_closing )
+    {
+      uint32_t start_ms;
+
+      memcpy( &start_ms, &c->data[1], sizeof( start_ms ) );
+      _reply( c, response, start_ms );
+      return true;
+    }
+  }
+  return false;
+}
+
 void HTTPServer_AddApiToken( HTTPServerApiToken_t* token )
 {
-  assert( tokens_size < ARRAY_SIZE( tokens ) );
+  if ( tokens_size >= ARRAY_SIZE( tokens ) )
+  {
+    osal_log_error( MODULE_NAME "No free API token slots for %s\n", token->api_name );
+    return;
+  }
   memcpy( &tokens[tokens_size], token, sizeof( tokens[tokens_size] ) );
   tokens_size++;
 }
 
+void HTTPServer_AddWsEndpoint( const HTTPServerWsEndpoint_t* endpoint )
+{
+  if ( ws_endpoints_size >= ARRAY_SIZE( ws_endpoints ) )
+  {
+    osal_log_error( MODULE_NAME "No free WebSocket endpoint slots for %s\n", endpoint->path );
+    return;
+  }
+  memcpy( &ws_endpoints[ws_endpoints_size], endpoint, sizeof( ws_endpoints[ws_endpoints_size] ) );
+  ws_endpoints_size++;
+}
+
+void HTTPServer_SetStaticRoot( const char* root_dir )
+{
+  if ( root_dir == NULL || strlen( root_dir ) >= sizeof( static_root ) )
+  {
+    static_root[0] = '\0';
+    return;
+  }
+  strcpy( static_root, root_dir );
+}
+
 bool HTTPServer_IsClientConnected( void )
 {
   if ( last_msg_time != 0 )
   {
-    TickType_t diff = xTaskGetTickCount() - last_msg_time;
-    if ( ST2MS( diff ) < CONNECTION_TIMEOUT )
+    uint32_t diff = osal_task_get_time_ms() - last_msg_time;
+    if ( diff < CONNECTION_TIMEOUT )
     {
       return true;
     }
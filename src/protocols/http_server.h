@@ -39,12 +39,25 @@ typedef struct
 
 typedef HTTPServerResponse_t ( *HTTPServerCb_t )( struct mg_str* uri, struct mg_str* data, HTTPServerMethod_t method );
 
+/* Answers now, or returns code 0 and answers later with HTTPServer_Reply() */
+typedef HTTPServerResponse_t ( *HTTPServerDeferredCb_t )( unsigned long conn_id, struct mg_http_message* hm,
+                                                          HTTPServerMethod_t method );
+
 typedef struct
 {
   const char* api_name; /* API name after /api/ */
   HTTPServerCb_t cb;
+  HTTPServerDeferredCb_t deferred_cb; /* Used instead of cb when set */
 } HTTPServerApiToken_t;
 
+typedef struct
+{
+  const char* path; /* Upgraded to a WebSocket when requested, e.g. "/ws/cli" */
+  void ( *open )( struct mg_connection* c );
+  void ( *message )( struct mg_connection* c, struct mg_str data );
+  void ( *close )( struct mg_connection* c );
+} HTTPServerWsEndpoint_t;
+
 /* Public functions ----------------------------------------------------------*/
 
 /**
@@ -62,6 +75,27 @@ void HTTPServer_Deinit( void );
  */
 void HTTPServer_AddApiToken( HTTPServerApiToken_t* token );
 
+/**
+ * @brief   Answer a request a deferred callback left open. Later requests on
+ *          the same connection wait until then. Call on the Mongoose poll task.
+ * @param   [in] conn_id - Connection id passed to the callback.
+ * @return  true - if sent, false if the client has gone
+ */
+bool HTTPServer_Reply( unsigned long conn_id, const HTTPServerResponse_t* response );
+
+/**
+ * @brief   Add WebSocket endpoint. The callbacks run on the Mongoose poll task.
+ *          Call before HTTPServer_Init().
+ */
+void HTTPServer_AddWsEndpoint( const HTTPServerWsEndpoint_t* endpoint );
+
+/**
+ * @brief   Serve files from a directory for requests outside /api/ and /metrics.
+ *          Call before HTTPServer_Init().
+ * @param   [in] root_dir - Directory to serve, or NULL to disable.
+ */
+void HTTPServer_SetStaticRoot( const char* root_dir );
+
 /**
  * @brief   Checks if any client send data last 5 seconds.
  */
@@ -1,620 +1,2834 @@
 #include "mqtt_app.h"
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-#include "dev_config.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
-#include "freertos/timers.h"
+#include "hq_metrics.h"
 #include "mongoose.h"
-#include "mongoose_task.h"
+#include "mongoose_process.h"
+#include "mongoose_tls.h"
+#include "mqtt_compress.h"
 #include "mqtt_config.h"
-
-#define RETRY_COUNT              3
-#define MAX_SUBSCRIPTIONS        10
-#define TIMEOUT_DEFAULT_MS       5000
-#define RECONNECT_DELAY_MS       30000
-#define MESSAGE_QUEUE_SIZE       6
-#define MONGOOSE_TASK_STACK_SIZE 4096
-#define MONGOOSE_TASK_PRIORITY   5
-
+#include "mqtt_session.h"
+#include "mqtt_spool.h"
+#include "mqtt_topic_alias.h"
+#include "mqtt_topic_trie.h"
+#include "osal_bin_sem.h"
+#include "osal_count_sem.h"
+#include "osal_log.h"
+#include "osal_mutex.h"
+#include "osal_queue.h"
+#include "osal_task.h"
+#include "osal_timer.h"
+
+#define MODULE_NAME "[MQTT] "
+
+#ifndef CONFIG_MQTT_TASK_STACK_SIZE
+#define CONFIG_MQTT_TASK_STACK_SIZE 4096
+#endif
+
+#ifndef CONFIG_MQTT_MESSAGE_QUEUE_SIZE
+#define CONFIG_MQTT_MESSAGE_QUEUE_SIZE 6
+#endif
+
+#ifndef CONFIG_MQTT_SPOOL_SEGMENT_SIZE
+#define CONFIG_MQTT_SPOOL_SEGMENT_SIZE 16384
+#endif
+
+#ifndef CONFIG_MQTT_SPOOL_MAX_SEGMENTS
+#define CONFIG_MQTT_SPOOL_MAX_SEGMENTS 8
+#endif
+
+#ifndef CONFIG_MQTT_SPOOL_REPLAY_RATE
+#define CONFIG_MQTT_SPOOL_REPLAY_RATE 100
+#endif
+
+#ifndef CONFIG_MQTT_SESSION_PATH
+#define CONFIG_MQTT_SESSION_PATH "/mqtt_session"
+#endif
+
+#ifndef CONFIG_MQTT_TLS_SESSION_PATH
+#define CONFIG_MQTT_TLS_SESSION_PATH "/mqtt_tls_session"
+#endif
+
+#ifndef CONFIG_MQTT_RECONNECT_MIN_MS
+#define CONFIG_MQTT_RECONNECT_MIN_MS 1000
+#endif
+
+#ifndef CONFIG_MQTT_RECONNECT_MAX_MS
+#define CONFIG_MQTT_RECONNECT_MAX_MS 60000
+#endif
+
+#ifndef CONFIG_MQTT_RECONNECT_JITTER
+#define CONFIG_MQTT_RECONNECT_JITTER 50
+#endif
+
+#ifndef CONFIG_MQTT_TOPIC_ALIAS_MAX
+#define CONFIG_MQTT_TOPIC_ALIAS_MAX 16
+#endif
+
+#ifndef CONFIG_MQTT_TOPIC_ALIAS_HOT
+#define CONFIG_MQTT_TOPIC_ALIAS_HOT 2
+#endif
+
+#ifndef CONFIG_MQTT_COMPRESS_MIN
+#define CONFIG_MQTT_COMPRESS_MIN 256
+#endif
+
+#ifndef CONFIG_MQTT_DECOMPRESS_MAX
+#define CONFIG_MQTT_DECOMPRESS_MAX 65536
+#endif
+
+#define RETRY_COUNT         3
+#define TIMEOUT_DEFAULT_MS  5000
+#define CONNECT_TIMEOUT_MS  10000
+#define SESSION_STABLE_MS   10000
+#define RETRY_SCAN_MS       250
+#define PENDING_MAX         16
+#define RESUBSCRIBE_BATCH   32
+#define RX_QOS2_MAX         32
+#define SESSION_SAVE_MS     250
+#define COMPRESS_RULES_MAX  8
+#define MQTT_TASK_PRIORITY  5
+
+// Queued to the publisher task by MqttApp_Deinit() to stop it cleanly.
+#define MESSAGE_STOP        ( -1 )
+// Queued on connect so a publisher idle on the queue starts replaying.
+#define MESSAGE_WAKE        ( -2 )
+
+// Copy of mqtt_publish_props_t made by MqttApp_PublishProps(); one heap
+// block that also holds the property strings
+typedef struct
+{
+  uint32_t expiry_s;
+  uint32_t queued_ms;
+  size_t count;
+  struct mg_mqtt_prop user[];
+} mqtt_props_t;
+
+// Queued descriptor; topic and payload stay owned by the caller until
+// release( ctx ) runs. props is owned by the message.
 typedef struct
 {
-  char topic[64];
-  char message[256];
+  const char* topic;
+  const void* payload;
+  size_t len;
   int qos;
+  mqtt_props_t* props;
+  mqtt_release_cb_t release;
+  void* ctx;
 } mqtt_message_t;
 
+// QoS 1 publish awaiting its PUBACK, or QoS 2 publish awaiting its PUBREC
+// and then, once released, its PUBCOMP
 typedef struct
 {
-  char topic[128];
-  mqtt_message_callback_t callback;
-  bool active;
-  bool pending_unsub;
+  bool used;
+  bool released;    // QoS 2: PUBREC received and PUBREL sent, payload gone
+  uint16_t id;
+  uint8_t retries;
+  uint32_t first_sent_ms;
+  uint32_t sent_ms;
+  mqtt_message_t msg;
+} mqtt_inflight_t;
+
+// One local callback on a topic filter
+typedef struct mqtt_subscriber
+{
+  struct mqtt_subscriber* next;
+  mqtt_subscription_cb_t callback;
+  mqtt_message_callback_t legacy;
+  void* ctx;
+} mqtt_subscriber_t;
+
+// One topic filter as the broker knows it, with every local callback on it.
+// Kept in a list for resubscribing and in the trie for matching.
+typedef struct mqtt_subscription
+{
+  struct mqtt_subscription* next;
+  mqtt_subscriber_t* subscribers;
+  int qos;            // Highest QoS requested from the broker, -1 before the first SUBSCRIBE
+  uint16_t sub_id;    // SUBSCRIBE awaiting its SUBACK, 0 if none
+  char topic[];
 } mqtt_subscription_t;
 
+typedef enum
+{
+  PENDING_FREE = 0,
+  PENDING_SUBSCRIBE,
+  PENDING_UNSUBSCRIBE,
+  PENDING_RESUBSCRIBE,
+} mqtt_pending_type_t;
+
+// A request waiting for its SUBACK or UNSUBACK, keyed by packet id.
+// Requests for a filter whose SUBSCRIBE is already in flight join it and
+// share its id.
+typedef struct
+{
+  mqtt_pending_type_t type;
+  uint16_t id;
+  int prev_qos;                      // Filter QoS to restore if the SUBSCRIBE fails
+  uint32_t filters;                  // Filters in a resubscribe batch
+  mqtt_subscription_t* sub;          // NULL once the filter is gone
+  mqtt_subscriber_t* subscriber;     // Added by this request, dropped if it fails
+  uint32_t sent_ms;
+  uint32_t timeout_ms;
+  mqtt_done_cb_t done;
+  void* done_ctx;
+} mqtt_pending_t;
+
 typedef struct
 {
   int initialized;
   int connected;
+  mqtt_conn_state_t conn_state;
+  uint32_t failures;
+  uint32_t retry_delay_ms;
+  uint32_t attempt_ms;          // When the current attempt started
+  uint32_t tls_start_ms;        // When the TLS handshake of the attempt started
+  uint32_t session_ms;          // When the current session started
+  uint32_t connects;
+  uint32_t reconnects;
+  uint64_t connected_ms;        // Closed sessions only
+  char last_error[64];
+  bool error_fresh;             // last_error was set by the current attempt
   struct mg_connection* nc;
-  mqtt_subscription_t subscriptions[MAX_SUBSCRIPTIONS];
-  char pending_subscribe_topic[128];
-  char pending_unsubscribe_topic[128];
-  int retries;
-  struct mg_mqtt_opts publish_opts;
+  mqtt_subscription_t* subscriptions;
+  mqtt_trie_t* trie;
+  char client_id[24];
+  bool clean;                   // Clean session requested on connect
+  int version;                  // Protocol version of the current connection
+  mqtt_alias_table_t* aliases;
+  bool session_dirty;           // In-flight state changed since the last save
+  bool session_save_failed;
+  uint32_t session_saved_ms;
+  uint16_t resume_id;           // Packet id counter restored from the session file
+  uint32_t rx_count;
+  uint16_t rx_ids[RX_QOS2_MAX]; // QoS 2 publishes delivered, PUBREL not seen yet; oldest first
+  uint32_t pending_count;
+  mqtt_pending_t pending[PENDING_MAX];
+  uint32_t window;
+  uint32_t window_debt;         // Tokens still to take back after the window shrank
+  uint32_t inflight_count;
+  mqtt_inflight_t inflight[CONFIG_MQTT_INFLIGHT_MAX];
 } mqtt_state_t;
 
 typedef struct
 {
-  TimerHandle_t reconnect;
-  TimerHandle_t puback;
-  TimerHandle_t suback;
-  TimerHandle_t unsuback;
+  osal_timer_id_t reconnect;
+  osal_timer_id_t retry;
 } mqtt_timers_t;
 
 typedef struct
 {
-  QueueHandle_t message_queue;
-  SemaphoreHandle_t puback;
-  SemaphoreHandle_t suback;
-  SemaphoreHandle_t unsuback;
+  bool used;
+  size_t min_len;
+} mqtt_compress_rule_t;
+
+// Topic filters whose payloads are compressed. The lock guards the rules;
+// the encoder workspace belongs to the publisher task.
+typedef struct
+{
+  osal_mutex_id_t lock;
+  mqtt_trie_t* trie;
+  mqtt_compress_rule_t rules[COMPRESS_RULES_MAX];
+  void* work;
+} mqtt_compress_t;
+
+typedef struct
+{
+  osal_task_id_t publisher;
+  osal_queue_id_t message_queue;
+  osal_count_sem_id_t window;
+  osal_bin_sem_id_t stopped;
+  bool spill_waiting;    // Publisher blocked on the window, may spill
 } mqtt_sync_t;
 
 typedef struct
 {
-  int puback_received;
-  int suback_received;
-  int unsuback_received;
-} mqtt_ack_flags_t;
+  hq_metric_t* connects;
+  hq_metric_t* disconnects;
+  hq_metric_t* published;
+  hq_metric_t* dropped;
+  hq_metric_t* received;
+  hq_metric_t* puback_timeouts;
+  hq_metric_t* acked;
+  hq_metric_t* retransmits;
+  hq_metric_t* puback_latency;
+  hq_metric_t* reconnects;
+  hq_metric_t* connect_failures;
+  hq_metric_t* duplicates;
+  hq_metric_t* sessions_resumed;
+  hq_metric_t* alias_saved;
+  hq_metric_t* expired;
+  hq_metric_t* compressed;
+  hq_metric_t* compress_in;
+  hq_metric_t* compress_out;
+  hq_metric_t* decompressed;
+  hq_metric_t* tls_handshake;
+  hq_metric_t* tls_resume_offered;
+} mqtt_metrics_t;
+
+// Arguments for work marshalled onto the Mongoose poll task
+typedef struct
+{
+  const mqtt_message_t* msg;
+  const char* topic;
+  int qos;
+  mqtt_subscription_cb_t callback;
+  mqtt_message_callback_t legacy;
+  void* ctx;
+  mqtt_done_cb_t done;
+  void* done_ctx;
+  uint32_t timeout_ms;
+  bool sent;
+  bool result;
+} mqtt_request_t;
 
 // Static variables
+// Everything below except the sync objects is owned by the Mongoose poll
+// task; other tasks only touch it through MongooseProcess_CallWait().
 static mqtt_state_t mqtt_state = { 0 };
 static mqtt_timers_t mqtt_timers = { 0 };
 static mqtt_sync_t mqtt_sync = { 0 };
-static mqtt_ack_flags_t mqtt_acks = { 0 };
+static mqtt_compress_t mqtt_compress = { 0 };
+static mqtt_metrics_t mqtt_metrics = { 0 };
 
 // Forward declarations
 static void ev_handler( struct mg_connection* nc, int ev, void* ev_data );
 static void mqtt_connect( void );
-static void mqtt_connected( void );
-static void mqtt_publish_internal( const char* topic, const char* message, int qos );
-static void mongoose_task( void* pvParameters );
 
-// Subscription management functions
-static mqtt_subscription_t* find_subscription( const char* topic )
+// Connection state (poll task only)
+static uint64_t connected_ms_total( void )
 {
-  if ( !topic )
-    return NULL;
+  uint64_t total = mqtt_state.connected_ms;
 
-  for ( int i = 0; i < MAX_SUBSCRIPTIONS; i++ )
+  if ( mqtt_state.conn_state == MQTT_STATE_CONNECTED )
   {
-    if ( mqtt_state.subscriptions[i].active && strcmp( mqtt_state.subscriptions[i].topic, topic ) == 0 )
-    {
-      return &mqtt_state.subscriptions[i];
-    }
+    total += osal_task_get_time_ms() - mqtt_state.session_ms;
   }
-  return NULL;
+  return total;
 }
 
-static mqtt_subscription_t* find_free_subscription_slot( void )
+static void set_state( mqtt_conn_state_t state )
 {
-  for ( int i = 0; i < MAX_SUBSCRIPTIONS; i++ )
+  if ( mqtt_state.conn_state == MQTT_STATE_CONNECTED && state != MQTT_STATE_CONNECTED )
   {
-    if ( !mqtt_state.subscriptions[i].active )
-    {
-      return &mqtt_state.subscriptions[i];
-    }
+    mqtt_state.connected_ms += osal_task_get_time_ms() - mqtt_state.session_ms;
   }
-  return NULL;
+  else if ( mqtt_state.conn_state != MQTT_STATE_CONNECTED && state == MQTT_STATE_CONNECTED )
+  {
+    mqtt_state.session_ms = osal_task_get_time_ms();
+  }
+  mqtt_state.conn_state = state;
+  mqtt_state.connected = ( state == MQTT_STATE_CONNECTED );
 }
 
-static void clear_subscription( mqtt_subscription_t* sub )
+static void set_error( const char* fmt, const char* detail )
 {
-  if ( sub )
-  {
-    memset( sub->topic, 0, sizeof( sub->topic ) );
-    sub->callback = NULL;
-    sub->active = false;
-    sub->pending_unsub = false;
-  }
+  snprintf( mqtt_state.last_error, sizeof( mqtt_state.last_error ), fmt, detail );
+  mqtt_state.error_fresh = true;
 }
 
-static void resubscribe_all( void )
+// Metrics
+static void metrics_collect( hq_metrics_out_t* out, void* ctx )
+{
+  mqtt_spool_stats_t spool;
+
+  (void) ctx;
+  MqttSpool_GetStats( &spool );
+
+  hq_metrics_emit( out, HQ_METRIC_GAUGE, "hq_mqtt_queue_depth", NULL, "Messages waiting to be published",
+                   mqtt_state.initialized ? (int64_t) osal_queue_get_count( mqtt_sync.message_queue ) : 0 );
+  hq_metrics_emit( out, HQ_METRIC_GAUGE, "hq_mqtt_connected", NULL, "MQTT session state",
+                   mqtt_state.connected ? 1 : 0 );
+  hq_metrics_emit( out, HQ_METRIC_GAUGE, "hq_mqtt_connection_state", NULL,
+                   "0 stopped, 1 connecting, 2 connected, 3 backoff", (int64_t) mqtt_state.conn_state );
+  hq_metrics_emit( out, HQ_METRIC_COUNTER, "hq_mqtt_connected_seconds_total", NULL, "Time spent connected",
+                   (int64_t) ( connected_ms_total() / 1000 ) );
+  hq_metrics_emit( out, HQ_METRIC_GAUGE, "hq_mqtt_reconnect_delay_ms", NULL, "Backoff before the next attempt",
+                   ( mqtt_state.conn_state == MQTT_STATE_BACKOFF ) ? (int64_t) mqtt_state.retry_delay_ms : 0 );
+  hq_metrics_emit( out, HQ_METRIC_GAUGE, "hq_mqtt_inflight", NULL, "QoS 1/2 publishes awaiting their ack",
+                   (int64_t) mqtt_state.inflight_count );
+  hq_metrics_emit( out, HQ_METRIC_GAUGE, "hq_mqtt_spool_depth", NULL, "Messages waiting in the persistent spool",
+                   (int64_t) spool.records );
+  hq_metrics_emit( out, HQ_METRIC_GAUGE, "hq_mqtt_spool_bytes", NULL, "Disk space used by the spool",
+                   (int64_t) spool.bytes );
+  hq_metrics_emit( out, HQ_METRIC_COUNTER, "hq_mqtt_spooled_total", NULL, "Messages written to the spool",
+                   (int64_t) spool.spooled );
+  hq_metrics_emit( out, HQ_METRIC_COUNTER, "hq_mqtt_spool_replayed_total", NULL, "Spooled messages published",
+                   (int64_t) spool.replayed );
+  hq_metrics_emit( out, HQ_METRIC_COUNTER, "hq_mqtt_spool_dropped_total", NULL, "Spooled messages lost to the size limit",
+                   (int64_t) spool.dropped );
+}
+
+static void metrics_register( void )
 {
-  for ( int i = 0; i < MAX_SUBSCRIPTIONS; i++ )
+  static const uint64_t latency_bounds[] = { 1, 5, 10, 25, 50, 100, 250, 500, 1000, 5000 };
+  static const uint64_t handshake_bounds[] = { 10, 50, 100, 250, 500, 1000, 2000, 5000, 10000 };
+  static bool registered = false;
+
+  mqtt_metrics.connects = hq_metrics_counter( "hq_mqtt_connects_total", NULL, "MQTT sessions established" );
+  mqtt_metrics.disconnects = hq_metrics_counter( "hq_mqtt_disconnects_total", NULL, "MQTT sessions lost" );
+  mqtt_metrics.published = hq_metrics_counter( "hq_mqtt_published_total", NULL, "MQTT messages published" );
+  mqtt_metrics.dropped = hq_metrics_counter( "hq_mqtt_dropped_total", NULL, "MQTT messages rejected or dropped undelivered" );
+  mqtt_metrics.received = hq_metrics_counter( "hq_mqtt_received_total", NULL, "MQTT messages received" );
+  mqtt_metrics.puback_timeouts = hq_metrics_counter( "hq_mqtt_puback_timeouts_total", NULL, "QoS 1/2 publishes that were never acknowledged" );
+  mqtt_metrics.acked = hq_metrics_counter( "hq_mqtt_acked_total", NULL, "QoS 1 publishes acknowledged and QoS 2 publishes completed" );
+  mqtt_metrics.retransmits = hq_metrics_counter( "hq_mqtt_retransmits_total", NULL, "QoS 1/2 publishes sent again with DUP set, or PUBRELs sent again" );
+  mqtt_metrics.reconnects = hq_metrics_counter( "hq_mqtt_reconnects_total", NULL, "MQTT connection attempts after a failure or a lost session" );
+  mqtt_metrics.connect_failures = hq_metrics_counter( "hq_mqtt_connect_failures_total", NULL, "MQTT connection attempts that did not reach CONNACK" );
+  mqtt_metrics.duplicates = hq_metrics_counter( "hq_mqtt_duplicates_total", NULL, "QoS 2 redeliveries dropped before reaching subscribers" );
+  mqtt_metrics.sessions_resumed = hq_metrics_counter( "hq_mqtt_sessions_resumed_total", NULL, "Connects that found the broker session present" );
+  mqtt_metrics.alias_saved = hq_metrics_counter( "hq_mqtt_topic_alias_saved_bytes_total", NULL, "Topic bytes replaced by MQTT 5 topic aliases" );
+  mqtt_metrics.expired = hq_metrics_counter( "hq_mqtt_expired_total", NULL, "Messages whose expiry interval ran out before they were sent" );
+  mqtt_metrics.compressed = hq_metrics_counter( "hq_mqtt_compressed_total", NULL, "Payloads published compressed" );
+  mqtt_metrics.compress_in = hq_metrics_counter( "hq_mqtt_compress_in_bytes_total", NULL, "Payload bytes before compression" );
+  mqtt_metrics.compress_out = hq_metrics_counter( "hq_mqtt_compress_out_bytes_total", NULL, "Compressed frame bytes published in their place" );
+  mqtt_metrics.decompressed = hq_metrics_counter( "hq_mqtt_decompressed_total", NULL, "Compressed payloads inflated before delivery" );
+  mqtt_metrics.puback_latency = hq_metrics_histogram( "hq_mqtt_puback_latency_ms", NULL, "Time from first send to PUBACK or PUBCOMP",
+                                                      latency_bounds, sizeof( latency_bounds ) / sizeof( latency_bounds[0] ) );
+  mqtt_metrics.tls_handshake = hq_metrics_histogram( "hq_mqtt_tls_handshake_ms", NULL, "Time from TCP connect to the end of the TLS handshake",
+                                                     handshake_bounds, sizeof( handshake_bounds ) / sizeof( handshake_bounds[0] ) );
+  mqtt_metrics.tls_resume_offered = hq_metrics_counter( "hq_mqtt_tls_resume_offered_total", NULL, "TLS handshakes that offered a saved session" );
+
+  // Collectors cannot be unregistered, so Deinit/Init must not add another
+  if ( !registered )
   {
-    if ( mqtt_state.subscriptions[i].active )
-    {
-      mg_mqtt_sub( mqtt_state.nc, &(struct mg_mqtt_opts) {
-                                    .topic = mg_str( mqtt_state.subscriptions[i].topic ),
-                                    .qos = 0 } );
-    }
+    hq_metrics_register_collector( metrics_collect, NULL );
+    registered = true;
   }
 }
 
-// Timer callback functions
-static void reconnect_timer_callback( TimerHandle_t xTimer )
+// Subscription management (poll task only)
+static mqtt_subscription_t* find_subscription( const char* topic )
 {
-  if ( !mqtt_state.connected )
+  if ( !topic )
+    return NULL;
+
+  return (mqtt_subscription_t*) MqttTrie_Lookup( mqtt_state.trie, topic );
+}
+
+static mqtt_subscription_t* add_subscription( const char* topic )
+{
+  size_t size = strlen( topic ) + 1;
+  mqtt_subscription_t* sub = calloc( 1, sizeof( *sub ) + size );
+
+  if ( sub == NULL )
   {
-    printf( "Attempting to reconnect...\n" );
-    mqtt_connect();
+    return NULL;
+  }
+  memcpy( sub->topic, topic, size );
+  sub->qos = -1;
+  if ( !MqttTrie_Insert( mqtt_state.trie, sub->topic, sub ) )
+  {
+    free( sub );
+    return NULL;
   }
+  sub->next = mqtt_state.subscriptions;
+  mqtt_state.subscriptions = sub;
+  return sub;
 }
 
-static void puback_timer_callback( TimerHandle_t xTimer )
+static void remove_subscription( mqtt_subscription_t* sub )
 {
-  if ( !mqtt_acks.puback_received && mqtt_state.retries < RETRY_COUNT )
+  for ( mqtt_subscription_t** p = &mqtt_state.subscriptions; *p != NULL; p = &( *p )->next )
+  {
+    if ( *p == sub )
+    {
+      *p = sub->next;
+      break;
+    }
+  }
+  MqttTrie_Remove( mqtt_state.trie, sub->topic );
+
+  // Requests still waiting on this filter complete without it
+  for ( uint32_t i = 0; i < PENDING_MAX; i++ )
   {
-    printf( "Retrying QoS 1 message, attempt %d...\n", mqtt_state.retries + 1 );
-    mg_mqtt_pub( mqtt_state.nc, &mqtt_state.publish_opts );
-    mqtt_state.retries++;
+    if ( mqtt_state.pending[i].sub == sub )
+    {
+      mqtt_state.pending[i].sub = NULL;
+      mqtt_state.pending[i].subscriber = NULL;
+    }
   }
-  else if ( mqtt_state.retries >= RETRY_COUNT )
+  while ( sub->subscribers != NULL )
   {
-    printf( "Failed to receive PUBACK after %d retries\n", RETRY_COUNT );
-    xSemaphoreGive( mqtt_sync.puback );
-    xTimerStop( mqtt_timers.puback, 0 );
+    mqtt_subscriber_t* next = sub->subscribers->next;
+    free( sub->subscribers );
+    sub->subscribers = next;
   }
+  free( sub );
 }
 
-static void suback_timer_callback( TimerHandle_t xTimer )
+static void remove_all_subscriptions( void )
 {
-  if ( !mqtt_acks.suback_received )
+  while ( mqtt_state.subscriptions != NULL )
   {
-    printf( "SUBACK timeout for topic: %s\n", mqtt_state.pending_subscribe_topic );
-    xSemaphoreGive( mqtt_sync.suback );
+    remove_subscription( mqtt_state.subscriptions );
   }
 }
 
-static void unsuback_timer_callback( TimerHandle_t xTimer )
+// Legacy subscribers are matched on being legacy: a filter has at most one
+// and MqttApp_Subscribe() replaces its callback.
+static mqtt_subscriber_t* find_subscriber( mqtt_subscription_t* sub, const mqtt_request_t* req )
 {
-  if ( !mqtt_acks.unsuback_received )
+  for ( mqtt_subscriber_t* s = sub->subscribers; s != NULL; s = s->next )
   {
-    printf( "UNSUBACK timeout for topic: %s\n", mqtt_state.pending_unsubscribe_topic );
-    xSemaphoreGive( mqtt_sync.unsuback );
+    if ( req->legacy != NULL ? s->legacy != NULL : ( s->callback == req->callback && s->ctx == req->ctx ) )
+    {
+      return s;
+    }
   }
+  return NULL;
 }
 
-// Connection management
-static void mqtt_connect( void )
+static void remove_subscriber( mqtt_subscription_t* sub, mqtt_subscriber_t* subscriber )
 {
-  if ( mqtt_state.nc != NULL )
+  for ( mqtt_subscriber_t** p = &sub->subscribers; *p != NULL; p = &( *p )->next )
   {
-    mqtt_state.nc->is_closing = 1;
+    if ( *p == subscriber )
+    {
+      *p = subscriber->next;
+      free( subscriber );
+      return;
+    }
   }
+}
 
-  const char* address = MQTTConfig_GetString( MQTT_CONFIG_VALUE_ADDRESS );
-  const char* username = MQTTConfig_GetString( MQTT_CONFIG_VALUE_USERNAME );
-  const char* password = MQTTConfig_GetString( MQTT_CONFIG_VALUE_PASSWORD );
-  const char* client_id = MQTTConfig_GetString( MQTT_CONFIG_VALUE_CLIENT_ID );
-
-  // Use configured client_id, fallback to serial number if empty
-  const char* effective_client_id = ( client_id && strlen( client_id ) > 0 ) ? client_id : DevConfig_GetSerialNumber();
-
-  // Ensure we have a valid client_id
-  if ( !effective_client_id || strlen( effective_client_id ) == 0 )
+static uint16_t next_packet_id( void )
+{
+  // Shares the counter mg_mqtt_pub()/mg_mqtt_sub() use so ids never collide
+  if ( ++mgr.mqtt_id == 0 )
   {
-    effective_client_id = "esp32_device";    // Default fallback
+    ++mgr.mqtt_id;
   }
+  return mgr.mqtt_id;
+}
 
-  printf( "Connecting to MQTT server at %s\n", address );
-  printf( "  Client ID: %s\n", effective_client_id );
-  printf( "  Username: %s\n", username ? username : "(null)" );
-  printf( "  Password: %s\n", password ? "***" : "(null)" );
+// Packet parsing and MQTT 5 (poll task only)
+// First byte after the fixed header; mg_mqtt_parse() checked the length
+static const uint8_t* packet_body( const struct mg_mqtt_message* mm )
+{
+  const uint8_t* p = (const uint8_t*) mm->dgram.buf + 1;
 
-  struct mg_mqtt_opts opts_con = {
-    .user = mg_str( username ? username : "" ),
-    .pass = mg_str( password ? password : "" ),
-    .client_id = mg_str( effective_client_id ),
-    .keepalive = 60,
-    .clean = true };
+  while ( *p & 0x80 )
+  {
+    p++;
+  }
+  return p + 1;
+}
 
-  mqtt_state.nc = mg_mqtt_connect( &mgr, address, &opts_con, ev_handler, NULL );
-  if ( mqtt_state.nc == NULL )
+static bool varint_read( const uint8_t** p, const uint8_t* end, uint32_t* value )
+{
+  *value = 0;
+  for ( uint32_t shift = 0; *p < end && shift < 28; shift += 7 )
   {
-    printf( "Failed to create MQTT connection\n" );
+    uint8_t b = *( *p )++;
+    *value |= (uint32_t) ( b & 0x7F ) << shift;
+    if ( ( b & 0x80 ) == 0 )
+    {
+      return true;
+    }
   }
+  return false;
 }
 
-static void mqtt_connected( void )
+// Skips the property block at p; false if it is cut short
+static bool props_skip( const uint8_t** p, const uint8_t* end )
 {
-  mqtt_state.connected = 1;
-  const char* address = MQTTConfig_GetString( MQTT_CONFIG_VALUE_ADDRESS );
+  uint32_t len;
 
-  if ( mg_url_is_ssl( address ) )
+  if ( !varint_read( p, end, &len ) || len > (size_t) ( end - *p ) )
   {
-    const char* cert = MQTTConfig_GetCert( MQTT_CONFIG_VALUE_CERT );
-    struct mg_tls_opts opts_ca = {
-      .ca = mg_str( cert ),
-      .name = mg_url_host( address ),
-    };
-    mg_tls_init( mqtt_state.nc, &opts_ca );
+    return false;
   }
-
-  xTimerStop( mqtt_timers.reconnect, 0 );
-  printf( "Connected to MQTT server\n" );
-  resubscribe_all();
+  *p += len;
+  return true;
 }
 
-static void mqtt_disconnected( void )
+// Size of a length prefixed string or binary field, prefix included; 0 if
+// it is cut short
+static size_t prop_string_size( const uint8_t* p, const uint8_t* end )
 {
-  mqtt_state.connected = 0;
-  printf( "Disconnected from MQTT server\n" );
-  xTimerStart( mqtt_timers.reconnect, 0 );
+  size_t size;
+
+  if ( end - p < 2 )
+  {
+    return 0;
+  }
+  size = 2 + ( ( (size_t) p[0] << 8 ) | p[1] );
+  return ( size <= (size_t) ( end - p ) ) ? size : 0;
 }
 
-// Message handling
-static void handle_mqtt_message( struct mg_mqtt_message* mm )
+// Value of the one, two or four byte integer property id in the block at p.
+// Every type is listed so the properties in front of it can be skipped.
+static bool props_find_int( const uint8_t* p, const uint8_t* end, uint8_t id, uint32_t* value )
 {
-  MG_INFO( ( "%lu RECEIVED %.*s <- %.*s", mqtt_state.nc->id, (int) mm->data.len,
-             mm->data.buf, (int) mm->topic.len, mm->topic.buf ) );
+  uint32_t len;
 
-  char topic_str[129] = { 0 };
-  size_t topic_len = mm->topic.len < 128 ? mm->topic.len : 128;
-  memcpy( topic_str, mm->topic.buf, topic_len );
+  if ( !varint_read( &p, end, &len ) || len > (size_t) ( end - p ) )
+  {
+    return false;
+  }
+  end = p + len;
 
-  for ( int i = 0; i < MAX_SUBSCRIPTIONS; i++ )
+  while ( p < end )
   {
-    if ( mqtt_state.subscriptions[i].active && mqtt_state.subscriptions[i].callback )
+    uint8_t prop = *p++;
+    const uint8_t* next = p;
+    size_t size = 0;
+
+    switch ( prop )
     {
-      if ( mg_match( mg_str( topic_str ), mg_str( mqtt_state.subscriptions[i].topic ), NULL ) )
-      {
-        mqtt_state.subscriptions[i].callback( topic_str, mm->data.buf, mm->data.len );
+      case MQTT_PROP_PAYLOAD_FORMAT_INDICATOR:
+      case MQTT_PROP_REQUEST_PROBLEM_INFORMATION:
+      case MQTT_PROP_REQUEST_RESPONSE_INFORMATION:
+      case MQTT_PROP_MAXIMUM_QOS:
+      case MQTT_PROP_RETAIN_AVAILABLE:
+      case MQTT_PROP_WILDCARD_SUBSCRIPTION_AVAILABLE:
+      case MQTT_PROP_SUBSCRIPTION_IDENTIFIER_AVAILABLE:
+      case MQTT_PROP_SHARED_SUBSCRIPTION_AVAILABLE:
+        size = 1;
+        break;
+      case MQTT_PROP_SERVER_KEEP_ALIVE:
+      case MQTT_PROP_RECEIVE_MAXIMUM:
+      case MQTT_PROP_TOPIC_ALIAS_MAXIMUM:
+      case MQTT_PROP_TOPIC_ALIAS:
+        size = 2;
+        break;
+      case MQTT_PROP_MESSAGE_EXPIRY_INTERVAL:
+      case MQTT_PROP_SESSION_EXPIRY_INTERVAL:
+      case MQTT_PROP_WILL_DELAY_INTERVAL:
+      case MQTT_PROP_MAXIMUM_PACKET_SIZE:
+        size = 4;
         break;
+      case MQTT_PROP_SUBSCRIPTION_IDENTIFIER:
+        if ( !varint_read( &next, end, &len ) )
+        {
+          return false;
+        }
+        break;
+      case MQTT_PROP_USER_PROPERTY:
+        size = prop_string_size( next, end );
+        if ( size == 0 )
+        {
+          return false;
+        }
+        next += size;
+        // fall through
+      default:
+        // UTF-8 strings and binary data
+        size = prop_string_size( next, end );
+        if ( size == 0 )
+        {
+          return false;
+        }
+        break;
+    }
+    if ( size > (size_t) ( end - next ) )
+    {
+      return false;
+    }
+    if ( prop == id && next == p && size <= 4 )
+    {
+      *value = 0;
+      for ( size_t i = 0; i < size; i++ )
+      {
+        *value = ( *value << 8 ) | p[i];
       }
+      return true;
     }
+    p = next + size;
   }
+  return false;
 }
 
-static void handle_mqtt_command( struct mg_mqtt_message* mm )
+// mg_mqtt_parse() only skips MQTT 5 properties when more than two bytes
+// follow the packet id, so a PUBLISH with a tiny payload still has them in
+// front of the data.
+static void publish_skip_props( struct mg_mqtt_message* mm )
 {
-  switch ( mm->cmd )
-  {
-    case MQTT_CMD_SUBACK:
-      mqtt_acks.suback_received = 1;
-      xTimerStop( mqtt_timers.suback, 0 );
-      xSemaphoreGive( mqtt_sync.suback );
-      printf( "Subscribed to topic: %s\n", mqtt_state.pending_subscribe_topic );
-      break;
-
-    case MQTT_CMD_UNSUBACK:
-      mqtt_acks.unsuback_received = 1;
-      xTimerStop( mqtt_timers.unsuback, 0 );
-      xSemaphoreGive( mqtt_sync.unsuback );
-      printf( "Unsubscribed from topic: %s\n", mqtt_state.pending_unsubscribe_topic );
-      break;
-
-    case MQTT_CMD_PUBACK:
-      mqtt_acks.puback_received = 1;
-      xTimerStop( mqtt_timers.puback, 0 );
-      xSemaphoreGive( mqtt_sync.puback );
-      printf( "PUBACK received\n" );
-      break;
-
-    case MQTT_CMD_PINGRESP:
-      printf( "PINGRESP received\n" );
-      break;
+  const uint8_t* p = (const uint8_t*) mm->data.buf;
+  const uint8_t* end = p + mm->data.len;
 
-    case MQTT_CMD_PUBREC:
-      printf( "PUBREC received\n" );
-      break;
-
-    case MQTT_CMD_PUBCOMP:
-      printf( "PUBCOMP received\n" );
-      break;
-
-    default:
-      break;
+  if ( mm->props_start == 0 && props_skip( &p, end ) )
+  {
+    mm->data = mg_str_n( (const char*) p, (size_t) ( end - p ) );
   }
 }
 
-// Event handler
-static void ev_handler( struct mg_connection* nc, int ev, void* ev_data )
+static uint32_t props_remaining_s( const mqtt_props_t* props )
 {
-  switch ( ev )
-  {
-    case MG_EV_CONNECT:
-      printf( "MQTT transport connected\n" );
-      mqtt_connected();
-      break;
-
-    case MG_EV_MQTT_CMD:
-      handle_mqtt_command( (struct mg_mqtt_message*) ev_data );
-      break;
-
-    case MG_EV_MQTT_MSG:
-      handle_mqtt_message( (struct mg_mqtt_message*) ev_data );
-      break;
-
-    case MG_EV_CLOSE:
-      printf( "MQTT connection closed\n" );
-      mqtt_disconnected();
-      break;
+  uint32_t elapsed_s = ( osal_task_get_time_ms() - props->queued_ms ) / 1000U;
 
-    case MG_EV_ERROR:
-      printf( "MQTT connection error: %s\n", (char*) ev_data );
-      mqtt_disconnected();
-      break;
+  return ( elapsed_s < props->expiry_s ) ? props->expiry_s - elapsed_s : 0;
+}
 
-    default:
-      break;
-  }
+static bool message_expired( const mqtt_message_t* msg )
+{
+  return msg->props != NULL && msg->props->expiry_s != 0 && props_remaining_s( msg->props ) == 0;
 }
 
-// Publishing functions
-static void mqtt_publish_internal( const char* topic, const char* message, int qos )
+// Every PUBLISH goes through here, resends included, so the alias table
+// always matches what the broker was told on this connection.
+static uint16_t publish_send( const mqtt_message_t* msg, uint16_t retransmit_id )
 {
-  if ( !mqtt_state.nc || !mqtt_state.connected )
+  struct mg_mqtt_prop props[MQTT_USER_PROPS_MAX + 3];
+  struct mg_mqtt_opts opts = {
+    .topic = mg_str( msg->topic ),
+    .message = mg_str_n( (const char*) msg->payload, msg->len ),
+    .qos = (uint8_t) msg->qos,
+    .retransmit_id = retransmit_id,
+    .props = props };
+
+  if ( mqtt_state.version == 5 )
   {
-    printf( "Cannot publish: not connected\n" );
-    return;
-  }
-
-  printf( "Publishing to topic '%s': %s\n", topic, message );
-
-  mqtt_acks.puback_received = 0;
-  memset( &mqtt_state.publish_opts, 0, sizeof( mqtt_state.publish_opts ) );
+    bool send_topic = true;
+    uint16_t alias = MqttAlias_Resolve( mqtt_state.aliases, msg->topic, &send_topic );
 
-  mqtt_state.publish_opts.qos = qos;
-  mqtt_state.publish_opts.topic = mg_str( topic );
-  mqtt_state.publish_opts.version = 4;
-  mqtt_state.publish_opts.message = mg_str( message );
-  mqtt_state.retries = 0;
-
-  mg_mqtt_pub( mqtt_state.nc, &mqtt_state.publish_opts );
-
-  if ( qos == 1 )
-  {
-    xTimerStart( mqtt_timers.puback, 0 );
-    if ( xSemaphoreTake( mqtt_sync.puback, pdMS_TO_TICKS( TIMEOUT_DEFAULT_MS * RETRY_COUNT + 100 ) ) == pdFALSE )
+    if ( alias != 0 )
     {
-      printf( "Failed to receive PUBACK after %d retries\n", RETRY_COUNT );
+      props[opts.num_props++] = (struct mg_mqtt_prop) { .id = MQTT_PROP_TOPIC_ALIAS, .iv = alias };
+      if ( !send_topic )
+      {
+        hq_metrics_add( mqtt_metrics.alias_saved, opts.topic.len );
+        opts.topic = mg_str_n( "", 0 );
+      }
     }
-    else
+    if ( msg->props != NULL )
+    {
+      if ( msg->props->expiry_s != 0 )
+      {
+        // A resend past the deadline still has to go out; 0 would mean
+        // already expired
+        uint32_t remaining = props_remaining_s( msg->props );
+        props[opts.num_props++] = (struct mg_mqtt_prop) {
+          .id = MQTT_PROP_MESSAGE_EXPIRY_INTERVAL,
+          .iv = remaining ? remaining : 1 };
+      }
+      memcpy( &props[opts.num_props], msg->props->user, msg->props->count * sizeof( props[0] ) );
+      opts.num_props += msg->props->count;
+    }
+    if ( MqttCompress_Peek( msg->payload, msg->len, NULL ) )
     {
-      printf( "PUBACK received for topic '%s'\n", topic );
+      props[opts.num_props++] = (struct mg_mqtt_prop) {
+        .id = MQTT_PROP_CONTENT_TYPE,
+        .val = mg_str( MQTT_COMPRESS_CONTENT_TYPE ) };
     }
   }
+  return mg_mqtt_pub( mqtt_state.nc, &opts );
 }
 
-// Task function
-static void mongoose_task( void* pvParameters )
+// The retry timer runs while anything waits for an ack or the session
+// still has to be saved
+static void retry_timer_idle( void )
 {
-  mqtt_message_t msg;
-  while ( 1 )
+  if ( mqtt_state.inflight_count == 0 && mqtt_state.pending_count == 0 && !mqtt_state.session_dirty )
+  {
+    osal_timer_stop( mqtt_timers.retry, 0 );
+  }
+}
+
+// Pending SUBACK/UNSUBACK table (poll task only)
+static mqtt_pending_t* pending_alloc( mqtt_pending_type_t type, uint16_t id, const mqtt_request_t* req )
+{
+  for ( uint32_t i = 0; i < PENDING_MAX; i++ )
   {
-    if ( xQueueReceive( mqtt_sync.message_queue, &msg, portMAX_DELAY ) )
+    mqtt_pending_t* p = &mqtt_state.pending[i];
+    if ( p->type == PENDING_FREE )
     {
-      if ( mqtt_state.connected )
+      memset( p, 0, sizeof( *p ) );
+      p->type = type;
+      p->id = id;
+      p->sent_ms = osal_task_get_time_ms();
+      p->timeout_ms = TIMEOUT_DEFAULT_MS;
+      if ( req != NULL )
+      {
+        p->timeout_ms = req->timeout_ms ? req->timeout_ms : TIMEOUT_DEFAULT_MS;
+        p->done = req->done;
+        p->done_ctx = req->done_ctx;
+      }
+      if ( mqtt_state.pending_count++ == 0 && mqtt_state.inflight_count == 0 )
       {
-        mqtt_publish_internal( msg.topic, msg.message, msg.qos );
+        osal_timer_start( mqtt_timers.retry, 0 );
       }
+      return p;
     }
   }
+  osal_log_error( MODULE_NAME "Too many subscribe requests in flight\n" );
+  return NULL;
 }
 
-// Configuration update callback
-static void config_update_callback( void )
+static bool subscription_is_pending( const mqtt_subscription_t* sub )
 {
-  MqttApp_Deinit();
-  MqttApp_Init();
+  for ( uint32_t i = 0; i < PENDING_MAX; i++ )
+  {
+    if ( mqtt_state.pending[i].type != PENDING_FREE && mqtt_state.pending[i].sub == sub )
+    {
+      return true;
+    }
+  }
+  return false;
 }
 
-// Public API functions
-bool MqttApp_Subscribe( const char* topic, int qos, mqtt_message_callback_t callback, uint32_t timeout_ms )
+// Undo a subscribe request: drop the subscriber it added and the filter
+// once nothing uses it any more.
+static void subscribe_rollback( mqtt_subscription_t* sub, mqtt_subscriber_t* added )
 {
-  if ( !mqtt_state.initialized || !mqtt_state.connected || !topic || !callback )
+  if ( added != NULL )
   {
-    return false;
+    remove_subscriber( sub, added );
   }
-
-  mqtt_subscription_t* existing = find_subscription( topic );
-  if ( existing )
+  if ( sub->subscribers == NULL && !subscription_is_pending( sub ) )
   {
-    existing->callback = callback;
-    return true;
+    remove_subscription( sub );
   }
+}
 
-  mqtt_subscription_t* sub = find_free_subscription_slot();
-  if ( !sub )
-  {
-    printf( "No free subscription slots available\n" );
-    return false;
-  }
+static void pending_complete( mqtt_pending_t* p, bool success )
+{
+  mqtt_pending_t done = *p;
 
-  strncpy( sub->topic, topic, sizeof( sub->topic ) - 1 );
-  sub->callback = callback;
-  sub->active = true;
-  sub->pending_unsub = false;
+  // Free the slot first; done() may start another request
+  p->type = PENDING_FREE;
+  mqtt_state.pending_count--;
+  retry_timer_idle();
 
-  strncpy( mqtt_state.pending_subscribe_topic, topic, sizeof( mqtt_state.pending_subscribe_topic ) - 1 );
+  if ( done.type == PENDING_SUBSCRIBE && done.sub != NULL )
+  {
+    if ( done.sub->sub_id == done.id )
+    {
+      done.sub->sub_id = 0;
+      if ( !success )
+      {
+        done.sub->qos = done.prev_qos;
+      }
+    }
+    if ( !success )
+    {
+      subscribe_rollback( done.sub, done.subscriber );
+    }
+  }
 
-  mqtt_acks.suback_received = 0;
-  mg_mqtt_sub( mqtt_state.nc, &(struct mg_mqtt_opts) { .topic = mg_str( topic ), .qos = qos } );
+  if ( done.done != NULL )
+  {
+    done.done( success, done.done_ctx );
+  }
+}
 
-  xTimerChangePeriod( mqtt_timers.suback, pdMS_TO_TICKS( timeout_ms ), 0 );
-  xTimerStart( mqtt_timers.suback, 0 );
+// SUBACK carries one return code per filter after the packet id (and the
+// MQTT 5 properties)
+static void pending_acked( const struct mg_mqtt_message* mm, mqtt_pending_type_t type )
+{
+  const uint8_t* p = packet_body( mm ) + 2;
+  const uint8_t* end = (const uint8_t*) mm->dgram.buf + mm->dgram.len;
+  uint32_t failed = 0;
+  uint32_t codes;
 
-  if ( xSemaphoreTake( mqtt_sync.suback, pdMS_TO_TICKS( timeout_ms + 100 ) ) == pdFALSE )
+  if ( mqtt_state.version == 5 && !props_skip( &p, end ) )
   {
-    printf( "Subscribe timeout for topic: %s\n", topic );
-    clear_subscription( sub );
-    return false;
+    p = end;
   }
-
-  if ( !mqtt_acks.suback_received )
+  codes = ( p < end ) ? (uint32_t) ( end - p ) : 0;
+  for ( uint32_t i = 0; i < codes; i++ )
   {
-    printf( "Subscribe failed for topic: %s\n", topic );
-    clear_subscription( sub );
-    return false;
+    failed += ( p[i] & 0x80 ) ? 1 : 0;
   }
 
-  printf( "Successfully subscribed to topic: %s\n", topic );
-  return true;
+  for ( uint32_t i = 0; i < PENDING_MAX; i++ )
+  {
+    mqtt_pending_t* pending = &mqtt_state.pending[i];
+    if ( pending->id != mm->id || pending->type == PENDING_FREE )
+    {
+      continue;
+    }
+
+    if ( pending->type == PENDING_RESUBSCRIBE && type == PENDING_SUBSCRIBE )
+    {
+      if ( failed > 0 || codes < pending->filters )
+      {
+        osal_log_warning( MODULE_NAME "Broker refused %u of %u filters on resubscribe\n",
+                          (unsigned) ( failed + pending->filters - codes ), (unsigned) pending->filters );
+      }
+      pending_complete( pending, failed == 0 );
+    }
+    else if ( pending->type == type )
+    {
+      pending_complete( pending, type == PENDING_UNSUBSCRIBE || ( codes > 0 && failed == 0 ) );
+    }
+  }
 }
 
-bool MqttApp_Unsubscribe( const char* topic, uint32_t timeout_ms )
+static void pending_scan( uint32_t now )
 {
-  if ( !mqtt_state.initialized || !mqtt_state.connected || !topic )
+  for ( uint32_t i = 0; i < PENDING_MAX; i++ )
   {
-    return false;
+    mqtt_pending_t* p = &mqtt_state.pending[i];
+    if ( p->type != PENDING_FREE && now - p->sent_ms >= p->timeout_ms )
+    {
+      osal_log_warning( MODULE_NAME "No %s for packet %u\n",
+                        ( p->type == PENDING_UNSUBSCRIBE ) ? "UNSUBACK" : "SUBACK", p->id );
+      pending_complete( p, false );
+    }
   }
+}
 
-  mqtt_subscription_t* sub = find_subscription( topic );
-  if ( !sub )
+// Acks for a closed connection never arrive
+static void pending_fail_all( void )
+{
+  for ( uint32_t i = 0; i < PENDING_MAX; i++ )
   {
-    printf( "Topic not found in subscriptions: %s\n", topic );
-    return false;
+    if ( mqtt_state.pending[i].type != PENDING_FREE )
+    {
+      pending_complete( &mqtt_state.pending[i], false );
+    }
   }
+}
 
-  strncpy( mqtt_state.pending_unsubscribe_topic, topic, sizeof( mqtt_state.pending_unsubscribe_topic ) - 1 );
+// Sends every filter again after a reconnect, as few SUBSCRIBE packets as
+// RESUBSCRIBE_BATCH allows.
+static void resubscribe_all( void )
+{
+  mqtt_subscription_t* sub = mqtt_state.subscriptions;
 
-  mqtt_acks.unsuback_received = 0;
+  while ( sub != NULL )
+  {
+    mqtt_subscription_t* first = sub;
+    uint32_t count = 0;
+    size_t len = ( mqtt_state.version == 5 ) ? 3 : 2;    // packet id, no properties
 
-  // Build UNSUBSCRIBE packet manually since mg_mqtt_unsub doesn't exist
-  struct mg_str topic_str = mg_str( topic );
-  size_t packet_len = 2 + 2 + topic_str.len;    // packet_id (2) + topic_len (2) + topic
+    for ( ; sub != NULL && count < RESUBSCRIBE_BATCH; sub = sub->next )
+    {
+      if ( sub->qos >= 0 )
+      {
+        len += 2 + strlen( sub->topic ) + 1;
+        count++;
+      }
+    }
+    if ( count == 0 )
+    {
+      break;
+    }
+
+    uint16_t packet_id = next_packet_id();
+    uint8_t id_bytes[3] = { ( packet_id >> 8 ) & 0xFF, packet_id & 0xFF, 0 };
+
+    mg_mqtt_send_header( mqtt_state.nc, MQTT_CMD_SUBSCRIBE, 0x02, (uint32_t) len );
+    mg_send( mqtt_state.nc, id_bytes, ( mqtt_state.version == 5 ) ? 3 : 2 );
+    for ( mqtt_subscription_t* s = first; s != sub; s = s->next )
+    {
+      if ( s->qos >= 0 )
+      {
+        size_t topic_len = strlen( s->topic );
+        uint8_t topic_len_bytes[2] = { ( topic_len >> 8 ) & 0xFF, topic_len & 0xFF };
+        uint8_t qos = (uint8_t) s->qos;
+        mg_send( mqtt_state.nc, topic_len_bytes, 2 );
+        mg_send( mqtt_state.nc, s->topic, topic_len );
+        mg_send( mqtt_state.nc, &qos, 1 );
+      }
+    }
+
+    // Only for logging refusals; a full table just skips that
+    mqtt_pending_t* p = pending_alloc( PENDING_RESUBSCRIBE, packet_id, NULL );
+    if ( p != NULL )
+    {
+      p->filters = count;
+    }
+  }
+}
+
+static void message_release( const mqtt_message_t* msg )
+{
+  free( msg->props );
+  if ( msg->release != NULL )
+  {
+    msg->release( msg->ctx );
+  }
+}
+
+// Persistent session (poll task only). With clean session off, every
+// change to the in-flight window or the QoS 2 receipts marks the session
+// dirty; the retry timer keeps running until it is saved, at most every
+// SESSION_SAVE_MS, so a crash loses at most the last few hundred ms of acks.
+// Disconnect and Deinit save it right away.
+static void session_changed( void )
+{
+  if ( !mqtt_state.clean && !mqtt_state.session_dirty )
+  {
+    mqtt_state.session_dirty = true;
+    osal_timer_start( mqtt_timers.retry, 0 );
+  }
+}
+
+static void session_save( void )
+{
+  mqtt_session_msg_t msgs[CONFIG_MQTT_INFLIGHT_MAX];
+  mqtt_session_t session = {
+    .next_id = mgr.mqtt_id,
+    .msgs = msgs,
+    .rx_count = mqtt_state.rx_count,
+    .rx_ids = mqtt_state.rx_ids };
+
+  for ( uint32_t i = 0; i < CONFIG_MQTT_INFLIGHT_MAX; i++ )
+  {
+    const mqtt_inflight_t* slot = &mqtt_state.inflight[i];
+    if ( slot->used )
+    {
+      msgs[session.msg_count++] = (mqtt_session_msg_t) {
+        .id = slot->id,
+        .qos = (uint8_t) slot->msg.qos,
+        .released = slot->released,
+        .topic = slot->released ? "" : slot->msg.topic,
+        .payload = slot->msg.payload,
+        .len = slot->released ? 0 : slot->msg.len };
+    }
+  }
+
+  mqtt_state.session_dirty = false;
+  mqtt_state.session_saved_ms = osal_task_get_time_ms();
+  if ( MqttSession_Save( CONFIG_MQTT_SESSION_PATH, &session ) )
+  {
+    mqtt_state.session_save_failed = false;
+  }
+  else if ( !mqtt_state.session_save_failed )
+  {
+    osal_log_warning( MODULE_NAME "Cannot save session to %s\n", CONFIG_MQTT_SESSION_PATH );
+    mqtt_state.session_save_failed = true;
+  }
+}
+
+static void session_flush( void )
+{
+  if ( mqtt_state.session_dirty && osal_task_get_time_ms() - mqtt_state.session_saved_ms >= SESSION_SAVE_MS )
+  {
+    session_save();
+    retry_timer_idle();
+  }
+}
+
+// Picks up the window and receipts an earlier run left behind. Runs from
+// MqttApp_Init() before the poll task and the publisher see the state.
+static void session_restore( void )
+{
+  mqtt_session_t session;
+  uint32_t now = osal_task_get_time_ms();
+  uint32_t skipped = 0;
+
+  if ( mqtt_state.clean )
+  {
+    MqttSession_Remove( CONFIG_MQTT_SESSION_PATH );
+    return;
+  }
+  if ( !MqttSession_Load( CONFIG_MQTT_SESSION_PATH, &session ) )
+  {
+    return;
+  }
+
+  for ( uint32_t i = 0; i < session.msg_count; i++ )
+  {
+    mqtt_session_msg_t* msg = &session.msgs[i];
+    if ( mqtt_state.inflight_count == mqtt_state.window )
+    {
+      skipped++;
+      continue;
+    }
+
+    mqtt_inflight_t* slot = &mqtt_state.inflight[mqtt_state.inflight_count++];
+    slot->used = true;
+    slot->released = msg->released;
+    slot->id = msg->id;
+    slot->first_sent_ms = now;
+    slot->sent_ms = now;
+    slot->msg = (mqtt_message_t) {
+      .topic = msg->topic,
+      .payload = msg->payload,
+      .len = msg->len,
+      .qos = msg->qos,
+      .release = free,
+      .ctx = (void*) msg->topic };
+    msg->topic = NULL;    // Owned by the slot now
+  }
+
+  // Keep the newest receipts if the table shrank
+  uint32_t first = ( session.rx_count > RX_QOS2_MAX ) ? session.rx_count - RX_QOS2_MAX : 0;
+  mqtt_state.rx_count = session.rx_count - first;
+  memcpy( mqtt_state.rx_ids, session.rx_ids + first, mqtt_state.rx_count * sizeof( uint16_t ) );
+  mqtt_state.resume_id = session.next_id;
+
+  if ( skipped > 0 )
+  {
+    osal_log_warning( MODULE_NAME "In-flight window too small, dropped %u restored publishes\n", (unsigned) skipped );
+    hq_metrics_add( mqtt_metrics.dropped, skipped );
+  }
+  osal_log_info( MODULE_NAME "Restored session: %u publishes in flight, %u QoS 2 receipts\n",
+                 (unsigned) mqtt_state.inflight_count, (unsigned) mqtt_state.rx_count );
+  MqttSession_Free( &session );
+}
+
+// In-flight window (poll task only)
+static void inflight_send( mqtt_inflight_t* slot, bool dup )
+{
+  slot->id = publish_send( &slot->msg, dup ? slot->id : 0 );
+  slot->sent_ms = osal_task_get_time_ms();
+}
+
+static void send_pubrel( uint16_t id )
+{
+  uint8_t id_bytes[2] = { ( id >> 8 ) & 0xFF, id & 0xFF };
+
+  mg_mqtt_send_header( mqtt_state.nc, MQTT_CMD_PUBREL, 0x02, sizeof( id_bytes ) );
+  mg_send( mqtt_state.nc, id_bytes, sizeof( id_bytes ) );
+}
+
+// Resend whatever the slot is waiting on: the PUBLISH with DUP set, or the
+// PUBREL once the broker has the QoS 2 message
+static void inflight_retransmit( mqtt_inflight_t* slot )
+{
+  if ( slot->released )
+  {
+    send_pubrel( slot->id );
+    slot->sent_ms = osal_task_get_time_ms();
+  }
+  else
+  {
+    inflight_send( slot, true );
+  }
+  hq_metrics_inc( mqtt_metrics.retransmits );
+}
+
+static void inflight_release( mqtt_inflight_t* slot )
+{
+  message_release( &slot->msg );
+  slot->used = false;
+  mqtt_state.inflight_count--;
+  session_changed();
+  if ( mqtt_state.window_debt > 0 )
+  {
+    mqtt_state.window_debt--;
+  }
+  else
+  {
+    osal_count_sem_give( mqtt_sync.window );
+  }
+  retry_timer_idle();
+}
+
+static void inflight_release_all( void )
+{
+  for ( uint32_t i = 0; i < CONFIG_MQTT_INFLIGHT_MAX; i++ )
+  {
+    if ( mqtt_state.inflight[i].used )
+    {
+      inflight_release( &mqtt_state.inflight[i] );
+    }
+  }
+}
+
+static void inflight_resend_all( void )
+{
+  for ( uint32_t i = 0; i < CONFIG_MQTT_INFLIGHT_MAX; i++ )
+  {
+    if ( mqtt_state.inflight[i].used )
+    {
+      inflight_retransmit( &mqtt_state.inflight[i] );
+    }
+  }
+}
+
+static mqtt_inflight_t* inflight_find( uint16_t id, int qos, bool released )
+{
+  for ( uint32_t i = 0; i < CONFIG_MQTT_INFLIGHT_MAX; i++ )
+  {
+    mqtt_inflight_t* slot = &mqtt_state.inflight[i];
+    if ( slot->used && slot->id == id && slot->msg.qos == qos && slot->released == released )
+    {
+      return slot;
+    }
+  }
+  return NULL;
+}
+
+// PUBACK for QoS 1, PUBCOMP for QoS 2
+static void inflight_acked( uint16_t id, int qos )
+{
+  mqtt_inflight_t* slot = inflight_find( id, qos, qos == 2 );
+
+  if ( slot != NULL )
+  {
+    hq_metrics_observe( mqtt_metrics.puback_latency, osal_task_get_time_ms() - slot->first_sent_ms );
+    hq_metrics_inc( mqtt_metrics.acked );
+    inflight_release( slot );
+  }
+}
+
+// PUBREC: the broker owns the QoS 2 message and Mongoose has already sent
+// PUBREL, so only the id is kept until PUBCOMP.
+static void inflight_received( uint16_t id )
+{
+  mqtt_inflight_t* slot = inflight_find( id, 2, false );
+
+  if ( slot != NULL )
+  {
+    message_release( &slot->msg );
+    slot->msg.props = NULL;
+    slot->msg.release = NULL;
+    slot->msg.topic = NULL;
+    slot->msg.payload = NULL;
+    slot->msg.len = 0;
+    slot->released = true;
+    slot->retries = 0;
+    slot->sent_ms = osal_task_get_time_ms();
+    session_changed();
+  }
+}
+
+// Inbound QoS 2 (poll task only). Mongoose answers PUBLISH with PUBREC and
+// PUBREL with PUBCOMP; remembering the ids in between tells a redelivery
+// from a new message, so each one reaches the subscribers once.
+static bool rx_qos2_seen( uint16_t id )
+{
+  for ( uint32_t i = 0; i < mqtt_state.rx_count; i++ )
+  {
+    if ( mqtt_state.rx_ids[i] == id )
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void rx_qos2_add( uint16_t id )
+{
+  if ( mqtt_state.rx_count == RX_QOS2_MAX )
+  {
+    // A broker that never releases its oldest message loses dedup for it
+    memmove( &mqtt_state.rx_ids[0], &mqtt_state.rx_ids[1], ( RX_QOS2_MAX - 1 ) * sizeof( uint16_t ) );
+    mqtt_state.rx_count--;
+  }
+  mqtt_state.rx_ids[mqtt_state.rx_count++] = id;
+  session_changed();
+}
+
+static void rx_qos2_release( uint16_t id )
+{
+  for ( uint32_t i = 0; i < mqtt_state.rx_count; i++ )
+  {
+    if ( mqtt_state.rx_ids[i] == id )
+    {
+      memmove( &mqtt_state.rx_ids[i], &mqtt_state.rx_ids[i + 1], ( mqtt_state.rx_count - i - 1 ) * sizeof( uint16_t ) );
+      mqtt_state.rx_count--;
+      session_changed();
+      return;
+    }
+  }
+}
+
+// Poll task: timer work
+static void reconnect_on_loop( void* arg )
+{
+  (void) arg;
+  if ( mqtt_state.initialized && mqtt_state.conn_state == MQTT_STATE_BACKOFF )
+  {
+    osal_log_info( MODULE_NAME "Attempting to reconnect (attempt %u)...\n", (unsigned) mqtt_state.failures );
+    mqtt_state.reconnects++;
+    hq_metrics_inc( mqtt_metrics.reconnects );
+    mqtt_connect();
+  }
+}
+
+// The first retry after a loss goes out at once; after that the delay
+// doubles from CONFIG_MQTT_RECONNECT_MIN_MS up to the cap, minus a random
+// share of up to CONFIG_MQTT_RECONNECT_JITTER percent so devices that lost
+// the broker together do not come back in lockstep.
+static uint32_t backoff_delay_ms( uint32_t failures )
+{
+  uint32_t delay = CONFIG_MQTT_RECONNECT_MIN_MS;
+  uint32_t jitter;
+  uint32_t r = 0;
+
+  if ( failures == 0 )
+  {
+    return 0;
+  }
+  for ( uint32_t i = 1; i < failures && delay < CONFIG_MQTT_RECONNECT_MAX_MS; i++ )
+  {
+    delay *= 2;
+  }
+  if ( delay > CONFIG_MQTT_RECONNECT_MAX_MS )
+  {
+    delay = CONFIG_MQTT_RECONNECT_MAX_MS;
+  }
+
+  jitter = (uint32_t) ( (uint64_t) delay * CONFIG_MQTT_RECONNECT_JITTER / 100 );
+  mg_random( &r, sizeof( r ) );
+  return delay - ( jitter ? r % ( jitter + 1 ) : 0 );
+}
+
+static void reconnect_schedule( void )
+{
+  mqtt_state.retry_delay_ms = backoff_delay_ms( mqtt_state.failures++ );
+  set_state( MQTT_STATE_BACKOFF );
+
+  if ( mqtt_state.retry_delay_ms == 0 )
+  {
+    if ( MongooseProcess_Call( reconnect_on_loop, NULL ) )
+    {
+      return;
+    }
+    mqtt_state.retry_delay_ms = CONFIG_MQTT_RECONNECT_MIN_MS;
+  }
+
+  osal_log_info( MODULE_NAME "Reconnecting in %u ms\n", (unsigned) mqtt_state.retry_delay_ms );
+  // Also starts the one-shot timer
+  osal_timer_change_period( mqtt_timers.reconnect, mqtt_state.retry_delay_ms, 0 );
+}
+
+// Each in-flight publish and (un)subscribe has its own deadline; one
+// periodic timer checks them all rather than arming a timer per packet id.
+static void retry_scan_on_loop( void* arg )
+{
+  uint32_t now = osal_task_get_time_ms();
+
+  (void) arg;
+  if ( !mqtt_state.initialized )
+  {
+    return;
+  }
+
+  session_flush();
+  // Offline publishes are resent as a batch from mqtt_connected()
+  if ( !mqtt_state.connected )
+  {
+    return;
+  }
+
+  pending_scan( now );
+  for ( uint32_t i = 0; i < CONFIG_MQTT_INFLIGHT_MAX; i++ )
+  {
+    mqtt_inflight_t* slot = &mqtt_state.inflight[i];
+    if ( !slot->used || now - slot->sent_ms < TIMEOUT_DEFAULT_MS )
+    {
+      continue;
+    }
+
+    if ( slot->retries < RETRY_COUNT )
+    {
+      slot->retries++;
+      osal_log_warning( MODULE_NAME "Retrying QoS %d message %u, attempt %d...\n", slot->msg.qos, slot->id, slot->retries );
+      inflight_retransmit( slot );
+    }
+    else
+    {
+      osal_log_error( MODULE_NAME "Failed to receive %s for %u after %d retries\n",
+                      ( slot->msg.qos == 1 ) ? "PUBACK" : slot->released ? "PUBCOMP" : "PUBREC", slot->id, RETRY_COUNT );
+      hq_metrics_inc( mqtt_metrics.puback_timeouts );
+      inflight_release( slot );
+    }
+  }
+}
+
+// Timer callbacks run on the timer service task and must not touch
+// Mongoose directly.
+static void reconnect_timer_callback( osal_timer_id_t timer )
+{
+  // Try again later if the poll task is not running (yet)
+  if ( !MongooseProcess_Call( reconnect_on_loop, NULL ) )
+  {
+    osal_timer_change_period( timer, CONFIG_MQTT_RECONNECT_MAX_MS, 0 );
+  }
+}
+
+static void retry_timer_callback( osal_timer_id_t timer )
+{
+  (void) timer;
+  MongooseProcess_Call( retry_scan_on_loop, NULL );
+}
+
+// Connection management
+static void mqtt_connect( void )
+{
+  if ( mqtt_state.nc != NULL )
+  {
+    // Detach first so the CLOSE of the old connection is ignored
+    struct mg_connection* old = mqtt_state.nc;
+    mqtt_state.nc = NULL;
+    old->is_closing = 1;
+    pending_fail_all();
+  }
+
+  osal_timer_stop( mqtt_timers.reconnect, 0 );
+  set_state( MQTT_STATE_CONNECTING );
+  mqtt_state.attempt_ms = osal_task_get_time_ms();
+  mqtt_state.error_fresh = false;
+
+  bool clean = true;
+  MQTTConfig_GetBool( &clean, MQTT_CONFIG_VALUE_CLEAN );
+  if ( clean != mqtt_state.clean )
+  {
+    if ( clean )
+    {
+      MqttSession_Remove( CONFIG_MQTT_SESSION_PATH );
+    }
+    mqtt_state.clean = clean;
+    mqtt_state.session_dirty = false;
+    session_changed();
+    retry_timer_idle();
+  }
+  if ( mqtt_state.resume_id != 0 )
+  {
+    // Ids restored from the session file must not be handed out again
+    mgr.mqtt_id = mqtt_state.resume_id;
+    mqtt_state.resume_id = 0;
+  }
+
+  const char* address = MQTTConfig_GetString( MQTT_CONFIG_VALUE_ADDRESS );
+  const char* username = MQTTConfig_GetString( MQTT_CONFIG_VALUE_USERNAME );
+  const char* password = MQTTConfig_GetString( MQTT_CONFIG_VALUE_PASSWORD );
+  const char* client_id = MQTTConfig_GetString( MQTT_CONFIG_VALUE_CLIENT_ID );
+
+  // Use configured client_id, fallback to the one generated at init
+  const char* effective_client_id = ( client_id && strlen( client_id ) > 0 ) ? client_id : mqtt_state.client_id;
+
+  osal_log_info( MODULE_NAME "Connecting to MQTT server at %s\n", address );
+  osal_log_info( MODULE_NAME "  Client ID: %s\n", effective_client_id );
+  osal_log_info( MODULE_NAME "  Username: %s\n", username ? username : "(null)" );
+  osal_log_info( MODULE_NAME "  Password: %s\n", password ? "***" : "(null)" );
+
+  int version = CONFIG_MQTT_PROTOCOL_VERSION;
+  MQTTConfig_GetInt( &version, MQTT_CONFIG_VALUE_VERSION );
+  mqtt_state.version = ( version == 5 ) ? 5 : 4;
+
+  // An MQTT 5 session ends with the connection unless it is given an
+  // expiry interval; the session file keeps the client half for good too.
+  struct mg_mqtt_prop session_expiry = { .id = MQTT_PROP_SESSION_EXPIRY_INTERVAL, .iv = UINT32_MAX };
+  struct mg_mqtt_opts opts_con = {
+    .user = mg_str( username ? username : "" ),
+    .pass = mg_str( password ? password : "" ),
+    .client_id = mg_str( effective_client_id ),
+    .keepalive = 60,
+    .version = (uint8_t) mqtt_state.version,
+    .clean = clean,
+    .props = &session_expiry,
+    .num_props = clean ? 0 : 1 };
+
+  mqtt_state.nc = mg_mqtt_connect( &mgr, address, &opts_con, ev_handler, NULL );
+  if ( mqtt_state.nc == NULL )
+  {
+    osal_log_error( MODULE_NAME "Failed to create MQTT connection\n" );
+    set_error( "cannot connect to %s", address ? address : "(null)" );
+    hq_metrics_inc( mqtt_metrics.connect_failures );
+    reconnect_schedule();
+  }
+}
+
+static void mqtt_transport_connected( struct mg_connection* nc )
+{
+  const char* address = MQTTConfig_GetString( MQTT_CONFIG_VALUE_ADDRESS );
+
+  osal_log_debug( MODULE_NAME "MQTT transport connected\n" );
+  if ( mg_url_is_ssl( address ) )
+  {
+    const char* cert = MQTTConfig_GetCert( MQTT_CONFIG_VALUE_CERT );
+    struct mg_tls_opts opts_ca = {
+      .ca = mg_str( cert ),
+      .name = mg_url_host( address ),
+    };
+    mg_tls_init( nc, &opts_ca );
+    mqtt_state.tls_start_ms = osal_task_get_time_ms();
+    if ( MongooseTls_Resume( nc, CONFIG_MQTT_TLS_SESSION_PATH ) )
+    {
+      hq_metrics_inc( mqtt_metrics.tls_resume_offered );
+    }
+  }
+}
+
+static void mqtt_connected( bool session_present )
+{
+  // Next time the TLS handshake can be cut short
+  if ( mqtt_state.nc->is_tls )
+  {
+    MongooseTls_Save( mqtt_state.nc, CONFIG_MQTT_TLS_SESSION_PATH );
+  }
+
+  set_state( MQTT_STATE_CONNECTED );
+  mqtt_state.connects++;
+  mqtt_state.error_fresh = false;
+  hq_metrics_inc( mqtt_metrics.connects );
+
+  if ( mqtt_state.clean || !session_present )
+  {
+    // The broker starts afresh: it forgot the QoS 2 messages it sent us and
+    // every filter has to be sent again
+    osal_log_info( MODULE_NAME "Connected to MQTT server\n" );
+    mqtt_state.rx_count = 0;
+    session_changed();
+    resubscribe_all();
+  }
+  else
+  {
+    osal_log_info( MODULE_NAME "Connected to MQTT server, session resumed\n" );
+    hq_metrics_inc( mqtt_metrics.sessions_resumed );
+  }
+
+  // Required after resuming a session; with a clean one it still turns a
+  // lost ack into a duplicate rather than a lost message
+  inflight_resend_all();
+
+  if ( MqttSpool_Count() > 0 )
+  {
+    mqtt_message_t wake = { .qos = MESSAGE_WAKE };
+    // A full queue wakes the publisher anyway
+    (void) osal_queue_send( mqtt_sync.message_queue, &wake, 0 );
+  }
+}
+
+static void mqtt_disconnected( void )
+{
+  if ( mqtt_state.conn_state == MQTT_STATE_CONNECTED )
+  {
+    hq_metrics_inc( mqtt_metrics.disconnects );
+    if ( !mqtt_state.error_fresh )
+    {
+      set_error( "%s", "connection lost" );
+    }
+    // Only a session that held up resets the backoff, so a broker that
+    // accepts and then drops us at once is not hammered
+    if ( osal_task_get_time_ms() - mqtt_state.session_ms >= SESSION_STABLE_MS )
+    {
+      mqtt_state.failures = 0;
+    }
+  }
+  else
+  {
+    if ( !mqtt_state.error_fresh )
+    {
+      set_error( "%s", "connection closed before CONNACK" );
+    }
+    hq_metrics_inc( mqtt_metrics.connect_failures );
+  }
+  mqtt_state.nc = NULL;
+  pending_fail_all();
+  if ( mqtt_state.session_dirty )
+  {
+    session_save();
+  }
+  osal_log_info( MODULE_NAME "Disconnected from MQTT server: %s\n", mqtt_state.last_error );
+  reconnect_schedule();
+}
+
+// Message handling
+typedef struct
+{
+  const struct mg_mqtt_message* mm;
+  char* topic;    // NUL-terminated copy, made only for legacy callbacks
+} mqtt_delivery_t;
+
+static void deliver_message( void* value, void* arg )
+{
+  mqtt_subscription_t* sub = (mqtt_subscription_t*) value;
+  mqtt_delivery_t* delivery = (mqtt_delivery_t*) arg;
+  const struct mg_mqtt_message* mm = delivery->mm;
+
+  for ( mqtt_subscriber_t* s = sub->subscribers; s != NULL; s = s->next )
+  {
+    if ( s->callback != NULL )
+    {
+      s->callback( mm->topic.buf, mm->topic.len, mm->data.buf, mm->data.len, s->ctx );
+    }
+    else if ( s->legacy != NULL )
+    {
+      if ( delivery->topic == NULL )
+      {
+        delivery->topic = mg_mprintf( "%.*s", (int) mm->topic.len, mm->topic.buf );
+        if ( delivery->topic == NULL )
+        {
+          continue;
+        }
+      }
+      s->legacy( delivery->topic, mm->data.buf, mm->data.len );
+    }
+  }
+}
+
+// Subscribers get compressed payloads inflated; a frame that does not
+// decode, or would inflate past CONFIG_MQTT_DECOMPRESS_MAX, is passed on as
+// it came. Returns the buffer to free after delivery.
+static char* payload_inflate( struct mg_mqtt_message* mm )
+{
+  size_t raw_len;
+  char* raw;
+
+  if ( !MqttCompress_Peek( mm->data.buf, mm->data.len, &raw_len ) )
+  {
+    return NULL;
+  }
+
+  raw = ( raw_len <= CONFIG_MQTT_DECOMPRESS_MAX ) ? malloc( raw_len + 1 ) : NULL;
+  if ( raw == NULL || !MqttCompress_Decode( mm->data.buf, mm->data.len, raw, raw_len ) )
+  {
+    osal_log_warning( MODULE_NAME "Delivering compressed payload on %.*s as is\n", (int) mm->topic.len,
+                      mm->topic.buf );
+    free( raw );
+    return NULL;
+  }
+  raw[raw_len] = '\0';
+  mm->data = mg_str_n( raw, raw_len );
+  hq_metrics_inc( mqtt_metrics.decompressed );
+  return raw;
+}
+
+static void handle_mqtt_message( struct mg_mqtt_message* mm )
+{
+  mqtt_delivery_t delivery = { .mm = mm };
+  char* raw;
+
+  if ( mqtt_state.version == 5 )
+  {
+    publish_skip_props( mm );
+  }
+
+  osal_log_debug( MODULE_NAME "%lu RECEIVED %.*s <- %.*s\n", mqtt_state.nc->id, (int) mm->data.len,
+                  mm->data.buf, (int) mm->topic.len, mm->topic.buf );
+
+  if ( mm->qos == 2 )
+  {
+    if ( rx_qos2_seen( mm->id ) )
+    {
+      osal_log_debug( MODULE_NAME "Dropping redelivered QoS 2 message %u\n", mm->id );
+      hq_metrics_inc( mqtt_metrics.duplicates );
+      return;
+    }
+    rx_qos2_add( mm->id );
+  }
+
+  hq_metrics_inc( mqtt_metrics.received );
+  raw = payload_inflate( mm );
+
+  if ( MqttTrie_Match( mqtt_state.trie, mm->topic.buf, mm->topic.len, deliver_message, &delivery ) == 0 )
+  {
+    osal_log_debug( MODULE_NAME "No subscription matches %.*s\n", (int) mm->topic.len, mm->topic.buf );
+  }
+  free( delivery.topic );
+  free( raw );
+}
+
+// CONNACK: session present flag, then the return code and, for MQTT 5,
+// the properties
+static void handle_connack( struct mg_connection* nc, const struct mg_mqtt_message* mm )
+{
+  if ( mm->ack == 0 )
+  {
+    const uint8_t* end = (const uint8_t*) mm->dgram.buf + mm->dgram.len;
+    uint32_t alias_max = 0;
+
+    // Aliases are per connection; the broker sets how many it takes
+    if ( mqtt_state.version == 5 )
+    {
+      (void) props_find_int( packet_body( mm ) + 2, end, MQTT_PROP_TOPIC_ALIAS_MAXIMUM, &alias_max );
+    }
+    MqttAlias_Reset( mqtt_state.aliases, (uint16_t) alias_max );
+    mqtt_connected( mm->dgram.len >= 4 && ( mm->dgram.buf[2] & 0x01 ) );
+  }
+  else
+  {
+    char code[12];
+    snprintf( code, sizeof( code ), "%d", mm->ack );
+    set_error( "CONNACK refused, code %s", code );
+    nc->is_draining = 1;
+  }
+}
+
+static void handle_mqtt_command( struct mg_connection* nc, struct mg_mqtt_message* mm )
+{
+  switch ( mm->cmd )
+  {
+    case MQTT_CMD_CONNACK:
+      handle_connack( nc, mm );
+      break;
+
+    case MQTT_CMD_SUBACK:
+      pending_acked( mm, PENDING_SUBSCRIBE );
+      break;
+
+    case MQTT_CMD_UNSUBACK:
+      pending_acked( mm, PENDING_UNSUBSCRIBE );
+      break;
+
+    case MQTT_CMD_PUBACK:
+      inflight_acked( mm->id, 1 );
+      break;
+
+    case MQTT_CMD_PINGRESP:
+      osal_log_debug( MODULE_NAME "PINGRESP received\n" );
+      break;
+
+    case MQTT_CMD_PUBREC:
+      inflight_received( mm->id );
+      break;
+
+    case MQTT_CMD_PUBCOMP:
+      inflight_acked( mm->id, 2 );
+      break;
+
+    case MQTT_CMD_PUBREL:
+      rx_qos2_release( mm->id );
+      break;
+
+    default:
+      break;
+  }
+}
+
+// Event handler
+static void ev_handler( struct mg_connection* nc, int ev, void* ev_data )
+{
+  // Events from a connection replaced by a reconnect or Deinit
+  if ( nc != mqtt_state.nc )
+  {
+    return;
+  }
+
+  switch ( ev )
+  {
+    case MG_EV_CONNECT:
+      mqtt_transport_connected( nc );
+      break;
+
+    case MG_EV_TLS_HS:
+      hq_metrics_observe( mqtt_metrics.tls_handshake, osal_task_get_time_ms() - mqtt_state.tls_start_ms );
+      break;
+
+    case MG_EV_POLL:
+      if ( mqtt_state.conn_state == MQTT_STATE_CONNECTING &&
+           osal_task_get_time_ms() - mqtt_state.attempt_ms >= CONNECT_TIMEOUT_MS )
+      {
+        set_error( "%s", "connect timed out" );
+        nc->is_closing = 1;
+      }
+      session_flush();
+      break;
+
+    case MG_EV_MQTT_CMD:
+      // CONNACK is handled here rather than on MG_EV_MQTT_OPEN, which does
+      // not carry the session present flag
+      handle_mqtt_command( nc, (struct mg_mqtt_message*) ev_data );
+      break;
+
+    case MG_EV_MQTT_MSG:
+      handle_mqtt_message( (struct mg_mqtt_message*) ev_data );
+      break;
+
+    case MG_EV_CLOSE:
+      osal_log_debug( MODULE_NAME "MQTT connection closed\n" );
+      mqtt_disconnected();
+      break;
+
+    case MG_EV_ERROR:
+      // MG_EV_CLOSE always follows and does the bookkeeping
+      osal_log_error( MODULE_NAME "MQTT connection error: %s\n", (char*) ev_data );
+      set_error( "%s", (char*) ev_data );
+      break;
+
+    default:
+      break;
+  }
+}
+
+// Poll task: requests from other tasks
+static void connect_on_loop( void* arg )
+{
+  (void) arg;
+  mqtt_connect();
+}
+
+static void disconnect_on_loop( void* arg )
+{
+  (void) arg;
+  if ( mqtt_state.nc != NULL )
+  {
+    struct mg_connection* nc = mqtt_state.nc;
+    mqtt_state.nc = NULL;
+    if ( mqtt_state.connected )
+    {
+      // Mongoose reads the (empty) property list for MQTT 5
+      mg_mqtt_disconnect( nc, &(struct mg_mqtt_opts) { .props = NULL } );
+    }
+    nc->is_draining = 1;
+  }
+  set_state( MQTT_STATE_STOPPED );
+  if ( !mqtt_state.clean )
+  {
+    // Keep the window for the next run before handing it back
+    session_save();
+  }
+  inflight_release_all();
+  pending_fail_all();
+}
+
+static void reconnect_forced_on_loop( void* arg )
+{
+  (void) arg;
+  if ( mqtt_state.initialized )
+  {
+    // New settings deserve an immediate attempt
+    mqtt_state.failures = 0;
+    mqtt_connect();
+  }
+}
+
+static void publish_on_loop( void* arg )
+{
+  mqtt_request_t* req = (mqtt_request_t*) arg;
+  const mqtt_message_t* msg = req->msg;
+
+  if ( !mqtt_state.nc || !mqtt_state.connected )
+  {
+    // Lost since the publisher looked; result asks it to spool the message
+    osal_log_debug( MODULE_NAME "Cannot publish: not connected\n" );
+    req->result = true;
+    return;
+  }
+
+  if ( message_expired( msg ) )
+  {
+    osal_log_debug( MODULE_NAME "Message to '%s' expired before it was sent\n", msg->topic );
+    hq_metrics_inc( mqtt_metrics.expired );
+    return;
+  }
+
+  osal_log_debug( MODULE_NAME "Publishing %u bytes to topic '%s'\n", (unsigned) msg->len, msg->topic );
+
+  if ( msg->qos > 0 )
+  {
+    // The publisher holds a window token, so a free slot exists
+    for ( uint32_t i = 0; i < CONFIG_MQTT_INFLIGHT_MAX; i++ )
+    {
+      mqtt_inflight_t* slot = &mqtt_state.inflight[i];
+      if ( !slot->used )
+      {
+        slot->used = true;
+        slot->released = false;
+        slot->retries = 0;
+        slot->msg = *msg;
+        inflight_send( slot, false );
+        slot->first_sent_ms = slot->sent_ms;
+        session_changed();
+        if ( mqtt_state.inflight_count++ == 0 && mqtt_state.pending_count == 0 )
+        {
+          osal_timer_start( mqtt_timers.retry, 0 );
+        }
+        req->sent = true;
+        break;
+      }
+    }
+  }
+  else
+  {
+    // mg_mqtt_pub() copies straight into the send buffer, so the payload
+    // can go back to its owner right away.
+    publish_send( msg, 0 );
+    message_release( msg );
+    req->sent = true;
+  }
+
+  if ( req->sent )
+  {
+    hq_metrics_inc( mqtt_metrics.published );
+  }
+}
+
+static uint16_t send_subscribe( const char* topic, int qos )
+{
+  mg_mqtt_sub( mqtt_state.nc, &(struct mg_mqtt_opts) { .topic = mg_str( topic ), .qos = (uint8_t) qos } );
+  return mgr.mqtt_id;
+}
+
+static uint16_t send_unsubscribe( const char* topic )
+{
+  // Build UNSUBSCRIBE packet manually since mg_mqtt_unsub doesn't exist
+  struct mg_str topic_str = mg_str( topic );
+  size_t id_len = ( mqtt_state.version == 5 ) ? 3 : 2;    // packet_id (2) + no MQTT 5 properties (1)
+  size_t packet_len = id_len + 2 + topic_str.len;          // + topic_len (2) + topic
+
+  mg_mqtt_send_header( mqtt_state.nc, MQTT_CMD_UNSUBSCRIBE, 0x02, packet_len );
+
+  uint16_t packet_id = next_packet_id();
+  uint8_t id_bytes[3] = { ( packet_id >> 8 ) & 0xFF, packet_id & 0xFF, 0 };
+  mg_send( mqtt_state.nc, id_bytes, id_len );
+
+  // Send topic length and topic
+  uint8_t topic_len_bytes[2] = { ( topic_str.len >> 8 ) & 0xFF, topic_str.len & 0xFF };
+  mg_send( mqtt_state.nc, topic_len_bytes, 2 );
+  mg_send( mqtt_state.nc, topic_str.buf, topic_str.len );
+  return packet_id;
+}
+
+static void request_done( const mqtt_request_t* req, bool success )
+{
+  if ( req->done != NULL )
+  {
+    req->done( success, req->done_ctx );
+  }
+}
+
+// Sets req->result once the request is accepted; req->done then runs
+// exactly once, here or when the ack arrives.
+static void subscribe_on_loop( void* arg )
+{
+  mqtt_request_t* req = (mqtt_request_t*) arg;
+  mqtt_subscriber_t* added = NULL;
+  mqtt_pending_t* pending;
+
+  if ( !mqtt_state.connected )
+  {
+    return;
+  }
+
+  if ( !MqttTrie_IsValidFilter( req->topic ) || req->qos < 0 || req->qos > 2 )
+  {
+    osal_log_error( MODULE_NAME "Invalid subscription: %s\n", req->topic );
+    return;
+  }
+
+  mqtt_subscription_t* sub = find_subscription( req->topic );
+  if ( !sub )
+  {
+    sub = add_subscription( req->topic );
+    if ( !sub )
+    {
+      osal_log_error( MODULE_NAME "Cannot add subscription: %s\n", req->topic );
+      return;
+    }
+  }
+
+  mqtt_subscriber_t* subscriber = find_subscriber( sub, req );
+  if ( subscriber )
+  {
+    subscriber->legacy = req->legacy;
+  }
+  else
+  {
+    added = calloc( 1, sizeof( *added ) );
+    if ( !added )
+    {
+      subscribe_rollback( sub, NULL );
+      return;
+    }
+    added->callback = req->callback;
+    added->legacy = req->legacy;
+    added->ctx = req->ctx;
+    added->next = sub->subscribers;
+    sub->subscribers = added;
+  }
+
+  if ( req->qos > sub->qos )
+  {
+    // New filter or higher QoS: the broker has to be asked
+    pending = pending_alloc( PENDING_SUBSCRIBE, 0, req );
+    if ( !pending )
+    {
+      subscribe_rollback( sub, added );
+      return;
+    }
+    pending->prev_qos = sub->qos;
+    pending->id = send_subscribe( sub->topic, req->qos );
+    sub->qos = req->qos;
+    sub->sub_id = pending->id;
+  }
+  else if ( sub->sub_id != 0 )
+  {
+    // Covered by the SUBSCRIBE already in flight; wait for its SUBACK
+    pending = pending_alloc( PENDING_SUBSCRIBE, sub->sub_id, req );
+    if ( !pending )
+    {
+      subscribe_rollback( sub, added );
+      return;
+    }
+    pending->prev_qos = sub->qos;
+  }
+  else
+  {
+    req->result = true;
+    request_done( req, true );
+    return;
+  }
+
+  pending->sub = sub;
+  pending->subscriber = added;
+  req->result = true;
+}
+
+static void unsubscribe_on_loop( void* arg )
+{
+  mqtt_request_t* req = (mqtt_request_t*) arg;
+
+  if ( !mqtt_state.connected )
+  {
+    return;
+  }
+
+  mqtt_subscription_t* sub = find_subscription( req->topic );
+  if ( !sub )
+  {
+    osal_log_warning( MODULE_NAME "Topic not found in subscriptions: %s\n", req->topic );
+    return;
+  }
+
+  // Removing one of several subscribers stays local
+  if ( req->callback )
+  {
+    mqtt_subscriber_t* subscriber = find_subscriber( sub, req );
+    if ( !subscriber )
+    {
+      return;
+    }
+    if ( sub->subscribers != subscriber || subscriber->next != NULL )
+    {
+      remove_subscriber( sub, subscriber );
+      req->result = true;
+      request_done( req, true );
+      return;
+    }
+  }
+
+  mqtt_pending_t* pending = pending_alloc( PENDING_UNSUBSCRIBE, 0, req );
+  if ( !pending )
+  {
+    return;
+  }
+  pending->id = send_unsubscribe( sub->topic );
+
+  // Gone locally right away, so a new subscribe to the same filter starts
+  // afresh and reaches the broker after this UNSUBSCRIBE
+  remove_subscription( sub );
+  req->result = true;
+}
+
+// Store-and-forward (publisher task only, which keeps the spool in order)
+static void spool_message( const mqtt_message_t* msg )
+{
+  if ( !MqttSpool_Push( msg->topic, msg->payload, msg->len, msg->qos ) )
+  {
+    hq_metrics_inc( mqtt_metrics.dropped );
+  }
+  message_release( msg );
+}
+
+static void compress_rule_visit( void* value, void* arg )
+{
+  const mqtt_compress_rule_t* rule = (const mqtt_compress_rule_t*) value;
+  size_t* min_len = (size_t*) arg;
+
+  if ( rule->min_len < *min_len )
+  {
+    *min_len = rule->min_len;
+  }
+}
+
+// Replaces the payload of a message on a compressed topic with a frame, if
+// that comes out smaller. The caller's buffers are released right away and
+// the message then owns one block with the topic and the frame, so the
+// spool and the session file keep the compressed form too.
+static void message_compress( mqtt_message_t* msg )
+{
+  size_t min_len = SIZE_MAX;
+  size_t topic_size = strlen( msg->topic ) + 1;
+  size_t frame_len;
+  char* block;
+
+  osal_mutex_take( mqtt_compress.lock );
+  MqttTrie_Match( mqtt_compress.trie, msg->topic, topic_size - 1, compress_rule_visit, &min_len );
+  osal_mutex_give( mqtt_compress.lock );
+  if ( msg->len < min_len || msg->len < 2 )
+  {
+    return;
+  }
+
+  block = malloc( topic_size + msg->len - 1 );
+  if ( block == NULL )
+  {
+    return;
+  }
+  frame_len = MqttCompress_Encode( msg->payload, msg->len, block + topic_size, msg->len - 1, mqtt_compress.work );
+  if ( frame_len == 0 )
+  {
+    free( block );
+    return;
+  }
+  memcpy( block, msg->topic, topic_size );
+  hq_metrics_inc( mqtt_metrics.compressed );
+  hq_metrics_add( mqtt_metrics.compress_in, msg->len );
+  hq_metrics_add( mqtt_metrics.compress_out, frame_len );
+
+  if ( msg->release != NULL )
+  {
+    msg->release( msg->ctx );
+  }
+  msg->topic = block;
+  msg->payload = block + topic_size;
+  msg->len = frame_len;
+  msg->release = free;
+  msg->ctx = block;
+}
+
+// QoS 1/2 needs a window token; this blocks while N publishes are waiting
+// for their ack. With spill set, a window that stays full until the
+// queue behind it fills up sends the message to the spool instead.
+static bool window_take( bool spill )
+{
+  if ( !spill || !MqttSpool_IsOpen() )
+  {
+    osal_count_sem_take( mqtt_sync.window );
+    return true;
+  }
+
+  if ( osal_count_sem_timed_wait( mqtt_sync.window, 0 ) == OSAL_SUCCESS )
+  {
+    return true;
+  }
+
+  // Filling the queue gives one extra token to wake us (see spill_wake()).
+  // Whoever clears spill_waiting first decides what the token was.
+  __atomic_store_n( &mqtt_sync.spill_waiting, true, __ATOMIC_SEQ_CST );
+  if ( osal_queue_get_count( mqtt_sync.message_queue ) >= CONFIG_MQTT_MESSAGE_QUEUE_SIZE &&
+       __atomic_exchange_n( &mqtt_sync.spill_waiting, false, __ATOMIC_SEQ_CST ) )
+  {
+    return false;
+  }
+  osal_count_sem_take( mqtt_sync.window );
+  return __atomic_exchange_n( &mqtt_sync.spill_waiting, false, __ATOMIC_SEQ_CST );
+}
+
+// Called after posting; only the publisher drains the queue, so once full
+// it stays full until window_take() gives up and spills.
+static void spill_wake( void )
+{
+  if ( osal_queue_get_count( mqtt_sync.message_queue ) >= CONFIG_MQTT_MESSAGE_QUEUE_SIZE &&
+       __atomic_exchange_n( &mqtt_sync.spill_waiting, false, __ATOMIC_SEQ_CST ) )
+  {
+    osal_count_sem_give( mqtt_sync.window );
+  }
+}
+
+// Publishing functions
+static bool mqtt_publish_internal( const mqtt_message_t* msg, bool spill )
+{
+  mqtt_request_t req = { .msg = msg };
+
+  if ( msg->qos > 0 && !window_take( spill ) )
+  {
+    spool_message( msg );
+    return true;
+  }
+
+  MongooseProcess_CallWait( publish_on_loop, &req );
+
+  if ( !req.sent )
+  {
+    if ( msg->qos > 0 )
+    {
+      osal_count_sem_give( mqtt_sync.window );
+    }
+    // A spooled message being replayed is still in the spool
+    if ( spill && req.result )
+    {
+      spool_message( msg );
+    }
+    else
+    {
+      message_release( msg );
+    }
+  }
+  return req.sent;
+}
+
+// Publish the oldest spooled message; it stays in the spool until the
+// publish is accepted, so a disconnect here loses nothing.
+static void spool_replay_one( void )
+{
+  mqtt_spool_record_t rec;
+
+  if ( !MqttSpool_Peek( &rec ) )
+  {
+    return;
+  }
+
+  mqtt_message_t msg = {
+    .topic = rec.topic,
+    .payload = rec.payload,
+    .len = rec.len,
+    .qos = rec.qos,
+    .release = free,
+    .ctx = rec.topic };
+
+  if ( mqtt_publish_internal( &msg, false ) )
+  {
+    MqttSpool_Pop();
+  }
+}
+
+// Task function
+static void publisher_task( void* arg )
+{
+  const uint32_t replay_interval_ms = ( CONFIG_MQTT_SPOOL_REPLAY_RATE > 0 ) ? 1000U / CONFIG_MQTT_SPOOL_REPLAY_RATE : 0U;
+  uint32_t last_replay_ms = osal_task_get_time_ms();
+  mqtt_message_t msg;
+
+  (void) arg;
+  while ( 1 )
+  {
+    bool replaying = mqtt_state.connected && MqttSpool_Count() > 0;
+    uint32_t wait = OSAL_MAX_DELAY;
+
+    if ( replaying )
+    {
+      uint32_t elapsed = osal_task_get_time_ms() - last_replay_ms;
+      wait = ( elapsed < replay_interval_ms ) ? replay_interval_ms - elapsed : 0U;
+    }
+
+    if ( osal_queue_receive( mqtt_sync.message_queue, &msg, wait ) == OSAL_SUCCESS )
+    {
+      if ( msg.qos == MESSAGE_STOP )
+      {
+        // Park here until MqttApp_Deinit() deletes the task; returning from a
+        // task function is not allowed on every OSAL port.
+        osal_bin_sem_give( mqtt_sync.stopped );
+        while ( 1 )
+        {
+          osal_task_delay_ms( 1000 );
+        }
+      }
+
+      if ( msg.qos == MESSAGE_WAKE )
+      {
+        replaying = mqtt_state.connected && MqttSpool_Count() > 0;
+      }
+      else
+      {
+        message_compress( &msg );
+        if ( mqtt_state.connected && MqttSpool_Count() == 0 )
+        {
+          mqtt_publish_internal( &msg, true );
+        }
+        else
+        {
+          // Anything behind a non-empty spool goes to the spool too, so the
+          // broker sees messages in the order they were posted.
+          spool_message( &msg );
+        }
+      }
+    }
 
-  mg_mqtt_send_header( mqtt_state.nc, MQTT_CMD_UNSUBSCRIBE, 0x02, packet_len );
+    if ( replaying && osal_task_get_time_ms() - last_replay_ms >= replay_interval_ms )
+    {
+      last_replay_ms = osal_task_get_time_ms();
+      spool_replay_one();
+    }
+  }
+}
 
-  // Send packet ID (using a simple counter, could be more sophisticated)
-  static uint16_t packet_id = 1;
-  uint8_t id_bytes[2] = { ( packet_id >> 8 ) & 0xFF, packet_id & 0xFF };
-  mg_send( mqtt_state.nc, id_bytes, 2 );
-  packet_id++;
+// Grows or shrinks the in-flight window in place. Slots past a smaller
+// window stay in use until acknowledged, and their tokens are taken back
+// as they complete.
+static void window_resize_on_loop( void* arg )
+{
+  int window = CONFIG_MQTT_INFLIGHT_MAX;
 
-  // Send topic length and topic
-  uint8_t topic_len_bytes[2] = { ( topic_str.len >> 8 ) & 0xFF, topic_str.len & 0xFF };
-  mg_send( mqtt_state.nc, topic_len_bytes, 2 );
-  mg_send( mqtt_state.nc, topic_str.buf, topic_str.len );
+  (void) arg;
+  if ( !mqtt_state.initialized )
+  {
+    return;
+  }
+  MQTTConfig_GetInt( &window, MQTT_CONFIG_VALUE_INFLIGHT );
+  if ( window < 1 || window > CONFIG_MQTT_INFLIGHT_MAX )
+  {
+    osal_log_warning( MODULE_NAME "In-flight window %d out of range, keeping %u\n", window,
+                      (unsigned) mqtt_state.window );
+    return;
+  }
+
+  for ( ; mqtt_state.window < (uint32_t) window; mqtt_state.window++ )
+  {
+    if ( mqtt_state.window_debt > 0 )
+    {
+      mqtt_state.window_debt--;
+    }
+    else
+    {
+      osal_count_sem_give( mqtt_sync.window );
+    }
+  }
+  for ( ; mqtt_state.window > (uint32_t) window; mqtt_state.window-- )
+  {
+    if ( osal_count_sem_timed_wait( mqtt_sync.window, 0 ) != OSAL_SUCCESS )
+    {
+      mqtt_state.window_debt++;
+    }
+  }
+  osal_log_info( MODULE_NAME "In-flight window set to %d\n", window );
+}
+
+// A saved TLS session belongs to the server it was made with
+static void tls_forget_on_loop( void* arg )
+{
+  (void) arg;
+  MongooseTls_Forget( CONFIG_MQTT_TLS_SESSION_PATH );
+}
+
+// Configuration update callback
+static void config_update_callback( uint32_t changed )
+{
+  // Everything used by CONNECT or the TLS handshake needs a new connection;
+  // topics are read on every use. Settings may be saved from an HTTP
+  // handler on the poll task, so only queue the work here.
+  const uint32_t connection_settings =
+    MQTT_CONFIG_CHANGED( MQTT_CONFIG_VALUE_ADDRESS ) | MQTT_CONFIG_CHANGED( MQTT_CONFIG_VALUE_SSL ) |
+    MQTT_CONFIG_CHANGED( MQTT_CONFIG_VALUE_USERNAME ) | MQTT_CONFIG_CHANGED( MQTT_CONFIG_VALUE_PASSWORD ) |
+    MQTT_CONFIG_CHANGED( MQTT_CONFIG_VALUE_CLIENT_ID ) | MQTT_CONFIG_CHANGED( MQTT_CONFIG_VALUE_CERT ) |
+    MQTT_CONFIG_CHANGED( MQTT_CONFIG_VALUE_CLEAN ) | MQTT_CONFIG_CHANGED( MQTT_CONFIG_VALUE_VERSION );
+
+  if ( changed & MQTT_CONFIG_CHANGED( MQTT_CONFIG_VALUE_INFLIGHT ) )
+  {
+    MongooseProcess_Call( window_resize_on_loop, NULL );
+  }
+  if ( changed & ( MQTT_CONFIG_CHANGED( MQTT_CONFIG_VALUE_ADDRESS ) | MQTT_CONFIG_CHANGED( MQTT_CONFIG_VALUE_CERT ) ) )
+  {
+    MongooseProcess_Call( tls_forget_on_loop, NULL );
+  }
+  if ( changed & connection_settings )
+  {
+    MongooseProcess_Call( reconnect_forced_on_loop, NULL );
+  }
+}
+
+// Blocking subscribe and unsubscribe wait for the completion off the poll task
+typedef struct
+{
+  osal_bin_sem_id_t sem;
+  bool success;
+} mqtt_waiter_t;
+
+static void waiter_done( bool success, void* ctx )
+{
+  mqtt_waiter_t* waiter = (mqtt_waiter_t*) ctx;
+
+  waiter->success = success;
+  osal_bin_sem_give( waiter->sem );
+}
+
+static bool request_submit( MongooseProcessFn_t fn, mqtt_request_t* req )
+{
+  if ( !mqtt_state.initialized || !mqtt_state.connected || !req->topic )
+  {
+    return false;
+  }
+  return MongooseProcess_CallWait( fn, req ) && req->result;
+}
+
+static bool request_wait( MongooseProcessFn_t fn, mqtt_request_t* req, uint32_t timeout_ms )
+{
+  mqtt_waiter_t waiter = { .success = false };
+
+  // The ack is handled on the poll task, waiting there would deadlock
+  if ( MongooseProcess_IsPollTask() )
+  {
+    osal_log_error( MODULE_NAME "Blocking (un)subscribe called from the Mongoose poll task\n" );
+    return false;
+  }
 
-  xTimerChangePeriod( mqtt_timers.unsuback, pdMS_TO_TICKS( timeout_ms ), 0 );
-  xTimerStart( mqtt_timers.unsuback, 0 );
+  if ( osal_bin_sem_create( &waiter.sem, "mqtt_wait", 0 ) != OSAL_SUCCESS )
+  {
+    return false;
+  }
+
+  req->done = waiter_done;
+  req->done_ctx = &waiter;
+  req->timeout_ms = timeout_ms;
+  if ( request_submit( fn, req ) )
+  {
+    // Completion is guaranteed: the ack, the deadline scan or the
+    // disconnect (also on Deinit) finishes every pending request.
+    (void) osal_bin_sem_take( waiter.sem );
+  }
+
+  (void) osal_bin_sem_delete( waiter.sem );
+  return waiter.success;
+}
 
-  if ( xSemaphoreTake( mqtt_sync.unsuback, pdMS_TO_TICKS( timeout_ms + 100 ) ) == pdFALSE )
+static bool subscribe_wait( mqtt_request_t* req, uint32_t timeout_ms )
+{
+  if ( !req->callback && !req->legacy )
+  {
+    return false;
+  }
+
+  if ( !request_wait( subscribe_on_loop, req, timeout_ms ) )
   {
-    printf( "Unsubscribe timeout for topic: %s\n", topic );
+    osal_log_error( MODULE_NAME "Subscribe failed for topic: %s\n", req->topic ? req->topic : "(null)" );
     return false;
   }
 
-  if ( !mqtt_acks.unsuback_received )
+  osal_log_info( MODULE_NAME "Successfully subscribed to topic: %s\n", req->topic );
+  return true;
+}
+
+static bool unsubscribe_wait( mqtt_request_t* req, uint32_t timeout_ms )
+{
+  if ( !request_wait( unsubscribe_on_loop, req, timeout_ms ) )
   {
-    printf( "Unsubscribe failed for topic: %s\n", topic );
+    osal_log_error( MODULE_NAME "Unsubscribe failed for topic: %s\n", req->topic ? req->topic : "(null)" );
     return false;
   }
 
-  clear_subscription( sub );
-  printf( "Successfully unsubscribed from topic: %s\n", topic );
+  osal_log_info( MODULE_NAME "Successfully unsubscribed from topic: %s\n", req->topic );
   return true;
 }
 
-void MqttApp_Init( void )
+// Public API functions
+bool MqttApp_Subscribe( const char* topic, int qos, mqtt_message_callback_t callback, uint32_t timeout_ms )
+{
+  mqtt_request_t req = { .topic = topic, .qos = qos, .legacy = callback };
+
+  return subscribe_wait( &req, timeout_ms );
+}
+
+bool MqttApp_SubscribeCtx( const char* filter, int qos, mqtt_subscription_cb_t callback, void* ctx,
+                           uint32_t timeout_ms )
+{
+  mqtt_request_t req = { .topic = filter, .qos = qos, .callback = callback, .ctx = ctx };
+
+  return subscribe_wait( &req, timeout_ms );
+}
+
+bool MqttApp_SubscribeAsync( const char* filter, int qos, mqtt_subscription_cb_t callback, void* ctx,
+                             mqtt_done_cb_t done, void* done_ctx )
+{
+  mqtt_request_t req = { .topic = filter, .qos = qos, .callback = callback, .ctx = ctx,
+                         .done = done, .done_ctx = done_ctx };
+
+  return callback != NULL && request_submit( subscribe_on_loop, &req );
+}
+
+bool MqttApp_Unsubscribe( const char* topic, uint32_t timeout_ms )
+{
+  mqtt_request_t req = { .topic = topic };
+
+  return unsubscribe_wait( &req, timeout_ms );
+}
+
+bool MqttApp_UnsubscribeCtx( const char* filter, mqtt_subscription_cb_t callback, void* ctx, uint32_t timeout_ms )
+{
+  mqtt_request_t req = { .topic = filter, .callback = callback, .ctx = ctx };
+
+  if ( !callback )
+  {
+    return false;
+  }
+  return unsubscribe_wait( &req, timeout_ms );
+}
+
+bool MqttApp_UnsubscribeAsync( const char* filter, mqtt_subscription_cb_t callback, void* ctx,
+                               mqtt_done_cb_t done, void* done_ctx )
+{
+  mqtt_request_t req = { .topic = filter, .callback = callback, .ctx = ctx, .done = done, .done_ctx = done_ctx };
+
+  return request_submit( unsubscribe_on_loop, &req );
+}
+
+// Undo a partial MqttApp_Init(); every handle not created yet is NULL
+static void init_cleanup( void )
+{
+  // Restored publishes never reached the window, just drop them
+  for ( uint32_t i = 0; i < CONFIG_MQTT_INFLIGHT_MAX; i++ )
+  {
+    if ( mqtt_state.inflight[i].used )
+    {
+      message_release( &mqtt_state.inflight[i].msg );
+    }
+  }
+
+  if ( mqtt_timers.retry != NULL )
+  {
+    osal_timer_delete( mqtt_timers.retry, 0 );
+  }
+  if ( mqtt_timers.reconnect != NULL )
+  {
+    osal_timer_delete( mqtt_timers.reconnect, 0 );
+  }
+  MqttSpool_Close();
+  if ( mqtt_sync.message_queue != NULL )
+  {
+    osal_queue_delete( mqtt_sync.message_queue );
+  }
+  if ( mqtt_sync.window != NULL )
+  {
+    osal_count_sem_delete( mqtt_sync.window );
+  }
+  if ( mqtt_sync.stopped != NULL )
+  {
+    osal_bin_sem_delete( mqtt_sync.stopped );
+  }
+  MqttTrie_Destroy( mqtt_state.trie );
+  MqttAlias_Destroy( mqtt_state.aliases );
+  MqttTrie_Destroy( mqtt_compress.trie );
+  free( mqtt_compress.work );
+  if ( mqtt_compress.lock != NULL )
+  {
+    osal_mutex_delete( mqtt_compress.lock );
+  }
+
+  memset( &mqtt_state, 0, sizeof( mqtt_state ) );
+  memset( &mqtt_timers, 0, sizeof( mqtt_timers ) );
+  memset( &mqtt_sync, 0, sizeof( mqtt_sync ) );
+  memset( &mqtt_compress, 0, sizeof( mqtt_compress ) );
+}
+
+bool MqttApp_Init( void )
 {
-  assert( mqtt_state.initialized == 0 );
+  uint32_t id = 0;
+
+  if ( mqtt_state.initialized )
+  {
+    return false;
+  }
 
   MQTTConfig_Init();
   MQTTConfig_SetCallback( config_update_callback );
+  metrics_register();
+
+  int window = CONFIG_MQTT_INFLIGHT_MAX;
+  MQTTConfig_GetInt( &window, MQTT_CONFIG_VALUE_INFLIGHT );
+  if ( window < 1 || window > CONFIG_MQTT_INFLIGHT_MAX )
+  {
+    osal_log_warning( MODULE_NAME "In-flight window %d out of range, using %d\n", window, CONFIG_MQTT_INFLIGHT_MAX );
+    window = CONFIG_MQTT_INFLIGHT_MAX;
+  }
+  mqtt_state.window = (uint32_t) window;
+
+  bool clean = true;
+  MQTTConfig_GetBool( &clean, MQTT_CONFIG_VALUE_CLEAN );
+  mqtt_state.clean = clean;
+
+#ifdef CONFIG_MQTT_SPOOL
+  // Without a mounted filesystem the app still runs, it just drops
+  // messages while offline.
+  if ( !MqttSpool_Open( CONFIG_MQTT_SPOOL_PATH, CONFIG_MQTT_SPOOL_SEGMENT_SIZE, CONFIG_MQTT_SPOOL_MAX_SEGMENTS ) )
+  {
+    osal_log_warning( MODULE_NAME "Outbound spool unavailable at %s\n", CONFIG_MQTT_SPOOL_PATH );
+  }
+#endif
 
   // Create timers
-  mqtt_timers.puback = xTimerCreate( "PubackTimer", pdMS_TO_TICKS( TIMEOUT_DEFAULT_MS ), pdTRUE, NULL, puback_timer_callback );
-  mqtt_timers.reconnect = xTimerCreate( "ReconnectTimer", pdMS_TO_TICKS( RECONNECT_DELAY_MS ), pdTRUE, NULL, reconnect_timer_callback );
-  mqtt_timers.suback = xTimerCreate( "SubackTimer", pdMS_TO_TICKS( TIMEOUT_DEFAULT_MS ), pdFALSE, NULL, suback_timer_callback );
-  mqtt_timers.unsuback = xTimerCreate( "UnsubackTimer", pdMS_TO_TICKS( TIMEOUT_DEFAULT_MS ), pdFALSE, NULL, unsuback_timer_callback );
-
-  assert( mqtt_timers.puback != NULL );
-  assert( mqtt_timers.reconnect != NULL );
-  assert( mqtt_timers.suback != NULL );
-  assert( mqtt_timers.unsuback != NULL );
-
-  // Create synchronization objects
-  mqtt_sync.message_queue = xQueueCreate( MESSAGE_QUEUE_SIZE, sizeof( mqtt_message_t ) );
-  mqtt_sync.puback = xSemaphoreCreateBinary();
-  mqtt_sync.suback = xSemaphoreCreateBinary();
-  mqtt_sync.unsuback = xSemaphoreCreateBinary();
-
-  assert( mqtt_sync.message_queue != NULL );
-  assert( mqtt_sync.puback != NULL );
-  assert( mqtt_sync.suback != NULL );
-  assert( mqtt_sync.unsuback != NULL );
+  if ( osal_timer_create( &mqtt_timers.retry, "mqtt_retry", RETRY_SCAN_MS, true,
+                          retry_timer_callback, NULL, NULL, 0 ) != OSAL_SUCCESS ||
+       osal_timer_create( &mqtt_timers.reconnect, "mqtt_reconnect", CONFIG_MQTT_RECONNECT_MIN_MS, false,
+                          reconnect_timer_callback, NULL, NULL, 0 ) != OSAL_SUCCESS )
+  {
+    osal_log_error( MODULE_NAME "Cannot create timers\n" );
+    init_cleanup();
+    return false;
+  }
 
-  // Initialize state
-  memset( mqtt_state.subscriptions, 0, sizeof( mqtt_state.subscriptions ) );
-  memset( &mqtt_acks, 0, sizeof( mqtt_acks ) );
+  // Restored publishes hold their window tokens from the start
+  session_restore();
 
-  xTaskCreate( mongoose_task, "MongooseTask", MONGOOSE_TASK_STACK_SIZE, NULL, MONGOOSE_TASK_PRIORITY, NULL );
-  xTimerStart( mqtt_timers.reconnect, 0 );
-  mqtt_connect();
+  // Create synchronization objects; the window counts one above its
+  // maximum for the token spill_wake() may add
+  if ( osal_queue_create( &mqtt_sync.message_queue, "mqtt_msg", CONFIG_MQTT_MESSAGE_QUEUE_SIZE,
+                          sizeof( mqtt_message_t ) ) != OSAL_SUCCESS ||
+       osal_count_sem_create( &mqtt_sync.window, "mqtt_window", mqtt_state.window - mqtt_state.inflight_count,
+                              CONFIG_MQTT_INFLIGHT_MAX + 1 ) != OSAL_SUCCESS ||
+       osal_bin_sem_create( &mqtt_sync.stopped, "mqtt_stopped", 0 ) != OSAL_SUCCESS )
+  {
+    osal_log_error( MODULE_NAME "Cannot create synchronization objects\n" );
+    init_cleanup();
+    return false;
+  }
+
+  // Initialize state
+  mqtt_state.subscriptions = NULL;
+  mqtt_state.trie = MqttTrie_Create();
+  mqtt_state.aliases = MqttAlias_Create( CONFIG_MQTT_TOPIC_ALIAS_MAX, CONFIG_MQTT_TOPIC_ALIAS_HOT );
+  mqtt_compress.trie = MqttTrie_Create();
+  mqtt_compress.work = malloc( MQTT_COMPRESS_WORK_SIZE );
+  if ( mqtt_state.trie == NULL || mqtt_state.aliases == NULL || mqtt_compress.trie == NULL ||
+       mqtt_compress.work == NULL || osal_mutex_create( &mqtt_compress.lock, "mqtt_compress" ) != OSAL_SUCCESS )
+  {
+    osal_log_error( MODULE_NAME "Out of memory\n" );
+    init_cleanup();
+    return false;
+  }
+  mg_random( &id, sizeof( id ) );
+  snprintf( mqtt_state.client_id, sizeof( mqtt_state.client_id ), "hq_%08lx", (unsigned long) id );
   mqtt_state.initialized = 1;
+
+  if ( osal_task_create( &mqtt_sync.publisher, "mqtt_pub", publisher_task, NULL, NULL,
+                         CONFIG_MQTT_TASK_STACK_SIZE, MQTT_TASK_PRIORITY, NULL ) != OSAL_SUCCESS )
+  {
+    osal_log_error( MODULE_NAME "Cannot create publisher task\n" );
+    init_cleanup();
+    return false;
+  }
+
+  if ( mqtt_state.inflight_count > 0 )
+  {
+    osal_timer_start( mqtt_timers.retry, 0 );
+  }
+  if ( !MongooseProcess_CallWait( connect_on_loop, NULL ) )
+  {
+    osal_log_error( MODULE_NAME "Mongoose process is not running\n" );
+    mqtt_state.conn_state = MQTT_STATE_BACKOFF;
+    osal_timer_change_period( mqtt_timers.reconnect, CONFIG_MQTT_RECONNECT_MIN_MS, 0 );
+  }
+  return true;
 }
 
 void MqttApp_Deinit( void )
 {
+  mqtt_message_t stop = { .qos = MESSAGE_STOP };
+
   if ( mqtt_state.initialized == 0 )
   {
     return;
   }
 
-  // Delete timers
-  xTimerDelete( mqtt_timers.reconnect, 0 );
-  xTimerDelete( mqtt_timers.suback, 0 );
-  xTimerDelete( mqtt_timers.unsuback, 0 );
-  xTimerDelete( mqtt_timers.puback, 0 );
+  // Calls queued by the timers check this before doing anything
+  mqtt_state.initialized = 0;
 
-  // Delete synchronization objects
-  vQueueDelete( mqtt_sync.message_queue );
-  vSemaphoreDelete( mqtt_sync.puback );
-  vSemaphoreDelete( mqtt_sync.suback );
-  vSemaphoreDelete( mqtt_sync.unsuback );
+  // Disconnecting first hands back every window token, so a publisher
+  // blocked on a full window wakes up and drains the queue. It also fails
+  // pending (un)subscribes, which still stops the retry timer.
+  MongooseProcess_CallWait( disconnect_on_loop, NULL );
 
-  // Clear subscriptions
-  memset( mqtt_state.subscriptions, 0, sizeof( mqtt_state.subscriptions ) );
+  // Delete timers
+  osal_timer_delete( mqtt_timers.reconnect, 0 );
+  osal_timer_delete( mqtt_timers.retry, 0 );
 
-  if ( mqtt_state.connected )
-  {
-    mg_mqtt_disconnect( mqtt_state.nc, NULL );
-    mqtt_state.nc->is_closing = 1;
-    mqtt_state.nc = NULL;
-  }
+  // Stop the publisher between messages. Deleting it while it waits on the
+  // queue would leave the queue lock held.
+  osal_queue_send( mqtt_sync.message_queue, &stop, OSAL_MAX_DELAY );
+  osal_bin_sem_take( mqtt_sync.stopped );
+  osal_task_delete( mqtt_sync.publisher );
+  MqttSpool_Close();
+
+  // Delete synchronization objects
+  osal_queue_delete( mqtt_sync.message_queue );
+  osal_count_sem_delete( mqtt_sync.window );
+  osal_bin_sem_delete( mqtt_sync.stopped );
+
+  // Nothing is delivered once disconnected
+  remove_all_subscriptions();
+  MqttTrie_Destroy( mqtt_state.trie );
+  MqttAlias_Destroy( mqtt_state.aliases );
+  MqttTrie_Destroy( mqtt_compress.trie );
+  free( mqtt_compress.work );
+  osal_mutex_delete( mqtt_compress.lock );
 
   // Reset state
   memset( &mqtt_state, 0, sizeof( mqtt_state ) );
   memset( &mqtt_timers, 0, sizeof( mqtt_timers ) );
   memset( &mqtt_sync, 0, sizeof( mqtt_sync ) );
-  memset( &mqtt_acks, 0, sizeof( mqtt_acks ) );
+  memset( &mqtt_compress, 0, sizeof( mqtt_compress ) );
 }
 
-bool MqttApp_PostData( const char* topic, const char* message, int qos )
+// One block for the properties and their strings; NULL with *ok set if
+// there is nothing to send
+static mqtt_props_t* props_copy( const mqtt_publish_props_t* props, bool* ok )
 {
-  if ( mqtt_state.initialized == 0 )
+  size_t size = sizeof( mqtt_props_t );
+  mqtt_props_t* copy;
+  char* strings;
+
+  *ok = true;
+  if ( props == NULL || ( props->expiry_s == 0 && props->user_prop_count == 0 ) )
+  {
+    return NULL;
+  }
+
+  *ok = false;
+  if ( props->user_prop_count > MQTT_USER_PROPS_MAX || ( props->user_prop_count > 0 && props->user_props == NULL ) )
+  {
+    return NULL;
+  }
+  for ( size_t i = 0; i < props->user_prop_count; i++ )
+  {
+    const mqtt_user_prop_t* up = &props->user_props[i];
+    if ( up->key == NULL || up->value == NULL || strlen( up->key ) > UINT16_MAX || strlen( up->value ) > UINT16_MAX )
+    {
+      return NULL;
+    }
+    size += sizeof( struct mg_mqtt_prop ) + strlen( up->key ) + strlen( up->value );
+  }
+
+  copy = malloc( size );
+  if ( copy == NULL )
+  {
+    return NULL;
+  }
+  copy->expiry_s = props->expiry_s;
+  copy->queued_ms = osal_task_get_time_ms();
+  copy->count = props->user_prop_count;
+  strings = (char*) &copy->user[copy->count];
+  for ( size_t i = 0; i < copy->count; i++ )
+  {
+    size_t key_len = strlen( props->user_props[i].key );
+    size_t value_len = strlen( props->user_props[i].value );
+
+    memcpy( strings, props->user_props[i].key, key_len );
+    memcpy( strings + key_len, props->user_props[i].value, value_len );
+    copy->user[i] = (struct mg_mqtt_prop) {
+      .id = MQTT_PROP_USER_PROPERTY,
+      .key = mg_str_n( strings, key_len ),
+      .val = mg_str_n( strings + key_len, value_len ) };
+    strings += key_len + value_len;
+  }
+  *ok = true;
+  return copy;
+}
+
+bool MqttApp_Publish( const char* topic, const void* payload, size_t len, int qos, mqtt_release_cb_t release, void* ctx )
+{
+  return MqttApp_PublishProps( topic, payload, len, qos, NULL, release, ctx );
+}
+
+bool MqttApp_PublishProps( const char* topic, const void* payload, size_t len, int qos,
+                           const mqtt_publish_props_t* props, mqtt_release_cb_t release, void* ctx )
+{
+  bool ok;
+  mqtt_message_t msg = {
+    .topic = topic,
+    .payload = payload,
+    .len = len,
+    .qos = qos,
+    .release = release,
+    .ctx = ctx };
+
+  if ( mqtt_state.initialized == 0 || topic == NULL || ( payload == NULL && len > 0 ) || qos < 0 || qos > 2 )
+  {
+    return false;
+  }
+
+  msg.props = props_copy( props, &ok );
+  if ( !ok )
+  {
+    return false;
+  }
+
+  if ( osal_queue_send( mqtt_sync.message_queue, &msg, 0 ) != OSAL_SUCCESS )
+  {
+    free( msg.props );
+    hq_metrics_inc( mqtt_metrics.dropped );
+    spill_wake();
+    return false;
+  }
+  spill_wake();
+  return true;
+}
+
+bool MqttApp_SetCompression( const char* filter, size_t min_len )
+{
+  mqtt_compress_rule_t* rule;
+
+  if ( mqtt_state.initialized == 0 || filter == NULL || !MqttTrie_IsValidFilter( filter ) )
+  {
+    return false;
+  }
+
+  osal_mutex_take( mqtt_compress.lock );
+  rule = (mqtt_compress_rule_t*) MqttTrie_Lookup( mqtt_compress.trie, filter );
+  for ( int i = 0; rule == NULL && i < COMPRESS_RULES_MAX; i++ )
+  {
+    if ( !mqtt_compress.rules[i].used && MqttTrie_Insert( mqtt_compress.trie, filter, &mqtt_compress.rules[i] ) )
+    {
+      rule = &mqtt_compress.rules[i];
+      rule->used = true;
+    }
+  }
+  if ( rule != NULL )
+  {
+    rule->min_len = ( min_len > 0 ) ? min_len : CONFIG_MQTT_COMPRESS_MIN;
+  }
+  osal_mutex_give( mqtt_compress.lock );
+  return rule != NULL;
+}
+
+bool MqttApp_ClearCompression( const char* filter )
+{
+  mqtt_compress_rule_t* rule;
+
+  if ( mqtt_state.initialized == 0 || filter == NULL )
   {
     return false;
   }
 
-  mqtt_message_t msg = { 0 };
+  osal_mutex_take( mqtt_compress.lock );
+  rule = (mqtt_compress_rule_t*) MqttTrie_Remove( mqtt_compress.trie, filter );
+  if ( rule != NULL )
+  {
+    rule->used = false;
+  }
+  osal_mutex_give( mqtt_compress.lock );
+  return rule != NULL;
+}
 
-  if ( strlen( topic ) >= sizeof( msg.topic ) )
+bool MqttApp_PostData( const char* topic, const char* message, int qos )
+{
+  if ( mqtt_state.initialized == 0 )
   {
-    printf( "ERROR: Topic too long\n" );
     return false;
   }
-  if ( strlen( message ) >= sizeof( msg.message ) )
+
+  // One allocation for both strings; freed once the message is sent or acked
+  size_t topic_size = strlen( topic ) + 1;
+  size_t message_len = strlen( message );
+  char* block = malloc( topic_size + message_len );
+  if ( block == NULL )
   {
-    printf( "ERROR: Message too long\n" );
+    osal_log_error( MODULE_NAME "Out of memory for %u byte message\n", (unsigned) message_len );
+    hq_metrics_inc( mqtt_metrics.dropped );
     return false;
   }
 
-  strncpy( msg.topic, topic, sizeof( msg.topic ) - 1 );
-  strncpy( msg.message, message, sizeof( msg.message ) - 1 );
-  msg.topic[sizeof( msg.topic ) - 1] = '\0';
-  msg.message[sizeof( msg.message ) - 1] = '\0';
-  msg.qos = qos;
+  memcpy( block, topic, topic_size );
+  memcpy( block + topic_size, message, message_len );
 
-  return xQueueSend( mqtt_sync.message_queue, &msg, 0 ) == pdTRUE;
+  if ( !MqttApp_Publish( block, block + topic_size, message_len, qos, free, block ) )
+  {
+    free( block );
+    return false;
+  }
+  return true;
 }
 
 bool MqttApp_IsConnected( void )
 {
   return mqtt_state.initialized && mqtt_state.connected;
 }
+
+void MqttApp_Reconnect( void )
+{
+  MongooseProcess_Call( reconnect_forced_on_loop, NULL );
+}
+
+static void conn_stats_on_loop( void* arg )
+{
+  mqtt_conn_stats_t* stats = (mqtt_conn_stats_t*) arg;
+
+  stats->state = mqtt_state.conn_state;
+  stats->failures = mqtt_state.failures;
+  stats->retry_delay_ms = ( mqtt_state.conn_state == MQTT_STATE_BACKOFF ) ? mqtt_state.retry_delay_ms : 0;
+  stats->connects = mqtt_state.connects;
+  stats->reconnects = mqtt_state.reconnects;
+  stats->connected_ms = connected_ms_total();
+  memcpy( stats->last_error, mqtt_state.last_error, sizeof( stats->last_error ) );
+}
+
+void MqttApp_GetConnStats( mqtt_conn_stats_t* stats )
+{
+  memset( stats, 0, sizeof( *stats ) );
+  if ( mqtt_state.initialized )
+  {
+    (void) MongooseProcess_CallWait( conn_stats_on_loop, stats );
+  }
+}
@@ -19,16 +19,123 @@
 
 /**
  * @brief   Init mqtt app task.
+ * @return  true - if started, false if already running or out of resources;
+ *          nothing is left allocated on failure
  */
-void MqttApp_Init( void );
+bool MqttApp_Init( void );
 
 /**
  * @brief   Deinit mqtt app task.
  */
 void MqttApp_Deinit( void );
 
+/**
+ * @brief   Called once the MQTT app no longer needs a published buffer.
+ * @param   [in] ctx - Context passed to MqttApp_Publish().
+ */
+typedef void (*mqtt_release_cb_t)(void* ctx);
+
+/**
+ * @brief   Publish a binary payload without copying it into the queue.
+ *
+ *          Only a descriptor is queued. The payload is copied once, straight
+ *          into the connection send buffer on the Mongoose poll task. topic
+ *          and payload must stay valid until release( ctx ) is called: right
+ *          after sending for QoS 0, after the PUBACK (or the final retry) for
+ *          QoS 1, after the PUBREC for QoS 2, or once the message is copied
+ *          to the outbound spool or the persistent session file.
+ *          release runs on the publisher or Mongoose poll task and may be
+ *          NULL.
+ * @note    With the "clean" setting off, publishes still in flight and QoS 2
+ *          receipts are kept in CONFIG_MQTT_SESSION_PATH and resumed by the
+ *          next MqttApp_Init(); subscriptions are then kept by the broker.
+ * @note    While offline, while the QoS 1/2 window stays full long enough for
+ *          the queue to fill up, or while older messages are still spooled,
+ *          messages are written to the spool and replayed in order once the
+ *          session is back.
+ * @note    With the "version" setting at 5, topics published again and again
+ *          go out as two byte topic aliases, up to CONFIG_MQTT_TOPIC_ALIAS_MAX
+ *          per connection and never more than the broker allows.
+ * @note    On a topic set up with MqttApp_SetCompression() the payload is
+ *          compressed into a heap copy on the publisher task and release
+ *          runs as soon as that is done.
+ * @param   [in] topic - MQTT topic to publish to.
+ * @param   [in] payload - Message bytes, any length.
+ * @param   [in] len - Payload length in bytes.
+ * @param   [in] qos - Quality of Service level (0, 1, or 2).
+ * @param   [in] release - Ownership callback, or NULL for static buffers.
+ * @param   [in] ctx - Argument for release.
+ * @return  true - if queued; on false the caller keeps ownership and
+ *          release is not called.
+ */
+bool MqttApp_Publish( const char* topic, const void* payload, size_t len, int qos, mqtt_release_cb_t release, void* ctx );
+
+#define MQTT_USER_PROPS_MAX 8
+
+/**
+ * @brief   MQTT 5 user property, a UTF-8 key/value pair.
+ */
+typedef struct
+{
+  const char* key;
+  const char* value;
+} mqtt_user_prop_t;
+
+/**
+ * @brief   MQTT 5 properties of one publish.
+ */
+typedef struct
+{
+  uint32_t expiry_s;                    /**< Message Expiry Interval in seconds, 0 = never */
+  const mqtt_user_prop_t* user_props;   /**< Sent in this order */
+  size_t user_prop_count;               /**< At most MQTT_USER_PROPS_MAX */
+} mqtt_publish_props_t;
+
+/**
+ * @brief   MqttApp_Publish() with MQTT 5 properties.
+ *
+ *          props is copied before this returns. The expiry interval counts
+ *          from this call: a message that is still queued or waiting for
+ *          the in-flight window when it runs out is dropped
+ *          (hq_mqtt_expired_total); otherwise the broker gets the time
+ *          that is left.
+ * @note    With the "version" setting at 4 the properties are not sent,
+ *          but expired messages are still dropped. Messages that go through
+ *          the spool or the session file lose their properties.
+ * @param   [in] props - Properties, or NULL for none.
+ * @return  true - if queued; false if not, or if props is invalid
+ */
+bool MqttApp_PublishProps( const char* topic, const void* payload, size_t len, int qos,
+                           const mqtt_publish_props_t* props, mqtt_release_cb_t release, void* ctx );
+
+/**
+ * @brief   Compress payloads published on topics matching filter.
+ *
+ *          Payloads of at least min_len bytes are sent as an LZ4 frame (see
+ *          mqtt_compress.h) if that makes them smaller; on MQTT 5 they also
+ *          carry MQTT_COMPRESS_CONTENT_TYPE. Received frames are inflated
+ *          before delivery on every topic, up to CONFIG_MQTT_DECOMPRESS_MAX
+ *          bytes. Calling this again for the same filter changes min_len;
+ *          with several matching filters the smallest min_len applies.
+ * @note    Rules last until MqttApp_Deinit(); at most 8 filters.
+ * @param   [in] filter - MQTT topic filter, wildcards allowed.
+ * @param   [in] min_len - Smallest payload worth compressing, 0 for
+ *          CONFIG_MQTT_COMPRESS_MIN.
+ * @return  true - if the rule is in place
+ */
+bool MqttApp_SetCompression( const char* filter, size_t min_len );
+
+/**
+ * @brief   Stop compressing payloads for a filter given to
+ *          MqttApp_SetCompression().
+ * @return  true - if the filter had a rule
+ */
+bool MqttApp_ClearCompression( const char* filter );
+
 /**
  * @brief   Post data to MQTT topic.
+ * @note    Copies topic and message into one heap block; see MqttApp_Publish()
+ *          to avoid the copy.
  * @param   [in] topic - MQTT topic to publish to.
  * @param   [in] message - Message content to publish.
  * @param   [in] qos - Quality of Service level (0, 1, or 2).
@@ -42,10 +149,42 @@ bool MqttApp_PostData( const char* topic, const char* message, int qos );
  */
 bool MqttApp_IsConnected(void);
 
+/**
+ * @brief   Drop the connection, if any, and connect again right away.
+ * @note    Saved settings reconnect by themselves when they need to.
+ */
+void MqttApp_Reconnect(void);
+
+typedef enum
+{
+  MQTT_STATE_STOPPED = 0,    /**< Not initialized */
+  MQTT_STATE_CONNECTING,     /**< TCP, TLS or CONNECT/CONNACK in progress */
+  MQTT_STATE_CONNECTED,      /**< Session established */
+  MQTT_STATE_BACKOFF,        /**< Waiting for the next connection attempt */
+} mqtt_conn_state_t;
+
+typedef struct
+{
+  mqtt_conn_state_t state;
+  uint32_t failures;         /**< Consecutive failed or short-lived attempts; sets the backoff */
+  uint32_t retry_delay_ms;   /**< Delay chosen for the pending attempt (BACKOFF only) */
+  uint32_t connects;         /**< Sessions established since init */
+  uint32_t reconnects;       /**< Attempts made after a failure or a lost session */
+  uint64_t connected_ms;     /**< Total time connected, current session included */
+  char last_error[64];       /**< Why the last attempt or session ended, "" if none */
+} mqtt_conn_stats_t;
+
+/**
+ * @brief   Get the connection state machine and reconnect counters.
+ * @param   [out] stats - Snapshot; zeroed when the app is not running.
+ */
+void MqttApp_GetConnStats(mqtt_conn_stats_t* stats);
+
 typedef void (*mqtt_message_callback_t)(const char* topic, const char* message, size_t message_len);
 
 /**
  * @brief   Subscribe to MQTT topic with callback and timeout.
+ * @note    A filter has one callback of this kind; subscribing again replaces it.
  * @param   [in] topic - MQTT topic to subscribe to.
  * @param   [in] qos - Quality of Service level (0, 1, or 2).
  * @param   [in] callback - Function to call when message arrives.
@@ -62,4 +201,76 @@ bool MqttApp_Subscribe(const char* topic, int qos, mqtt_message_callback_t callb
  */
 bool MqttApp_Unsubscribe(const char* topic, uint32_t timeout_ms);
 
+/**
+ * @brief   Called for each message whose topic matches the filter.
+ * @param   [in] topic - Topic name, not NUL-terminated.
+ * @param   [in] topic_len - Topic length in bytes.
+ * @param   [in] message - Message content.
+ * @param   [in] message_len - Message length in bytes.
+ * @param   [in] ctx - Context passed to MqttApp_SubscribeCtx().
+ * @note    Runs on the Mongoose poll task.
+ */
+typedef void (*mqtt_subscription_cb_t)(const char* topic, size_t topic_len, const char* message,
+                                       size_t message_len, void* ctx);
+
+/**
+ * @brief   Add a subscriber to a topic filter ('+' and '#' allowed).
+ * @note    Any number of subscribers may share a filter and every matching
+ *          one is called. SUBSCRIBE is only sent for a new filter or a
+ *          higher QoS; repeating callback and ctx is a no-op.
+ * @param   [in] filter - MQTT topic filter.
+ * @param   [in] qos - Quality of Service level (0, 1, or 2).
+ * @param   [in] callback - Function to call when a message arrives.
+ * @param   [in] ctx - Passed to callback.
+ * @param   [in] timeout_ms - Timeout in milliseconds for the SUBACK.
+ * @return  true - if subscribed, otherwise false
+ */
+bool MqttApp_SubscribeCtx(const char* filter, int qos, mqtt_subscription_cb_t callback, void* ctx,
+                          uint32_t timeout_ms);
+
+/**
+ * @brief   Remove one subscriber added by MqttApp_SubscribeCtx().
+ * @note    UNSUBSCRIBE is only sent when the last subscriber of the filter
+ *          goes; MqttApp_Unsubscribe() removes them all.
+ * @param   [in] filter - MQTT topic filter.
+ * @param   [in] callback - Callback given to MqttApp_SubscribeCtx().
+ * @param   [in] ctx - Context given to MqttApp_SubscribeCtx().
+ * @param   [in] timeout_ms - Timeout in milliseconds for the UNSUBACK.
+ * @return  true - if unsubscribed, otherwise false
+ */
+bool MqttApp_UnsubscribeCtx(const char* filter, mqtt_subscription_cb_t callback, void* ctx,
+                            uint32_t timeout_ms);
+
+/**
+ * @brief   Completion of an asynchronous subscribe or unsubscribe.
+ * @param   [in] success - true if acknowledged by the broker (or nothing
+ *          had to be sent), false on refusal, timeout or disconnect.
+ * @param   [in] ctx - Context passed with the request.
+ * @note    Runs on the Mongoose poll task.
+ */
+typedef void (*mqtt_done_cb_t)(bool success, void* ctx);
+
+/**
+ * @brief   MqttApp_SubscribeCtx() without waiting for the SUBACK.
+ * @note    Any number of requests may be in flight; each SUBSCRIBE is
+ *          tracked by its packet id. Safe to call from the poll task.
+ * @param   [in] done - Called once with the result, possibly before this
+ *          returns; may be NULL.
+ * @param   [in] done_ctx - Passed to done.
+ * @return  true - if the request was accepted and done will be called,
+ *          otherwise false
+ */
+bool MqttApp_SubscribeAsync(const char* filter, int qos, mqtt_subscription_cb_t callback, void* ctx,
+                            mqtt_done_cb_t done, void* done_ctx);
+
+/**
+ * @brief   MqttApp_UnsubscribeCtx() without waiting for the UNSUBACK.
+ * @note    A NULL callback removes every subscriber of the filter, like
+ *          MqttApp_Unsubscribe(). The subscribers stop being called at once.
+ * @return  true - if the request was accepted and done will be called,
+ *          otherwise false
+ */
+bool MqttApp_UnsubscribeAsync(const char* filter, mqtt_subscription_cb_t callback, void* ctx,
+                              mqtt_done_cb_t done, void* done_ctx);
+
 #endif
\ No newline at end of file
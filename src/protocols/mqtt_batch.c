@@ -0,0 +1,425 @@
+#include "mqtt_batch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hq_metrics.h"
+#include "mqtt_app.h"
+#include "osal_log.h"
+#include "osal_mutex.h"
+#include "osal_task.h"
+#include "osal_timer.h"
+
+#define MODULE_NAME "[MQTT batch] "
+
+#ifndef CONFIG_MQTT_BATCH_MAX_TOPICS
+#define CONFIG_MQTT_BATCH_MAX_TOPICS 8
+#endif
+
+#ifndef CONFIG_MQTT_BATCH_MAX_BYTES
+#define CONFIG_MQTT_BATCH_MAX_BYTES 1024
+#endif
+
+#ifndef CONFIG_MQTT_BATCH_MAX_AGE_MS
+#define CONFIG_MQTT_BATCH_MAX_AGE_MS 1000
+#endif
+
+#define VARINT_MAX_BYTES    10
+#define TICK_MIN_MS         10
+#define MIN_BATCH_BYTES     ( 1 + 2 * VARINT_MAX_BYTES )
+
+typedef enum
+{
+  FLUSH_EXPLICIT,
+  FLUSH_SIZE,
+  FLUSH_AGE
+} flush_reason_t;
+
+// One open batch. block holds the topic followed by the payload and is
+// handed to MqttApp_Publish() as a whole, which frees the slot.
+typedef struct
+{
+  char* block;
+  uint8_t* data;
+  uint32_t len;
+  uint32_t count;
+  int qos;
+  uint8_t format;
+  uint32_t opened_ms;
+  uint32_t last_ms;
+  int64_t last_value;
+} batch_slot_t;
+
+typedef struct
+{
+  hq_metric_t* messages;
+  hq_metric_t* packets;
+  hq_metric_t* dropped;
+  hq_metric_t* per_packet;
+} batch_metrics_t;
+
+typedef struct
+{
+  bool initialized;
+  mqtt_batch_config_t config;
+  batch_slot_t slots[CONFIG_MQTT_BATCH_MAX_TOPICS];
+  mqtt_batch_stats_t stats;
+  osal_timer_id_t timer;
+} batch_state_t;
+
+static batch_state_t batch = { 0 };
+static batch_metrics_t batch_metrics = { 0 };
+static osal_mutex_id_t batch_lock;
+static bool batch_lock_created = false;
+
+// Encoding
+static size_t varint_put( uint8_t* out, uint64_t value )
+{
+  size_t n = 0;
+
+  do
+  {
+    uint8_t byte = (uint8_t) ( value & 0x7F );
+    value >>= 7;
+    out[n++] = byte | ( value ? 0x80 : 0 );
+  } while ( value );
+  return n;
+}
+
+// Maps the difference of two samples to small unsigned numbers: 0, -1, 1,
+// -2 ... become 0, 1, 2, 3 ... Unsigned arithmetic, so any two int64_t
+// values give a defined, wrapping delta.
+static uint64_t zigzag_delta( int64_t value, int64_t last )
+{
+  uint64_t delta = (uint64_t) value - (uint64_t) last;
+
+  return ( delta << 1 ) ^ ( 0U - ( delta >> 63 ) );
+}
+
+// Slots (batch_lock held)
+static batch_slot_t* slot_find( const char* topic )
+{
+  for ( int i = 0; i < CONFIG_MQTT_BATCH_MAX_TOPICS; i++ )
+  {
+    if ( batch.slots[i].block != NULL && strcmp( batch.slots[i].block, topic ) == 0 )
+    {
+      return &batch.slots[i];
+    }
+  }
+  return NULL;
+}
+
+static batch_slot_t* slot_open( const char* topic, uint8_t format, int qos )
+{
+  size_t topic_size = strlen( topic ) + 1;
+
+  for ( int i = 0; i < CONFIG_MQTT_BATCH_MAX_TOPICS; i++ )
+  {
+    batch_slot_t* slot = &batch.slots[i];
+    if ( slot->block != NULL )
+    {
+      continue;
+    }
+
+    slot->block = malloc( topic_size + batch.config.max_bytes );
+    if ( slot->block == NULL )
+    {
+      return NULL;
+    }
+    memcpy( slot->block, topic, topic_size );
+    slot->data = (uint8_t*) slot->block + topic_size;
+    slot->data[0] = format;
+    slot->len = 1;
+    slot->count = 0;
+    slot->qos = qos;
+    slot->format = format;
+    slot->opened_ms = osal_task_get_time_ms();
+    slot->last_ms = slot->opened_ms;
+    slot->last_value = 0;
+    return slot;
+  }
+  return NULL;
+}
+
+static bool slot_flush( batch_slot_t* slot, flush_reason_t reason )
+{
+  bool queued;
+
+  if ( slot->block == NULL )
+  {
+    return true;
+  }
+
+  // On success the block belongs to the MQTT app until it is sent
+  queued = MqttApp_Publish( slot->block, slot->data, slot->len, slot->qos, free, slot->block );
+  if ( queued )
+  {
+    batch.stats.packets++;
+    batch.stats.bytes_out += slot->len;
+    if ( reason == FLUSH_SIZE )
+    {
+      batch.stats.flush_size++;
+    }
+    else if ( reason == FLUSH_AGE )
+    {
+      batch.stats.flush_age++;
+    }
+    hq_metrics_inc( batch_metrics.packets );
+    hq_metrics_observe( batch_metrics.per_packet, slot->count );
+  }
+  else
+  {
+    osal_log_warning( MODULE_NAME "Batch of %u messages for %s not queued\n", (unsigned) slot->count, slot->block );
+    batch.stats.dropped += slot->count;
+    hq_metrics_add( batch_metrics.dropped, slot->count );
+    free( slot->block );
+  }
+
+  memset( slot, 0, sizeof( *slot ) );
+  return queued;
+}
+
+// Find or open the batch for topic with room for need more bytes
+static batch_slot_t* slot_reserve( const char* topic, uint8_t format, int qos, size_t need )
+{
+  batch_slot_t* slot = slot_find( topic );
+
+  if ( slot != NULL && ( slot->format != format || slot->qos != qos ) )
+  {
+    slot_flush( slot, FLUSH_EXPLICIT );
+    slot = NULL;
+  }
+  if ( slot != NULL && slot->len + need > batch.config.max_bytes )
+  {
+    slot_flush( slot, FLUSH_SIZE );
+    slot = NULL;
+  }
+  return ( slot != NULL ) ? slot : slot_open( topic, format, qos );
+}
+
+static void slot_added( batch_slot_t* slot, size_t bytes_in )
+{
+  slot->count++;
+  batch.stats.messages++;
+  batch.stats.bytes_in += bytes_in;
+  hq_metrics_inc( batch_metrics.messages );
+
+  // Nothing more fits; don't hold a full batch until the next post
+  if ( slot->len + 2 > batch.config.max_bytes )
+  {
+    slot_flush( slot, FLUSH_SIZE );
+  }
+}
+
+// Age limit; runs on the timer service task. MqttApp_Publish() never
+// blocks, so flushing from here is safe.
+static void batch_timer_callback( osal_timer_id_t timer )
+{
+  uint32_t now = osal_task_get_time_ms();
+
+  (void) timer;
+  osal_mutex_take( batch_lock );
+  for ( int i = 0; i < CONFIG_MQTT_BATCH_MAX_TOPICS && batch.initialized; i++ )
+  {
+    batch_slot_t* slot = &batch.slots[i];
+    if ( slot->block != NULL && now - slot->opened_ms >= batch.config.max_age_ms )
+    {
+      slot_flush( slot, FLUSH_AGE );
+    }
+  }
+  osal_mutex_give( batch_lock );
+}
+
+static void metrics_register( void )
+{
+  static const uint64_t per_packet_bounds[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500 };
+
+  batch_metrics.messages = hq_metrics_counter( "hq_mqtt_batch_messages_total", NULL, "Messages added to MQTT batches" );
+  batch_metrics.packets = hq_metrics_counter( "hq_mqtt_batch_packets_total", NULL, "MQTT batches published" );
+  batch_metrics.dropped = hq_metrics_counter( "hq_mqtt_batch_dropped_total", NULL, "Batched messages that were not queued" );
+  batch_metrics.per_packet = hq_metrics_histogram( "hq_mqtt_batch_messages_per_packet", NULL, "Messages framed into one PUBLISH",
+                                                   per_packet_bounds, sizeof( per_packet_bounds ) / sizeof( per_packet_bounds[0] ) );
+}
+
+// Public API functions
+bool MqttBatch_Init( const mqtt_batch_config_t* config )
+{
+  mqtt_batch_config_t cfg = {
+    .max_bytes = CONFIG_MQTT_BATCH_MAX_BYTES,
+    .max_age_ms = CONFIG_MQTT_BATCH_MAX_AGE_MS };
+  uint32_t tick_ms;
+
+  if ( batch.initialized )
+  {
+    return false;
+  }
+  if ( config != NULL )
+  {
+    cfg = *config;
+  }
+  if ( cfg.max_bytes < MIN_BATCH_BYTES || cfg.max_age_ms == 0 )
+  {
+    osal_log_error( MODULE_NAME "Invalid limits: %u bytes, %u ms\n", (unsigned) cfg.max_bytes, (unsigned) cfg.max_age_ms );
+    return false;
+  }
+
+  if ( !batch_lock_created )
+  {
+    if ( osal_mutex_create( &batch_lock, "mqtt_batch" ) != OSAL_SUCCESS )
+    {
+      return false;
+    }
+    batch_lock_created = true;
+  }
+
+  metrics_register();
+
+  // Check a few times per age limit so batches leave close to on time
+  tick_ms = cfg.max_age_ms / 4;
+  if ( tick_ms < TICK_MIN_MS )
+  {
+    tick_ms = TICK_MIN_MS;
+  }
+  if ( osal_timer_create( &batch.timer, "mqtt_batch", tick_ms, true, batch_timer_callback, NULL, NULL, 0 ) != OSAL_SUCCESS )
+  {
+    return false;
+  }
+
+  osal_mutex_take( batch_lock );
+  memset( batch.slots, 0, sizeof( batch.slots ) );
+  memset( &batch.stats, 0, sizeof( batch.stats ) );
+  batch.config = cfg;
+  batch.initialized = true;
+  osal_mutex_give( batch_lock );
+
+  osal_timer_start( batch.timer, 0 );
+  return true;
+}
+
+void MqttBatch_Deinit( void )
+{
+  if ( !batch.initialized )
+  {
+    return;
+  }
+
+  // The timer callback takes batch_lock, so delete it before locking
+  osal_timer_delete( batch.timer, 0 );
+
+  osal_mutex_take( batch_lock );
+  for ( int i = 0; i < CONFIG_MQTT_BATCH_MAX_TOPICS; i++ )
+  {
+    slot_flush( &batch.slots[i], FLUSH_EXPLICIT );
+  }
+  batch.initialized = false;
+  osal_mutex_give( batch_lock );
+}
+
+bool MqttBatch_Post( const char* topic, const char* message, int qos )
+{
+  size_t len;
+  uint8_t prefix[VARINT_MAX_BYTES];
+  size_t prefix_len;
+  batch_slot_t* slot;
+
+  if ( !batch.initialized || topic == NULL || message == NULL )
+  {
+    return false;
+  }
+
+  len = strlen( message );
+  prefix_len = varint_put( prefix, len );
+
+  osal_mutex_take( batch_lock );
+  slot = ( 1 + prefix_len + len <= batch.config.max_bytes )
+           ? slot_reserve( topic, MQTT_BATCH_FORMAT_TEXT, qos, prefix_len + len )
+           : NULL;
+  if ( slot == NULL )
+  {
+    // Too large for a batch, or every slot is busy: send it on its own
+    batch.stats.unbatched++;
+    osal_mutex_give( batch_lock );
+    return MqttApp_PostData( topic, message, qos );
+  }
+
+  memcpy( slot->data + slot->len, prefix, prefix_len );
+  memcpy( slot->data + slot->len + prefix_len, message, len );
+  slot->len += (uint32_t) ( prefix_len + len );
+  slot_added( slot, len );
+  osal_mutex_give( batch_lock );
+  return true;
+}
+
+bool MqttBatch_PostValue( const char* topic, int64_t value, int qos )
+{
+  uint8_t sample[2 * VARINT_MAX_BYTES];
+  uint32_t now = osal_task_get_time_ms();
+  batch_slot_t* slot;
+  size_t n;
+
+  if ( !batch.initialized || topic == NULL )
+  {
+    return false;
+  }
+
+  osal_mutex_take( batch_lock );
+  slot = slot_reserve( topic, MQTT_BATCH_FORMAT_SERIES, qos, sizeof( sample ) );
+  if ( slot == NULL )
+  {
+    // A series cannot be posted on its own, the receiver expects frames
+    batch.stats.dropped++;
+    hq_metrics_inc( batch_metrics.dropped );
+    osal_mutex_give( batch_lock );
+    return false;
+  }
+
+  n = varint_put( sample, ( slot->count > 0 ) ? now - slot->last_ms : 0 );
+  n += varint_put( sample + n, zigzag_delta( value, slot->last_value ) );
+  memcpy( slot->data + slot->len, sample, n );
+  slot->len += (uint32_t) n;
+  slot->last_ms = now;
+  slot->last_value = value;
+  slot_added( slot, sizeof( value ) );
+  osal_mutex_give( batch_lock );
+  return true;
+}
+
+bool MqttBatch_Flush( const char* topic )
+{
+  bool result = true;
+
+  if ( !batch.initialized )
+  {
+    return false;
+  }
+
+  osal_mutex_take( batch_lock );
+  for ( int i = 0; i < CONFIG_MQTT_BATCH_MAX_TOPICS; i++ )
+  {
+    batch_slot_t* slot = &batch.slots[i];
+    if ( slot->block != NULL && ( topic == NULL || strcmp( slot->block, topic ) == 0 ) )
+    {
+      result &= slot_flush( slot, FLUSH_EXPLICIT );
+    }
+  }
+  osal_mutex_give( batch_lock );
+  return result;
+}
+
+void MqttBatch_GetStats( mqtt_batch_stats_t* stats )
+{
+  if ( stats == NULL )
+  {
+    return;
+  }
+
+  if ( !batch_lock_created )
+  {
+    memset( stats, 0, sizeof( *stats ) );
+    return;
+  }
+
+  osal_mutex_take( batch_lock );
+  *stats = batch.stats;
+  osal_mutex_give( batch_lock );
+}
@@ -0,0 +1,99 @@
+/**
+ *******************************************************************************
+ * @file    mqtt_batch.h
+ * @brief   Telemetry batching on top of the MQTT application layer
+ *******************************************************************************
+ *
+ * Small messages posted to the same topic are collected into one buffer and
+ * published as a single framed payload once the buffer is full or its
+ * oldest message reaches the age limit. Integers LEB128, signed values
+ * zigzag-encoded:
+ *
+ *   text batch    0x01 { length, bytes }...
+ *   series batch  0x02 { dt_ms, value - previous }...
+ *
+ * In a series the first sample has dt_ms 0 and is stored as a delta from 0,
+ * later samples carry the milliseconds since the previous one.
+ */
+
+/* Define to prevent recursive inclusion ------------------------------------*/
+
+#ifndef _MQTT_BATCH_H
+#define _MQTT_BATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MQTT_BATCH_FORMAT_TEXT   0x01
+#define MQTT_BATCH_FORMAT_SERIES 0x02
+
+/* Public types --------------------------------------------------------------*/
+
+typedef struct
+{
+  uint32_t max_bytes;     /**< Payload size that triggers a flush */
+  uint32_t max_age_ms;    /**< Age of the oldest message that triggers a flush */
+} mqtt_batch_config_t;
+
+typedef struct
+{
+  uint64_t messages;      /**< Messages added to a batch */
+  uint64_t packets;       /**< Batches handed to MqttApp_Publish() */
+  uint64_t bytes_in;      /**< Message bytes (or 8 per sample) before framing */
+  uint64_t bytes_out;     /**< Framed payload bytes published */
+  uint64_t flush_size;    /**< Batches flushed because they were full */
+  uint64_t flush_age;     /**< Batches flushed by the age limit */
+  uint64_t unbatched;     /**< Messages posted directly (too large, no slot) */
+  uint64_t dropped;       /**< Messages lost because a batch was not queued */
+} mqtt_batch_stats_t;
+
+/* Public functions ----------------------------------------------------------*/
+
+/**
+ * @brief   Start batching.
+ * @param   [in] config - Limits, or NULL for the CONFIG_MQTT_BATCH_* defaults.
+ * @return  true - if started, otherwise false
+ */
+bool MqttBatch_Init( const mqtt_batch_config_t* config );
+
+/**
+ * @brief   Flush every open batch and stop batching.
+ * @note    Call before MqttApp_Deinit() so the last batches are queued.
+ */
+void MqttBatch_Deinit( void );
+
+/**
+ * @brief   Add a text message to the batch for topic.
+ * @param   [in] topic - MQTT topic of the batch.
+ * @param   [in] message - Message content, copied into the batch.
+ * @param   [in] qos - QoS the batch is published with; a different QoS
+ *          flushes the open batch first.
+ * @return  true - if batched or queued, otherwise false
+ */
+bool MqttBatch_Post( const char* topic, const char* message, int qos );
+
+/**
+ * @brief   Add one sample to the delta-encoded series for topic.
+ * @param   [in] topic - MQTT topic of the series.
+ * @param   [in] value - Sample value.
+ * @param   [in] qos - QoS the batch is published with.
+ * @return  true - if batched, otherwise false
+ */
+bool MqttBatch_PostValue( const char* topic, int64_t value, int qos );
+
+/**
+ * @brief   Publish the open batch for topic now.
+ * @param   [in] topic - MQTT topic, or NULL for every open batch.
+ * @return  true - if nothing was lost, otherwise false
+ */
+bool MqttBatch_Flush( const char* topic );
+
+/**
+ * @brief   Get batching counters; messages / packets is the average number
+ *          of messages per PUBLISH.
+ * @param   [out] stats - Snapshot of the counters.
+ */
+void MqttBatch_GetStats( mqtt_batch_stats_t* stats );
+
+#endif
@@ -0,0 +1,274 @@
+#include "mqtt_compress.h"
+
+#include <string.h>
+
+#define MAGIC_LEN       3
+#define MIN_MATCH       4
+#define LAST_LITERALS   5     // LZ4: the block ends with at least 5 literals
+#define MATCH_LIMIT     12    // LZ4: no match starts in the last 12 bytes
+#define MAX_OFFSET      65535U
+
+static const uint8_t magic[MAGIC_LEN] = { 0x00, 'H', 'Z' };
+
+// Helpers
+static uint32_t read32( const uint8_t* p )
+{
+  uint32_t v;
+
+  memcpy( &v, p, sizeof( v ) );
+  return v;
+}
+
+static uint32_t hash4( uint32_t v )
+{
+  return ( v * 2654435761U ) >> ( 32 - MQTT_COMPRESS_HASH_BITS );
+}
+
+// Length beyond the 15 that fit in the token: runs of 255, then the rest
+static uint8_t* put_length( uint8_t* op, size_t len )
+{
+  for ( ; len >= 255; len -= 255 )
+  {
+    *op++ = 255;
+  }
+  *op++ = (uint8_t) len;
+  return op;
+}
+
+static bool get_length( const uint8_t** ip, const uint8_t* end, size_t* len )
+{
+  uint8_t b;
+
+  do
+  {
+    if ( *ip >= end )
+    {
+      return false;
+    }
+    b = *( *ip )++;
+    *len += b;
+  } while ( b == 255 );
+  return true;
+}
+
+// One sequence: literals, then a match unless match_len is 0 (the last
+// sequence). NULL if it does not fit before end.
+static uint8_t* put_sequence( uint8_t* op, const uint8_t* end, const uint8_t* lit, size_t lit_len, size_t offset,
+                              size_t match_len )
+{
+  size_t extra = match_len ? match_len - MIN_MATCH : 0;
+  size_t need = 1 + lit_len + lit_len / 255 + 1 + ( match_len ? 2 + extra / 255 + 1 : 0 );
+  uint8_t* token = op++;
+
+  if ( need > (size_t) ( end - token ) )
+  {
+    return NULL;
+  }
+
+  *token = (uint8_t) ( ( ( lit_len < 15 ) ? lit_len : 15 ) << 4 );
+  if ( lit_len >= 15 )
+  {
+    op = put_length( op, lit_len - 15 );
+  }
+  memcpy( op, lit, lit_len );
+  op += lit_len;
+
+  if ( match_len )
+  {
+    *token |= (uint8_t) ( ( extra < 15 ) ? extra : 15 );
+    *op++ = (uint8_t) ( offset & 0xFF );
+    *op++ = (uint8_t) ( offset >> 8 );
+    if ( extra >= 15 )
+    {
+      op = put_length( op, extra - 15 );
+    }
+  }
+  return op;
+}
+
+static size_t block_encode( const uint8_t* in, size_t len, uint8_t* out, size_t out_size, uint32_t* table )
+{
+  const uint8_t* ip = in;
+  const uint8_t* anchor = in;
+  const uint8_t* end = in + len;
+  const uint8_t* match_limit = ( len > MATCH_LIMIT ) ? end - LAST_LITERALS : end;
+  uint8_t* op = out;
+  uint8_t* out_end = out + out_size;
+
+  memset( table, 0, MQTT_COMPRESS_WORK_SIZE );
+
+  while ( len > MATCH_LIMIT && ip < end - MATCH_LIMIT )
+  {
+    uint32_t seq = read32( ip );
+    uint32_t h = hash4( seq );
+    const uint8_t* ref = in + table[h];
+
+    table[h] = (uint32_t) ( ip - in );
+    if ( ref >= ip || (size_t) ( ip - ref ) > MAX_OFFSET || read32( ref ) != seq )
+    {
+      ip++;
+      continue;
+    }
+
+    while ( ip > anchor && ref > in && ip[-1] == ref[-1] )
+    {
+      ip--;
+      ref--;
+    }
+    const uint8_t* mp = ip + MIN_MATCH;
+    const uint8_t* mr = ref + MIN_MATCH;
+    while ( mp < match_limit && *mp == *mr )
+    {
+      mp++;
+      mr++;
+    }
+
+    op = put_sequence( op, out_end, anchor, (size_t) ( ip - anchor ), (size_t) ( ip - ref ), (size_t) ( mp - ip ) );
+    if ( op == NULL )
+    {
+      return 0;
+    }
+    ip = anchor = mp;
+    if ( ip < end - MATCH_LIMIT )
+    {
+      table[hash4( read32( ip - 2 ) )] = (uint32_t) ( ip - 2 - in );
+    }
+  }
+
+  op = put_sequence( op, out_end, anchor, (size_t) ( end - anchor ), 0, 0 );
+  return ( op != NULL ) ? (size_t) ( op - out ) : 0;
+}
+
+// Public functions
+size_t MqttCompress_Bound( size_t len )
+{
+  return MAGIC_LEN + 5 + 1 + len + len / 255 + 1;
+}
+
+size_t MqttCompress_Encode( const void* in, size_t len, void* out, size_t out_size, void* work )
+{
+  uint8_t* op = (uint8_t*) out;
+  size_t header = MAGIC_LEN;
+  size_t block;
+
+  if ( len > UINT32_MAX || out_size < MAGIC_LEN + 5 )
+  {
+    return 0;
+  }
+
+  memcpy( op, magic, MAGIC_LEN );
+  for ( size_t v = len; ; v >>= 7 )
+  {
+    op[header++] = (uint8_t) ( ( v & 0x7F ) | ( ( v >= 0x80 ) ? 0x80 : 0 ) );
+    if ( v < 0x80 )
+    {
+      break;
+    }
+  }
+
+  block = block_encode( (const uint8_t*) in, len, op + header, out_size - header, (uint32_t*) work );
+  return ( block != 0 ) ? header + block : 0;
+}
+
+bool MqttCompress_Peek( const void* data, size_t len, size_t* raw_len )
+{
+  const uint8_t* p = (const uint8_t*) data;
+  const uint8_t* end = p + len;
+  uint32_t value = 0;
+
+  if ( len < MAGIC_LEN + 2 || memcmp( p, magic, MAGIC_LEN ) != 0 )
+  {
+    return false;
+  }
+  p += MAGIC_LEN;
+  for ( uint32_t shift = 0; p < end && shift < 32; shift += 7 )
+  {
+    uint8_t b = *p++;
+    value |= (uint32_t) ( b & 0x7F ) << shift;
+    if ( ( b & 0x80 ) == 0 )
+    {
+      if ( raw_len != NULL )
+      {
+        *raw_len = value;
+      }
+      return p < end;
+    }
+  }
+  return false;
+}
+
+bool MqttCompress_Decode( const void* frame, size_t len, void* out, size_t raw_len )
+{
+  const uint8_t* ip = (const uint8_t*) frame + MAGIC_LEN;
+  const uint8_t* end = (const uint8_t*) frame + len;
+  uint8_t* op = (uint8_t*) out;
+  uint8_t* out_end = op + raw_len;
+  size_t header_len;
+
+  if ( !MqttCompress_Peek( frame, len, &header_len ) || header_len != raw_len )
+  {
+    return false;
+  }
+  while ( *ip & 0x80 )
+  {
+    ip++;
+  }
+  ip++;
+
+  while ( ip < end )
+  {
+    uint8_t token = *ip++;
+    size_t lit_len = token >> 4;
+    size_t match_len = token & 0x0F;
+    size_t offset;
+
+    if ( lit_len == 15 && !get_length( &ip, end, &lit_len ) )
+    {
+      return false;
+    }
+    if ( lit_len > (size_t) ( end - ip ) || lit_len > (size_t) ( out_end - op ) )
+    {
+      return false;
+    }
+    memcpy( op, ip, lit_len );
+    ip += lit_len;
+    op += lit_len;
+    if ( ip == end )
+    {
+      break;
+    }
+
+    if ( end - ip < 2 )
+    {
+      return false;
+    }
+    offset = (size_t) ip[0] | ( (size_t) ip[1] << 8 );
+    ip += 2;
+    if ( match_len == 15 && !get_length( &ip, end, &match_len ) )
+    {
+      return false;
+    }
+    match_len += MIN_MATCH;
+    if ( offset == 0 || offset > (size_t) ( op - (uint8_t*) out ) || match_len > (size_t) ( out_end - op ) )
+    {
+      return false;
+    }
+
+    // Matches may overlap their own output, so copy forwards byte by byte
+    // unless they are far enough back
+    const uint8_t* ref = op - offset;
+    if ( offset >= match_len )
+    {
+      memcpy( op, ref, match_len );
+      op += match_len;
+    }
+    else
+    {
+      while ( match_len-- > 0 )
+      {
+        *op++ = *ref++;
+      }
+    }
+  }
+  return op == out_end;
+}
@@ -0,0 +1,66 @@
+/**
+ *******************************************************************************
+ * @file    mqtt_compress.h
+ * @brief   LZ payload compression for MQTT messages
+ *******************************************************************************
+ *
+ * A compressed payload is a small frame around an LZ4 block, so the server
+ * side can inflate it with any stock LZ4 block decoder:
+ *
+ *   0x00 'H' 'Z' { raw length LEB128 } LZ4 block
+ *
+ * The leading zero byte keeps the marker apart from text, JSON and the
+ * mqtt_batch frames. MQTT 5 publishes also carry MQTT_COMPRESS_CONTENT_TYPE.
+ *
+ * The encoder is a greedy single pass with a hash table of the last
+ * position of each four byte sequence; it favours speed over ratio.
+ */
+
+/* Define to prevent recursive inclusion ------------------------------------*/
+
+#ifndef _MQTT_COMPRESS_H
+#define _MQTT_COMPRESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MQTT_COMPRESS_CONTENT_TYPE "application/x-hq-lz4"
+
+#define MQTT_COMPRESS_HASH_BITS 11
+#define MQTT_COMPRESS_WORK_SIZE ( sizeof( uint32_t ) << MQTT_COMPRESS_HASH_BITS )
+
+/* Public functions ----------------------------------------------------------*/
+
+/**
+ * @brief   Largest frame MqttCompress_Encode() can produce for len bytes.
+ */
+size_t MqttCompress_Bound( size_t len );
+
+/**
+ * @brief   Compress a payload into a frame.
+ * @param   [in] out_size - Space at out; the encoder gives up as soon as the
+ *          frame would not fit, so pass len - 1 to only keep frames that
+ *          are smaller than the payload.
+ * @param   [in] work - MQTT_COMPRESS_WORK_SIZE bytes of scratch memory,
+ *          suitably aligned for uint32_t.
+ * @return  Frame length, 0 if it does not fit or len is above UINT32_MAX
+ */
+size_t MqttCompress_Encode( const void* in, size_t len, void* out, size_t out_size, void* work );
+
+/**
+ * @brief   Check for the frame marker and read the raw length.
+ * @param   [out] raw_len - Length after decoding, may be NULL.
+ * @return  true - if data starts like a frame
+ */
+bool MqttCompress_Peek( const void* data, size_t len, size_t* raw_len );
+
+/**
+ * @brief   Inflate a frame.
+ * @param   [in] raw_len - Length returned by MqttCompress_Peek(); out must
+ *          hold that many bytes.
+ * @return  true - if the frame decoded to exactly raw_len bytes
+ */
+bool MqttCompress_Decode( const void* frame, size_t len, void* out, size_t raw_len );
+
+#endif
@@ -1,6 +1,6 @@
 /**
  *******************************************************************************
- * @file    mqtt.c
+ * @file    mqtt_config.c
  * @author  Dmytro Shevchenko
  * @brief   MQTT source file
  *******************************************************************************
@@ -9,20 +9,22 @@
 /* Includes ------------------------------------------------------------------*/
 #include "mqtt_config.h"
 
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include <sys/stat.h>
-#include <sys/unistd.h>
 
-#include "esp_err.h"
-#include "esp_spiffs.h"
-#include "nvs.h"
-#include "nvs_flash.h"
+#include "osal_file.h"
+#include "osal_log.h"
 
 /* Private macros ------------------------------------------------------------*/
 
-#define PARTITION_NAME    "dev_config"
-#define STORAGE_NAMESPACE "mqtt_config"
-#define MQTT_CERT_FILE    "/spiffs/mqtt.pem"
+#define MODULE_NAME "[MQTT config] "
+
+// One "name=value" line per setting
+#define CONFIG_FILE_MAX ( MQTT_CONFIG_VALUE_LAST * ( MQTT_CONFIG_STR_SIZE + 16 ) )
+
 
 /* Private types -------------------------------------------------------------*/
 
@@ -46,24 +48,40 @@ typedef struct
 {
   char address[MQTT_CONFIG_STR_SIZE];
   char config_topic[MQTT_CONFIG_STR_SIZE];
-  char control_topic[MQTT_CONFIG_STR_SIZE];
+  char client_id[MQTT_CONFIG_STR_SIZE];
   char post_data_topic[MQTT_CONFIG_STR_SIZE];
   char username[MQTT_CONFIG_STR_SIZE];
   char password[MQTT_CONFIG_STR_SIZE];
-  char cert[MQTT_CERT_MAX_SIZE];
   uint8_t use_ssl;
+  int32_t inflight;
+  uint8_t clean;
+  int32_t version;
 } config_data_t;
 
 static mqtt_apply_config_cb apply_config_callback = NULL;
 
 /* Private variables ---------------------------------------------------------*/
 static config_data_t config_data;
+static bool config_loaded = false;
+
+// The certificate is only read from its file when a TLS connection asks for
+// it; NULL until then.
+static char* config_cert = NULL;
+
+// Settings as of the last save: only what differs from them is applied,
+// so a value set and set back again changes nothing
+static config_data_t saved_data;
+static bool file_stale = false;
+static bool cert_unsaved = false;
+static bool cert_unapplied = false;
 
 #define _default_address       "mqtt://192.168.1.169:1883"
 #define _default_config_topic  "/config/"
-#define _default_control_topic "/control/"
 #define _default_post_topic    "/post_data/"
 static uint8_t default_tls = false;
+static int32_t default_inflight = CONFIG_MQTT_INFLIGHT_MAX;
+static uint8_t default_clean = true;
+static int32_t default_version = CONFIG_MQTT_PROTOCOL_VERSION;
 
 static value_t config_values[MQTT_CONFIG_VALUE_LAST] =
   {
@@ -73,152 +91,253 @@ static value_t config_values[MQTT_CONFIG_VALUE_LAST] =
     [MQTT_CONFIG_VALUE_POST_DATA_TOPIC] = {.name = "post",      .type = VALUE_TYPE_STRING, .value = (void*) &config_data.post_data_topic, .default_value = (void*) _default_post_topic},
     [MQTT_CONFIG_VALUE_USERNAME] = {.name = "user",      .type = VALUE_TYPE_STRING, .value = (void*) &config_data.username,        .default_value = (void*) ""                 },
     [MQTT_CONFIG_VALUE_PASSWORD] = {.name = "pass",      .type = VALUE_TYPE_STRING, .value = (void*) &config_data.password,        .default_value = (void*) ""                 },
-    [MQTT_CONFIG_VALUE_CLIENT_ID] = {.name = "client_id", .type = VALUE_TYPE_STRING, .value = (void*) &config_data.control_topic,   .default_value = (void*) ""                 },
-    [MQTT_CONFIG_VALUE_CERT] = {.name = "cert",      .type = VALUE_TYPE_CERT,   .value = (void*) &config_data.cert,            .default_value = (void*) ""                 },
+    [MQTT_CONFIG_VALUE_CLIENT_ID] = {.name = "client_id", .type = VALUE_TYPE_STRING, .value = (void*) &config_data.client_id,       .default_value = (void*) ""                 },
+    [MQTT_CONFIG_VALUE_CERT] = {.name = "cert",      .type = VALUE_TYPE_CERT,   .value = NULL,                                 .default_value = (void*) ""                 },
+    [MQTT_CONFIG_VALUE_INFLIGHT] = {.name = "inflight",  .type = VALUE_TYPE_INT,    .value = (void*) &config_data.inflight,        .default_value = (void*) &default_inflight  },
+    [MQTT_CONFIG_VALUE_CLEAN] = {.name = "clean",     .type = VALUE_TYPE_BOOL,   .value = (void*) &config_data.clean,           .default_value = (void*) &default_clean     },
+    [MQTT_CONFIG_VALUE_VERSION] = {.name = "version",   .type = VALUE_TYPE_INT,    .value = (void*) &config_data.version,         .default_value = (void*) &default_version   },
 };
 
-static bool _read_data( void )
+// File backend over the OSAL filesystem. Both files are written to
+// "<path>.tmp" and renamed, so a cut-short write keeps the previous copy.
+static bool _write_file( const char* path, const void* data, size_t len )
 {
-  nvs_handle_t my_handle;
-  esp_err_t err;
+  char tmp[OSAL_MAX_PATH_LEN];
+  bool ok;
+
+  if ( snprintf( tmp, sizeof( tmp ), "%s.tmp", path ) >= (int) sizeof( tmp ) )
+  {
+    return false;
+  }
+  osal_file_id_t fd = osal_open_create( tmp, OSAL_FILE_FLAG_CREATE | OSAL_FILE_FLAG_TRUNCATE, OSAL_WRITE_ONLY );
+  if ( fd < 0 )
+  {
+    return false;
+  }
+  ok = len == 0 || osal_write( fd, data, len ) == (int32_t) len;
+  osal_close( fd );
 
-  err = nvs_open_from_partition( PARTITION_NAME, STORAGE_NAMESPACE, NVS_READONLY, &my_handle );
-  if ( err != ESP_OK )
+  if ( !ok || osal_rename( tmp, path ) != OSAL_SUCCESS )
   {
+    osal_remove( tmp );
     return false;
   }
+  return true;
+}
+
+// Reads up to size - 1 bytes and terminates them; -1 if there is no file
+static int32_t _read_file( const char* path, char* buf, size_t size )
+{
+  int32_t len;
+  osal_file_id_t fd = osal_open_create( path, OSAL_FILE_FLAG_NONE, OSAL_READ_ONLY );
+
+  if ( fd < 0 )
+  {
+    return -1;
+  }
+  len = osal_read( fd, buf, size - 1 );
+  osal_close( fd );
+  if ( len < 0 )
+  {
+    return -1;
+  }
+  buf[len] = '\0';
+  return len;
+}
+
+static void _parse_line( char* line )
+{
+  char* value = strchr( line, '=' );
 
+  if ( value == NULL )
+  {
+    return;
+  }
+  *value++ = '\0';
+
+  // Names this version does not know are skipped, so a newer file still loads
   for ( int i = 0; i < MQTT_CONFIG_VALUE_LAST; i++ )
   {
+    if ( strcmp( line, config_values[i].name ) != 0 )
+    {
+      continue;
+    }
     switch ( config_values[i].type )
     {
       case VALUE_TYPE_INT:
-        err = nvs_get_i32( my_handle, config_values[i].name, config_values[i].value );
-        if ( err != ESP_OK )
-        {
-          printf( "[MQTT_CONFIG] not found in nvs %s\n\r", config_values[i].name );
-          memcpy( config_values[i].value, config_values[i].default_value, sizeof( int32_t ) );
-        }
+        *( (int32_t*) config_values[i].value ) = (int32_t) strtol( value, NULL, 10 );
         break;
 
       case VALUE_TYPE_BOOL:
-        err = nvs_get_u8( my_handle, config_values[i].name, config_values[i].value );
-        if ( err != ESP_OK )
-        {
-          printf( "[MQTT_CONFIG] not found in nvs %s\n\r", config_values[i].name );
-          memcpy( config_values[i].value, config_values[i].default_value, sizeof( uint8_t ) );
-        }
+        *( (uint8_t*) config_values[i].value ) = ( strcmp( value, "1" ) == 0 );
         break;
 
       case VALUE_TYPE_STRING:
+        if ( strlen( value ) < MQTT_CONFIG_STR_SIZE )
         {
-          size_t length = MQTT_CONFIG_STR_SIZE;
-          err = nvs_get_str( my_handle, config_values[i].name, config_values[i].value, &length );
-          if ( err != ESP_OK )
-          {
-            printf( "[MQTT_CONFIG] not found in nvs %s\n\r", config_values[i].name );
-            strcpy( config_values[i].value, config_values[i].default_value );
-          }
+          strcpy( config_values[i].value, value );
         }
         break;
 
       case VALUE_TYPE_CERT:
-        {
-          FILE* f = fopen( MQTT_CERT_FILE, "rb" );
-          if ( f == NULL )
-          {
-            printf( "MQTT Failed to open file for reading" );
-            break;
-          }
-          fread( config_data.cert, sizeof( config_data.cert ), 1, f );
-          fclose( f );
-        }
         break;
     }
-    if ( err != ESP_OK )
-    {
-      printf( "[MQTT_CONFIG] not found in nvs %s\n\r", config_values[i].name );
-    }
+    return;
   }
-
-  nvs_close( my_handle );
-  return true;
 }
 
-static bool _save_data( void )
+static bool _read_data( void )
 {
-  nvs_handle_t my_handle;
-  esp_err_t err;
+  char buf[CONFIG_FILE_MAX];
+  char* line = buf;
 
-  err = nvs_open_from_partition( PARTITION_NAME, STORAGE_NAMESPACE, NVS_READWRITE, &my_handle );
-  if ( err != ESP_OK )
+  if ( _read_file( CONFIG_MQTT_CONFIG_PATH, buf, sizeof( buf ) ) < 0 )
   {
     return false;
   }
+  while ( line != NULL && *line != '\0' )
+  {
+    char* next = strchr( line, '\n' );
+    if ( next != NULL )
+    {
+      *next++ = '\0';
+    }
+    _parse_line( line );
+    line = next;
+  }
+  return true;
+}
+
+static uint32_t _changed_mask( void )
+{
+  uint32_t changed = 0;
 
   for ( int i = 0; i < MQTT_CONFIG_VALUE_LAST; i++ )
   {
-    switch ( config_values[i].type )
+    const value_t* v = &config_values[i];
+    // Same field in the snapshot; the certificate has none
+    const void* saved = NULL;
+    bool differs = false;
+
+    if ( v->value != NULL )
+    {
+      saved = (const char*) &saved_data + ( (const char*) v->value - (const char*) &config_data );
+    }
+
+    switch ( v->type )
     {
       case VALUE_TYPE_INT:
-        err = nvs_set_i32( my_handle, config_values[i].name, *( (int32_t*) config_values[i].value ) );
+        differs = memcmp( v->value, saved, sizeof( int32_t ) ) != 0;
         break;
 
       case VALUE_TYPE_BOOL:
-        err = nvs_set_u8( my_handle, config_values[i].name, *( (uint8_t*) config_values[i].value ) );
+        differs = memcmp( v->value, saved, sizeof( uint8_t ) ) != 0;
         break;
 
       case VALUE_TYPE_STRING:
-        err = nvs_set_str( my_handle, config_values[i].name, (const char*) config_values[i].value );
+        differs = strcmp( v->value, saved ) != 0;
         break;
 
       case VALUE_TYPE_CERT:
-        {
-          struct stat st;
-          if ( stat( MQTT_CERT_FILE, &st ) == 0 )
-          {
-            unlink( MQTT_CERT_FILE );
-          }
-          FILE* f = fopen( MQTT_CERT_FILE, "wb" );
-          if ( f == NULL )
-          {
-            printf( "MQTT Failed to open file for writing" );
-            break;
-          }
-          fwrite( config_data.cert, strlen( config_data.cert ), 1, f );
-          fclose( f );
-        }
+        differs = cert_unapplied;
         break;
     }
-    if ( err != ESP_OK )
+    if ( differs )
     {
-      printf( "[MQTT_CONFIG] Cannot save %s\n\r", config_values[i].name );
+      changed |= MQTT_CONFIG_CHANGED( i );
     }
   }
+  return changed;
+}
 
-  err = nvs_commit( my_handle );
-  if ( err != ESP_OK )
+static bool _save_data( uint32_t changed )
+{
+  char buf[CONFIG_FILE_MAX];
+  size_t len = 0;
+  bool ok = true;
+
+  if ( file_stale || ( changed & ~MQTT_CONFIG_CHANGED( MQTT_CONFIG_VALUE_CERT ) ) )
   {
-    nvs_close( my_handle );
-    return false;
+    for ( int i = 0; i < MQTT_CONFIG_VALUE_LAST; i++ )
+    {
+      const value_t* v = &config_values[i];
+      switch ( v->type )
+      {
+        case VALUE_TYPE_INT:
+          len += (size_t) snprintf( buf + len, sizeof( buf ) - len, "%s=%ld\n", v->name, (long) *( (int32_t*) v->value ) );
+          break;
+
+        case VALUE_TYPE_BOOL:
+          len += (size_t) snprintf( buf + len, sizeof( buf ) - len, "%s=%d\n", v->name, *( (uint8_t*) v->value ) ? 1 : 0 );
+          break;
+
+        case VALUE_TYPE_STRING:
+          len += (size_t) snprintf( buf + len, sizeof( buf ) - len, "%s=%s\n", v->name, (const char*) v->value );
+          break;
+
+        case VALUE_TYPE_CERT:
+          break;
+      }
+    }
+    file_stale = !_write_file( CONFIG_MQTT_CONFIG_PATH, buf, len );
+    if ( file_stale )
+    {
+      osal_log_error( MODULE_NAME "Cannot save settings to %s\n", CONFIG_MQTT_CONFIG_PATH );
+      ok = false;
+    }
   }
-  nvs_close( my_handle );
-  return true;
+
+  if ( cert_unsaved )
+  {
+    size_t cert_len = strlen( config_cert );
+    bool written = true;
+
+    if ( cert_len > 0 )
+    {
+      written = _write_file( CONFIG_MQTT_CERT_PATH, config_cert, cert_len );
+    }
+    else
+    {
+      (void) osal_remove( CONFIG_MQTT_CERT_PATH );
+    }
+    if ( written )
+    {
+      cert_unsaved = false;
+    }
+    else
+    {
+      osal_log_error( MODULE_NAME "Cannot save certificate to %s\n", CONFIG_MQTT_CERT_PATH );
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+static char* _load_cert( void )
+{
+  if ( config_cert == NULL )
+  {
+    config_cert = calloc( 1, MQTT_CERT_MAX_SIZE );
+    if ( config_cert != NULL && _read_file( CONFIG_MQTT_CERT_PATH, config_cert, MQTT_CERT_MAX_SIZE ) < 0 )
+    {
+      config_cert[0] = '\0';
+    }
+  }
+  return config_cert;
 }
 
 static void _set_default_config( void )
 {
-  printf( "Set default mqtt config\n\r" );
   for ( int i = 0; i < MQTT_CONFIG_VALUE_LAST; i++ )
   {
     switch ( config_values[i].type )
     {
       case VALUE_TYPE_INT:
-        memcpy( config_values[i].value, config_values[i].default_value, sizeof( int ) );
+        memcpy( config_values[i].value, config_values[i].default_value, sizeof( int32_t ) );
         break;
 
       case VALUE_TYPE_BOOL:
-        memcpy( config_values[i].value, config_values[i].default_value, sizeof( bool ) );
+        memcpy( config_values[i].value, config_values[i].default_value, sizeof( uint8_t ) );
         break;
 
       case VALUE_TYPE_STRING:
@@ -226,7 +345,6 @@ static void _set_default_config( void )
         break;
 
       case VALUE_TYPE_CERT:
-        memset( config_values[i].value, 0, MQTT_CERT_MAX_SIZE );
         break;
     }
   }
@@ -234,10 +352,20 @@ static void _set_default_config( void )
 
 void MQTTConfig_Init( void )
 {
+  // MqttApp_Init() runs again on every restart; keep values set at runtime.
+  if ( config_loaded )
+  {
+    return;
+  }
+
+  // Settings missing from the file keep their defaults
+  _set_default_config();
   if ( false == _read_data() )
   {
-    _set_default_config();
+    osal_log_info( MODULE_NAME "No saved settings at %s, using defaults\n", CONFIG_MQTT_CONFIG_PATH );
   }
+  saved_data = config_data;
+  config_loaded = true;
 }
 
 bool MQTTConfig_SetInt( int value, mqtt_config_value_t config_value )
@@ -245,7 +373,7 @@ bool MQTTConfig_SetInt( int value, mqtt_config_value_t config_value )
   assert( config_value < MQTT_CONFIG_VALUE_LAST );
   if ( config_values[config_value].type == VALUE_TYPE_INT )
   {
-    int* set_value = (int*) config_values[config_value].value;
+    int32_t* set_value = (int32_t*) config_values[config_value].value;
     *set_value = value;
     return true;
   }
@@ -257,8 +385,8 @@ bool MQTTConfig_SetBool( bool value, mqtt_config_value_t config_value )
   assert( config_value < MQTT_CONFIG_VALUE_LAST );
   if ( config_values[config_value].type == VALUE_TYPE_BOOL )
   {
-    bool* set_value = (bool*) config_values[config_value].value;
-    *set_value = value;
+    uint8_t* set_value = (uint8_t*) config_values[config_value].value;
+    *set_value = (uint8_t) value;
     return true;
   }
   return false;
@@ -269,8 +397,17 @@ bool MQTTConfig_SetCert( const char* cert, size_t cert_len, size_t offset, mqtt_
   assert( config_value < MQTT_CONFIG_VALUE_LAST );
   if ( config_values[config_value].type == VALUE_TYPE_CERT && cert_len + offset < MQTT_CERT_MAX_SIZE )
   {
-    char* set_value = (char*) config_values[config_value].value;
-    memcpy( &set_value[offset], cert, cert_len );
+    char* set_value = _load_cert();
+    if ( set_value == NULL )
+    {
+      return false;
+    }
+    if ( memcmp( &set_value[offset], cert, cert_len ) != 0 )
+    {
+      memcpy( &set_value[offset], cert, cert_len );
+      cert_unsaved = true;
+      cert_unapplied = true;
+    }
     return true;
   }
   return false;
@@ -280,7 +417,9 @@ bool MQTTConfig_SetString( const char* string, mqtt_config_value_t config_value
 {
   assert( string );
   assert( config_value < MQTT_CONFIG_VALUE_LAST );
-  if ( config_values[config_value].type == VALUE_TYPE_STRING && strlen( string ) < MQTT_CONFIG_STR_SIZE )
+  // One line per setting in the file, so no line breaks
+  if ( config_values[config_value].type == VALUE_TYPE_STRING && strlen( string ) < MQTT_CONFIG_STR_SIZE &&
+       strpbrk( string, "\r\n" ) == NULL )
   {
     char* set_value = (char*) config_values[config_value].value;
     strcpy( set_value, string );
@@ -295,7 +434,7 @@ bool MQTTConfig_GetInt( int* value, mqtt_config_value_t config_value )
   assert( config_value < MQTT_CONFIG_VALUE_LAST );
   if ( config_values[config_value].type == VALUE_TYPE_INT )
   {
-    *value = *( (int*) config_values[config_value].value );
+    *value = (int) *( (int32_t*) config_values[config_value].value );
     return true;
   }
   return false;
@@ -307,7 +446,7 @@ bool MQTTConfig_GetBool( bool* value, mqtt_config_value_t config_value )
   assert( config_value < MQTT_CONFIG_VALUE_LAST );
   if ( config_values[config_value].type == VALUE_TYPE_BOOL )
   {
-    *value = *( (bool*) config_values[config_value].value );
+    *value = *( (uint8_t*) config_values[config_value].value ) != 0;
     return true;
   }
   return false;
@@ -328,17 +467,21 @@ const char* MQTTConfig_GetCert( mqtt_config_value_t config_value )
   assert( config_value < MQTT_CONFIG_VALUE_LAST );
   if ( config_values[config_value].type == VALUE_TYPE_CERT )
   {
-    return (char*) config_values[config_value].value;
+    return _load_cert();
   }
   return NULL;
 }
 
 bool MQTTConfig_Save( void )
 {
-  bool result = _save_data();
-  if ( apply_config_callback != NULL )
+  uint32_t changed = _changed_mask();
+  bool result = _save_data( changed );
+
+  saved_data = config_data;
+  cert_unapplied = false;
+  if ( apply_config_callback != NULL && changed != 0 )
   {
-    apply_config_callback();
+    apply_config_callback( changed );
   }
   return result;
 }
@@ -4,6 +4,12 @@
  * @author  Dmytro Shevchenko
  * @brief   MQTT modules configuration header file
  *******************************************************************************
+ *
+ * Settings live in RAM and are written to CONFIG_MQTT_CONFIG_PATH on the
+ * mounted OSAL filesystem as "name=value" lines; the CA certificate is kept
+ * apart in CONFIG_MQTT_CERT_PATH and only read once a TLS connection needs
+ * it. MQTTConfig_Save() hands the set of changed settings to the callback,
+ * so the client only reconnects for settings that need a new connection.
  */
 
 /* Define to prevent recursive inclusion ------------------------------------*/
@@ -13,12 +19,34 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+
+#include "hq_config.h"
 
 /* Public macros -------------------------------------------------------------*/
 
 #define MQTT_CONFIG_STR_SIZE 64
 #define MQTT_CERT_MAX_SIZE   5120
 
+#ifndef CONFIG_MQTT_INFLIGHT_MAX
+#define CONFIG_MQTT_INFLIGHT_MAX 8
+#endif
+
+#ifndef CONFIG_MQTT_PROTOCOL_VERSION
+#define CONFIG_MQTT_PROTOCOL_VERSION 4
+#endif
+
+#ifndef CONFIG_MQTT_CONFIG_PATH
+#define CONFIG_MQTT_CONFIG_PATH "/mqtt_config"
+#endif
+
+#ifndef CONFIG_MQTT_CERT_PATH
+#define CONFIG_MQTT_CERT_PATH "/mqtt.pem"
+#endif
+
+// Bit of a setting in the mask passed to mqtt_apply_config_cb
+#define MQTT_CONFIG_CHANGED( value ) ( 1UL << ( value ) )
+
 /* Public types --------------------------------------------------------------*/
 
 typedef enum
@@ -31,10 +59,18 @@ typedef enum
   MQTT_CONFIG_VALUE_PASSWORD,
   MQTT_CONFIG_VALUE_CLIENT_ID,
   MQTT_CONFIG_VALUE_CERT,
+  MQTT_CONFIG_VALUE_INFLIGHT,    // QoS 1/2 publishes awaiting their ack, 1..CONFIG_MQTT_INFLIGHT_MAX
+  MQTT_CONFIG_VALUE_CLEAN,       // Clean session; false keeps the session across reconnects and restarts
+  MQTT_CONFIG_VALUE_VERSION,     // Protocol version: 4 (3.1.1) or 5
   MQTT_CONFIG_VALUE_LAST
 } mqtt_config_value_t;
 
-typedef void ( *mqtt_apply_config_cb )( void );
+/**
+ * @brief   Called by MQTTConfig_Save() when settings changed.
+ * @param   [in] changed - MQTT_CONFIG_CHANGED() bits of the settings that
+ *          differ from the previous save.
+ */
+typedef void ( *mqtt_apply_config_cb )( uint32_t changed );
 
 /* Public functions ----------------------------------------------------------*/
 
@@ -51,6 +87,13 @@ bool MQTTConfig_GetInt( int* value, mqtt_config_value_t config_value );
 bool MQTTConfig_GetBool( bool* value, mqtt_config_value_t config_value );
 const char* MQTTConfig_GetString( mqtt_config_value_t config_value );
 const char* MQTTConfig_GetCert( mqtt_config_value_t config_value );
+
+/**
+ * @brief   Write changed settings and apply them through the callback.
+ * @note    Settings are applied even if they cannot be written, e.g.
+ *          without a mounted filesystem.
+ * @return  true - if everything changed was written, otherwise false
+ */
 bool MQTTConfig_Save( void );
 void MQTTConfig_SetCallback( mqtt_apply_config_cb cb );
 
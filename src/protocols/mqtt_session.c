@@ -0,0 +1,208 @@
+#include "mqtt_session.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mongoose.h"
+#include "osal_file.h"
+#include "osal_log.h"
+
+#define MODULE_NAME "[MQTT session] "
+
+#define SESSION_MAGIC   0x45514D48UL    // "HMQE"
+#define MSG_MAX         1024U
+#define PAYLOAD_MAX     ( 1024U * 1024U )
+
+// File layout: header, rx_count packet ids, then msg_count messages, each a
+// msg header, topic (no terminator) and payload. crc covers all but the
+// file header.
+typedef struct
+{
+  uint32_t magic;
+  uint16_t next_id;
+  uint16_t rx_count;
+  uint32_t msg_count;
+  uint32_t crc;
+} session_header_t;
+
+typedef struct
+{
+  uint16_t id;
+  uint8_t qos;
+  uint8_t released;
+  uint16_t topic_len;
+  uint16_t reserved;
+  uint32_t len;
+} session_msg_header_t;
+
+// Helpers
+static bool file_read( osal_file_id_t fd, void* buf, size_t len, uint32_t* crc )
+{
+  if ( len == 0 )
+  {
+    return true;
+  }
+  if ( osal_read( fd, buf, len ) != (int32_t) len )
+  {
+    return false;
+  }
+  *crc = mg_crc32( *crc, (const char*) buf, len );
+  return true;
+}
+
+static bool file_write( osal_file_id_t fd, const void* buf, size_t len )
+{
+  return len == 0 || osal_write( fd, buf, len ) == (int32_t) len;
+}
+
+static session_msg_header_t msg_header( const mqtt_session_msg_t* msg )
+{
+  session_msg_header_t hdr = {
+    .id = msg->id,
+    .qos = msg->qos,
+    .released = msg->released ? 1 : 0,
+    .topic_len = (uint16_t) strlen( msg->topic ),
+    .len = (uint32_t) msg->len };
+
+  return hdr;
+}
+
+static uint32_t session_crc( const mqtt_session_t* session )
+{
+  uint32_t crc = mg_crc32( 0, (const char*) session->rx_ids, session->rx_count * sizeof( uint16_t ) );
+
+  for ( uint32_t i = 0; i < session->msg_count; i++ )
+  {
+    const mqtt_session_msg_t* msg = &session->msgs[i];
+    session_msg_header_t hdr = msg_header( msg );
+    crc = mg_crc32( crc, (const char*) &hdr, sizeof( hdr ) );
+    crc = mg_crc32( crc, msg->topic, hdr.topic_len );
+    crc = mg_crc32( crc, (const char*) msg->payload, msg->len );
+  }
+  return crc;
+}
+
+// Public functions
+bool MqttSession_Save( const char* path, const mqtt_session_t* session )
+{
+  char tmp[OSAL_MAX_PATH_LEN];
+  bool ok;
+  session_header_t hdr = {
+    .magic = SESSION_MAGIC,
+    .next_id = session->next_id,
+    .rx_count = (uint16_t) session->rx_count,
+    .msg_count = session->msg_count,
+    .crc = session_crc( session ) };
+
+  if ( snprintf( tmp, sizeof( tmp ), "%s.tmp", path ) >= (int) sizeof( tmp ) )
+  {
+    return false;
+  }
+
+  osal_file_id_t fd = osal_open_create( tmp, OSAL_FILE_FLAG_CREATE | OSAL_FILE_FLAG_TRUNCATE, OSAL_WRITE_ONLY );
+  if ( fd < 0 )
+  {
+    return false;
+  }
+
+  ok = file_write( fd, &hdr, sizeof( hdr ) ) &&
+       file_write( fd, session->rx_ids, session->rx_count * sizeof( uint16_t ) );
+  for ( uint32_t i = 0; ok && i < session->msg_count; i++ )
+  {
+    const mqtt_session_msg_t* msg = &session->msgs[i];
+    session_msg_header_t msg_hdr = msg_header( msg );
+    ok = file_write( fd, &msg_hdr, sizeof( msg_hdr ) ) && file_write( fd, msg->topic, msg_hdr.topic_len ) &&
+         file_write( fd, msg->payload, msg->len );
+  }
+  osal_close( fd );
+
+  if ( !ok || osal_rename( tmp, path ) != OSAL_SUCCESS )
+  {
+    osal_remove( tmp );
+    return false;
+  }
+  return true;
+}
+
+bool MqttSession_Load( const char* path, mqtt_session_t* session )
+{
+  session_header_t hdr;
+  uint32_t crc = 0;
+  bool ok;
+
+  memset( session, 0, sizeof( *session ) );
+  osal_file_id_t fd = osal_open_create( path, OSAL_FILE_FLAG_NONE, OSAL_READ_ONLY );
+  if ( fd < 0 )
+  {
+    return false;
+  }
+
+  ok = osal_read( fd, &hdr, sizeof( hdr ) ) == (int32_t) sizeof( hdr ) && hdr.magic == SESSION_MAGIC &&
+       hdr.msg_count <= MSG_MAX;
+  if ( ok && hdr.rx_count > 0 )
+  {
+    session->rx_ids = malloc( hdr.rx_count * sizeof( uint16_t ) );
+    ok = session->rx_ids != NULL && file_read( fd, session->rx_ids, hdr.rx_count * sizeof( uint16_t ), &crc );
+    session->rx_count = ok ? hdr.rx_count : 0;
+  }
+  if ( ok && hdr.msg_count > 0 )
+  {
+    session->msgs = calloc( hdr.msg_count, sizeof( mqtt_session_msg_t ) );
+    ok = session->msgs != NULL;
+  }
+
+  for ( uint32_t i = 0; ok && i < hdr.msg_count; i++ )
+  {
+    mqtt_session_msg_t* msg = &session->msgs[i];
+    session_msg_header_t msg_hdr;
+    char* block;
+
+    ok = file_read( fd, &msg_hdr, sizeof( msg_hdr ), &crc ) && ( msg_hdr.topic_len > 0 || msg_hdr.released ) &&
+         ( msg_hdr.qos == 1 || msg_hdr.qos == 2 ) && msg_hdr.len <= PAYLOAD_MAX;
+    block = ok ? malloc( msg_hdr.topic_len + 1U + msg_hdr.len ) : NULL;
+    if ( block == NULL )
+    {
+      ok = false;
+      break;
+    }
+
+    msg->id = msg_hdr.id;
+    msg->qos = msg_hdr.qos;
+    msg->released = msg_hdr.released != 0;
+    msg->topic = block;
+    msg->payload = block + msg_hdr.topic_len + 1;
+    msg->len = msg_hdr.len;
+    session->msg_count++;
+
+    ok = file_read( fd, block, msg_hdr.topic_len, &crc ) &&
+         file_read( fd, block + msg_hdr.topic_len + 1, msg_hdr.len, &crc );
+    block[msg_hdr.topic_len] = '\0';
+  }
+  osal_close( fd );
+
+  if ( !ok || crc != hdr.crc )
+  {
+    osal_log_warning( MODULE_NAME "Ignoring damaged %s\n", path );
+    MqttSession_Free( session );
+    return false;
+  }
+  session->next_id = hdr.next_id;
+  return true;
+}
+
+void MqttSession_Free( mqtt_session_t* session )
+{
+  for ( uint32_t i = 0; i < session->msg_count; i++ )
+  {
+    free( (void*) session->msgs[i].topic );
+  }
+  free( session->msgs );
+  free( session->rx_ids );
+  memset( session, 0, sizeof( *session ) );
+}
+
+void MqttSession_Remove( const char* path )
+{
+  (void) osal_remove( path );
+}
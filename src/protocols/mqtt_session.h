@@ -0,0 +1,77 @@
+/**
+ *******************************************************************************
+ * @file    mqtt_session.h
+ * @brief   Client side of a persistent MQTT session, saved to a file
+ *******************************************************************************
+ *
+ * With clean session off the broker keeps subscriptions and unfinished
+ * QoS 1/2 flows across reconnects, and expects the client to keep its half:
+ * publishes not yet acknowledged and QoS 2 packet ids received but not yet
+ * released. This module stores that half in one file on the mounted OSAL
+ * filesystem so it also survives a restart. The file is written to
+ * "<path>.tmp" and renamed over "<path>", so a cut-short write leaves the
+ * previous snapshot in place.
+ */
+
+/* Define to prevent recursive inclusion ------------------------------------*/
+
+#ifndef _MQTT_SESSION_H
+#define _MQTT_SESSION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Public types --------------------------------------------------------------*/
+
+/**
+ * @brief   Outbound QoS 1/2 publish that is not finished yet.
+ *          Loaded entries own one heap block starting at topic that also
+ *          holds the payload; MqttSession_Free() releases it.
+ */
+typedef struct
+{
+  uint16_t id;
+  uint8_t qos;
+  bool released;          /**< QoS 2: PUBREC received, only PUBREL is resent */
+  const char* topic;
+  const void* payload;
+  size_t len;
+} mqtt_session_msg_t;
+
+typedef struct
+{
+  uint16_t next_id;       /**< Packet id counter, so new ids do not collide */
+  uint32_t msg_count;
+  mqtt_session_msg_t* msgs;
+  uint32_t rx_count;
+  uint16_t* rx_ids;       /**< QoS 2 publishes delivered, PUBREL not yet seen */
+} mqtt_session_t;
+
+/* Public functions ----------------------------------------------------------*/
+
+/**
+ * @brief   Write a snapshot of the session.
+ * @return  true - if the snapshot replaced the previous one, otherwise false
+ */
+bool MqttSession_Save( const char* path, const mqtt_session_t* session );
+
+/**
+ * @brief   Read the last snapshot.
+ * @param   [out] session - Filled in on success; release with MqttSession_Free().
+ * @return  true - if a valid snapshot was read, otherwise false and
+ *          session is left empty
+ */
+bool MqttSession_Load( const char* path, mqtt_session_t* session );
+
+/**
+ * @brief   Free what MqttSession_Load() allocated.
+ */
+void MqttSession_Free( mqtt_session_t* session );
+
+/**
+ * @brief   Delete the snapshot, e.g. when clean sessions are used again.
+ */
+void MqttSession_Remove( const char* path );
+
+#endif
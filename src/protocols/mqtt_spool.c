@@ -0,0 +1,577 @@
+#include "mqtt_spool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mongoose.h"
+#include "osal_file.h"
+#include "osal_log.h"
+#include "osal_mutex.h"
+
+#define MODULE_NAME "[MQTT spool] "
+
+#ifndef CONFIG_MQTT_SPOOL_INDEX_INTERVAL
+#define CONFIG_MQTT_SPOOL_INDEX_INTERVAL 16
+#endif
+
+#define RECORD_MAGIC   0xA5
+#define INDEX_MAGIC    0x53514D48UL    // "HMQS"
+#define NO_FILE        ( (osal_file_id_t) -1 )
+
+// On-disk record: header, topic (no terminator), payload
+typedef struct
+{
+  uint8_t magic;
+  uint8_t qos;
+  uint16_t topic_len;
+  uint32_t len;
+  uint32_t crc;
+} spool_header_t;
+
+// Contents of "<path>.idx"; segments are head_seq .. head_seq + count - 1
+typedef struct
+{
+  uint32_t magic;
+  uint32_t head_seq;
+  uint32_t head_off;
+  uint32_t count;
+} spool_index_t;
+
+typedef struct
+{
+  uint32_t size;       // valid bytes in the file
+  uint32_t records;    // records not yet popped
+} spool_segment_t;
+
+typedef struct
+{
+  bool open;
+  char path[OSAL_MAX_PATH_LEN - 12];
+  uint32_t segment_size;
+  uint32_t max_segments;
+  uint32_t head_seq;
+  uint32_t head_off;
+  uint32_t count;
+  uint32_t records;
+  uint32_t bytes;
+  uint32_t peeked;
+  uint32_t unsaved;    // pops since the index was written
+  spool_segment_t* segments;
+  osal_file_id_t reader;
+  osal_file_id_t writer;
+  uint64_t spooled;
+  uint64_t replayed;
+  uint64_t dropped;
+} spool_state_t;
+
+static spool_state_t spool = { .reader = NO_FILE, .writer = NO_FILE };
+static osal_mutex_id_t spool_lock;
+static bool spool_lock_created = false;
+
+// Helpers (spool_lock held)
+static spool_segment_t* segment( uint32_t seq )
+{
+  return &spool.segments[seq % spool.max_segments];
+}
+
+static void segment_path( uint32_t seq, char* buf, size_t size )
+{
+  snprintf( buf, size, "%s.%lu", spool.path, (unsigned long) seq );
+}
+
+static void file_close( osal_file_id_t* fd )
+{
+  if ( *fd >= 0 )
+  {
+    osal_close( *fd );
+    *fd = NO_FILE;
+  }
+}
+
+static bool file_read( osal_file_id_t fd, void* buf, size_t len )
+{
+  return len == 0 || osal_read( fd, buf, len ) == (int32_t) len;
+}
+
+static bool file_write( osal_file_id_t fd, const void* buf, size_t len )
+{
+  return len == 0 || osal_write( fd, buf, len ) == (int32_t) len;
+}
+
+static uint32_t record_crc( const char* topic, size_t topic_len, const void* payload, size_t len )
+{
+  return mg_crc32( mg_crc32( 0, topic, topic_len ), (const char*) payload, len );
+}
+
+static void index_save( void )
+{
+  char path[OSAL_MAX_PATH_LEN];
+  spool_index_t index = {
+    .magic = INDEX_MAGIC,
+    .head_seq = spool.head_seq,
+    .head_off = spool.head_off,
+    .count = spool.count };
+
+  spool.unsaved = 0;
+  snprintf( path, sizeof( path ), "%s.idx", spool.path );
+  osal_file_id_t fd = osal_open_create( path, OSAL_FILE_FLAG_CREATE | OSAL_FILE_FLAG_TRUNCATE, OSAL_WRITE_ONLY );
+  if ( fd < 0 || !file_write( fd, &index, sizeof( index ) ) )
+  {
+    osal_log_error( MODULE_NAME "Failed to save %s\n", path );
+  }
+  file_close( &fd );
+}
+
+static bool index_load( spool_index_t* index )
+{
+  char path[OSAL_MAX_PATH_LEN];
+  bool ok;
+
+  snprintf( path, sizeof( path ), "%s.idx", spool.path );
+  osal_file_id_t fd = osal_open_create( path, OSAL_FILE_FLAG_NONE, OSAL_READ_ONLY );
+  if ( fd < 0 )
+  {
+    return false;
+  }
+  ok = file_read( fd, index, sizeof( *index ) ) && index->magic == INDEX_MAGIC &&
+       index->count <= spool.max_segments;
+  file_close( &fd );
+  return ok;
+}
+
+// Walk the record headers of one segment from start. Stops at the first
+// record that does not fit, which is where a write was cut short.
+static void segment_scan( uint32_t seq, uint32_t start, bool is_tail )
+{
+  char path[OSAL_MAX_PATH_LEN];
+  spool_segment_t* seg = segment( seq );
+  osal_fstat_t st;
+  spool_header_t hdr;
+  uint32_t off = start;
+
+  seg->size = start;
+  seg->records = 0;
+
+  segment_path( seq, path, sizeof( path ) );
+  if ( osal_stat( path, &st ) != OSAL_SUCCESS )
+  {
+    return;
+  }
+
+  osal_file_id_t fd = osal_open_create( path, OSAL_FILE_FLAG_NONE, is_tail ? OSAL_READ_WRITE : OSAL_READ_ONLY );
+  if ( fd < 0 )
+  {
+    return;
+  }
+
+  while ( osal_lseek( fd, off, OSAL_SEEK_SET ) == (int32_t) off && file_read( fd, &hdr, sizeof( hdr ) ) )
+  {
+    uint32_t next = off + (uint32_t) sizeof( hdr ) + hdr.topic_len + hdr.len;
+    if ( hdr.magic != RECORD_MAGIC || hdr.topic_len == 0 || hdr.len > spool.segment_size ||
+         next > OSAL_FILESTAT_SIZE( st ) )
+    {
+      break;
+    }
+    off = next;
+    seg->records++;
+  }
+
+  seg->size = off;
+  if ( off < OSAL_FILESTAT_SIZE( st ) )
+  {
+    osal_log_warning( MODULE_NAME "%s: ignoring %u trailing bytes\n", path,
+                      (unsigned) ( OSAL_FILESTAT_SIZE( st ) - off ) );
+    if ( is_tail )
+    {
+      osal_file_truncate( fd, off );
+    }
+  }
+  file_close( &fd );
+}
+
+// Delete the head segment once it is replayed or dropped
+static void head_remove( void )
+{
+  char path[OSAL_MAX_PATH_LEN];
+  spool_segment_t* seg = segment( spool.head_seq );
+
+  file_close( &spool.reader );
+  if ( spool.count == 1 )
+  {
+    file_close( &spool.writer );
+  }
+
+  segment_path( spool.head_seq, path, sizeof( path ) );
+  osal_remove( path );
+
+  spool.records -= seg->records;
+  spool.bytes -= seg->size;
+  seg->size = 0;
+  seg->records = 0;
+  spool.head_seq++;
+  spool.head_off = 0;
+  spool.count--;
+  spool.peeked = 0;
+  index_save();
+}
+
+static void head_drop( void )
+{
+  spool_segment_t* seg = segment( spool.head_seq );
+
+  if ( seg->records > 0 )
+  {
+    osal_log_warning( MODULE_NAME "Spool full, dropping %u oldest messages\n", (unsigned) seg->records );
+  }
+  spool.dropped += seg->records;
+  head_remove();
+}
+
+// Start a new tail segment, making room first if the spool is at its limit
+static bool tail_add( void )
+{
+  char path[OSAL_MAX_PATH_LEN];
+  uint32_t seq;
+
+  file_close( &spool.writer );
+  if ( spool.count == spool.max_segments )
+  {
+    head_drop();
+  }
+
+  seq = spool.head_seq + spool.count;
+  segment_path( seq, path, sizeof( path ) );
+  spool.writer = osal_open_create( path, OSAL_FILE_FLAG_CREATE | OSAL_FILE_FLAG_TRUNCATE, OSAL_WRITE_ONLY );
+  if ( spool.writer < 0 )
+  {
+    osal_log_error( MODULE_NAME "Failed to create %s\n", path );
+    spool.writer = NO_FILE;
+    return false;
+  }
+
+  segment( seq )->size = 0;
+  segment( seq )->records = 0;
+  spool.count++;
+  index_save();
+  return true;
+}
+
+// Public functions
+bool MqttSpool_Open( const char* path, uint32_t segment_size, uint32_t max_segments )
+{
+  spool_index_t index;
+
+  if ( path == NULL || strlen( path ) >= sizeof( spool.path ) || max_segments < 2 ||
+       segment_size <= sizeof( spool_header_t ) )
+  {
+    return false;
+  }
+
+  if ( !spool_lock_created )
+  {
+    if ( osal_mutex_create( &spool_lock, "mqtt_spool" ) != OSAL_SUCCESS )
+    {
+      return false;
+    }
+    spool_lock_created = true;
+  }
+
+  MqttSpool_Close();
+  osal_mutex_take( spool_lock );
+
+  memset( &spool, 0, sizeof( spool ) );
+  spool.reader = NO_FILE;
+  spool.writer = NO_FILE;
+  strcpy( spool.path, path );
+  spool.segment_size = segment_size;
+  spool.max_segments = max_segments;
+  spool.segments = calloc( max_segments, sizeof( spool_segment_t ) );
+  if ( spool.segments == NULL )
+  {
+    osal_mutex_give( spool_lock );
+    return false;
+  }
+
+  if ( index_load( &index ) )
+  {
+    spool.head_seq = index.head_seq;
+    spool.head_off = index.head_off;
+    spool.count = index.count;
+  }
+
+  for ( uint32_t i = 0; i < spool.count; i++ )
+  {
+    uint32_t seq = spool.head_seq + i;
+    segment_scan( seq, ( i == 0 ) ? spool.head_off : 0, i + 1 == spool.count );
+    spool.records += segment( seq )->records;
+    spool.bytes += segment( seq )->size;
+  }
+
+  // Probe the filesystem now so a missing mount shows up here, not on the
+  // first outage.
+  index_save();
+  char probe[OSAL_MAX_PATH_LEN];
+  osal_fstat_t st;
+  snprintf( probe, sizeof( probe ), "%s.idx", spool.path );
+  if ( osal_stat( probe, &st ) != OSAL_SUCCESS )
+  {
+    osal_log_warning( MODULE_NAME "%s is not writable, spool disabled\n", spool.path );
+    free( spool.segments );
+    spool.segments = NULL;
+    osal_mutex_give( spool_lock );
+    return false;
+  }
+
+  spool.open = true;
+  if ( spool.records > 0 )
+  {
+    osal_log_info( MODULE_NAME "Recovered %u messages from %s\n", (unsigned) spool.records, spool.path );
+  }
+  osal_mutex_give( spool_lock );
+  return true;
+}
+
+void MqttSpool_Close( void )
+{
+  if ( !spool_lock_created )
+  {
+    return;
+  }
+
+  osal_mutex_take( spool_lock );
+  if ( spool.open )
+  {
+    file_close( &spool.reader );
+    file_close( &spool.writer );
+    index_save();
+    free( spool.segments );
+    spool.segments = NULL;
+    spool.open = false;
+  }
+  osal_mutex_give( spool_lock );
+}
+
+bool MqttSpool_IsOpen( void )
+{
+  return spool.open;
+}
+
+bool MqttSpool_Push( const char* topic, const void* payload, size_t len, int qos )
+{
+  size_t topic_len = ( topic != NULL ) ? strlen( topic ) : 0;
+  size_t size = sizeof( spool_header_t ) + topic_len + len;
+  spool_header_t hdr = {
+    .magic = RECORD_MAGIC,
+    .qos = (uint8_t) qos,
+    .topic_len = (uint16_t) topic_len,
+    .len = (uint32_t) len };
+  bool ok = false;
+
+  if ( !spool_lock_created )
+  {
+    return false;
+  }
+
+  osal_mutex_take( spool_lock );
+  if ( !spool.open )
+  {
+    osal_mutex_give( spool_lock );
+    return false;
+  }
+
+  if ( topic_len == 0 || topic_len > UINT16_MAX || size > spool.segment_size )
+  {
+    osal_log_error( MODULE_NAME "%u byte message does not fit in a segment\n", (unsigned) size );
+    spool.dropped++;
+    osal_mutex_give( spool_lock );
+    return false;
+  }
+
+  if ( spool.count == 0 || segment( spool.head_seq + spool.count - 1 )->size + size > spool.segment_size )
+  {
+    if ( !tail_add() )
+    {
+      spool.dropped++;
+      osal_mutex_give( spool_lock );
+      return false;
+    }
+  }
+
+  spool_segment_t* tail = segment( spool.head_seq + spool.count - 1 );
+  if ( spool.writer < 0 )
+  {
+    char path[OSAL_MAX_PATH_LEN];
+    segment_path( spool.head_seq + spool.count - 1, path, sizeof( path ) );
+    spool.writer = osal_open_create( path, OSAL_FILE_FLAG_CREATE, OSAL_WRITE_ONLY );
+    if ( spool.writer < 0 )
+    {
+      spool.writer = NO_FILE;
+    }
+  }
+
+  // Always write at the end of the valid data, over any partial record a
+  // failed write left behind.
+  if ( spool.writer >= 0 && osal_lseek( spool.writer, tail->size, OSAL_SEEK_SET ) == (int32_t) tail->size )
+  {
+    hdr.crc = record_crc( topic, topic_len, payload, len );
+    ok = file_write( spool.writer, &hdr, sizeof( hdr ) ) && file_write( spool.writer, topic, topic_len ) &&
+         file_write( spool.writer, payload, len );
+  }
+
+  if ( ok )
+  {
+    tail->size += (uint32_t) size;
+    tail->records++;
+    spool.records++;
+    spool.bytes += (uint32_t) size;
+    spool.spooled++;
+  }
+  else
+  {
+    osal_log_error( MODULE_NAME "Write failed, message dropped\n" );
+    file_close( &spool.writer );
+    spool.dropped++;
+  }
+
+  osal_mutex_give( spool_lock );
+  return ok;
+}
+
+bool MqttSpool_Peek( mqtt_spool_record_t* rec )
+{
+  bool found = false;
+
+  if ( rec == NULL || !spool_lock_created )
+  {
+    return false;
+  }
+
+  osal_mutex_take( spool_lock );
+  while ( spool.open && spool.count > 0 && !found )
+  {
+    spool_segment_t* seg = segment( spool.head_seq );
+    spool_header_t hdr;
+    char* block = NULL;
+    char path[OSAL_MAX_PATH_LEN];
+
+    if ( spool.head_off >= seg->size )
+    {
+      if ( spool.count == 1 && seg->size == 0 )
+      {
+        break;
+      }
+      head_remove();
+      continue;
+    }
+
+    // littlefs only shows data to other handles once the writer is closed
+    if ( spool.count == 1 )
+    {
+      file_close( &spool.writer );
+    }
+
+    if ( spool.reader < 0 )
+    {
+      segment_path( spool.head_seq, path, sizeof( path ) );
+      spool.reader = osal_open_create( path, OSAL_FILE_FLAG_NONE, OSAL_READ_ONLY );
+      if ( spool.reader < 0 )
+      {
+        spool.reader = NO_FILE;
+      }
+    }
+
+    if ( spool.reader >= 0 && osal_lseek( spool.reader, spool.head_off, OSAL_SEEK_SET ) == (int32_t) spool.head_off &&
+         file_read( spool.reader, &hdr, sizeof( hdr ) ) && hdr.magic == RECORD_MAGIC &&
+         spool.head_off + sizeof( hdr ) + hdr.topic_len + hdr.len <= seg->size )
+    {
+      block = malloc( (size_t) hdr.topic_len + 1 + hdr.len );
+      if ( block == NULL )
+      {
+        break;
+      }
+      if ( file_read( spool.reader, block, hdr.topic_len ) &&
+           file_read( spool.reader, block + hdr.topic_len + 1, hdr.len ) &&
+           record_crc( block, hdr.topic_len, block + hdr.topic_len + 1, hdr.len ) == hdr.crc )
+      {
+        block[hdr.topic_len] = '\0';
+        rec->topic = block;
+        rec->payload = block + hdr.topic_len + 1;
+        rec->len = hdr.len;
+        rec->qos = hdr.qos;
+        spool.peeked = (uint32_t) ( sizeof( hdr ) + hdr.topic_len + hdr.len );
+        found = true;
+        break;
+      }
+      free( block );
+    }
+
+    // Unreadable record: the rest of the segment cannot be framed either
+    osal_log_error( MODULE_NAME "Corrupt record in segment %lu, skipping %u messages\n",
+                    (unsigned long) spool.head_seq, (unsigned) seg->records );
+    spool.dropped += seg->records;
+    spool.records -= seg->records;
+    seg->records = 0;
+    spool.head_off = seg->size;
+  }
+  osal_mutex_give( spool_lock );
+  return found;
+}
+
+void MqttSpool_Pop( void )
+{
+  if ( !spool_lock_created )
+  {
+    return;
+  }
+
+  osal_mutex_take( spool_lock );
+  if ( spool.open && spool.peeked > 0 )
+  {
+    spool_segment_t* seg = segment( spool.head_seq );
+
+    spool.head_off += spool.peeked;
+    spool.peeked = 0;
+    seg->records--;
+    spool.records--;
+    spool.replayed++;
+    if ( spool.head_off >= seg->size )
+    {
+      head_remove();
+    }
+    else if ( ++spool.unsaved >= CONFIG_MQTT_SPOOL_INDEX_INTERVAL )
+    {
+      // A reset replays at most the pops since the last save
+      index_save();
+    }
+  }
+  osal_mutex_give( spool_lock );
+}
+
+uint32_t MqttSpool_Count( void )
+{
+  return spool.open ? spool.records : 0;
+}
+
+void MqttSpool_GetStats( mqtt_spool_stats_t* stats )
+{
+  if ( stats == NULL )
+  {
+    return;
+  }
+
+  memset( stats, 0, sizeof( *stats ) );
+  if ( !spool_lock_created )
+  {
+    return;
+  }
+
+  osal_mutex_take( spool_lock );
+  stats->records = spool.records;
+  stats->bytes = spool.bytes;
+  stats->segments = spool.count;
+  stats->spooled = spool.spooled;
+  stats->replayed = spool.replayed;
+  stats->dropped = spool.dropped;
+  osal_mutex_give( spool_lock );
+}
@@ -0,0 +1,99 @@
+/**
+ *******************************************************************************
+ * @file    mqtt_spool.h
+ * @brief   Persistent store-and-forward queue for outbound MQTT messages
+ *******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion ------------------------------------*/
+
+#ifndef _MQTT_SPOOL_H
+#define _MQTT_SPOOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Public types --------------------------------------------------------------*/
+
+/**
+ * @brief   Oldest spooled message, see MqttSpool_Peek().
+ *          topic is the start of one heap block that also holds the payload;
+ *          free( topic ) releases both.
+ */
+typedef struct
+{
+  char* topic;
+  const void* payload;
+  size_t len;
+  int qos;
+} mqtt_spool_record_t;
+
+typedef struct
+{
+  uint32_t records;      /**< Messages waiting to be replayed */
+  uint32_t bytes;        /**< Disk space used by segment files */
+  uint32_t segments;     /**< Segment files on disk */
+  uint64_t spooled;      /**< Messages written since open */
+  uint64_t replayed;     /**< Messages handed back by MqttSpool_Pop() */
+  uint64_t dropped;      /**< Messages lost to drop-oldest, size or corruption */
+} mqtt_spool_stats_t;
+
+/* Public functions ----------------------------------------------------------*/
+
+/**
+ * @brief   Open the spool, picking up whatever an earlier run left behind.
+ *
+ *          Messages are appended to segment files named "<path>.<n>" and
+ *          the read position is kept in "<path>.idx". At most max_segments
+ *          files of segment_size bytes are used; when they are full the
+ *          oldest segment is deleted (drop-oldest). The read position is
+ *          saved when a segment is finished and on close, so after a crash
+ *          part of one segment may be replayed twice.
+ * @param   [in] path - Path prefix on a mounted filesystem.
+ * @param   [in] segment_size - Maximum size of one segment file in bytes.
+ * @param   [in] max_segments - Maximum number of segment files.
+ * @return  true - if the spool is usable, otherwise false
+ */
+bool MqttSpool_Open( const char* path, uint32_t segment_size, uint32_t max_segments );
+
+/**
+ * @brief   Save the read position and close all files.
+ */
+void MqttSpool_Close( void );
+
+/**
+ * @brief   Check whether the spool is open.
+ */
+bool MqttSpool_IsOpen( void );
+
+/**
+ * @brief   Append a message to the end of the spool.
+ * @return  true - if written, otherwise false
+ */
+bool MqttSpool_Push( const char* topic, const void* payload, size_t len, int qos );
+
+/**
+ * @brief   Read the oldest message without removing it.
+ * @param   [out] rec - Filled in on success; the caller frees rec->topic.
+ * @return  true - if a message was read, false if the spool is empty
+ */
+bool MqttSpool_Peek( mqtt_spool_record_t* rec );
+
+/**
+ * @brief   Remove the message last returned by MqttSpool_Peek().
+ */
+void MqttSpool_Pop( void );
+
+/**
+ * @brief   Number of messages waiting to be replayed.
+ */
+uint32_t MqttSpool_Count( void );
+
+/**
+ * @brief   Get spool counters.
+ * @param   [out] stats - Snapshot of the spool state.
+ */
+void MqttSpool_GetStats( mqtt_spool_stats_t* stats );
+
+#endif
@@ -0,0 +1,159 @@
+#include "mqtt_topic_alias.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Misses of topics without an alias are counted per hash bucket; a shared
+// bucket only makes a topic hot a little early.
+#define MISS_BUCKETS 64U
+
+typedef struct
+{
+  char* topic;        // NULL while the alias is free
+  uint32_t hash;
+  uint32_t last_used;
+} alias_entry_t;
+
+struct mqtt_alias_table
+{
+  uint16_t capacity;
+  uint16_t limit;
+  uint16_t count;
+  uint8_t hot_threshold;
+  uint32_t tick;
+  uint8_t misses[MISS_BUCKETS];
+  alias_entry_t entries[];    // Alias n is entries[n - 1]
+};
+
+// Helpers
+static uint32_t topic_hash( const char* topic )
+{
+  uint32_t hash = 2166136261UL;
+
+  while ( *topic != '\0' )
+  {
+    hash = ( hash ^ (uint8_t) *topic++ ) * 16777619UL;
+  }
+  return hash;
+}
+
+static void entry_clear( alias_entry_t* entry )
+{
+  free( entry->topic );
+  memset( entry, 0, sizeof( *entry ) );
+}
+
+static alias_entry_t* entry_victim( mqtt_alias_table_t* table )
+{
+  alias_entry_t* victim = &table->entries[0];
+
+  for ( uint16_t i = 1; i < table->limit; i++ )
+  {
+    if ( table->entries[i].last_used < victim->last_used )
+    {
+      victim = &table->entries[i];
+    }
+  }
+  return victim;
+}
+
+// Public functions
+mqtt_alias_table_t* MqttAlias_Create( uint16_t capacity, uint8_t hot_threshold )
+{
+  mqtt_alias_table_t* table = calloc( 1, sizeof( *table ) + capacity * sizeof( alias_entry_t ) );
+
+  if ( table != NULL )
+  {
+    table->capacity = capacity;
+    table->hot_threshold = hot_threshold;
+  }
+  return table;
+}
+
+void MqttAlias_Destroy( mqtt_alias_table_t* table )
+{
+  if ( table != NULL )
+  {
+    MqttAlias_Reset( table, 0 );
+    free( table );
+  }
+}
+
+void MqttAlias_Reset( mqtt_alias_table_t* table, uint16_t limit )
+{
+  if ( table == NULL )
+  {
+    return;
+  }
+
+  for ( uint16_t i = 0; i < table->capacity; i++ )
+  {
+    entry_clear( &table->entries[i] );
+  }
+  memset( table->misses, 0, sizeof( table->misses ) );
+  table->limit = ( limit < table->capacity ) ? limit : table->capacity;
+  table->count = 0;
+  table->tick = 0;
+}
+
+uint16_t MqttAlias_Resolve( mqtt_alias_table_t* table, const char* topic, bool* send_topic )
+{
+  alias_entry_t* entry = NULL;
+  uint32_t hash;
+
+  *send_topic = true;
+  if ( table == NULL || table->limit == 0 || topic == NULL || *topic == '\0' )
+  {
+    return 0;
+  }
+
+  hash = topic_hash( topic );
+  for ( uint16_t i = 0; i < table->limit; i++ )
+  {
+    alias_entry_t* e = &table->entries[i];
+    if ( e->topic != NULL && e->hash == hash && strcmp( e->topic, topic ) == 0 )
+    {
+      e->last_used = ++table->tick;
+      *send_topic = false;
+      return (uint16_t) ( i + 1 );
+    }
+    if ( e->topic == NULL && entry == NULL )
+    {
+      entry = e;
+    }
+  }
+
+  if ( entry == NULL )
+  {
+    uint8_t* misses = &table->misses[hash % MISS_BUCKETS];
+    if ( *misses < UINT8_MAX )
+    {
+      ( *misses )++;
+    }
+    if ( *misses < table->hot_threshold )
+    {
+      return 0;
+    }
+    *misses = 0;
+    entry = entry_victim( table );
+    entry_clear( entry );
+    table->count--;
+  }
+
+  size_t size = strlen( topic ) + 1;
+  entry->topic = malloc( size );
+  if ( entry->topic == NULL )
+  {
+    return 0;
+  }
+  memcpy( entry->topic, topic, size );
+  entry->hash = hash;
+  entry->last_used = ++table->tick;
+  table->count++;
+  return (uint16_t) ( entry - table->entries + 1 );
+}
+
+uint16_t MqttAlias_Count( const mqtt_alias_table_t* table )
+{
+  return ( table != NULL ) ? table->count : 0;
+}
@@ -0,0 +1,68 @@
+/**
+ *******************************************************************************
+ * @file    mqtt_topic_alias.h
+ * @brief   Outbound MQTT 5 topic alias assignment
+ *******************************************************************************
+ *
+ * An MQTT 5 PUBLISH may carry a two byte alias instead of its topic once the
+ * alias has been sent together with the topic on the same connection. This
+ * table decides which topics get one. While aliases are free every new
+ * topic takes one; once all are in use a topic has to miss hot_threshold
+ * times before it takes over the alias used least recently, so a one-off
+ * topic does not evict a busy one.
+ *
+ * Mappings only live as long as the connection: call MqttAlias_Reset() with
+ * the broker's Topic Alias Maximum on every CONNACK.
+ *
+ * Not thread safe; the MQTT app uses it from the Mongoose poll task only.
+ */
+
+/* Define to prevent recursive inclusion ------------------------------------*/
+
+#ifndef _MQTT_TOPIC_ALIAS_H
+#define _MQTT_TOPIC_ALIAS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Public types --------------------------------------------------------------*/
+
+typedef struct mqtt_alias_table mqtt_alias_table_t;
+
+/* Public functions ----------------------------------------------------------*/
+
+/**
+ * @brief   Create a table without any usable alias until MqttAlias_Reset().
+ * @param   [in] capacity - Most aliases ever used, whatever the broker allows.
+ * @param   [in] hot_threshold - Misses before a topic evicts another; 0 or 1
+ *          evicts on the first miss.
+ * @return  Table, or NULL if out of memory
+ */
+mqtt_alias_table_t* MqttAlias_Create( uint16_t capacity, uint8_t hot_threshold );
+
+/**
+ * @brief   Free the table and its topic copies.
+ */
+void MqttAlias_Destroy( mqtt_alias_table_t* table );
+
+/**
+ * @brief   Forget every mapping, for a new connection.
+ * @param   [in] limit - Topic Alias Maximum from the CONNACK, 0 if none.
+ */
+void MqttAlias_Reset( mqtt_alias_table_t* table, uint16_t limit );
+
+/**
+ * @brief   Pick the alias for the next PUBLISH to topic.
+ * @param   [out] send_topic - true if the topic has to be sent (a new or
+ *          reassigned alias, or none), false if the alias alone will do.
+ * @return  Alias for the Topic Alias property, 0 to send without one
+ */
+uint16_t MqttAlias_Resolve( mqtt_alias_table_t* table, const char* topic, bool* send_topic );
+
+/**
+ * @brief   Number of aliases mapped on the current connection.
+ */
+uint16_t MqttAlias_Count( const mqtt_alias_table_t* table );
+
+#endif
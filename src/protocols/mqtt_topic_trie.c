@@ -0,0 +1,431 @@
+#include "mqtt_topic_trie.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Children with literal levels are kept sorted so lookups are a binary
+// search; the two wildcards get their own pointers.
+typedef struct trie_node
+{
+  struct trie_node* parent;
+  struct trie_node** children;
+  uint32_t child_count;
+  uint32_t child_cap;
+  struct trie_node* plus;
+  struct trie_node* hash;
+  void* value;
+  bool has_value;
+  size_t level_len;
+  char level[];
+} trie_node_t;
+
+struct mqtt_trie
+{
+  trie_node_t* root;
+  uint32_t count;
+};
+
+// Matching state shared by the recursion
+typedef struct
+{
+  mqtt_trie_visit_cb_t visit;
+  void* arg;
+  uint32_t matches;
+} match_ctx_t;
+
+// Level helpers
+static const char* level_end( const char* p, const char* end )
+{
+  const char* slash = memchr( p, '/', (size_t) ( end - p ) );
+  return ( slash != NULL ) ? slash : end;
+}
+
+static int level_cmp( const trie_node_t* node, const char* level, size_t len )
+{
+  size_t n = ( node->level_len < len ) ? node->level_len : len;
+  int cmp = memcmp( node->level, level, n );
+
+  if ( cmp != 0 )
+  {
+    return cmp;
+  }
+  return ( node->level_len < len ) ? -1 : ( node->level_len > len ) ? 1 : 0;
+}
+
+static bool is_wildcard( const char* level, size_t len, char wildcard )
+{
+  return len == 1 && level[0] == wildcard;
+}
+
+// Children
+static uint32_t child_search( const trie_node_t* node, const char* level, size_t len, bool* found )
+{
+  uint32_t lo = 0;
+  uint32_t hi = node->child_count;
+
+  *found = false;
+  while ( lo < hi )
+  {
+    uint32_t mid = lo + ( hi - lo ) / 2;
+    int cmp = level_cmp( node->children[mid], level, len );
+    if ( cmp == 0 )
+    {
+      *found = true;
+      return mid;
+    }
+    if ( cmp < 0 )
+    {
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+static trie_node_t* child_find( const trie_node_t* node, const char* level, size_t len )
+{
+  bool found;
+
+  if ( is_wildcard( level, len, '+' ) )
+  {
+    return node->plus;
+  }
+  if ( is_wildcard( level, len, '#' ) )
+  {
+    return node->hash;
+  }
+
+  uint32_t i = child_search( node, level, len, &found );
+  return found ? node->children[i] : NULL;
+}
+
+static trie_node_t* child_add( trie_node_t* node, const char* level, size_t len )
+{
+  trie_node_t* child = child_find( node, level, len );
+  bool found;
+
+  if ( child != NULL )
+  {
+    return child;
+  }
+
+  child = calloc( 1, sizeof( *child ) + len + 1 );
+  if ( child == NULL )
+  {
+    return NULL;
+  }
+  child->parent = node;
+  child->level_len = len;
+  memcpy( child->level, level, len );
+
+  if ( is_wildcard( level, len, '+' ) )
+  {
+    node->plus = child;
+    return child;
+  }
+  if ( is_wildcard( level, len, '#' ) )
+  {
+    node->hash = child;
+    return child;
+  }
+
+  if ( node->child_count == node->child_cap )
+  {
+    uint32_t cap = node->child_cap ? node->child_cap * 2 : 4;
+    trie_node_t** children = realloc( node->children, cap * sizeof( *children ) );
+    if ( children == NULL )
+    {
+      free( child );
+      return NULL;
+    }
+    node->children = children;
+    node->child_cap = cap;
+  }
+
+  uint32_t i = child_search( node, level, len, &found );
+  memmove( &node->children[i + 1], &node->children[i], ( node->child_count - i ) * sizeof( *node->children ) );
+  node->children[i] = child;
+  node->child_count++;
+  return child;
+}
+
+static void child_unlink( trie_node_t* node, trie_node_t* child )
+{
+  bool found;
+
+  if ( node->plus == child )
+  {
+    node->plus = NULL;
+    return;
+  }
+  if ( node->hash == child )
+  {
+    node->hash = NULL;
+    return;
+  }
+
+  uint32_t i = child_search( node, child->level, child->level_len, &found );
+  if ( found )
+  {
+    memmove( &node->children[i], &node->children[i + 1], ( node->child_count - i - 1 ) * sizeof( *node->children ) );
+    node->child_count--;
+  }
+}
+
+static bool node_is_empty( const trie_node_t* node )
+{
+  return !node->has_value && node->child_count == 0 && node->plus == NULL && node->hash == NULL;
+}
+
+static void node_free( trie_node_t* node )
+{
+  for ( uint32_t i = 0; i < node->child_count; i++ )
+  {
+    node_free( node->children[i] );
+  }
+  if ( node->plus != NULL )
+  {
+    node_free( node->plus );
+  }
+  if ( node->hash != NULL )
+  {
+    node_free( node->hash );
+  }
+  free( node->children );
+  free( node );
+}
+
+static trie_node_t* node_walk( const trie_node_t* root, const char* filter )
+{
+  const char* p = filter;
+  const char* end = filter + strlen( filter );
+  const trie_node_t* node = root;
+
+  while ( node != NULL )
+  {
+    const char* e = level_end( p, end );
+    node = child_find( node, p, (size_t) ( e - p ) );
+    if ( e == end )
+    {
+      break;
+    }
+    p = e + 1;
+  }
+  return (trie_node_t*) node;
+}
+
+// Matching
+static void node_visit( const trie_node_t* node, match_ctx_t* ctx )
+{
+  if ( node != NULL && node->has_value )
+  {
+    ctx->matches++;
+    ctx->visit( node->value, ctx->arg );
+  }
+}
+
+// p points at the next level of the topic, or done is set once every level
+// has been consumed by the walk down to node.
+static void match_node( const trie_node_t* node, const char* p, const char* end, bool done, bool root_dollar,
+                        match_ctx_t* ctx )
+{
+  // "a/#" matches "a" as well as everything below it
+  if ( !root_dollar )
+  {
+    node_visit( node->hash, ctx );
+  }
+
+  if ( done )
+  {
+    node_visit( node, ctx );
+    return;
+  }
+
+  const char* e = level_end( p, end );
+  bool last = ( e == end );
+  const char* next = last ? end : e + 1;
+  size_t len = (size_t) ( e - p );
+  bool found;
+
+  if ( node->child_count > 0 )
+  {
+    uint32_t i = child_search( node, p, len, &found );
+    if ( found )
+    {
+      match_node( node->children[i], next, end, last, false, ctx );
+    }
+  }
+
+  if ( node->plus != NULL && !root_dollar )
+  {
+    match_node( node->plus, next, end, last, false, ctx );
+  }
+}
+
+// Public functions
+mqtt_trie_t* MqttTrie_Create( void )
+{
+  mqtt_trie_t* trie = calloc( 1, sizeof( *trie ) );
+
+  if ( trie != NULL )
+  {
+    trie->root = calloc( 1, sizeof( trie_node_t ) );
+    if ( trie->root == NULL )
+    {
+      free( trie );
+      trie = NULL;
+    }
+  }
+  return trie;
+}
+
+void MqttTrie_Destroy( mqtt_trie_t* trie )
+{
+  if ( trie != NULL )
+  {
+    node_free( trie->root );
+    free( trie );
+  }
+}
+
+bool MqttTrie_IsValidFilter( const char* filter )
+{
+  const char* p = filter;
+  const char* end;
+
+  if ( filter == NULL || *filter == '\0' )
+  {
+    return false;
+  }
+
+  end = filter + strlen( filter );
+  while ( true )
+  {
+    const char* e = level_end( p, end );
+    size_t len = (size_t) ( e - p );
+
+    if ( ( memchr( p, '+', len ) != NULL && !is_wildcard( p, len, '+' ) ) ||
+         ( memchr( p, '#', len ) != NULL && ( !is_wildcard( p, len, '#' ) || e != end ) ) )
+    {
+      return false;
+    }
+    if ( e == end )
+    {
+      return true;
+    }
+    p = e + 1;
+  }
+}
+
+bool MqttTrie_Insert( mqtt_trie_t* trie, const char* filter, void* value )
+{
+  const char* p = filter;
+  const char* end;
+  trie_node_t* node;
+
+  if ( trie == NULL || !MqttTrie_IsValidFilter( filter ) )
+  {
+    return false;
+  }
+
+  end = filter + strlen( filter );
+  node = trie->root;
+  while ( true )
+  {
+    const char* e = level_end( p, end );
+    trie_node_t* child = child_add( node, p, (size_t) ( e - p ) );
+    if ( child == NULL )
+    {
+      // Drop the part of the path created for this filter
+      while ( node != trie->root && node_is_empty( node ) )
+      {
+        trie_node_t* parent = node->parent;
+        child_unlink( parent, node );
+        node_free( node );
+        node = parent;
+      }
+      return false;
+    }
+    node = child;
+    if ( e == end )
+    {
+      break;
+    }
+    p = e + 1;
+  }
+
+  if ( node->has_value )
+  {
+    return false;
+  }
+  node->value = value;
+  node->has_value = true;
+  trie->count++;
+  return true;
+}
+
+void* MqttTrie_Lookup( const mqtt_trie_t* trie, const char* filter )
+{
+  const trie_node_t* node;
+
+  if ( trie == NULL || filter == NULL || *filter == '\0' )
+  {
+    return NULL;
+  }
+
+  node = node_walk( trie->root, filter );
+  return ( node != NULL && node->has_value ) ? node->value : NULL;
+}
+
+void* MqttTrie_Remove( mqtt_trie_t* trie, const char* filter )
+{
+  trie_node_t* node;
+  void* value;
+
+  if ( trie == NULL || filter == NULL || *filter == '\0' )
+  {
+    return NULL;
+  }
+
+  node = node_walk( trie->root, filter );
+  if ( node == NULL || !node->has_value )
+  {
+    return NULL;
+  }
+
+  value = node->value;
+  node->value = NULL;
+  node->has_value = false;
+  trie->count--;
+
+  while ( node != trie->root && node_is_empty( node ) )
+  {
+    trie_node_t* parent = node->parent;
+    child_unlink( parent, node );
+    node_free( node );
+    node = parent;
+  }
+  return value;
+}
+
+uint32_t MqttTrie_Match( const mqtt_trie_t* trie, const char* topic, size_t len,
+                         mqtt_trie_visit_cb_t visit, void* arg )
+{
+  match_ctx_t ctx = { .visit = visit, .arg = arg, .matches = 0 };
+
+  if ( trie == NULL || topic == NULL || len == 0 || visit == NULL )
+  {
+    return 0;
+  }
+
+  match_node( trie->root, topic, topic + len, false, topic[0] == '$', &ctx );
+  return ctx.matches;
+}
+
+uint32_t MqttTrie_Count( const mqtt_trie_t* trie )
+{
+  return ( trie != NULL ) ? trie->count : 0;
+}
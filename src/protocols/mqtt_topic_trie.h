@@ -0,0 +1,88 @@
+/**
+ *******************************************************************************
+ * @file    mqtt_topic_trie.h
+ * @brief   Topic filter trie with MQTT wildcard matching
+ *******************************************************************************
+ *
+ * Maps topic filters to values, one level per node. Matching a topic walks
+ * its levels once, following the exact, '+' and '#' children at each node,
+ * so the cost depends on the topic depth rather than the number of filters.
+ * Follows the MQTT 3.1.1 rules: '#' also matches the parent level, and
+ * filters starting with a wildcard never match topics starting with '$'.
+ *
+ * Not thread safe; the MQTT app uses it from the Mongoose poll task only.
+ */
+
+/* Define to prevent recursive inclusion ------------------------------------*/
+
+#ifndef _MQTT_TOPIC_TRIE_H
+#define _MQTT_TOPIC_TRIE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Public types --------------------------------------------------------------*/
+
+typedef struct mqtt_trie mqtt_trie_t;
+
+/**
+ * @brief   Called for each filter that matches a topic.
+ * @param   [in] value - Value stored with the filter.
+ * @param   [in] arg - Argument passed to MqttTrie_Match().
+ */
+typedef void (*mqtt_trie_visit_cb_t)(void* value, void* arg);
+
+/* Public functions ----------------------------------------------------------*/
+
+/**
+ * @brief   Create an empty trie.
+ * @return  Trie, or NULL if out of memory
+ */
+mqtt_trie_t* MqttTrie_Create( void );
+
+/**
+ * @brief   Free the trie. Values are not touched.
+ */
+void MqttTrie_Destroy( mqtt_trie_t* trie );
+
+/**
+ * @brief   Check a topic filter: '+' and '#' must fill a whole level and
+ *          '#' must be the last level.
+ */
+bool MqttTrie_IsValidFilter( const char* filter );
+
+/**
+ * @brief   Store value under filter.
+ * @return  true - if stored; false if the filter is invalid, already
+ *          present or memory ran out
+ */
+bool MqttTrie_Insert( mqtt_trie_t* trie, const char* filter, void* value );
+
+/**
+ * @brief   Find the value stored under exactly this filter.
+ * @return  Value, or NULL if the filter is not present
+ */
+void* MqttTrie_Lookup( const mqtt_trie_t* trie, const char* filter );
+
+/**
+ * @brief   Remove filter and prune the nodes it no longer needs.
+ * @return  The value that was stored, or NULL if the filter is not present
+ */
+void* MqttTrie_Remove( mqtt_trie_t* trie, const char* filter );
+
+/**
+ * @brief   Visit the value of every filter that matches topic.
+ * @param   [in] topic - Topic name; need not be NUL-terminated.
+ * @param   [in] len - Topic length in bytes.
+ * @return  Number of matching filters
+ */
+uint32_t MqttTrie_Match( const mqtt_trie_t* trie, const char* topic, size_t len,
+                         mqtt_trie_visit_cb_t visit, void* arg );
+
+/**
+ * @brief   Number of filters stored.
+ */
+uint32_t MqttTrie_Count( const mqtt_trie_t* trie );
+
+#endif
@@ -0,0 +1,144 @@
+/*
+ * CLI Output Benchmark
+ *
+ * Runs a command that prints a status dump of about 2 KB through the CLI and
+ * reports the write() calls and wall time it costs. Every byte used to be a
+ * write() of its own; the output buffer turns the dump into a few blocks.
+ *
+ * The binary is linked with -Wl,--wrap=write so the calls made by the CLI
+ * platform layer can be counted. Output goes to /dev/null.
+ *
+ * Usage: hq_cmd_bench [-n iterations] [-l lines_per_dump]
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hq_cmd.h"
+#include "hq_config.h"
+
+ssize_t __real_write(int fd, const void *buf, size_t len);
+
+static unsigned long g_writes;
+static unsigned long g_bytes;
+static int g_lines = 40;
+
+ssize_t __wrap_write(int fd, const void *buf, size_t len)
+{
+    if (fd == STDOUT_FILENO)
+    {
+        g_writes++;
+        g_bytes += len;
+    }
+    return __real_write(fd, buf, len);
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* A status dump in the shape of a task list: 50 byte lines */
+static void cmd_dump_handler(hq_cmd_cli_t *cli, char *args, void *context)
+{
+    char line[64];
+
+    (void)cli;
+    (void)args;
+    (void)context;
+
+    for (int i = 0; i < g_lines; i++)
+    {
+        snprintf(line, sizeof(line), "task %-12s state %-8s stack %6d prio %2d", "worker", "blocked",
+                 4096 - i * 13, i % 25);
+        hq_cmd_print(line);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static const char command[] = "dump\r";
+    hq_cmd_binding_t dump_binding = {
+        .name = "dump",
+        .help = "Print a status dump",
+        .tokenize_args = false,
+        .context = NULL,
+        .handler = cmd_dump_handler,
+    };
+    long iterations = 1000;
+    int console;
+    int devnull;
+    int opt;
+    uint64_t start;
+    uint64_t elapsed;
+
+    while ((opt = getopt(argc, argv, "n:l:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': iterations = atol(optarg); break;
+            case 'l': g_lines = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-n iterations] [-l lines]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (iterations < 1)
+    {
+        iterations = 1;
+    }
+    if (g_lines < 1)
+    {
+        g_lines = 1;
+    }
+
+    if (hq_cmd_init() != 0 || hq_cmd_register(&dump_binding) != 0)
+    {
+        fprintf(stderr, "failed to start the CLI\n");
+        return 1;
+    }
+    /* Feed the commands from here instead of the input task */
+    hq_cmd_stop();
+    hq_cmd_wait();
+
+    console = dup(STDOUT_FILENO);
+    devnull = open("/dev/null", O_WRONLY);
+    if (console < 0 || devnull < 0 || dup2(devnull, STDOUT_FILENO) < 0)
+    {
+        fprintf(stderr, "failed to redirect stdout\n");
+        return 1;
+    }
+
+    g_writes = 0;
+    g_bytes = 0;
+    start = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        for (const char *c = command; *c != '\0'; c++)
+        {
+            hq_cmd_receive_char(*c);
+        }
+        hq_cmd_process();
+    }
+    elapsed = now_ns() - start;
+
+    (void)dup2(console, STDOUT_FILENO);
+    close(devnull);
+    close(console);
+
+    printf("CLI output: %d line dump, %ld iterations, %d byte output buffer\n", g_lines, iterations,
+           CONFIG_CMD_OUTPUT_BUFFER_SIZE);
+    printf("  %lu bytes per command  %lu write() calls per command (%lu bytes each)\n", g_bytes / iterations,
+           g_writes / iterations, g_writes ? g_bytes / g_writes : 0UL);
+    printf("  %.1f us per command  (one write() per byte would be %lu calls)\n",
+           (double)elapsed / 1e3 / (double)iterations, g_bytes / iterations);
+
+    hq_cmd_deinit();
+    return 0;
+}
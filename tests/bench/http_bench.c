@@ -0,0 +1,335 @@
+/*
+ * HTTP Server Load Generator
+ *
+ * Starts the HTTP server in-process (or targets an external one with -u),
+ * opens N keep-alive client connections on a separate Mongoose manager and
+ * drives a weighted mix of API and static-file requests for a fixed time.
+ * Reports throughput and latency percentiles.
+ *
+ * Usage: hq_http_bench [-c connections] [-d seconds] [-u base_url]
+ *                      [-r path[:weight]]...
+ *
+ * Default mix: /api/bench (weight 8), /small.html (1 KB, weight 1),
+ *              /large.bin (16 KB, weight 1).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "http_server.h"
+#include "mongoose.h"
+#include "mongoose_process.h"
+#include "osal_task.h"
+
+#define MAX_CONNECTIONS 256
+#define MAX_ROUTES      16
+#define MAX_SAMPLES     (4U * 1024U * 1024U)
+
+typedef struct
+{
+    char path[128];
+    uint32_t weight;
+    uint64_t count;
+} route_t;
+
+typedef struct
+{
+    struct mg_connection *c;
+    uint64_t sent_ns;
+    int route;
+} client_t;
+
+static route_t g_routes[MAX_ROUTES];
+static int g_route_count;
+static uint32_t g_weight_total;
+
+static client_t g_clients[MAX_CONNECTIONS];
+static uint32_t *g_samples_us;
+static size_t g_sample_count;
+static uint64_t g_completed;
+static uint64_t g_errors;
+static uint64_t g_non_2xx;
+static uint64_t g_bytes;
+static uint32_t g_rng = 0x12345678U;
+static volatile int g_running = 1;
+
+static char g_host[64];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Deterministic mix so runs are comparable. */
+static int pick_route(void)
+{
+    uint32_t r;
+
+    g_rng = g_rng * 1664525U + 1013904223U;
+    r = (g_rng >> 8) % g_weight_total;
+
+    for (int i = 0; i < g_route_count; i++)
+    {
+        if (r < g_routes[i].weight)
+        {
+            return i;
+        }
+        r -= g_routes[i].weight;
+    }
+    return 0;
+}
+
+static void send_request(client_t *cl)
+{
+    cl->route = pick_route();
+    cl->sent_ns = now_ns();
+    mg_printf(cl->c, "GET %s HTTP/1.1\r\nHost: %s\r\n\r\n", g_routes[cl->route].path, g_host);
+}
+
+static void client_fn(struct mg_connection *c, int ev, void *ev_data)
+{
+    client_t *cl = (client_t *)c->fn_data;
+
+    if (ev == MG_EV_CONNECT)
+    {
+        send_request(cl);
+    }
+    else if (ev == MG_EV_HTTP_MSG)
+    {
+        struct mg_http_message *hm = (struct mg_http_message *)ev_data;
+        uint64_t elapsed_us = (now_ns() - cl->sent_ns) / 1000U;
+        int status = mg_http_status(hm);
+
+        if (g_sample_count < MAX_SAMPLES)
+        {
+            g_samples_us[g_sample_count++] = (elapsed_us > UINT32_MAX) ? UINT32_MAX : (uint32_t)elapsed_us;
+        }
+        g_completed++;
+        g_bytes += hm->message.len;
+        g_routes[cl->route].count++;
+        if (status < 200 || status > 299)
+        {
+            g_non_2xx++;
+        }
+
+        if (g_running)
+        {
+            send_request(cl);
+        }
+    }
+    else if (ev == MG_EV_ERROR)
+    {
+        g_errors++;
+    }
+    else if (ev == MG_EV_CLOSE)
+    {
+        cl->c = NULL;
+    }
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t percentile(double p)
+{
+    size_t idx;
+
+    if (g_sample_count == 0U)
+    {
+        return 0U;
+    }
+
+    idx = (size_t)(p * (double)(g_sample_count - 1U) + 0.5);
+    return g_samples_us[idx];
+}
+
+static void add_route(const char *spec)
+{
+    const char *colon = strrchr(spec, ':');
+    size_t len = (colon != NULL) ? (size_t)(colon - spec) : strlen(spec);
+    route_t *r;
+
+    if (g_route_count >= MAX_ROUTES || len == 0U || len >= sizeof(g_routes[0].path))
+    {
+        fprintf(stderr, "ignoring route '%s'\n", spec);
+        return;
+    }
+
+    r = &g_routes[g_route_count++];
+    memcpy(r->path, spec, len);
+    r->path[len] = '\0';
+    r->weight = (colon != NULL) ? (uint32_t)strtoul(colon + 1, NULL, 10) : 1U;
+    if (r->weight == 0U)
+    {
+        r->weight = 1U;
+    }
+    g_weight_total += r->weight;
+}
+
+static HTTPServerResponse_t bench_api(struct mg_str *uri, struct mg_str *data, HTTPServerMethod_t method)
+{
+    HTTPServerResponse_t response = {
+        200, "Content-Type: application/json\r\n", "{\"ok\":true,\"value\":42}\n"
+    };
+
+    (void)uri;
+    (void)data;
+    (void)method;
+    return response;
+}
+
+static void write_file(const char *dir, const char *name, size_t size)
+{
+    char path[256];
+    FILE *f;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    f = fopen(path, "wb");
+    if (f == NULL)
+    {
+        return;
+    }
+    for (size_t i = 0; i < size; i++)
+    {
+        fputc('a' + (int)(i % 26U), f);
+    }
+    fclose(f);
+}
+
+static void start_local_server(char *root, size_t root_size)
+{
+    static HTTPServerApiToken_t token = { .api_name = "bench", .cb = bench_api };
+
+    snprintf(root, root_size, "/tmp/hq_http_bench_%d", (int)getpid());
+    mkdir(root, 0755);
+    write_file(root, "small.html", 1024U);
+    write_file(root, "large.bin", 16U * 1024U);
+
+    MongooseProcess_Init();
+    HTTPServer_AddApiToken(&token);
+    HTTPServer_SetStaticRoot(root);
+    HTTPServer_Init();
+
+    /* Give the poll task a cycle to pick up the listener. */
+    osal_task_delay_ms(200);
+}
+
+int main(int argc, char **argv)
+{
+    int connections = 32;
+    int seconds = 5;
+    const char *url = NULL;
+    char root[64] = "";
+    struct mg_mgr client_mgr;
+    uint64_t start;
+    uint64_t elapsed;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:d:u:r:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'c': connections = atoi(optarg); break;
+            case 'd': seconds = atoi(optarg); break;
+            case 'u': url = optarg; break;
+            case 'r': add_route(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-c conns] [-d seconds] [-u url] [-r path[:weight]]...\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (connections < 1 || connections > MAX_CONNECTIONS)
+    {
+        connections = (connections < 1) ? 1 : MAX_CONNECTIONS;
+    }
+    if (seconds < 1)
+    {
+        seconds = 1;
+    }
+    if (g_route_count == 0)
+    {
+        add_route("/api/bench:8");
+        add_route("/small.html:1");
+        add_route("/large.bin:1");
+    }
+
+    g_samples_us = (uint32_t *)malloc(MAX_SAMPLES * sizeof(uint32_t));
+    if (g_samples_us == NULL)
+    {
+        return 1;
+    }
+
+    if (url == NULL)
+    {
+        start_local_server(root, sizeof(root));
+        url = "http://127.0.0.1:8000";
+    }
+
+    {
+        struct mg_str host = mg_url_host(url);
+        snprintf(g_host, sizeof(g_host), "%.*s", (int)host.len, host.buf);
+    }
+
+    mg_mgr_init(&client_mgr);
+    mg_log_set(MG_LL_ERROR);
+
+    for (int i = 0; i < connections; i++)
+    {
+        g_clients[i].c = mg_http_connect(&client_mgr, url, client_fn, &g_clients[i]);
+    }
+
+    printf("HTTP load: %s, %d connections, %d s\n", url, connections, seconds);
+
+    start = now_ns();
+    while (now_ns() - start < (uint64_t)seconds * 1000000000ULL)
+    {
+        mg_mgr_poll(&client_mgr, 10);
+    }
+    g_running = 0;
+    elapsed = now_ns() - start;
+
+    mg_mgr_free(&client_mgr);
+
+    qsort(g_samples_us, g_sample_count, sizeof(g_samples_us[0]), cmp_u32);
+
+    printf("  requests:   %llu (%.0f req/s, %.1f MB/s)\n",
+           (unsigned long long)g_completed,
+           (double)g_completed * 1e9 / (double)elapsed,
+           (double)g_bytes * 1e9 / (double)elapsed / (1024.0 * 1024.0));
+    printf("  errors:     %llu transport, %llu non-2xx\n",
+           (unsigned long long)g_errors, (unsigned long long)g_non_2xx);
+    printf("  latency us: p50 %u  p90 %u  p99 %u  p99.9 %u  max %u\n",
+           percentile(0.50), percentile(0.90), percentile(0.99), percentile(0.999),
+           percentile(1.0));
+    for (int i = 0; i < g_route_count; i++)
+    {
+        printf("  %-24s weight %-3u %llu\n", g_routes[i].path, g_routes[i].weight,
+               (unsigned long long)g_routes[i].count);
+    }
+
+    if (root[0] != '\0')
+    {
+        char path[128];
+
+        HTTPServer_Deinit();
+        snprintf(path, sizeof(path), "%s/small.html", root);
+        remove(path);
+        snprintf(path, sizeof(path), "%s/large.bin", root);
+        remove(path);
+        rmdir(root);
+    }
+
+    free(g_samples_us);
+    return (g_completed > 0U) ? 0 : 1;
+}
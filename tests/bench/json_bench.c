@@ -0,0 +1,185 @@
+/*
+ * JSON Extraction Benchmark
+ *
+ * Compares extracting a set of fields with repeated mg_json_get_*() calls
+ * (one document scan per field) against a single hq_json_parse() pass, on
+ * generated ~1 KB and ~16 KB telemetry documents.
+ *
+ * Usage: hq_json_bench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hq_json.h"
+#include "mongoose.h"
+
+#define FIELD_COUNT 8
+
+typedef struct
+{
+    char id[32];
+    char fw[16];
+    int64_t seq;
+    int64_t ts;
+    double temp;
+    double hum;
+    bool ok;
+    int64_t interval;
+} telemetry_t;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Fields are spread before and after a bulky samples array on purpose. */
+static size_t build_document(char *buf, size_t size, size_t target_len)
+{
+    hq_json_writer_t w;
+    int64_t i = 0;
+
+    for (;;)
+    {
+        hq_json_writer_init(&w, buf, size);
+        hq_json_obj_begin(&w);
+        hq_json_key(&w, "device");
+        hq_json_obj_begin(&w);
+        hq_json_kv_str(&w, "id", "hq-0042-sensor");
+        hq_json_kv_str(&w, "fw", "1.4.2");
+        hq_json_obj_end(&w);
+        hq_json_kv_int(&w, "seq", 123456);
+        hq_json_key(&w, "samples");
+        hq_json_arr_begin(&w);
+        for (int64_t s = 0; s < i; s++)
+        {
+            hq_json_obj_begin(&w);
+            hq_json_kv_int(&w, "t", 1700000000 + s);
+            hq_json_kv_double(&w, "v", 20.0 + (double)(s % 17) * 0.25);
+            hq_json_obj_end(&w);
+        }
+        hq_json_arr_end(&w);
+        hq_json_kv_int(&w, "ts", 1700000123);
+        hq_json_kv_double(&w, "temp", 21.75);
+        hq_json_kv_double(&w, "hum", 48.5);
+        hq_json_kv_bool(&w, "ok", true);
+        hq_json_key(&w, "cfg");
+        hq_json_obj_begin(&w);
+        hq_json_kv_int(&w, "interval", 30);
+        hq_json_obj_end(&w);
+        hq_json_obj_end(&w);
+
+        if (hq_json_writer_finish(&w) < 0 || w.total >= target_len)
+        {
+            return w.len;
+        }
+        i++;
+    }
+}
+
+static void extract_mg(struct mg_str json, telemetry_t *t)
+{
+    char *s;
+
+    s = mg_json_get_str(json, "$.device.id");
+    if (s != NULL)
+    {
+        snprintf(t->id, sizeof(t->id), "%s", s);
+        free(s);
+    }
+    s = mg_json_get_str(json, "$.device.fw");
+    if (s != NULL)
+    {
+        snprintf(t->fw, sizeof(t->fw), "%s", s);
+        free(s);
+    }
+    t->seq = mg_json_get_long(json, "$.seq", 0);
+    t->ts = mg_json_get_long(json, "$.ts", 0);
+    mg_json_get_num(json, "$.temp", &t->temp);
+    mg_json_get_num(json, "$.hum", &t->hum);
+    mg_json_get_bool(json, "$.ok", &t->ok);
+    t->interval = mg_json_get_long(json, "$.cfg.interval", 0);
+}
+
+static int32_t extract_hq(const char *json, size_t len, telemetry_t *t)
+{
+    const hq_json_field_t fields[FIELD_COUNT] = {
+        { "$.device.id",    HQ_JSON_TYPE_STRING, t->id,        sizeof(t->id) },
+        { "$.device.fw",    HQ_JSON_TYPE_STRING, t->fw,        sizeof(t->fw) },
+        { "$.seq",          HQ_JSON_TYPE_INT,    &t->seq,      0 },
+        { "$.ts",           HQ_JSON_TYPE_INT,    &t->ts,       0 },
+        { "$.temp",         HQ_JSON_TYPE_DOUBLE, &t->temp,     0 },
+        { "$.hum",          HQ_JSON_TYPE_DOUBLE, &t->hum,      0 },
+        { "$.ok",           HQ_JSON_TYPE_BOOL,   &t->ok,       0 },
+        { "$.cfg.interval", HQ_JSON_TYPE_INT,    &t->interval, 0 },
+    };
+
+    return hq_json_parse(json, len, fields, FIELD_COUNT, NULL);
+}
+
+static void run_case(const char *label, size_t target_len, long iterations)
+{
+    static char doc[32 * 1024];
+    size_t len = build_document(doc, sizeof(doc), target_len);
+    struct mg_str json = mg_str_n(doc, len);
+    telemetry_t a;
+    telemetry_t b;
+    uint64_t t0;
+    uint64_t mg_ns;
+    uint64_t hq_ns;
+
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+
+    t0 = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        extract_mg(json, &a);
+    }
+    mg_ns = now_ns() - t0;
+
+    t0 = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        if (extract_hq(doc, len, &b) != FIELD_COUNT)
+        {
+            printf("  %s: hq_json_parse failed\n", label);
+            return;
+        }
+    }
+    hq_ns = now_ns() - t0;
+
+    if (strcmp(a.id, b.id) != 0 || strcmp(a.fw, b.fw) != 0 || a.seq != b.seq ||
+        a.ts != b.ts || a.temp != b.temp || a.hum != b.hum || a.ok != b.ok ||
+        a.interval != b.interval)
+    {
+        printf("  %s: results differ between parsers\n", label);
+        return;
+    }
+
+    printf("  %-6s %6zu bytes  mg_json_get x%d: %8.0f ns/doc  hq_json_parse: %8.0f ns/doc  speedup %.1fx\n",
+           label, len, FIELD_COUNT,
+           (double)mg_ns / (double)iterations,
+           (double)hq_ns / (double)iterations,
+           (hq_ns > 0U) ? (double)mg_ns / (double)hq_ns : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = (argc > 1) ? strtol(argv[1], NULL, 10) : 20000;
+
+    if (iterations <= 0)
+    {
+        iterations = 20000;
+    }
+
+    printf("JSON field extraction, %d fields, %ld iterations\n", FIELD_COUNT, iterations);
+    run_case("1KB", 1024U, iterations);
+    run_case("16KB", 16U * 1024U, iterations / 8 > 0 ? iterations / 8 : 1);
+
+    return 0;
+}
@@ -0,0 +1,337 @@
+/*
+ * MQTT Client Benchmark
+ *
+ * Runs MqttApp against the in-process broker stand-in, behind a relay that
+ * adds a fixed one-way delay and optionally loses packets, and measures:
+ *
+ * - acknowledged QoS 1 messages per second for several in-flight window
+ *   sizes; with a window of N the ceiling is roughly N / RTT
+ * - end-to-end latency of single QoS 1 messages published and received
+ *   back through a subscription
+ * - recovery after the relay drops the connection: time until the session
+ *   is back and until a message published right after the drop arrives
+ *
+ * A lost packet stalls its direction for NET_DELAY_PROXY_RTO_MS, like a TCP
+ * retransmission. With -s the broker and client speak TLS, so connection and
+ * recovery times include a full handshake over the delayed link.
+ *
+ * Usage: hq_mqtt_bench [-n messages] [-l one_way_delay_ms] [-p loss_percent]
+ *                      [-w window[,window...]] [-r reconnect_rounds] [-s]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hq_metrics.h"
+#include "mongoose_process.h"
+#include "mqtt_app.h"
+#include "mqtt_broker_stub.h"
+#include "mqtt_config.h"
+#include "net_delay_proxy.h"
+#include "osal_task.h"
+
+#define BROKER_URL "mqtt://127.0.0.1:18831"
+#define PROXY_URL  "tcp://127.0.0.1:18832"
+#define CLIENT_URL "mqtt://127.0.0.1:18832"
+#define TLS_BROKER_URL "mqtts://127.0.0.1:18831"
+#define TLS_CLIENT_URL "mqtts://127.0.0.1:18832"
+#define MAX_WINDOWS 16
+#define MAX_SAMPLES 1000
+
+/* Time and count of echoed messages, written on the poll task */
+static volatile uint64_t g_received_ns;
+static volatile uint32_t g_received;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static bool wait_connected(uint32_t timeout_ms)
+{
+    for (uint32_t waited = 0; waited < timeout_ms; waited += 10U)
+    {
+        if (MqttApp_IsConnected())
+        {
+            return true;
+        }
+        osal_task_delay_ms(10);
+    }
+    return false;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void on_echo(const char *topic, size_t topic_len, const char *message, size_t message_len, void *ctx)
+{
+    (void)topic;
+    (void)topic_len;
+    (void)message;
+    (void)message_len;
+    (void)ctx;
+    __atomic_store_n(&g_received_ns, now_ns(), __ATOMIC_RELEASE);
+    __atomic_add_fetch(&g_received, 1U, __ATOMIC_RELEASE);
+}
+
+/* Publishes one message and waits for it to come back; 0 on timeout. */
+static uint64_t echo_once(uint32_t timeout_ms)
+{
+    uint32_t before = __atomic_load_n(&g_received, __ATOMIC_ACQUIRE);
+    uint64_t start = now_ns();
+    uint64_t deadline = start + (uint64_t)timeout_ms * 1000000ULL;
+
+    while (!MqttApp_PostData("hq/echo", "{\"probe\":1}", 1))
+    {
+        if (now_ns() > deadline)
+        {
+            return 0;
+        }
+        osal_task_delay_ms(1);
+    }
+    while (__atomic_load_n(&g_received, __ATOMIC_ACQUIRE) == before)
+    {
+        if (now_ns() > deadline)
+        {
+            return 0;
+        }
+        usleep(100);
+    }
+    return __atomic_load_n(&g_received_ns, __ATOMIC_ACQUIRE) - start;
+}
+
+static void run_latency(long messages)
+{
+    static uint64_t samples[MAX_SAMPLES];
+    long count = 0;
+
+    if (messages > MAX_SAMPLES)
+    {
+        messages = MAX_SAMPLES;
+    }
+    for (long i = 0; i < messages; i++)
+    {
+        uint64_t ns = echo_once(10000U);
+
+        if (ns != 0)
+        {
+            samples[count++] = ns;
+        }
+    }
+    if (count == 0)
+    {
+        printf("  latency: failed\n");
+        return;
+    }
+    qsort(samples, (size_t)count, sizeof(samples[0]), compare_u64);
+    printf("  latency (%ld/%ld delivered): p50 %.2f ms  p90 %.2f ms  p99 %.2f ms  max %.2f ms\n", count, messages,
+           (double)samples[count / 2] / 1e6, (double)samples[count * 9 / 10] / 1e6,
+           (double)samples[count * 99 / 100] / 1e6, (double)samples[count - 1] / 1e6);
+}
+
+static void run_recovery(int rounds)
+{
+    uint64_t connect_sum = 0;
+    uint64_t deliver_sum = 0;
+    uint64_t deliver_max = 0;
+    int done = 0;
+
+    for (int i = 0; i < rounds; i++)
+    {
+        uint64_t start;
+        uint64_t connected;
+        uint64_t delivered;
+
+        if (!wait_connected(30000U))
+        {
+            break;
+        }
+        start = now_ns();
+        net_delay_proxy_disconnect();
+        /* Published while the client may not know yet that the link is gone */
+        delivered = echo_once(30000U);
+        while (!MqttApp_IsConnected() && now_ns() - start < 30000000000ULL)
+        {
+            osal_task_delay_ms(1);
+        }
+        connected = now_ns() - start;
+        if (delivered == 0)
+        {
+            continue;
+        }
+        connect_sum += connected;
+        deliver_sum += delivered;
+        deliver_max = (delivered > deliver_max) ? delivered : deliver_max;
+        done++;
+    }
+    if (done == 0)
+    {
+        printf("  recovery: failed\n");
+        return;
+    }
+    printf("  recovery (%d/%d rounds): reconnected %.0f ms  first delivery avg %.0f ms  max %.0f ms\n", done,
+           rounds, (double)connect_sum / 1e6 / done, (double)deliver_sum / 1e6 / done, (double)deliver_max / 1e6);
+}
+
+/* Returns acknowledged messages per second, or a negative value on failure. */
+static double run_window(int window, long messages, hq_metric_t *acked)
+{
+    char payload[64];
+    int64_t target;
+    uint64_t start;
+    uint64_t deadline;
+
+    MQTTConfig_SetInt(window, MQTT_CONFIG_VALUE_INFLIGHT);
+    MqttApp_Init();
+    if (!wait_connected(5000U))
+    {
+        MqttApp_Deinit();
+        return -1.0;
+    }
+
+    target = hq_metrics_value(acked) + messages;
+    start = now_ns();
+
+    for (long i = 0; i < messages; i++)
+    {
+        snprintf(payload, sizeof(payload), "{\"seq\":%ld}", i);
+        /* A full queue means the window is full; wait for PUBACKs */
+        while (!MqttApp_PostData("hq/bench", payload, 1))
+        {
+            osal_task_delay_ms(1);
+        }
+    }
+
+    deadline = now_ns() + 60ULL * 1000000000ULL;
+    while (hq_metrics_value(acked) < target && now_ns() < deadline)
+    {
+        osal_task_delay_ms(1);
+    }
+
+    MqttApp_Deinit();
+
+    if (hq_metrics_value(acked) < target)
+    {
+        return -1.0;
+    }
+    return (double)messages * 1e9 / (double)(now_ns() - start);
+}
+
+int main(int argc, char **argv)
+{
+    long messages = 1000;
+    int delay_ms = 10;
+    int loss = 0;
+    int rounds = 5;
+    bool tls = false;
+    int windows[MAX_WINDOWS] = { 1, 4, 8, 16 };
+    int window_count = 4;
+    double baseline = 0.0;
+    hq_metric_t *acked;
+    hq_metric_t *handshakes;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:l:p:w:r:s")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': messages = atol(optarg); break;
+            case 'l': delay_ms = atoi(optarg); break;
+            case 'p': loss = atoi(optarg); break;
+            case 'r': rounds = atoi(optarg); break;
+            case 's': tls = true; break;
+            case 'w':
+                window_count = 0;
+                for (char *tok = strtok(optarg, ","); tok != NULL && window_count < MAX_WINDOWS;
+                     tok = strtok(NULL, ","))
+                {
+                    windows[window_count++] = atoi(tok);
+                }
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n messages] [-l delay_ms] [-p loss_percent] [-w window[,window...]] "
+                        "[-r rounds] [-s]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (messages < 1)
+    {
+        messages = 1;
+    }
+    if (delay_ms < 0)
+    {
+        delay_ms = 0;
+    }
+    loss = (loss < 0) ? 0 : (loss > 100) ? 100 : loss;
+
+    hq_metrics_init();
+    MongooseProcess_Init();
+
+    if (!mqtt_broker_stub_start(tls ? TLS_BROKER_URL : BROKER_URL) ||
+        !net_delay_proxy_start(PROXY_URL, "tcp://127.0.0.1:18831", (uint32_t)delay_ms))
+    {
+        fprintf(stderr, "failed to start broker stand-in or delay relay\n");
+        return 1;
+    }
+    net_delay_proxy_set_loss((uint32_t)loss);
+
+    MQTTConfig_Init();
+    MQTTConfig_SetString(tls ? TLS_CLIENT_URL : CLIENT_URL, MQTT_CONFIG_VALUE_ADDRESS);
+    if (tls)
+    {
+        static const char ca[] = MQTT_BROKER_STUB_TLS_CA;
+        MQTTConfig_SetCert(ca, sizeof(ca), 0, MQTT_CONFIG_VALUE_CERT);
+    }
+    acked = hq_metrics_counter("hq_mqtt_acked_total", NULL, NULL);
+    handshakes = hq_metrics_histogram("hq_mqtt_tls_handshake_ms", NULL, NULL, NULL, 0);
+
+    printf("MQTT QoS 1 publish: %ld messages, RTT %d ms, %d%% loss%s (window max %d)\n",
+           messages, 2 * delay_ms, loss, tls ? ", TLS" : "", CONFIG_MQTT_INFLIGHT_MAX);
+
+    for (int i = 0; i < window_count; i++)
+    {
+        double rate = run_window(windows[i], messages, acked);
+
+        if (rate < 0.0)
+        {
+            printf("  window %3d: failed\n", windows[i]);
+            continue;
+        }
+        if (baseline == 0.0)
+        {
+            baseline = rate;
+        }
+        printf("  window %3d: %8.0f msg/s  (%.1fx)\n", windows[i], rate, rate / baseline);
+    }
+
+    MqttApp_Init();
+    if (wait_connected(5000U) && MqttApp_SubscribeCtx("hq/echo", 1, on_echo, NULL, 5000U))
+    {
+        run_latency(messages);
+        run_recovery(rounds);
+    }
+    else
+    {
+        printf("  latency: failed to subscribe\n");
+    }
+    MqttApp_Deinit();
+    if (tls)
+    {
+        printf("  TLS handshakes: %lld\n", (long long)hq_metrics_value(handshakes));
+    }
+
+    net_delay_proxy_stop();
+    mqtt_broker_stub_stop();
+    MongooseProcess_Deinit();
+    return 0;
+}
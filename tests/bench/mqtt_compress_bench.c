@@ -0,0 +1,145 @@
+/*
+ * MQTT Payload Compression Benchmark
+ *
+ * Compression ratio and encode/decode throughput of mqtt_compress on
+ * generated telemetry JSON documents of 256 B to 16 KB, and on random bytes
+ * as the incompressible worst case.
+ *
+ * Usage: hq_mqtt_compress_bench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hq_json.h"
+#include "mqtt_compress.h"
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* A device report with a growing array of samples, like the JSON bench. */
+static size_t build_document(char *buf, size_t size, size_t target_len)
+{
+    hq_json_writer_t w;
+    int64_t i = 0;
+
+    for (;;)
+    {
+        hq_json_writer_init(&w, buf, size);
+        hq_json_obj_begin(&w);
+        hq_json_kv_str(&w, "id", "hq-0042-sensor");
+        hq_json_kv_int(&w, "seq", 123456);
+        hq_json_key(&w, "samples");
+        hq_json_arr_begin(&w);
+        for (int64_t s = 0; s < i; s++)
+        {
+            hq_json_obj_begin(&w);
+            hq_json_kv_int(&w, "t", 1700000000 + s * 30);
+            hq_json_kv_double(&w, "temp", 20.0 + (double)((s * 7) % 23) * 0.125);
+            hq_json_kv_double(&w, "hum", 40.0 + (double)((s * 5) % 17) * 0.5);
+            hq_json_kv_bool(&w, "ok", (s % 11) != 0);
+            hq_json_obj_end(&w);
+        }
+        hq_json_arr_end(&w);
+        hq_json_obj_end(&w);
+
+        if (hq_json_writer_finish(&w) < 0 || w.total >= target_len)
+        {
+            return w.len;
+        }
+        i++;
+    }
+}
+
+static void run_case(const char *label, const uint8_t *in, size_t len, long iterations)
+{
+    static uint32_t work[MQTT_COMPRESS_WORK_SIZE / sizeof(uint32_t)];
+    size_t bound = MqttCompress_Bound(len);
+    uint8_t *frame = malloc(bound);
+    uint8_t *out = malloc(len + 1U);
+    size_t frame_len = 0;
+    uint64_t t0;
+    uint64_t enc_ns;
+    uint64_t dec_ns;
+
+    if (frame == NULL || out == NULL)
+    {
+        printf("  %s: out of memory\n", label);
+        free(frame);
+        free(out);
+        return;
+    }
+
+    t0 = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        frame_len = MqttCompress_Encode(in, len, frame, bound, work);
+    }
+    enc_ns = now_ns() - t0;
+
+    t0 = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        if (!MqttCompress_Decode(frame, frame_len, out, len))
+        {
+            printf("  %s: decode failed\n", label);
+            free(frame);
+            free(out);
+            return;
+        }
+    }
+    dec_ns = now_ns() - t0;
+
+    if (memcmp(in, out, len) != 0)
+    {
+        printf("  %s: round trip differs\n", label);
+    }
+    else
+    {
+        printf("  %-6s %6zu -> %6zu bytes  ratio %5.2fx  encode %7.1f MB/s  decode %7.1f MB/s\n",
+               label, len, frame_len, (double)len / (double)frame_len,
+               (double)len * (double)iterations * 1000.0 / (double)(enc_ns ? enc_ns : 1U),
+               (double)len * (double)iterations * 1000.0 / (double)(dec_ns ? dec_ns : 1U));
+    }
+    free(frame);
+    free(out);
+}
+
+int main(int argc, char **argv)
+{
+    static const size_t sizes[] = { 256U, 1024U, 4096U, 16384U };
+    static char doc[32 * 1024];
+    static uint8_t noise[16384];
+    long iterations = (argc > 1) ? strtol(argv[1], NULL, 10) : 20000;
+    uint32_t seed = 12345U;
+    char label[16];
+
+    if (iterations <= 0)
+    {
+        iterations = 20000;
+    }
+
+    printf("MQTT payload compression, %ld iterations (fewer for larger inputs)\n", iterations);
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        long n = iterations / (long)(sizes[i] / 256U);
+
+        snprintf(label, sizeof(label), "%zuB", sizes[i]);
+        run_case(label, (const uint8_t *)doc, build_document(doc, sizeof(doc), sizes[i]), n > 0 ? n : 1);
+    }
+
+    for (size_t i = 0; i < sizeof(noise); i++)
+    {
+        seed = seed * 1103515245U + 12345U;
+        noise[i] = (uint8_t)(seed >> 16);
+    }
+    run_case("random", noise, sizeof(noise), iterations / 64 > 0 ? iterations / 64 : 1);
+
+    return 0;
+}
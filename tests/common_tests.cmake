@@ -1,14 +1,26 @@
 set(HQ_COMMON_TEST_ROOT "${CMAKE_CURRENT_LIST_DIR}")
 set(HQ_COMMON_TEST_RUNNER "${HQ_COMMON_TEST_ROOT}/tests.c")
+set(HQ_COMPONENT_TEST_RUNNER "${HQ_COMMON_TEST_ROOT}/component_tests.c")
 
 if(DEFINED CMAKE_SCRIPT_MODE_FILE)
   file(GLOB HQ_COMMON_OSAL_TEST_SOURCES
     "${HQ_COMMON_TEST_ROOT}/osal/*.c"
   )
+  file(GLOB HQ_COMPONENT_TEST_SOURCES
+    "${HQ_COMMON_TEST_ROOT}/json/*.c"
+    "${HQ_COMMON_TEST_ROOT}/metrics/*.c"
+    "${HQ_COMMON_TEST_ROOT}/protocols/*.c"
+  )
 else()
   file(GLOB HQ_COMMON_OSAL_TEST_SOURCES CONFIGURE_DEPENDS
     "${HQ_COMMON_TEST_ROOT}/osal/*.c"
   )
+  file(GLOB HQ_COMPONENT_TEST_SOURCES CONFIGURE_DEPENDS
+    "${HQ_COMMON_TEST_ROOT}/json/*.c"
+    "${HQ_COMMON_TEST_ROOT}/metrics/*.c"
+    "${HQ_COMMON_TEST_ROOT}/protocols/*.c"
+  )
 endif()
 
-list(SORT HQ_COMMON_OSAL_TEST_SOURCES)
\ No newline at end of file
+list(SORT HQ_COMMON_OSAL_TEST_SOURCES)
+list(SORT HQ_COMPONENT_TEST_SOURCES)
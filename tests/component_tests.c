@@ -0,0 +1,40 @@
+/*
+ * HQ Component Aggregated Tests Runner
+ *
+ * Runs tests for the components built on top of OSAL.
+ */
+
+#include <stdio.h>
+
+int hq_json_tests_run(void);
+int hq_metrics_tests_run(void);
+int mqtt_topic_trie_tests_run(void);
+int mqtt_topic_alias_tests_run(void);
+int mqtt_compress_tests_run(void);
+int mqtt_app_tests_run(void);
+int cmd_remote_tests_run(void);
+
+int main(void)
+{
+    int failed_total = 0;
+
+    printf("\n==================================================\n");
+    printf("         HQ Component Aggregated Test Run        \n");
+    printf("==================================================\n\n");
+
+    failed_total += hq_json_tests_run();
+    failed_total += hq_metrics_tests_run();
+    failed_total += mqtt_topic_trie_tests_run();
+    failed_total += mqtt_topic_alias_tests_run();
+    failed_total += mqtt_compress_tests_run();
+    failed_total += mqtt_app_tests_run();
+    failed_total += cmd_remote_tests_run();
+
+    printf("\n==================================================\n");
+    printf("              AGGREGATED SUMMARY                 \n");
+    printf("==================================================\n");
+    printf("  Total failed tests: %d\n", failed_total);
+    printf("==================================================\n");
+
+    return (failed_total == 0) ? 0 : 1;
+}
@@ -0,0 +1,277 @@
+/*
+ * JSON Module Tests
+ *
+ * Tests:
+ * 1. Writer output, escaping and overflow detection
+ * 2. Streaming writer through a sink
+ * 3. Single-pass schema parser
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hq_json.h"
+
+/* Test results tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test macros */
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_START(name) \
+    printf("\n==================================================\n"); \
+    printf("TEST: %s\n", name); \
+    printf("==================================================\n")
+
+#define TEST_END() \
+    printf("--------------------------------------------------\n")
+
+/* ============================================================================
+ * Test 1: Writer
+ * ========================================================================== */
+
+static void test_writer(void)
+{
+    TEST_START("Writer Output and Overflow");
+
+    char buf[160];
+    hq_json_writer_t w;
+
+    hq_json_writer_init(&w, buf, sizeof(buf));
+    hq_json_obj_begin(&w);
+    hq_json_kv_str(&w, "name", "a\"b\\c\n");
+    hq_json_kv_int(&w, "neg", -42);
+    hq_json_kv_uint(&w, "big", 18446744073709551615ULL);
+    hq_json_kv_bool(&w, "ok", true);
+    hq_json_key(&w, "list");
+    hq_json_arr_begin(&w);
+    hq_json_int(&w, 1);
+    hq_json_double(&w, 2.5);
+    hq_json_null(&w);
+    hq_json_obj_begin(&w);
+    hq_json_obj_end(&w);
+    hq_json_arr_end(&w);
+    hq_json_obj_end(&w);
+
+    int32_t n = hq_json_writer_finish(&w);
+    const char *expected =
+        "{\"name\":\"a\\\"b\\\\c\\n\",\"neg\":-42,\"big\":18446744073709551615,"
+        "\"ok\":true,\"list\":[1,2.5,null,{}]}";
+
+    TEST_ASSERT(n == (int32_t)strlen(expected), "Writer reports produced length");
+    TEST_ASSERT(strcmp(buf, expected) == 0, "Writer output matches expected document");
+
+    char small[8];
+    hq_json_writer_init(&w, small, sizeof(small));
+    hq_json_obj_begin(&w);
+    hq_json_kv_str(&w, "key", "value");
+    hq_json_obj_end(&w);
+    TEST_ASSERT(hq_json_writer_finish(&w) < 0, "Overflow is reported");
+    TEST_ASSERT(w.total == strlen("{\"key\":\"value\"}"), "Required size is still counted on overflow");
+    TEST_ASSERT(memchr(small, '\0', sizeof(small)) != NULL, "Overflowed buffer stays NUL-terminated");
+
+    hq_json_writer_init(&w, buf, sizeof(buf));
+    hq_json_obj_begin(&w);
+    TEST_ASSERT(hq_json_writer_finish(&w) < 0, "Unbalanced document is rejected");
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 2: Streaming sink
+ * ========================================================================== */
+
+typedef struct
+{
+    char data[512];
+    size_t len;
+    int calls;
+} sink_capture_t;
+
+static void capture_sink(void *ctx, const char *data, size_t len)
+{
+    sink_capture_t *cap = (sink_capture_t *)ctx;
+
+    if (cap->len + len < sizeof(cap->data))
+    {
+        memcpy(cap->data + cap->len, data, len);
+        cap->len += len;
+        cap->data[cap->len] = '\0';
+    }
+    cap->calls++;
+}
+
+static void test_sink(void)
+{
+    TEST_START("Streaming Writer Sink");
+
+    char scratch[16];
+    sink_capture_t cap;
+    hq_json_writer_t w;
+
+    memset(&cap, 0, sizeof(cap));
+    hq_json_writer_init_sink(&w, scratch, sizeof(scratch), capture_sink, &cap);
+    hq_json_arr_begin(&w);
+    for (int i = 0; i < 20; i++)
+    {
+        hq_json_int(&w, i * 1000);
+    }
+    hq_json_arr_end(&w);
+
+    int32_t n = hq_json_writer_finish(&w);
+
+    TEST_ASSERT(n > (int32_t)sizeof(scratch), "Document larger than scratch buffer produced");
+    TEST_ASSERT(cap.len == (size_t)n, "Sink received every byte");
+    TEST_ASSERT(cap.calls > 1, "Sink was called in chunks");
+    TEST_ASSERT(strncmp(cap.data, "[0,1000,2000,", 13) == 0, "Streamed output is well formed");
+    TEST_ASSERT(cap.data[cap.len - 1] == ']', "Streamed output is complete");
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 3: Parser
+ * ========================================================================== */
+
+static void test_parser(void)
+{
+    TEST_START("Single-pass Schema Parser");
+
+    const char *doc =
+        "{ \"id\": 17, \"name\": \"dev\\u00e9\\t1\", \"temp\": -3.25e1,"
+        "  \"on\": true, \"skip\": {\"deep\": [1, {\"x\": \"}\"}]},"
+        "  \"cfg\": {\"mode\": \"auto\", \"limits\": [10, 20, 30]},"
+        "  \"raw\": {\"a\": [1, 2]} }";
+
+    int64_t id = 0;
+    char name[16] = {0};
+    double temp = 0.0;
+    bool on = false;
+    char mode[8] = {0};
+    int64_t limit = 0;
+    hq_json_span_t raw = {0};
+    int64_t missing = 0;
+    uint32_t found = 0;
+
+    hq_json_field_t fields[] = {
+        { "$.id",           HQ_JSON_TYPE_INT,    &id,      0 },
+        { "$.name",         HQ_JSON_TYPE_STRING, name,     sizeof(name) },
+        { "$.temp",         HQ_JSON_TYPE_DOUBLE, &temp,    0 },
+        { "$.on",           HQ_JSON_TYPE_BOOL,   &on,      0 },
+        { "$.cfg.mode",     HQ_JSON_TYPE_STRING, mode,     sizeof(mode) },
+        { "$.cfg.limits[2]", HQ_JSON_TYPE_INT,   &limit,   0 },
+        { "$.raw",          HQ_JSON_TYPE_SPAN,   &raw,     0 },
+        { "$.missing",      HQ_JSON_TYPE_INT,    &missing, 0 },
+    };
+
+    int32_t n = hq_json_parse(doc, strlen(doc), fields, sizeof(fields) / sizeof(fields[0]), &found);
+
+    TEST_ASSERT(n == 7, "Seven of eight fields extracted");
+    TEST_ASSERT(found == 0x7FU, "Found mask marks extracted fields");
+    TEST_ASSERT(id == 17, "Integer field parsed");
+    TEST_ASSERT(strcmp(name, "dev\xc3\xa9\t1") == 0, "String field unescaped with UTF-8");
+    TEST_ASSERT(temp == -32.5, "Double field parsed");
+    TEST_ASSERT(on, "Bool field parsed");
+    TEST_ASSERT(strcmp(mode, "auto") == 0, "Nested string field parsed");
+    TEST_ASSERT(limit == 30, "Array element parsed");
+    TEST_ASSERT(raw.len == strlen("{\"a\": [1, 2]}") && strncmp(raw.ptr, "{\"a\"", 4) == 0,
+                "Span references the raw token");
+
+    char tiny[3];
+    hq_json_field_t tiny_field[] = {
+        { "$.name", HQ_JSON_TYPE_STRING, tiny, sizeof(tiny) },
+    };
+    TEST_ASSERT(hq_json_parse(doc, strlen(doc), tiny_field, 1, NULL) == 0,
+                "String that does not fit is not reported as found");
+
+    hq_json_field_t type_mismatch[] = {
+        { "$.name", HQ_JSON_TYPE_INT, &id, 0 },
+    };
+    TEST_ASSERT(hq_json_parse(doc, strlen(doc), type_mismatch, 1, NULL) == 0,
+                "Type mismatch is not reported as found");
+
+    const char *huge = "{\"a\": 1e30, \"b\": -1e19, \"c\": 99999999999999999999, \"d\": -9.2e18}";
+    int64_t a = 0, b = 0, c = 0, d = 0;
+    uint32_t huge_found = 0;
+    hq_json_field_t huge_fields[] = {
+        { "$.a", HQ_JSON_TYPE_INT, &a, 0 },
+        { "$.b", HQ_JSON_TYPE_INT, &b, 0 },
+        { "$.c", HQ_JSON_TYPE_INT, &c, 0 },
+        { "$.d", HQ_JSON_TYPE_INT, &d, 0 },
+    };
+    TEST_ASSERT(hq_json_parse(huge, strlen(huge), huge_fields, 4, &huge_found) == 1 && huge_found == 0x8U,
+                "Integers outside the int64_t range are not reported as found");
+    TEST_ASSERT(d == -9200000000000000000LL, "Exponent form inside the range converted");
+
+    const char *bad = "{\"id\": 1, \"name\": \"x";
+    hq_json_field_t bad_field[] = {
+        { "$.name", HQ_JSON_TYPE_STRING, name, sizeof(name) },
+    };
+    TEST_ASSERT(hq_json_parse(bad, strlen(bad), bad_field, 1, NULL) < 0, "Truncated input is rejected");
+
+    hq_json_field_t root[] = {
+        { "$", HQ_JSON_TYPE_INT, &id, 0 },
+    };
+    TEST_ASSERT(hq_json_parse(" 99 ", 4, root, 1, NULL) == 1 && id == 99, "Root scalar parsed");
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Main Test Runner
+ * ========================================================================== */
+
+static void hq_json_tests_reset(void)
+{
+    tests_run = 0;
+    tests_passed = 0;
+    tests_failed = 0;
+}
+
+int hq_json_tests_run(void)
+{
+    hq_json_tests_reset();
+
+    printf("\n");
+    printf("==================================================\n");
+    printf("                JSON Module Tests                 \n");
+    printf("==================================================\n");
+    printf("\n");
+
+    test_writer();
+    test_sink();
+    test_parser();
+
+    printf("\n");
+    printf("==================================================\n");
+    printf("                  TEST SUMMARY                    \n");
+    printf("==================================================\n");
+    printf("  Total tests:  %d\n", tests_run);
+    printf("  Passed:       %d\n", tests_passed);
+    printf("  Failed:       %d\n", tests_failed);
+    printf("  Success rate: %.1f%%\n",
+           (tests_run > 0) ? (100.0 * tests_passed / tests_run) : 0.0);
+    printf("==================================================\n");
+
+    if (tests_failed == 0) {
+        printf("\n✓ ALL TESTS PASSED!\n\n");
+    } else {
+        printf("\n✗ SOME TESTS FAILED!\n\n");
+    }
+
+    return tests_failed;
+}
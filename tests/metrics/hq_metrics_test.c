@@ -0,0 +1,285 @@
+/*
+ * Metrics Registry Tests
+ *
+ * Tests:
+ * 1. Counter, gauge and histogram registration and updates
+ * 2. Sharded counters updated from several tasks
+ * 3. Text exposition output and collectors
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hq_metrics.h"
+#include "osal_task.h"
+
+/* Test results tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test macros */
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_START(name) \
+    printf("\n==================================================\n"); \
+    printf("TEST: %s\n", name); \
+    printf("==================================================\n")
+
+#define TEST_END() \
+    printf("--------------------------------------------------\n")
+
+/* ============================================================================
+ * Test 1: Registration and updates
+ * ========================================================================== */
+
+static void test_basic(void)
+{
+    TEST_START("Registration and Updates");
+
+    static const uint64_t bounds[] = { 10, 100 };
+
+    TEST_ASSERT(hq_metrics_init() == OSAL_SUCCESS, "Registry initialised");
+
+    hq_metric_t *counter = hq_metrics_counter("test_events_total", NULL, "Test events");
+    hq_metric_t *gauge = hq_metrics_gauge("test_level", NULL, "Test level");
+    hq_metric_t *hist = hq_metrics_histogram("test_size", NULL, "Test sizes", bounds, 2U);
+
+    TEST_ASSERT(counter != NULL && gauge != NULL && hist != NULL, "Metrics registered");
+    TEST_ASSERT(hq_metrics_counter("test_events_total", NULL, NULL) == counter,
+                "Re-registration returns the existing metric");
+    TEST_ASSERT(hq_metrics_gauge("test_events_total", NULL, NULL) == NULL,
+                "Same name with a different type is rejected");
+
+    static const uint64_t unsorted[] = { 5, 1 };
+    TEST_ASSERT(hq_metrics_histogram("test_bad", NULL, NULL, unsorted, 2U) == NULL,
+                "Unsorted bucket bounds are rejected");
+
+    hq_metrics_inc(counter);
+    hq_metrics_add(counter, 41U);
+    TEST_ASSERT(hq_metrics_value(counter) == 42, "Counter accumulates");
+
+    hq_metrics_set(gauge, 7);
+    hq_metrics_gauge_add(gauge, -10);
+    TEST_ASSERT(hq_metrics_value(gauge) == -3, "Gauge set and add");
+
+    hq_metrics_observe(hist, 5U);
+    hq_metrics_observe(hist, 50U);
+    hq_metrics_observe(hist, 500U);
+    TEST_ASSERT(hq_metrics_value(hist) == 3, "Histogram counts observations");
+
+    hq_metrics_inc(NULL);
+    hq_metrics_observe(NULL, 1U);
+    TEST_ASSERT(hq_metrics_value(NULL) == 0, "NULL handles are ignored");
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 2: Concurrent updates
+ * ========================================================================== */
+
+#define WORKER_COUNT       4
+#define WORKER_ITERATIONS  100000
+
+static hq_metric_t *g_shared_counter;
+static volatile int g_workers_done;
+
+static void counter_worker(void *arg)
+{
+    (void)arg;
+
+    for (int i = 0; i < WORKER_ITERATIONS; i++)
+    {
+        hq_metrics_inc(g_shared_counter);
+    }
+
+    __atomic_fetch_add(&g_workers_done, 1, __ATOMIC_RELEASE);
+
+    while (1)
+    {
+        osal_task_delay_ms(1000);
+    }
+}
+
+static void test_concurrent(void)
+{
+    TEST_START("Sharded Counter Under Contention");
+
+    osal_task_id_t tasks[WORKER_COUNT];
+    int created = 0;
+
+    g_shared_counter = hq_metrics_counter("test_contended_total", NULL, NULL);
+    g_workers_done = 0;
+
+    for (int i = 0; i < WORKER_COUNT; i++)
+    {
+        if (osal_task_create(&tasks[i], "m_worker", counter_worker, NULL, NULL, 16384, 5, NULL) == OSAL_SUCCESS)
+        {
+            created++;
+        }
+    }
+    TEST_ASSERT(created == WORKER_COUNT, "Worker tasks created");
+
+    for (int waited = 0; waited < 5000 && __atomic_load_n(&g_workers_done, __ATOMIC_ACQUIRE) < created; waited += 10)
+    {
+        osal_task_delay_ms(10);
+    }
+
+    TEST_ASSERT(hq_metrics_value(g_shared_counter) == (int64_t)created * WORKER_ITERATIONS,
+                "No increments lost across shards");
+
+    for (int i = 0; i < created; i++)
+    {
+        osal_task_delete(tasks[i]);
+    }
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 3: Exposition format
+ * ========================================================================== */
+
+typedef struct
+{
+    char data[8192];
+    size_t len;
+} render_capture_t;
+
+static void capture_sink(void *ctx, const char *data, size_t len)
+{
+    render_capture_t *cap = (render_capture_t *)ctx;
+
+    if (cap->len + len < sizeof(cap->data))
+    {
+        memcpy(cap->data + cap->len, data, len);
+        cap->len += len;
+        cap->data[cap->len] = '\0';
+    }
+}
+
+/* Label set and help text of over 200 characters each */
+#define LONG_LABELS "path=\"/api/a/very/long/path/that/keeps/going/on/and/on/for/a/while\"," \
+                    "agent=\"a-client-with-a-long-user-agent-string/1.2.3 (compatible; test)\"," \
+                    "peer=\"a.rather.long.host.name.example.com\",instance=\"0123456789abcdef\""
+#define LONG_HELP "Requests by path, agent, peer and instance; the help text goes on long enough " \
+                  "that a single line of the exposition no longer fits in the few hundred bytes a " \
+                  "renderer might keep on its stack"
+
+static void test_collector(hq_metrics_out_t *out, void *ctx)
+{
+    hq_metrics_emit(out, HQ_METRIC_GAUGE, "test_pulled", "q=\"a\"", "Pulled value", *(int64_t *)ctx);
+    hq_metrics_emit(out, HQ_METRIC_GAUGE, "test_pulled", "q=\"b\"", NULL, 2);
+}
+
+static void test_exposition(void)
+{
+    TEST_START("Text Exposition Format");
+
+    static render_capture_t cap;
+    static int64_t pulled = 11;
+
+    hq_metric_t *ok = hq_metrics_counter("test_requests_total", "code=\"2xx\"", "Requests");
+    hq_metrics_counter("test_other_total", NULL, NULL);
+    hq_metric_t *err = hq_metrics_counter("test_requests_total", "code=\"5xx\"", "Requests");
+
+    hq_metrics_add(ok, 3U);
+    hq_metrics_inc(err);
+    hq_metrics_add(hq_metrics_counter("test_long_total", LONG_LABELS, LONG_HELP), 7U);
+
+    TEST_ASSERT(hq_metrics_register_collector(test_collector, &pulled) == OSAL_SUCCESS, "Collector registered");
+    TEST_ASSERT(hq_metrics_register_osal() == OSAL_SUCCESS, "OSAL collector registered");
+
+    memset(&cap, 0, sizeof(cap));
+    int32_t n = hq_metrics_render(capture_sink, &cap);
+
+    TEST_ASSERT(n > 0 && (size_t)n == cap.len, "Render reports produced length");
+    TEST_ASSERT(strstr(cap.data, "# TYPE test_events_total counter\ntest_events_total 42\n") != NULL,
+                "Counter rendered with TYPE line");
+    TEST_ASSERT(strstr(cap.data, "test_level -3\n") != NULL, "Gauge rendered");
+    TEST_ASSERT(strstr(cap.data,
+                       "test_size_bucket{le=\"10\"} 1\n"
+                       "test_size_bucket{le=\"100\"} 2\n"
+                       "test_size_bucket{le=\"+Inf\"} 3\n"
+                       "test_size_sum 555\n"
+                       "test_size_count 3\n") != NULL,
+                "Histogram rendered with cumulative buckets");
+    TEST_ASSERT(strstr(cap.data,
+                       "test_requests_total{code=\"2xx\"} 3\n"
+                       "test_requests_total{code=\"5xx\"} 1\n") != NULL,
+                "Label variants grouped under one family");
+
+    const char *first = strstr(cap.data, "# TYPE test_requests_total");
+    TEST_ASSERT(first != NULL && strstr(first + 1, "# TYPE test_requests_total") == NULL,
+                "Family header emitted once");
+    TEST_ASSERT(strstr(cap.data,
+                       "# HELP test_pulled Pulled value\n"
+                       "# TYPE test_pulled gauge\n"
+                       "test_pulled{q=\"a\"} 11\n"
+                       "test_pulled{q=\"b\"} 2\n") != NULL,
+                "Collector samples rendered");
+    TEST_ASSERT(strstr(cap.data, "hq_osal_file_opens_total ") != NULL, "OSAL file stats exported");
+    TEST_ASSERT(strstr(cap.data, "\ntest_long_total{" LONG_LABELS "} 7\n") != NULL &&
+                strstr(cap.data, "# HELP test_long_total " LONG_HELP "\n") != NULL,
+                "Lines longer than any fixed buffer rendered whole");
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Main Test Runner
+ * ========================================================================== */
+
+static void hq_metrics_tests_reset(void)
+{
+    tests_run = 0;
+    tests_passed = 0;
+    tests_failed = 0;
+}
+
+int hq_metrics_tests_run(void)
+{
+    hq_metrics_tests_reset();
+
+    printf("\n");
+    printf("==================================================\n");
+    printf("              Metrics Registry Tests              \n");
+    printf("==================================================\n");
+    printf("\n");
+
+    test_basic();
+    test_concurrent();
+    test_exposition();
+
+    printf("\n");
+    printf("==================================================\n");
+    printf("                  TEST SUMMARY                    \n");
+    printf("==================================================\n");
+    printf("  Total tests:  %d\n", tests_run);
+    printf("  Passed:       %d\n", tests_passed);
+    printf("  Failed:       %d\n", tests_failed);
+    printf("  Success rate: %.1f%%\n",
+           (tests_run > 0) ? (100.0 * tests_passed / tests_run) : 0.0);
+    printf("==================================================\n");
+
+    if (tests_failed == 0) {
+        printf("\n✓ ALL TESTS PASSED!\n\n");
+    } else {
+        printf("\n✗ SOME TESTS FAILED!\n\n");
+    }
+
+    return tests_failed;
+}
@@ -126,6 +126,10 @@ static void test_stat_volume_flow(void)
     TEST_ASSERT(st.total_blocks > 0U, "stat volume reports non-zero total blocks");
     TEST_ASSERT(st.blocks_free <= st.total_blocks, "free blocks are not greater than total blocks");
 
+    osal_blockdev_stats_t bd_before;
+    TEST_ASSERT(osal_filesys_get_blockdev_stats(&bd_before) == OSAL_SUCCESS, "blockdev stats readable");
+    TEST_ASSERT(bd_before.reads > 0U, "mount counted block device reads");
+
     osal_file_id_t fd = osal_open_create(TEST_FILE_PATH,
         OSAL_FILE_FLAG_CREATE | OSAL_FILE_FLAG_TRUNCATE,
         OSAL_READ_WRITE);
@@ -137,6 +141,11 @@ static void test_stat_volume_flow(void)
     TEST_ASSERT(rc == (int32_t)sizeof(payload), "write payload succeeds");
     TEST_ASSERT(osal_close(fd) == OSAL_SUCCESS, "close written file succeeds");
 
+    osal_blockdev_stats_t bd_after;
+    TEST_ASSERT(osal_filesys_get_blockdev_stats(&bd_after) == OSAL_SUCCESS, "blockdev stats readable after write");
+    TEST_ASSERT(bd_after.prog_bytes >= bd_before.prog_bytes + sizeof(payload), "write counted as programmed bytes");
+    TEST_ASSERT(osal_filesys_get_blockdev_stats(NULL) == OSAL_INVALID_POINTER, "blockdev stats NULL returns OSAL_INVALID_POINTER");
+
     osal_statvfs_t st_after;
     memset(&st_after, 0, sizeof(st_after));
     rc = osal_filesys_stat_volume(TEST_IMAGE_PATH, &st_after);
@@ -5,11 +5,13 @@
  * 1. Queue send/receive between tasks
  * 2. Queue overflow handling
  * 3. Queue count validation
+ * 4. Queue statistics
  */
 
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "osal_task.h"
 #include "osal_queue.h"
@@ -175,6 +177,96 @@ static void test_queue_send_receive(void)
     TEST_END();
 }
 
+/* ============================================================================
+ * Test 2: Queue Statistics
+ * ========================================================================== */
+
+static bool find_queue_stats(const char *name, osal_queue_stats_t *out)
+{
+    osal_queue_stats_t stats[16];
+    uint32_t count = 0;
+
+    if (osal_queue_get_stats(stats, 16, &count) != OSAL_SUCCESS) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (strcmp(stats[i].name, name) == 0) {
+            *out = stats[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+static void test_queue_stats(void)
+{
+    TEST_START("Queue Statistics");
+
+    osal_queue_id_t stats_queue;
+    osal_queue_stats_t stats;
+    queue_item_t item = { .value = 1 };
+    osal_status_t status;
+    uint32_t count = 0;
+
+    status = osal_queue_create(&stats_queue, "stats_queue", QUEUE_DEPTH, sizeof(queue_item_t));
+    TEST_ASSERT(status == OSAL_SUCCESS, "Queue created successfully");
+
+    TEST_ASSERT(osal_queue_get_stats(NULL, 16, &count) == OSAL_INVALID_POINTER,
+                "NULL stats array rejected");
+
+    /* Fill the queue, then drain all but one item */
+    for (uint32_t i = 0; i < QUEUE_DEPTH; i++) {
+        (void)osal_queue_send(stats_queue, &item, 0);
+    }
+    (void)osal_queue_send(stats_queue, &item, 0);
+    (void)osal_queue_receive(stats_queue, &item, 0);
+    (void)osal_queue_receive(stats_queue, &item, 0);
+
+    TEST_ASSERT(find_queue_stats("stats_queue", &stats), "Queue listed in stats");
+    TEST_ASSERT(stats.max_items == QUEUE_DEPTH, "Stats report queue depth");
+    TEST_ASSERT(stats.item_size == sizeof(queue_item_t), "Stats report item size");
+    TEST_ASSERT(stats.count == 1, "Stats report current count");
+    TEST_ASSERT(stats.high_water == QUEUE_DEPTH, "High water mark reached queue depth");
+    TEST_ASSERT(stats.sends == QUEUE_DEPTH, "Failed send not counted");
+    TEST_ASSERT(stats.receives == 2, "Receives counted");
+    TEST_ASSERT(stats.send_full == 1 && stats.receive_empty == 0, "Send to a full queue counted as failure");
+    TEST_ASSERT(stats.send_wait_us == 0 && stats.receive_wait_us == 0, "No wait time without waiting");
+
+    TEST_ASSERT(osal_queue_get_stats_by_name(NULL, &stats) == OSAL_INVALID_POINTER,
+                "NULL name rejected");
+    TEST_ASSERT(osal_queue_get_stats_by_name("no_such_queue", &stats) == OSAL_ERR_NAME_NOT_FOUND,
+                "Unknown name not found");
+
+    /* Wait on a full queue, then on an empty one, until the timeouts expire */
+    for (uint32_t i = 1; i < QUEUE_DEPTH; i++) {
+        (void)osal_queue_send(stats_queue, &item, 0);
+    }
+    TEST_ASSERT(osal_queue_send(stats_queue, &item, 20) == OSAL_QUEUE_TIMEOUT, "Send timed out on a full queue");
+    for (uint32_t i = 0; i < QUEUE_DEPTH; i++) {
+        (void)osal_queue_receive(stats_queue, &item, 0);
+    }
+    (void)osal_queue_receive(stats_queue, &item, 0);
+    TEST_ASSERT(osal_queue_receive(stats_queue, &item, 20) == OSAL_QUEUE_TIMEOUT,
+                "Receive timed out on an empty queue");
+
+    memset(&stats, 0, sizeof(stats));
+    TEST_ASSERT(osal_queue_get_stats_by_name("stats_queue", &stats) == OSAL_SUCCESS &&
+                strcmp(stats.name, "stats_queue") == 0, "Queue found by name");
+    TEST_ASSERT(stats.sends == 2 * QUEUE_DEPTH - 1 && stats.receives == QUEUE_DEPTH + 2,
+                "Throughput counted across both rounds");
+    TEST_ASSERT(stats.send_full == 2 && stats.receive_empty == 2, "Timeouts counted as failures");
+    TEST_ASSERT(stats.send_wait_us >= 10000 && stats.receive_wait_us >= 10000,
+                "Time blocked in senders and receivers accumulated");
+
+    status = osal_queue_delete(stats_queue);
+    TEST_ASSERT(status == OSAL_SUCCESS, "Queue deleted successfully");
+    TEST_ASSERT(!find_queue_stats("stats_queue", &stats), "Deleted queue no longer listed");
+    TEST_ASSERT(osal_queue_get_stats_by_name("stats_queue", &stats) == OSAL_ERR_NAME_NOT_FOUND,
+                "Deleted queue no longer found by name");
+
+    TEST_END();
+}
+
 /* ============================================================================
  * Main Test Runner
  * ========================================================================== */
@@ -197,6 +289,7 @@ int osal_queue_tests_run(void)
     printf("\n");
 
     test_queue_send_receive();
+    test_queue_stats();
 
     printf("\n");
     printf("==================================================\n");
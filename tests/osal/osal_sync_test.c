@@ -5,11 +5,13 @@
  * 1. Mutex protection with two tasks
  * 2. Binary semaphore task synchronization
  * 3. Counting semaphore producer/consumer
+ * 4. Mutex contention statistics
  */
 
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "osal_task.h"
 #include "osal_mutex.h"
@@ -285,6 +287,97 @@ static void test_counting_semaphore(void)
     TEST_END();
 }
 
+/* ============================================================================
+ * Test 4: Mutex Contention Statistics
+ * ========================================================================== */
+
+#define CONTENTION_HOLD_MS 50
+
+static osal_mutex_id_t stats_mutex_id;
+static volatile bool stats_waiter_started = false;
+static volatile bool stats_waiter_done = false;
+
+static void mutex_waiter_func(void *arg)
+{
+    (void)arg;
+
+    stats_waiter_started = true;
+    osal_mutex_take(stats_mutex_id);
+    osal_mutex_give(stats_mutex_id);
+    stats_waiter_done = true;
+
+    osal_test_task_done();
+}
+
+static bool find_mutex_stats(const char *name, osal_mutex_stats_t *out)
+{
+    osal_mutex_stats_t stats[16];
+    uint32_t count = 0;
+
+    if (osal_mutex_get_stats(stats, 16, &count) != OSAL_SUCCESS) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (strcmp(stats[i].name, name) == 0) {
+            *out = stats[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+static void test_mutex_stats(void)
+{
+    TEST_START("Mutex Contention Statistics");
+
+    osal_status_t status;
+    osal_task_id_t waiter_id;
+    osal_mutex_stats_t stats;
+    uint32_t count = 0;
+
+    stats_waiter_started = false;
+    stats_waiter_done = false;
+
+    status = osal_mutex_create(&stats_mutex_id, "stats_mutex");
+    TEST_ASSERT(status == OSAL_SUCCESS, "Mutex created successfully");
+
+    TEST_ASSERT(osal_mutex_get_stats(NULL, 16, &count) == OSAL_INVALID_POINTER,
+                "NULL stats array rejected");
+
+    /* Hold the mutex while the waiter blocks on it */
+    osal_mutex_take(stats_mutex_id);
+    status = osal_task_create(&waiter_id, "mutex_waiter", mutex_waiter_func,
+                              NULL, NULL, OSAL_TASK_MIN_STACK_SIZE, 10, NULL);
+    TEST_ASSERT(status == OSAL_SUCCESS, "Waiter task created");
+
+    while (!stats_waiter_started) {
+        osal_task_delay_ms(1);
+    }
+    osal_task_delay_ms(CONTENTION_HOLD_MS);
+    osal_mutex_give(stats_mutex_id);
+
+    uint32_t elapsed = 0;
+    while (!stats_waiter_done && elapsed < 1000) {
+        osal_task_delay_ms(10);
+        elapsed += 10;
+    }
+    TEST_ASSERT(stats_waiter_done, "Waiter task got the mutex");
+
+    TEST_ASSERT(find_mutex_stats("stats_mutex", &stats), "Mutex listed in stats");
+    TEST_ASSERT(stats.takes == 2, "Both takes counted");
+    TEST_ASSERT(stats.contended == 1, "Blocked take counted as contended");
+    TEST_ASSERT(stats.wait_max_us >= (CONTENTION_HOLD_MS / 2) * 1000U,
+                "Wait time measured");
+    TEST_ASSERT(stats.wait_us >= stats.wait_max_us, "Total wait covers longest wait");
+
+    osal_task_delete(waiter_id);
+    status = osal_mutex_delete(stats_mutex_id);
+    TEST_ASSERT(status == OSAL_SUCCESS, "Mutex deleted successfully");
+    TEST_ASSERT(!find_mutex_stats("stats_mutex", &stats), "Deleted mutex no longer listed");
+
+    TEST_END();
+}
+
 /* ============================================================================
  * Main Test Runner
  * ========================================================================== */
@@ -309,6 +402,7 @@ int osal_sync_tests_run(void)
     test_mutex_protection();
     test_binary_semaphore();
     test_counting_semaphore();
+    test_mutex_stats();
 
     printf("\n");
     printf("==================================================\n");
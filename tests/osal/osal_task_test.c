@@ -6,12 +6,14 @@
  * 2. Static task creation and deletion
  * 3. Task execution verification
  * 4. Time measurement with osal_task_get_time_ms()
+ * 5. Task statistics
  */
 
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
 #include <inttypes.h>
+#include <time.h>
 
 #include "osal_task.h"
 #include "osal_log.h"
@@ -354,6 +356,115 @@ static void test_concurrent_tasks(void)
     TEST_END();
 }
 
+/* ============================================================================
+ * Test 5: Task Statistics
+ * ========================================================================== */
+
+#define STATS_TASK_PRIORITY 10
+#define STATS_TASK_SPIN_US  50000U
+
+static volatile bool stats_task_spun = false;
+
+static void stats_task_func(void *arg)
+{
+    (void)arg;
+
+#ifdef ESP_PLATFORM
+    /* Burn some CPU so the task has run time to report */
+    uint64_t start = osal_task_get_time_us();
+    while (osal_task_get_time_us() - start < STATS_TASK_SPIN_US) {
+    }
+#else
+    /* Spin on the thread's own CPU clock, so being descheduled under
+     * load cannot leave it short of what the test asserts */
+    struct timespec ts;
+    uint64_t start;
+    uint64_t now;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    start = (uint64_t)ts.tv_sec * 1000000U + (uint64_t)ts.tv_nsec / 1000U;
+    do {
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        now = (uint64_t)ts.tv_sec * 1000000U + (uint64_t)ts.tv_nsec / 1000U;
+    } while (now - start < STATS_TASK_SPIN_US);
+#endif
+    stats_task_spun = true;
+
+    for (;;) {
+        osal_task_delay_ms(10);
+    }
+}
+
+static bool find_task_stats(const char *name, osal_task_stats_t *out)
+{
+    osal_task_stats_t stats[32];
+    uint32_t count = 0;
+
+    if (osal_task_get_stats(stats, 32, &count) != OSAL_SUCCESS) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (strcmp(stats[i].name, name) == 0) {
+            *out = stats[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+static void test_task_stats(void)
+{
+    TEST_START("Task Statistics");
+
+    osal_task_id_t task_id;
+    osal_task_stats_t stats;
+    osal_status_t status;
+    uint32_t count = 0;
+
+    stats_task_spun = false;
+
+    status = osal_task_get_stats(NULL, 32, &count);
+    TEST_ASSERT(status == OSAL_INVALID_POINTER || status == OSAL_ERR_NOT_IMPLEMENTED,
+                "NULL stats array rejected");
+    if (status == OSAL_ERR_NOT_IMPLEMENTED) {
+        printf("  Task statistics not available in this build\n");
+        TEST_END();
+        return;
+    }
+
+    uint64_t t0 = osal_task_get_time_us();
+    osal_task_delay_ms(20);
+    uint64_t t1 = osal_task_get_time_us();
+    TEST_ASSERT(t1 - t0 >= 15000U, "Microsecond clock advances across a delay");
+
+    status = osal_task_create(&task_id, "stats_task", stats_task_func, NULL, NULL,
+                              OSAL_TASK_MIN_STACK_SIZE, STATS_TASK_PRIORITY, NULL);
+    TEST_ASSERT(status == OSAL_SUCCESS, "Task created successfully");
+
+    uint32_t elapsed = 0;
+    while (!stats_task_spun && elapsed < 2000) {
+        osal_task_delay_ms(10);
+        elapsed += 10;
+    }
+    TEST_ASSERT(stats_task_spun, "Task finished spinning");
+
+    TEST_ASSERT(find_task_stats("stats_task", &stats), "Task listed in stats");
+    TEST_ASSERT(stats.priority == STATS_TASK_PRIORITY, "Stats report task priority");
+#ifndef ESP_PLATFORM
+    /* ESP-IDF only reports CPU time with run time stats enabled */
+    TEST_ASSERT(stats.cpu_time_us >= STATS_TASK_SPIN_US / 2U, "Stats report CPU time used");
+#endif
+
+    osal_task_delete(task_id);
+#ifdef ESP_PLATFORM
+    /* The idle task frees deleted tasks */
+    osal_task_delay_ms(50);
+#endif
+    TEST_ASSERT(!find_task_stats("stats_task", &stats), "Deleted task no longer listed");
+
+    TEST_END();
+}
+
 /* ============================================================================
  * Main Test Runner
  * ========================================================================== */
@@ -380,6 +491,7 @@ int osal_task_tests_run(void)
     test_static_task_creation();
     test_time_measurement();
     test_concurrent_tasks();
+    test_task_stats();
 
     /* Print summary */
     printf("\n");
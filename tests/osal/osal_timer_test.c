@@ -5,11 +5,13 @@
  * 1. One-shot timer expiry timing and context
  * 2. Auto-reload timer period change and reset
  * 3. Timer start/stop state
+ * 4. Timer statistics
  */
 
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "osal_task.h"
 #include "osal_timer.h"
@@ -233,6 +235,77 @@ static void test_auto_timer_change_reset(void)
     TEST_END();
 }
 
+static volatile uint32_t stats_callback_count = 0;
+
+static void stats_timer_callback(osal_timer_id_t timer_id)
+{
+    (void)timer_id;
+    stats_callback_count++;
+}
+
+static bool find_timer_stats(const char *name, osal_timer_stats_t *out)
+{
+    osal_timer_stats_t stats[16];
+    uint32_t count = 0;
+
+    if (osal_timer_get_stats(stats, 16, &count) != OSAL_SUCCESS) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (strcmp(stats[i].name, name) == 0) {
+            *out = stats[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+static void test_timer_stats(void)
+{
+    TEST_START("Timer Statistics");
+
+    osal_timer_id_t timer_id;
+    osal_timer_stats_t stats;
+    osal_status_t status;
+    uint32_t count = 0;
+
+    stats_callback_count = 0;
+
+    status = osal_timer_create(&timer_id, "stats_timer", 50, true,
+                               stats_timer_callback, NULL, NULL, 0);
+    TEST_ASSERT(status == OSAL_SUCCESS, "Auto-reload timer created");
+
+    TEST_ASSERT(osal_timer_get_stats(NULL, 16, &count) == OSAL_INVALID_POINTER,
+                "NULL stats array rejected");
+
+    TEST_ASSERT(find_timer_stats("stats_timer", &stats), "Timer listed in stats");
+    TEST_ASSERT(!stats.active && stats.next_ms == 0, "Stopped timer has no next expiry");
+    TEST_ASSERT(stats.auto_reload, "Stats report auto-reload");
+    TEST_ASSERT(stats.period_ms == 50, "Stats report period");
+
+    status = osal_timer_start(timer_id, 1000);
+    TEST_ASSERT(status == OSAL_SUCCESS, "Timer started");
+
+    uint32_t elapsed = 0;
+    while (stats_callback_count < 3 && elapsed < 1000) {
+        osal_task_delay_ms(10);
+        elapsed += 10;
+    }
+
+    TEST_ASSERT(find_timer_stats("stats_timer", &stats), "Running timer listed in stats");
+    TEST_ASSERT(stats.active, "Stats report timer active");
+    TEST_ASSERT(stats.next_ms <= 50, "Next expiry within one period");
+    TEST_ASSERT(stats.expirations >= 3, "Expirations counted");
+    printf("  Expirations: %u, overruns: %u\n",
+           (unsigned)stats.expirations, (unsigned)stats.overruns);
+
+    status = osal_timer_delete(timer_id, 1000);
+    TEST_ASSERT(status == OSAL_SUCCESS, "Timer deleted");
+    TEST_ASSERT(!find_timer_stats("stats_timer", &stats), "Deleted timer no longer listed");
+
+    TEST_END();
+}
+
 /* ============================================================================
  * Main Test Runner
  * ========================================================================== */
@@ -256,6 +329,7 @@ int osal_timer_tests_run(void)
 
     test_oneshot_timer();
     test_auto_timer_change_reset();
+    test_timer_stats();
 
     printf("\n");
     printf("==================================================\n");
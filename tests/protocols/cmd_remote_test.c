@@ -0,0 +1,681 @@
+/*
+ * Remote CLI Tests
+ *
+ * Connects telnet-style and WebSocket clients to the remote CLI on the
+ * shared Mongoose manager and checks that every client gets a session of
+ * its own.
+ *
+ * Tests:
+ * 1. Telnet: option negotiation, prompt, command output, IAC filtering
+ * 2. Two sessions at once keep their output apart
+ * 3. Clients beyond the session limit are turned away
+ * 4. WebSocket session on the HTTP server
+ * 5. Worker commands: streaming, Ctrl-C, parallel sessions
+ * 6. Deinit closes the sessions and cancels their commands
+ * 7. The net command lists the connections
+ * 8. Scripts, repeat and time
+ * 9. Commands run from code with their output captured
+ * 10. Commands over POST /api/cmd, one at a time, off the poll task
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "cmd_api.h"
+#include "cmd_net.h"
+#include "cmd_remote.h"
+#include "hq_cmd.h"
+#include "hq_config.h"
+#include "http_server.h"
+#include "mongoose.h"
+#include "mongoose_process.h"
+#include "osal_task.h"
+
+#define TELNET_URL "tcp://127.0.0.1:2323"
+#define WS_URL     "ws://127.0.0.1:8000/ws/cli"
+#define HTTP_URL   "tcp://127.0.0.1:8000"
+#define WAIT_MS    3000U
+#define SCRIPT_PATH "/tmp/hq_cmd_remote_test.txt"
+
+/* Test results tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test macros */
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_START(name) \
+    printf("\n==================================================\n"); \
+    printf("TEST: %s\n", name); \
+    printf("==================================================\n")
+
+#define TEST_END() \
+    printf("--------------------------------------------------\n")
+
+/* A network client; only touched on the Mongoose poll task */
+typedef struct
+{
+    struct mg_connection *c;
+    bool websocket;
+    bool http;      /* plain TCP to the HTTP server */
+    bool open;
+    bool closed;
+    size_t len;
+    char buf[2048];
+} test_client_t;
+
+typedef struct
+{
+    test_client_t *client;
+    const char *data;
+    size_t len;
+    bool result;
+} test_call_t;
+
+/* "say <word>" answers "said <word>" in the session that ran it */
+static void say_handler(hq_cmd_cli_t *cli, char *args, void *context)
+{
+    char line[64];
+    const char *word = (hq_cmd_get_token_count(args) > 0) ? hq_cmd_get_token(args, 1) : "";
+
+    (void)cli;
+    (void)context;
+    snprintf(line, sizeof(line), "said %s", word);
+    hq_cmd_print(line);
+}
+
+/* "count" prints a step every 10 ms for up to 3 s, on a worker */
+static volatile uint32_t g_count_done;
+
+static void count_handler(hq_cmd_cli_t *cli, char *args, void *context)
+{
+    char line[32];
+    int step;
+
+    (void)cli;
+    (void)args;
+    (void)context;
+    for (step = 1; step <= 300 && !hq_cmd_cancelled(); step++)
+    {
+        snprintf(line, sizeof(line), "step %d", step);
+        hq_cmd_print(line);
+        osal_task_delay_ms(10);
+    }
+    snprintf(line, sizeof(line), "%s at %d", hq_cmd_cancelled() ? "stopped" : "counted", step - 1);
+    hq_cmd_print(line);
+    __atomic_add_fetch(&g_count_done, 1U, __ATOMIC_RELEASE);
+}
+
+/* "nap" takes 300 ms, long enough to send a second API request meanwhile */
+static void nap_handler(hq_cmd_cli_t *cli, char *args, void *context)
+{
+    (void)cli;
+    (void)args;
+    (void)context;
+    osal_task_delay_ms(300);
+    hq_cmd_print("napped");
+}
+
+static bool wait_for_count_done(uint32_t count)
+{
+    for (uint32_t waited = 0; waited < WAIT_MS; waited += 10U)
+    {
+        if (__atomic_load_n(&g_count_done, __ATOMIC_ACQUIRE) >= count)
+        {
+            return true;
+        }
+        osal_task_delay_ms(10);
+    }
+    return false;
+}
+
+static void client_append(test_client_t *client, const void *data, size_t len)
+{
+    size_t room = sizeof(client->buf) - 1U - client->len;
+
+    if (len > room)
+    {
+        len = room;
+    }
+    memcpy(client->buf + client->len, data, len);
+    client->len += len;
+    client->buf[client->len] = '\0';
+}
+
+static void client_fn(struct mg_connection *c, int ev, void *ev_data)
+{
+    test_client_t *client = (test_client_t *)c->fn_data;
+
+    if (ev == MG_EV_CONNECT && !client->websocket)
+    {
+        client->open = true;
+    }
+    else if (ev == MG_EV_WS_OPEN)
+    {
+        client->open = true;
+    }
+    else if (ev == MG_EV_READ && !client->websocket)
+    {
+        client_append(client, c->recv.buf, c->recv.len);
+        c->recv.len = 0;
+    }
+    else if (ev == MG_EV_WS_MSG)
+    {
+        struct mg_ws_message *wm = (struct mg_ws_message *)ev_data;
+        client_append(client, wm->data.buf, wm->data.len);
+    }
+    else if (ev == MG_EV_CLOSE)
+    {
+        client->closed = true;
+        client->c = NULL;
+    }
+}
+
+static void connect_on_loop(void *arg)
+{
+    test_client_t *client = (test_client_t *)arg;
+
+    if (client->websocket)
+    {
+        client->c = mg_ws_connect(&mgr, WS_URL, client_fn, client, NULL);
+    }
+    else
+    {
+        client->c = mg_connect(&mgr, client->http ? HTTP_URL : TELNET_URL, client_fn, client);
+    }
+    client->closed = (client->c == NULL);
+}
+
+static void send_on_loop(void *arg)
+{
+    test_call_t *call = (test_call_t *)arg;
+    test_client_t *client = call->client;
+
+    if (client->c == NULL)
+    {
+        return;
+    }
+    if (client->websocket)
+    {
+        mg_ws_send(client->c, call->data, call->len, WEBSOCKET_OP_TEXT);
+    }
+    else
+    {
+        mg_send(client->c, call->data, call->len);
+    }
+}
+
+static void contains_on_loop(void *arg)
+{
+    test_call_t *call = (test_call_t *)arg;
+    test_client_t *client = call->client;
+
+    call->result = false;
+    for (size_t i = 0; i + call->len <= client->len && !call->result; i++)
+    {
+        call->result = memcmp(client->buf + i, call->data, call->len) == 0;
+    }
+}
+
+static void state_on_loop(void *arg)
+{
+    test_call_t *call = (test_call_t *)arg;
+
+    /* data selects the flag: "open" or "closed" */
+    call->result = (strcmp(call->data, "open") == 0) ? call->client->open : call->client->closed;
+}
+
+static void close_on_loop(void *arg)
+{
+    test_client_t *client = (test_client_t *)arg;
+
+    if (client->c != NULL)
+    {
+        client->c->is_closing = 1;
+    }
+}
+
+static void client_start(test_client_t *client, bool websocket)
+{
+    memset(client, 0, sizeof(*client));
+    client->websocket = websocket;
+    (void)MongooseProcess_CallWait(connect_on_loop, client);
+}
+
+static void client_start_http(test_client_t *client)
+{
+    memset(client, 0, sizeof(*client));
+    client->http = true;
+    (void)MongooseProcess_CallWait(connect_on_loop, client);
+}
+
+static void client_send(test_client_t *client, const char *data, size_t len)
+{
+    test_call_t call = { .client = client, .data = data, .len = len };
+    (void)MongooseProcess_CallWait(send_on_loop, &call);
+}
+
+static void client_say(test_client_t *client, const char *line)
+{
+    client_send(client, line, strlen(line));
+}
+
+static bool client_contains(test_client_t *client, const char *text, size_t len)
+{
+    test_call_t call = { .client = client, .data = text, .len = len };
+    (void)MongooseProcess_CallWait(contains_on_loop, &call);
+    return call.result;
+}
+
+static bool client_state(test_client_t *client, const char *flag)
+{
+    test_call_t call = { .client = client, .data = flag };
+    (void)MongooseProcess_CallWait(state_on_loop, &call);
+    return call.result;
+}
+
+static bool wait_for_text(test_client_t *client, const char *text)
+{
+    for (uint32_t waited = 0; waited < WAIT_MS; waited += 10U)
+    {
+        if (client_contains(client, text, strlen(text)))
+        {
+            return true;
+        }
+        osal_task_delay_ms(10);
+    }
+    return false;
+}
+
+static bool wait_for_state(test_client_t *client, const char *flag)
+{
+    for (uint32_t waited = 0; waited < WAIT_MS; waited += 10U)
+    {
+        if (client_state(client, flag))
+        {
+            return true;
+        }
+        osal_task_delay_ms(10);
+    }
+    return false;
+}
+
+static bool wait_for_sessions(uint32_t count)
+{
+    for (uint32_t waited = 0; waited < WAIT_MS; waited += 10U)
+    {
+        if (CmdRemote_GetSessionCount() == count)
+        {
+            return true;
+        }
+        osal_task_delay_ms(10);
+    }
+    return false;
+}
+
+static void client_stop(test_client_t *client)
+{
+    (void)MongooseProcess_CallWait(close_on_loop, client);
+    (void)wait_for_state(client, "closed");
+}
+
+/* ============================================================================
+ * Tests
+ * ========================================================================== */
+
+static test_client_t g_a;
+static test_client_t g_b;
+static test_client_t g_c;
+static test_client_t g_d;
+
+static void test_telnet(void)
+{
+    static const char negotiate[] = { (char)255, (char)251, 1, (char)255, (char)251, 3 };
+
+    TEST_START("Telnet session");
+
+    client_start(&g_a, false);
+    TEST_ASSERT(wait_for_text(&g_a, CONFIG_CMD_INVITATION), "Prompt shown on connect");
+    TEST_ASSERT(client_contains(&g_a, negotiate, sizeof(negotiate)), "Server offers to echo and suppress go-ahead");
+    TEST_ASSERT(wait_for_sessions(1), "One session open");
+
+    client_say(&g_a, "say alpha\r\n");
+    TEST_ASSERT(wait_for_text(&g_a, "said alpha"), "Command output reaches the client");
+
+    /* DO ECHO, a subnegotiation and CR NUL mixed into the line */
+    client_send(&g_a, "\xff\xfd\x01say \xff\xfa\x18\x01\xff\xf0" "beta\r\0", 19);
+    TEST_ASSERT(wait_for_text(&g_a, "said beta"), "Telnet negotiation stripped from input");
+
+    TEST_END();
+}
+
+static void test_two_sessions(void)
+{
+    TEST_START("Two sessions");
+
+    client_start(&g_b, false);
+    TEST_ASSERT(wait_for_text(&g_b, CONFIG_CMD_INVITATION), "Second client gets a prompt");
+    TEST_ASSERT(wait_for_sessions(2), "Two sessions open");
+
+    client_say(&g_a, "say one\r\n");
+    client_say(&g_b, "say two\r\n");
+    TEST_ASSERT(wait_for_text(&g_a, "said one"), "First client sees its output");
+    TEST_ASSERT(wait_for_text(&g_b, "said two"), "Second client sees its output");
+    TEST_ASSERT(!client_contains(&g_a, "said two", 8) && !client_contains(&g_b, "said one", 8),
+                "Neither sees the other's output");
+
+    TEST_END();
+}
+
+static void test_session_limit(void)
+{
+    TEST_START("Session limit");
+
+    client_start(&g_c, false);
+    TEST_ASSERT(wait_for_text(&g_c, "Too many sessions"), "Third client told why");
+    TEST_ASSERT(wait_for_state(&g_c, "closed"), "Third client disconnected");
+    TEST_ASSERT(CmdRemote_GetSessionCount() == 2, "Both sessions still open");
+
+    client_stop(&g_b);
+    TEST_ASSERT(wait_for_sessions(1), "Closing a client frees its slot");
+
+    TEST_END();
+}
+
+static void test_websocket(void)
+{
+    TEST_START("WebSocket session");
+
+    client_start(&g_b, true);
+    TEST_ASSERT(wait_for_state(&g_b, "open"), "WebSocket upgraded");
+    TEST_ASSERT(wait_for_text(&g_b, CONFIG_CMD_INVITATION), "Prompt sent as a message");
+    TEST_ASSERT(wait_for_sessions(2), "WebSocket counted as a session");
+
+    client_say(&g_b, "say ws\r");
+    TEST_ASSERT(wait_for_text(&g_b, "said ws"), "Command output sent back");
+    TEST_ASSERT(!client_contains(&g_a, "said ws", 7), "Telnet client does not see it");
+
+    TEST_END();
+}
+
+static void test_worker(void)
+{
+    TEST_START("Worker commands");
+
+    client_say(&g_a, "count\r\n");
+    TEST_ASSERT(wait_for_text(&g_a, "step 3"), "Output streamed while the command runs");
+    client_say(&g_a, "say meanwhile\r\n");
+    TEST_ASSERT(wait_for_text(&g_a, "said meanwhile"), "Session takes other commands meanwhile");
+
+    client_say(&g_b, "count\r");
+    TEST_ASSERT(wait_for_text(&g_b, "step 3"), "Second session runs one in parallel");
+    client_say(&g_b, "count\r");
+    TEST_ASSERT(wait_for_text(&g_b, "Still running"), "One worker command per session");
+
+    client_send(&g_a, "\x03", 1);
+    TEST_ASSERT(wait_for_text(&g_a, "^C") && wait_for_text(&g_a, "stopped at"), "Ctrl-C stops the command");
+    TEST_ASSERT(!client_contains(&g_b, "stopped at", 10), "Other session's command keeps running");
+    client_send(&g_b, "\x03", 1);
+    TEST_ASSERT(wait_for_text(&g_b, "stopped at"), "Ctrl-C over WebSocket");
+    TEST_ASSERT(wait_for_count_done(2), "Both commands returned");
+    TEST_ASSERT(!client_contains(&g_a, "counted", 7), "No command ran to the end");
+
+    TEST_END();
+}
+
+static bool write_script(const char *text)
+{
+    FILE *file = fopen(SCRIPT_PATH, "w");
+    bool ok;
+
+    if (file == NULL)
+    {
+        return false;
+    }
+    ok = fputs(text, file) >= 0;
+    return (fclose(file) == 0) && ok;
+}
+
+static void test_batch(void)
+{
+    TEST_START("Batch commands");
+
+    TEST_ASSERT(write_script("# greeting\nsay one\n\n  say two\r\nsay three"), "Script written");
+    client_say(&g_a, "run " SCRIPT_PATH "\r\n");
+    TEST_ASSERT(wait_for_text(&g_a, "said one") && wait_for_text(&g_a, "said two") &&
+                wait_for_text(&g_a, "said three"), "Script runs every command line");
+    TEST_ASSERT(hq_cmd_exec_script(SCRIPT_PATH) == 3, "Script runs outside a session too");
+
+    client_say(&g_a, "time say four\r\n");
+    TEST_ASSERT(wait_for_text(&g_a, "said four") && wait_for_text(&g_a, "Took "), "time reports the latency");
+    client_say(&g_a, "repeat 3 say five\r\n");
+    TEST_ASSERT(wait_for_text(&g_a, "3 runs in"), "repeat reports the latency");
+
+    TEST_ASSERT(write_script("say six\nnosuch\nsay seven\n"), "Script with an unknown command written");
+    client_say(&g_a, "run " SCRIPT_PATH "\r\n");
+    TEST_ASSERT(wait_for_text(&g_a, "Unknown command: nosuch") && wait_for_text(&g_a, ":2: script stopped"),
+                "Script stops at an unknown command");
+    TEST_ASSERT(!client_contains(&g_a, "said seven", 10), "Lines after it do not run");
+    TEST_ASSERT(hq_cmd_exec_script(SCRIPT_PATH) == -1, "Failed script returns -1");
+
+    TEST_ASSERT(write_script("run " SCRIPT_PATH "\n"), "Script running itself written");
+    client_say(&g_a, "run " SCRIPT_PATH "\r\n");
+    TEST_ASSERT(wait_for_text(&g_a, "nested too deep"), "Nesting is bounded");
+
+    (void)remove(SCRIPT_PATH);
+    TEST_ASSERT(hq_cmd_exec_script(SCRIPT_PATH) == -1, "Missing script returns -1");
+
+    TEST_END();
+}
+
+static void test_execute(void)
+{
+    char data[32];
+    hq_cmd_buffer_t out = { .data = data, .size = sizeof(data) };
+    char line[CONFIG_CMD_BUFFER_SIZE + 2];
+
+    TEST_START("Execute");
+
+    TEST_ASSERT(hq_cmd_execute("say code", hq_cmd_buffer_write, &out) == 0, "Command runs from code");
+    TEST_ASSERT(strcmp(data, "said code\n") == 0, "Output captured into the buffer");
+    TEST_ASSERT(!client_contains(&g_a, "said code", 9), "Nothing goes to a session");
+
+    out.len = 0U;
+    TEST_ASSERT(hq_cmd_execute("time say timed", hq_cmd_buffer_write, &out) == 0 &&
+                strncmp(data, "said timed\nTook ", 16) == 0, "Worker commands run inline");
+
+    out.len = 0U;
+    TEST_ASSERT(hq_cmd_execute("nosuch", hq_cmd_buffer_write, &out) == -1, "Unknown command returns -1");
+    TEST_ASSERT(strcmp(data, "Unknown command: nosuch\n") == 0, "Error captured too");
+
+    memset(line, 'x', sizeof(line) - 1U);
+    line[sizeof(line) - 1U] = '\0';
+    TEST_ASSERT(hq_cmd_execute(line, NULL, NULL) == -1, "Line too long returns -1");
+
+    out.len = 0U;
+    TEST_ASSERT(hq_cmd_execute("repeat 5 say abcdefgh", hq_cmd_buffer_write, &out) == 0, "Long output");
+    TEST_ASSERT(out.truncated && out.len == sizeof(data) - 1U && strlen(data) == out.len,
+                "Output cut at the buffer size");
+
+    TEST_ASSERT(hq_cmd_execute("say quiet", NULL, NULL) == 0, "Output can be dropped");
+
+    TEST_END();
+}
+
+static void test_http_api(void)
+{
+    static const char post[] = "POST /api/cmd HTTP/1.1\r\nContent-Length: 7\r\n\r\nsay api";
+    static const char unknown[] = "POST /api/cmd HTTP/1.1\r\nContent-Length: 6\r\n\r\nnosuch";
+    static const char nap[] = "POST /api/cmd HTTP/1.1\r\nContent-Length: 3\r\n\r\nnap";
+
+    TEST_START("HTTP command API");
+
+    client_start_http(&g_c);
+    TEST_ASSERT(wait_for_state(&g_c, "open"), "Connected to the HTTP server");
+    client_send(&g_c, post, sizeof(post) - 1U);
+    TEST_ASSERT(wait_for_text(&g_c, "HTTP/1.1 200") && wait_for_text(&g_c, "said api\n"), "POST runs the command");
+    client_send(&g_c, unknown, sizeof(unknown) - 1U);
+    TEST_ASSERT(wait_for_text(&g_c, "HTTP/1.1 400") && wait_for_text(&g_c, "Unknown command: nosuch"),
+                "Unknown command answered with 400");
+    client_say(&g_c, "GET /api/cmd HTTP/1.1\r\n\r\n");
+    TEST_ASSERT(wait_for_text(&g_c, "HTTP/1.1 405"), "Only POST accepted");
+    client_stop(&g_c);
+
+    client_start_http(&g_c);
+    client_start_http(&g_d);
+    TEST_ASSERT(wait_for_state(&g_c, "open") && wait_for_state(&g_d, "open"), "Two HTTP clients connected");
+    client_send(&g_c, nap, sizeof(nap) - 1U);
+    osal_task_delay_ms(50);
+    client_send(&g_d, post, sizeof(post) - 1U);
+    TEST_ASSERT(wait_for_text(&g_d, "HTTP/1.1 503") && wait_for_text(&g_d, "Another command is running"),
+                "Second command refused while one runs");
+    TEST_ASSERT(!client_contains(&g_c, "napped", 6), "Refused without waiting for the first");
+    TEST_ASSERT(wait_for_text(&g_c, "HTTP/1.1 200") && wait_for_text(&g_c, "napped\n"),
+                "Slow command answered once done");
+    client_send(&g_d, post, sizeof(post) - 1U);
+    TEST_ASSERT(wait_for_text(&g_d, "said api\n"), "Next command runs again");
+    client_stop(&g_d);
+    client_stop(&g_c);
+
+    TEST_END();
+}
+
+static void test_net(void)
+{
+    TEST_START("Net command");
+
+    client_say(&g_a, "net\r\n");
+    TEST_ASSERT(wait_for_text(&g_a, "Connections:"), "Connection counts printed");
+    TEST_ASSERT(wait_for_text(&g_a, "call latency"), "Event loop stats printed");
+    TEST_ASSERT(wait_for_text(&g_a, "127.0.0.1:2323"), "Telnet session listed");
+
+    TEST_END();
+}
+
+static void test_deinit(void)
+{
+    TEST_START("Deinit");
+
+    /* Earlier output already holds "step 1", so ask a second time to know it started */
+    client_say(&g_a, "count\r\n");
+    client_say(&g_a, "count\r\n");
+    TEST_ASSERT(wait_for_text(&g_a, "Still running"), "Command running at deinit");
+    CmdRemote_Deinit();
+    TEST_ASSERT(wait_for_state(&g_a, "closed") && wait_for_state(&g_b, "closed"), "Sessions closed");
+    TEST_ASSERT(wait_for_sessions(0), "No sessions left");
+    TEST_ASSERT(wait_for_count_done(3), "Closing the session cancelled the command");
+
+    client_start(&g_c, false);
+    TEST_ASSERT(wait_for_state(&g_c, "closed") && !client_state(&g_c, "open"), "Listener closed");
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Main Test Runner
+ * ========================================================================== */
+
+static void cmd_remote_tests_reset(void)
+{
+    tests_run = 0;
+    tests_passed = 0;
+    tests_failed = 0;
+}
+
+int cmd_remote_tests_run(void)
+{
+    hq_cmd_binding_t say_binding = {
+        .name = "say",
+        .help = "Print said <word>",
+        .tokenize_args = true,
+        .context = NULL,
+        .handler = say_handler,
+    };
+    hq_cmd_binding_t count_binding = {
+        .name = "count",
+        .help = "Print steps until Ctrl-C",
+        .tokenize_args = false,
+        .context = NULL,
+        .handler = count_handler,
+        .run_in_worker = true,
+    };
+    hq_cmd_binding_t nap_binding = {
+        .name = "nap",
+        .help = "Print napped after 300 ms",
+        .tokenize_args = false,
+        .context = NULL,
+        .handler = nap_handler,
+    };
+
+    cmd_remote_tests_reset();
+
+    printf("\n");
+    printf("==================================================\n");
+    printf("                Remote CLI Tests                  \n");
+    printf("==================================================\n");
+    printf("\n");
+
+    MongooseProcess_Init();
+    (void)hq_cmd_register(&say_binding);
+    (void)hq_cmd_register(&count_binding);
+    (void)hq_cmd_register(&nap_binding);
+    (void)CmdNet_Register();
+    hq_cmd_register_builtin_commands();
+    TEST_ASSERT(CmdApi_Init(), "Command API enabled");
+
+    if (CmdRemote_Init())
+    {
+        HTTPServer_Init();
+
+        test_telnet();
+        test_two_sessions();
+        test_session_limit();
+        test_websocket();
+        test_worker();
+        test_batch();
+        test_execute();
+        test_http_api();
+        test_net();
+        test_deinit();
+
+        HTTPServer_Deinit();
+    }
+    else
+    {
+        TEST_ASSERT(false, "Remote CLI listening");
+    }
+
+    MongooseProcess_Deinit();
+
+    printf("\n");
+    printf("==================================================\n");
+    printf("                  TEST SUMMARY                    \n");
+    printf("==================================================\n");
+    printf("  Total tests:  %d\n", tests_run);
+    printf("  Passed:       %d\n", tests_passed);
+    printf("  Failed:       %d\n", tests_failed);
+    printf("  Success rate: %.1f%%\n",
+           (tests_run > 0) ? (100.0 * tests_passed / tests_run) : 0.0);
+    printf("==================================================\n");
+
+    if (tests_failed == 0) {
+        printf("\n✓ ALL TESTS PASSED!\n\n");
+    } else {
+        printf("\n✗ SOME TESTS FAILED!\n\n");
+    }
+
+    return tests_failed;
+}
@@ -0,0 +1,1725 @@
+/*
+ * MQTT Application Tests
+ *
+ * Runs the MQTT client against the in-process broker stand-in on the
+ * shared Mongoose manager.
+ *
+ * Tests:
+ * 1. Connect to the broker
+ * 2. Subscribe and receive QoS 0 / QoS 1 publishes looped back by the broker
+ * 3. Variable-length binary publish with ownership release
+ * 4. Unsubscribe stops delivery
+ * 5. Deinit / Init restarts the client cleanly
+ * 6. QoS 1 publishes pipelined through a small in-flight window
+ * 7. Messages posted while offline or behind a full window are spooled and
+ *    replayed in order
+ * 8. Spool size limit, drop-oldest, recovery after reopening and after a reset
+ * 9. Batching: text and delta-encoded series frames, size and age flushes
+ * 10. Several subscribers per filter, overlapping wildcards, many filters
+ * 11. Concurrent asynchronous (un)subscribes and batched resubscribe
+ * 12. Reconnect: immediate first retry, growing backoff, state and counters
+ * 13. QoS 2 handshakes, persistent session resume and restored in-flight state
+ * 14. MQTT 5: topic aliases, message expiry and user properties
+ * 15. Per-topic payload compression and transparent decompression
+ * 16. QoS 2 exactly once through a relay that loses packets and connections
+ * 17. Saved settings: file backend and reconnecting only when needed
+ * 18. TLS: verified handshake, handshake timing and reconnect over TLS
+ * 19. CLI commands run from a control topic, output on the reply topic
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cmd_api.h"
+#include "hq_cmd.h"
+#include "hq_metrics.h"
+#include "mongoose_process.h"
+#include "mqtt_app.h"
+#include "mqtt_batch.h"
+#include "mqtt_broker_stub.h"
+#include "mqtt_compress.h"
+#include "mqtt_config.h"
+#include "mqtt_session.h"
+#include "mqtt_spool.h"
+#include "net_delay_proxy.h"
+#include "osal_file.h"
+#include "osal_mount.h"
+#include "osal_task.h"
+
+#define BROKER_URL "mqtt://127.0.0.1:18830"
+#define RELAY_LISTEN_URL "tcp://127.0.0.1:18833"
+#define RELAY_URL  "mqtt://127.0.0.1:18833"
+#define TLS_BROKER_URL "mqtts://127.0.0.1:18834"
+#define WAIT_MS    3000U
+
+/* Test filesystem image/mount for the spool */
+#ifdef ESP_PLATFORM
+#define TEST_IMAGE_PATH  "flash_test"
+#define TEST_MOUNT_POINT "/littlefs"
+#define TEST_SPOOL_PATH  "/littlefs/spool_test"
+#else
+#define TEST_IMAGE_PATH  "/tmp/mqtt_spool_test.img"
+#define TEST_MOUNT_POINT "/"
+#define TEST_SPOOL_PATH  "/spool_test"
+#endif
+
+#ifndef CONFIG_MQTT_SESSION_PATH
+#define CONFIG_MQTT_SESSION_PATH "/mqtt_session"
+#endif
+
+/* Test results tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test macros */
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_START(name) \
+    printf("\n==================================================\n"); \
+    printf("TEST: %s\n", name); \
+    printf("==================================================\n")
+
+#define TEST_END() \
+    printf("--------------------------------------------------\n")
+
+/* Written on the Mongoose poll task, read by the test task */
+static volatile uint32_t g_received;
+static char g_last_topic[64];
+static char g_last_message[64];
+static size_t g_last_len;
+static uint32_t g_last_sum;
+static volatile uint32_t g_released;
+
+static void on_message(const char *topic, const char *message, size_t message_len)
+{
+    size_t len = (message_len < sizeof(g_last_message) - 1U) ? message_len : sizeof(g_last_message) - 1U;
+
+    snprintf(g_last_topic, sizeof(g_last_topic), "%s", topic);
+    memcpy(g_last_message, message, len);
+    g_last_message[len] = '\0';
+    g_last_len = message_len;
+    g_last_sum = 0;
+    for (size_t i = 0; i < message_len; i++)
+    {
+        g_last_sum = g_last_sum * 31U + (uint8_t)message[i];
+    }
+    __atomic_add_fetch(&g_received, 1U, __ATOMIC_RELEASE);
+}
+
+/* Checks that spooled messages arrive as "0", "1", "2", ... */
+static volatile uint32_t g_spool_next;
+static volatile bool g_spool_in_order;
+
+static void on_spool_message(const char *topic, const char *message, size_t message_len)
+{
+    char expected[16];
+
+    (void)topic;
+    snprintf(expected, sizeof(expected), "%u", (unsigned)g_spool_next);
+    if (message_len != strlen(expected) || memcmp(message, expected, message_len) != 0)
+    {
+        g_spool_in_order = false;
+    }
+    g_spool_next++;
+    __atomic_add_fetch(&g_received, 1U, __ATOMIC_RELEASE);
+}
+
+/* Decoded contents of the batch frames received so far */
+#define MAX_BATCH_ITEMS 128
+static volatile uint32_t g_batch_packets;
+static uint32_t g_batch_items;
+static bool g_batch_valid;
+static char g_batch_text[MAX_BATCH_ITEMS][16];
+static int64_t g_batch_values[MAX_BATCH_ITEMS];
+static uint32_t g_batch_dt[MAX_BATCH_ITEMS];
+static size_t g_batch_max_len;
+
+static bool varint_get(const uint8_t **p, const uint8_t *end, uint64_t *value)
+{
+    *value = 0;
+    for (int shift = 0; *p < end && shift < 64; shift += 7)
+    {
+        uint8_t byte = *(*p)++;
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void on_batch(const char *topic, const char *message, size_t message_len)
+{
+    const uint8_t *p = (const uint8_t *)message;
+    const uint8_t *end = p + message_len;
+    int64_t value = 0;
+    uint64_t a;
+    uint64_t b;
+
+    (void)topic;
+    if (message_len > g_batch_max_len)
+    {
+        g_batch_max_len = message_len;
+    }
+
+    if (message_len == 0U)
+    {
+        g_batch_valid = false;
+    }
+    else if (*p == MQTT_BATCH_FORMAT_TEXT)
+    {
+        for (p++; p < end && g_batch_items < MAX_BATCH_ITEMS; g_batch_items++)
+        {
+            if (!varint_get(&p, end, &a) || a >= sizeof(g_batch_text[0]) || p + a > end)
+            {
+                g_batch_valid = false;
+                break;
+            }
+            memcpy(g_batch_text[g_batch_items], p, (size_t)a);
+            g_batch_text[g_batch_items][a] = '\0';
+            p += a;
+        }
+    }
+    else if (*p == MQTT_BATCH_FORMAT_SERIES)
+    {
+        for (p++; p < end && g_batch_items < MAX_BATCH_ITEMS; g_batch_items++)
+        {
+            if (!varint_get(&p, end, &a) || !varint_get(&p, end, &b))
+            {
+                g_batch_valid = false;
+                break;
+            }
+            value = (int64_t)((uint64_t)value + ((b >> 1) ^ (0U - (b & 1U))));
+            g_batch_dt[g_batch_items] = (uint32_t)a;
+            g_batch_values[g_batch_items] = value;
+        }
+    }
+    else
+    {
+        g_batch_valid = false;
+    }
+    __atomic_add_fetch(&g_batch_packets, 1U, __ATOMIC_RELEASE);
+}
+
+static void batch_reset(void)
+{
+    g_batch_items = 0;
+    g_batch_valid = true;
+    g_batch_max_len = 0;
+    __atomic_store_n(&g_batch_packets, 0U, __ATOMIC_RELEASE);
+}
+
+static bool wait_batches(uint32_t count, uint32_t timeout_ms)
+{
+    for (uint32_t waited = 0; waited < timeout_ms; waited += 10U)
+    {
+        if (__atomic_load_n(&g_batch_packets, __ATOMIC_ACQUIRE) >= count)
+        {
+            return true;
+        }
+        osal_task_delay_ms(10);
+    }
+    return __atomic_load_n(&g_batch_packets, __ATOMIC_ACQUIRE) >= count;
+}
+
+/* Subscriber contexts for the topic trie test */
+typedef struct
+{
+    uint32_t count;
+    char topic[64];
+} sub_sink_t;
+
+static void on_sink(const char *topic, size_t topic_len, const char *message, size_t message_len, void *ctx)
+{
+    sub_sink_t *sink = (sub_sink_t *)ctx;
+
+    (void)message;
+    (void)message_len;
+    snprintf(sink->topic, sizeof(sink->topic), "%.*s", (int)topic_len, topic);
+    __atomic_add_fetch(&sink->count, 1U, __ATOMIC_RELEASE);
+}
+
+static bool wait_sink(sub_sink_t *sink, uint32_t count, uint32_t timeout_ms)
+{
+    for (uint32_t waited = 0; waited < timeout_ms; waited += 10U)
+    {
+        if (__atomic_load_n(&sink->count, __ATOMIC_ACQUIRE) >= count)
+        {
+            return true;
+        }
+        osal_task_delay_ms(10);
+    }
+    return __atomic_load_n(&sink->count, __ATOMIC_ACQUIRE) >= count;
+}
+
+static volatile uint32_t g_done_ok;
+static volatile uint32_t g_done_failed;
+
+static void on_done(bool success, void *ctx)
+{
+    (void)ctx;
+    __atomic_add_fetch(success ? &g_done_ok : &g_done_failed, 1U, __ATOMIC_RELEASE);
+}
+
+static bool wait_done(uint32_t count, uint32_t timeout_ms)
+{
+    for (uint32_t waited = 0; waited < timeout_ms; waited += 10U)
+    {
+        if (__atomic_load_n(&g_done_ok, __ATOMIC_ACQUIRE) + __atomic_load_n(&g_done_failed, __ATOMIC_ACQUIRE) >= count)
+        {
+            return true;
+        }
+        osal_task_delay_ms(10);
+    }
+    return false;
+}
+
+static void on_release(void *ctx)
+{
+    (void)ctx;
+    __atomic_add_fetch(&g_released, 1U, __ATOMIC_RELEASE);
+}
+
+static bool wait_connected(void)
+{
+    for (uint32_t waited = 0; waited < WAIT_MS; waited += 10U)
+    {
+        if (MqttApp_IsConnected())
+        {
+            return true;
+        }
+        osal_task_delay_ms(10);
+    }
+    return false;
+}
+
+static bool wait_received(uint32_t count, uint32_t timeout_ms)
+{
+    for (uint32_t waited = 0; waited < timeout_ms; waited += 10U)
+    {
+        if (__atomic_load_n(&g_received, __ATOMIC_ACQUIRE) >= count)
+        {
+            return true;
+        }
+        osal_task_delay_ms(10);
+    }
+    return __atomic_load_n(&g_received, __ATOMIC_ACQUIRE) >= count;
+}
+
+/* ============================================================================
+ * Test 1: Connect
+ * ========================================================================== */
+
+static void test_connect(void)
+{
+    mqtt_broker_stub_stats_t stats;
+
+    TEST_START("Connect");
+
+    TEST_ASSERT(mqtt_broker_stub_start(BROKER_URL), "Broker stand-in listening");
+
+    MQTTConfig_Init();
+    TEST_ASSERT(MQTTConfig_SetString(BROKER_URL, MQTT_CONFIG_VALUE_ADDRESS), "Broker address configured");
+
+    TEST_ASSERT(MqttApp_Init(), "MQTT app started");
+    TEST_ASSERT(!MqttApp_Init(), "Second init refused while running");
+    TEST_ASSERT(wait_connected(), "Client connected (CONNACK received)");
+
+    mqtt_broker_stub_get_stats(&stats);
+    TEST_ASSERT(stats.connects == 1U, "Broker saw one CONNECT");
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 2: Subscribe and publish
+ * ========================================================================== */
+
+static void test_publish(void)
+{
+    mqtt_broker_stub_stats_t stats;
+    hq_metric_t *timeouts = hq_metrics_counter("hq_mqtt_puback_timeouts_total", NULL, NULL);
+    int64_t timeouts_before = hq_metrics_value(timeouts);
+
+    TEST_START("Subscribe and Publish");
+
+    TEST_ASSERT(MqttApp_Subscribe("hq/test/#", 1, on_message, WAIT_MS), "Subscribe acknowledged");
+    TEST_ASSERT(MqttApp_Subscribe("hq/test/#", 1, on_message, WAIT_MS), "Repeated subscribe succeeds");
+
+    TEST_ASSERT(MqttApp_PostData("hq/test/a", "qos0 hello", 0), "QoS 0 message queued");
+    TEST_ASSERT(wait_received(1U, WAIT_MS), "QoS 0 message looped back");
+    TEST_ASSERT(strcmp(g_last_topic, "hq/test/a") == 0 && strcmp(g_last_message, "qos0 hello") == 0,
+                "QoS 0 topic and payload intact");
+
+    TEST_ASSERT(MqttApp_PostData("hq/test/b", "qos1 hello", 1), "QoS 1 message queued");
+    TEST_ASSERT(wait_received(2U, WAIT_MS), "QoS 1 message looped back");
+    TEST_ASSERT(strcmp(g_last_topic, "hq/test/b") == 0 && strcmp(g_last_message, "qos1 hello") == 0,
+                "QoS 1 topic and payload intact");
+
+    TEST_ASSERT(MqttApp_PostData("hq/test/c", "after ack", 1), "Follow-up QoS 1 message queued");
+    TEST_ASSERT(wait_received(3U, WAIT_MS), "Follow-up message delivered");
+    TEST_ASSERT(hq_metrics_value(timeouts) == timeouts_before, "No PUBACK timeouts");
+
+    mqtt_broker_stub_get_stats(&stats);
+    TEST_ASSERT(stats.subscribes == 1U && stats.publishes == 3U && stats.forwarded == 3U,
+                "Broker counted 1 SUBSCRIBE and forwarded 3 PUBLISH");
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 3: Variable-length publish
+ * ========================================================================== */
+
+static void test_zero_copy(void)
+{
+    static uint8_t big[8192];
+    static const uint8_t binary[] = { 0x00, 0xFF, 0x00, 0x7F, 0x80 };
+    uint32_t received = __atomic_load_n(&g_received, __ATOMIC_ACQUIRE);
+    uint32_t sum = 0;
+
+    TEST_START("Variable-length Publish");
+
+    for (size_t i = 0; i < sizeof(big); i++)
+    {
+        big[i] = (uint8_t)(i * 7U);
+        sum = sum * 31U + big[i];
+    }
+
+    g_released = 0;
+    TEST_ASSERT(MqttApp_Publish("hq/test/big", big, sizeof(big), 1, on_release, NULL), "8 KB QoS 1 payload queued");
+    TEST_ASSERT(wait_received(received + 1U, WAIT_MS), "8 KB payload delivered");
+    TEST_ASSERT(g_last_len == sizeof(big) && g_last_sum == sum, "8 KB payload intact");
+
+    for (uint32_t waited = 0; __atomic_load_n(&g_released, __ATOMIC_ACQUIRE) < 1U && waited < WAIT_MS; waited += 10U)
+    {
+        osal_task_delay_ms(10);
+    }
+    TEST_ASSERT(g_released == 1U, "QoS 1 buffer released after PUBACK");
+
+    TEST_ASSERT(MqttApp_Publish("hq/test/bin", binary, sizeof(binary), 0, on_release, NULL), "Binary QoS 0 payload queued");
+    TEST_ASSERT(wait_received(received + 2U, WAIT_MS), "Binary payload delivered");
+    TEST_ASSERT(g_last_len == sizeof(binary) && memcmp(g_last_message, binary, sizeof(binary)) == 0,
+                "Embedded NUL bytes preserved");
+    TEST_ASSERT(g_released == 2U, "QoS 0 buffer released after send");
+
+    TEST_ASSERT(MqttApp_Publish("hq/test/empty", NULL, 0, 0, NULL, NULL), "Empty payload without release callback");
+    TEST_ASSERT(wait_received(received + 3U, WAIT_MS) && g_last_len == 0U, "Empty payload delivered");
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 4: Unsubscribe
+ * ========================================================================== */
+
+static void test_unsubscribe(void)
+{
+    uint32_t before;
+
+    TEST_START("Unsubscribe");
+
+    TEST_ASSERT(MqttApp_Unsubscribe("hq/test/#", WAIT_MS), "Unsubscribe acknowledged");
+    TEST_ASSERT(!MqttApp_Unsubscribe("hq/test/#", WAIT_MS), "Unknown topic rejected");
+
+    before = __atomic_load_n(&g_received, __ATOMIC_ACQUIRE);
+    TEST_ASSERT(MqttApp_PostData("hq/test/d", "nobody listens", 1), "Message queued after unsubscribe");
+    TEST_ASSERT(!wait_received(before + 1U, 300U), "No delivery after unsubscribe");
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 5: Restart
+ * ========================================================================== */
+
+static void test_restart(void)
+{
+    mqtt_broker_stub_stats_t stats;
+
+    TEST_START("Restart");
+
+    MqttApp_Deinit();
+    TEST_ASSERT(!MqttApp_IsConnected(), "Disconnected after deinit");
+    TEST_ASSERT(!MqttApp_PostData("hq/test/e", "dropped", 0), "Post rejected after deinit");
+
+    MqttApp_Init();
+    TEST_ASSERT(wait_connected(), "Reconnected after init");
+
+    mqtt_broker_stub_get_stats(&stats);
+    TEST_ASSERT(stats.connects == 2U, "Broker saw a second CONNECT");
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 6: In-flight window
+ * ========================================================================== */
+
+static void test_window(void)
+{
+    hq_metric_t *acked = hq_metrics_counter("hq_mqtt_acked_total", NULL, NULL);
+    hq_metric_t *timeouts = hq_metrics_counter("hq_mqtt_puback_timeouts_total", NULL, NULL);
+    int64_t acked_before;
+    int64_t timeouts_before = hq_metrics_value(timeouts);
+    uint32_t received_before;
+    bool queued = true;
+    char payload[16];
+
+    TEST_START("In-flight Window");
+
+    MqttApp_Deinit();
+    TEST_ASSERT(MQTTConfig_SetInt(4, MQTT_CONFIG_VALUE_INFLIGHT), "Window set to 4");
+    MqttApp_Init();
+    TEST_ASSERT(wait_connected(), "Reconnected with the new window");
+    TEST_ASSERT(MqttApp_Subscribe("hq/win/#", 1, on_message, WAIT_MS), "Subscribed to window topic");
+
+    acked_before = hq_metrics_value(acked);
+    received_before = __atomic_load_n(&g_received, __ATOMIC_ACQUIRE);
+
+    for (int i = 0; i < 40 && queued; i++)
+    {
+        uint32_t waited = 0;
+
+        snprintf(payload, sizeof(payload), "%d", i);
+        while (!(queued = MqttApp_PostData("hq/win/seq", payload, 1)) && waited < WAIT_MS)
+        {
+            osal_task_delay_ms(1);
+            waited++;
+        }
+    }
+    TEST_ASSERT(queued, "40 QoS 1 messages queued");
+    TEST_ASSERT(wait_received(received_before + 40U, WAIT_MS), "All 40 delivered");
+    TEST_ASSERT(strcmp(g_last_message, "39") == 0, "Delivered in order");
+
+    for (uint32_t waited = 0; hq_metrics_value(acked) < acked_before + 40 && waited < WAIT_MS; waited += 10U)
+    {
+        osal_task_delay_ms(10);
+    }
+    TEST_ASSERT(hq_metrics_value(acked) == acked_before + 40, "All 40 PUBACKs matched by packet id");
+    TEST_ASSERT(hq_metrics_value(timeouts) == timeouts_before, "No PUBACK timeouts");
+
+    MqttApp_Deinit();
+    MQTTConfig_SetInt(CONFIG_MQTT_INFLIGHT_MAX, MQTT_CONFIG_VALUE_INFLIGHT);
+    mqtt_broker_stub_stop();
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 7: Store-and-forward
+ * ========================================================================== */
+
+static void setup_test_fs(void)
+{
+    /* Start from a clean file-backed image every run. */
+    (void)osal_unmount(TEST_MOUNT_POINT);
+    (void)osal_rmfs(TEST_IMAGE_PATH);
+
+    (void)osal_mkfs(NULL, TEST_IMAGE_PATH, TEST_MOUNT_POINT, 4096U, 256U);
+    (void)osal_mount(TEST_IMAGE_PATH, TEST_MOUNT_POINT);
+}
+
+static void cleanup_test_fs(void)
+{
+    (void)osal_unmount(TEST_MOUNT_POINT);
+    (void)osal_rmfs(TEST_IMAGE_PATH);
+}
+
+static void test_store_and_forward(void)
+{
+    mqtt_spool_stats_t stats;
+    mqtt_broker_stub_stats_t broker;
+    uint32_t received_before;
+    bool queued = true;
+    char payload[16];
+
+    TEST_START("Store-and-forward");
+
+    setup_test_fs();
+    TEST_ASSERT(mqtt_broker_stub_start(BROKER_URL), "Broker stand-in restarted");
+    MqttApp_Init();
+    TEST_ASSERT(MqttSpool_IsOpen(), "Spool opened on the mounted filesystem");
+    TEST_ASSERT(wait_connected(), "Connected");
+    TEST_ASSERT(MqttApp_Subscribe("hq/spool/#", 1, on_spool_message, WAIT_MS), "Subscribed to spool topic");
+
+    mqtt_broker_stub_stop();
+    for (uint32_t waited = 0; MqttApp_IsConnected() && waited < WAIT_MS; waited += 10U)
+    {
+        osal_task_delay_ms(10);
+    }
+    TEST_ASSERT(!MqttApp_IsConnected(), "Broker gone, client offline");
+
+    g_spool_next = 0;
+    g_spool_in_order = true;
+    received_before = __atomic_load_n(&g_received, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < 50 && queued; i++)
+    {
+        uint32_t waited = 0;
+
+        /* The publisher moves queued messages to the spool; retry while it catches up */
+        snprintf(payload, sizeof(payload), "%d", i);
+        while (!(queued = MqttApp_PostData("hq/spool/seq", payload, (i % 2 == 0) ? 1 : 0)) && waited < WAIT_MS)
+        {
+            osal_task_delay_ms(1);
+            waited++;
+        }
+    }
+    TEST_ASSERT(queued, "50 messages accepted while offline");
+
+    for (uint32_t waited = 0; MqttSpool_Count() < 50U && waited < WAIT_MS; waited += 10U)
+    {
+        osal_task_delay_ms(10);
+    }
+    TEST_ASSERT(MqttSpool_Count() == 50U, "All 50 written to the spool");
+
+    /* Reconnect at once instead of waiting out the backoff */
+    TEST_ASSERT(mqtt_broker_stub_start(BROKER_URL), "Broker back");
+    MqttApp_Reconnect();
+    TEST_ASSERT(wait_received(received_before + 50U, 5000U), "All 50 replayed after reconnect");
+    TEST_ASSERT(g_spool_in_order, "Replayed in posting order");
+    for (uint32_t waited = 0; MqttSpool_Count() > 0U && waited < WAIT_MS; waited += 10U)
+    {
+        osal_task_delay_ms(10);
+    }
+    TEST_ASSERT(MqttSpool_Count() == 0U, "Spool drained");
+
+    MqttSpool_GetStats(&stats);
+    TEST_ASSERT(stats.replayed == 50U && stats.dropped == 0U && stats.segments == 0U,
+                "50 replayed, none dropped, segment files removed");
+
+    mqtt_broker_stub_get_stats(&broker);
+    TEST_ASSERT(broker.publishes == 50U, "Broker received each message once");
+
+    /* Online with a full window, the message waiting for a token spills as
+     * soon as the queue behind it fills up, well before the next PUBACK.
+     * One in flight, one waiting and a full queue need no retries to post. */
+    MqttApp_Deinit();
+    TEST_ASSERT(net_delay_proxy_start(RELAY_LISTEN_URL, "tcp://127.0.0.1:18830", 100U), "Relay adds a 200 ms round trip");
+    MQTTConfig_SetString(RELAY_URL, MQTT_CONFIG_VALUE_ADDRESS);
+    MQTTConfig_SetInt(1, MQTT_CONFIG_VALUE_INFLIGHT);
+    MqttApp_Init();
+    TEST_ASSERT(wait_connected(), "Connected through the relay with a window of 1");
+    TEST_ASSERT(MqttApp_Subscribe("hq/spool/#", 1, on_spool_message, WAIT_MS), "Subscribed through the relay");
+
+    g_spool_next = 0;
+    g_spool_in_order = true;
+    received_before = __atomic_load_n(&g_received, __ATOMIC_ACQUIRE);
+    uint32_t start = osal_task_get_time_ms();
+    for (int i = 0; i < CONFIG_MQTT_MESSAGE_QUEUE_SIZE + 2 && queued; i++)
+    {
+        uint32_t waited = 0;
+
+        snprintf(payload, sizeof(payload), "%d", i);
+        while (!(queued = MqttApp_PostData("hq/spool/seq", payload, 1)) && waited < WAIT_MS)
+        {
+            osal_task_delay_ms(1);
+            waited++;
+        }
+    }
+    TEST_ASSERT(queued, "Messages accepted behind the full window");
+    MqttSpool_GetStats(&stats);
+    for (uint32_t waited = 0; stats.spooled == 0U && waited < WAIT_MS; waited++)
+    {
+        osal_task_delay_ms(1);
+        MqttSpool_GetStats(&stats);
+    }
+    TEST_ASSERT(stats.spooled > 0U && osal_task_get_time_ms() - start < 100U,
+                "Spilled to the spool before the first PUBACK came back");
+    TEST_ASSERT(wait_received(received_before + CONFIG_MQTT_MESSAGE_QUEUE_SIZE + 2U, 5000U), "All delivered");
+    TEST_ASSERT(g_spool_in_order, "Spilled messages kept their order");
+
+    MqttApp_Deinit();
+    MQTTConfig_SetString(BROKER_URL, MQTT_CONFIG_VALUE_ADDRESS);
+    MQTTConfig_SetInt(CONFIG_MQTT_INFLIGHT_MAX, MQTT_CONFIG_VALUE_INFLIGHT);
+    net_delay_proxy_stop();
+    mqtt_broker_stub_stop();
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 8: Spool limits
+ * ========================================================================== */
+
+static void test_spool_limits(void)
+{
+    static uint8_t oversized[300];
+    mqtt_spool_stats_t stats;
+    mqtt_spool_record_t rec;
+    char payload[16];
+    uint32_t first;
+    uint32_t expected;
+    bool in_order = true;
+
+    TEST_START("Spool Limits");
+
+    /* Two 256-byte segments hold about 20 of these records */
+    TEST_ASSERT(MqttSpool_Open(TEST_SPOOL_PATH, 256U, 2U), "Small spool opened");
+    for (int i = 0; i < 100; i++)
+    {
+        snprintf(payload, sizeof(payload), "%d", i);
+        (void)MqttSpool_Push("t/seq", payload, strlen(payload), 1);
+    }
+    TEST_ASSERT(!MqttSpool_Push("t/big", oversized, sizeof(oversized), 1), "Record larger than a segment rejected");
+
+    MqttSpool_GetStats(&stats);
+    TEST_ASSERT(stats.bytes <= 512U && stats.segments <= 2U, "Disk usage bounded by the segment limit");
+    TEST_ASSERT(stats.records > 0U && stats.records + stats.dropped == 101U, "Every message kept or counted as dropped");
+
+    MqttSpool_Close();
+    TEST_ASSERT(MqttSpool_Open(TEST_SPOOL_PATH, 256U, 2U), "Spool reopened");
+    TEST_ASSERT(MqttSpool_Count() == stats.records, "Spooled messages recovered after reopening");
+
+    TEST_ASSERT(MqttSpool_Peek(&rec), "Oldest message readable");
+    first = (uint32_t)atoi((const char *)rec.payload);
+    TEST_ASSERT(first > 0U && strcmp(rec.topic, "t/seq") == 0, "Oldest messages were the ones dropped");
+    free(rec.topic);
+
+    expected = first;
+    while (MqttSpool_Peek(&rec))
+    {
+        snprintf(payload, sizeof(payload), "%u", (unsigned)expected++);
+        if (rec.len != strlen(payload) || memcmp(rec.payload, payload, rec.len) != 0)
+        {
+            in_order = false;
+        }
+        free(rec.topic);
+        MqttSpool_Pop();
+    }
+    TEST_ASSERT(in_order && expected == 100U, "Survivors read back in order up to the newest");
+
+    MqttSpool_GetStats(&stats);
+    TEST_ASSERT(stats.records == 0U && stats.bytes == 0U && stats.segments == 0U, "Empty spool uses no segment files");
+
+    /* A reset part way through a segment replays only the pops since the
+     * read position was last saved. Restoring the index as it was before
+     * Close() stands in for the power loss. */
+    MqttSpool_Close();
+    TEST_ASSERT(MqttSpool_Open(TEST_SPOOL_PATH, 4096U, 2U), "Spool reopened with room for 40 messages");
+    for (int i = 0; i < 40; i++)
+    {
+        snprintf(payload, sizeof(payload), "%d", i);
+        (void)MqttSpool_Push("t/seq", payload, strlen(payload), 1);
+    }
+    for (int i = 0; i < 20 && MqttSpool_Peek(&rec); i++)
+    {
+        free(rec.topic);
+        MqttSpool_Pop();
+    }
+    TEST_ASSERT(MqttSpool_Count() == 20U, "Half of 40 replayed");
+
+    char index_path[OSAL_MAX_PATH_LEN];
+    uint8_t index[64];
+    int32_t index_len = -1;
+    snprintf(index_path, sizeof(index_path), "%s.idx", TEST_SPOOL_PATH);
+    osal_file_id_t fd = osal_open_create(index_path, OSAL_FILE_FLAG_NONE, OSAL_READ_ONLY);
+    if (fd >= 0)
+    {
+        index_len = osal_read(fd, index, sizeof(index));
+        osal_close(fd);
+    }
+    MqttSpool_Close();
+    fd = osal_open_create(index_path, OSAL_FILE_FLAG_CREATE | OSAL_FILE_FLAG_TRUNCATE, OSAL_WRITE_ONLY);
+    TEST_ASSERT(index_len > 0 && fd >= 0 && osal_write(fd, index, (size_t)index_len) == index_len,
+                "Index put back as it was before the reset");
+    osal_close(fd);
+
+    TEST_ASSERT(MqttSpool_Open(TEST_SPOOL_PATH, 4096U, 2U), "Spool reopened after the reset");
+    TEST_ASSERT(MqttSpool_Count() >= 20U && MqttSpool_Count() < 20U + CONFIG_MQTT_SPOOL_INDEX_INTERVAL,
+                "Fewer than one save interval of messages replayed again");
+    snprintf(payload, sizeof(payload), "%u", (unsigned)(40U - MqttSpool_Count()));
+    TEST_ASSERT(MqttSpool_Peek(&rec) && rec.len == strlen(payload) && memcmp(rec.payload, payload, rec.len) == 0,
+                "Replay resumes at the saved position");
+    free(rec.topic);
+
+    MqttSpool_Close();
+    cleanup_test_fs();
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 9: Batching
+ * ========================================================================== */
+
+static void test_batch(void)
+{
+    static const int64_t series[] = { 1000, 1002, 1001, -5, 0, 1000000000000LL, 999999999999LL, INT64_MAX, INT64_MIN };
+    const mqtt_batch_config_t config = { .max_bytes = 64, .max_age_ms = 200 };
+    mqtt_batch_stats_t stats;
+    char text[16];
+    bool ok = true;
+    uint32_t start_ms;
+
+    TEST_START("Batching");
+
+    TEST_ASSERT(mqtt_broker_stub_start(BROKER_URL), "Broker stand-in restarted");
+    MqttApp_Init();
+    TEST_ASSERT(wait_connected(), "Connected");
+    TEST_ASSERT(MqttApp_Subscribe("hq/batch/#", 1, on_batch, WAIT_MS), "Subscribed to batch topic");
+    TEST_ASSERT(MqttBatch_Init(&config), "Batching started with 64 byte / 200 ms limits");
+
+    /* Age flush: a few small messages leave as one packet */
+    batch_reset();
+    start_ms = osal_task_get_time_ms();
+    for (int i = 0; i < 5; i++)
+    {
+        snprintf(text, sizeof(text), "m%d", i);
+        ok &= MqttBatch_Post("hq/batch/text", text, 1);
+    }
+    TEST_ASSERT(ok, "5 text messages batched");
+    TEST_ASSERT(wait_batches(1U, WAIT_MS), "Batch flushed by age");
+    TEST_ASSERT(osal_task_get_time_ms() - start_ms >= 150U, "Not flushed before the age limit");
+    TEST_ASSERT(g_batch_packets == 1U && g_batch_valid && g_batch_items == 5U, "One frame with 5 records");
+    TEST_ASSERT(strcmp(g_batch_text[0], "m0") == 0 && strcmp(g_batch_text[4], "m4") == 0, "Records in order");
+
+    /* Size flush: 40 messages do not fit in 64 bytes */
+    batch_reset();
+    for (int i = 0; i < 40; i++)
+    {
+        snprintf(text, sizeof(text), "value-%02d", i);
+        ok &= MqttBatch_Post("hq/batch/text", text, 1);
+    }
+    MqttBatch_Flush(NULL);
+    TEST_ASSERT(ok, "40 text messages batched");
+    TEST_ASSERT(wait_batches(6U, WAIT_MS) && g_batch_items == 40U, "40 records across the size-limited frames");
+    TEST_ASSERT(g_batch_valid && g_batch_max_len <= config.max_bytes, "Every frame within the size limit");
+    TEST_ASSERT(strcmp(g_batch_text[39], "value-39") == 0, "Last record intact");
+
+    /* Series: delta-encoded samples reconstruct exactly */
+    batch_reset();
+    for (size_t i = 0; i < sizeof(series) / sizeof(series[0]); i++)
+    {
+        ok &= MqttBatch_PostValue("hq/batch/series", series[i], 0);
+    }
+    TEST_ASSERT(ok && MqttBatch_Flush("hq/batch/series"), "Series batched and flushed");
+    TEST_ASSERT(wait_batches(1U, WAIT_MS) && g_batch_valid && g_batch_items == 9U, "One series frame with 9 samples");
+    ok = g_batch_dt[0] == 0U;
+    for (size_t i = 0; i < sizeof(series) / sizeof(series[0]); i++)
+    {
+        ok &= g_batch_values[i] == series[i];
+    }
+    TEST_ASSERT(ok, "Series values and first time offset decoded");
+
+    MqttBatch_GetStats(&stats);
+    TEST_ASSERT(stats.messages == 54U && stats.dropped == 0U && stats.unbatched == 0U, "54 messages batched, none lost");
+    TEST_ASSERT(stats.packets >= 8U && stats.flush_age == 1U && stats.flush_size >= 5U,
+                "Packets counted by flush reason");
+    TEST_ASSERT(stats.bytes_out <= stats.bytes_in + stats.messages + stats.packets,
+                "Framing costs at most one byte per short message plus one per packet");
+
+    /* Oversized messages bypass batching */
+    batch_reset();
+    TEST_ASSERT(MqttBatch_Post("hq/batch/big", "this message is longer than the sixty-four byte batch limit, really", 0),
+                "Oversized message accepted");
+    MqttBatch_GetStats(&stats);
+    TEST_ASSERT(stats.unbatched == 1U, "Oversized message published unbatched");
+
+    MqttBatch_Deinit();
+    TEST_ASSERT(!MqttBatch_Post("hq/batch/text", "late", 0), "Post rejected after deinit");
+
+    MqttApp_Deinit();
+    mqtt_broker_stub_stop();
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 10: Subscribers
+ * ========================================================================== */
+
+static void test_subscribers(void)
+{
+    static sub_sink_t a, b, all, dev[16];
+    mqtt_broker_stub_stats_t before, after;
+    char filter[32];
+    bool ok = true;
+
+    TEST_START("Subscribers");
+
+    TEST_ASSERT(mqtt_broker_stub_start(BROKER_URL), "Broker stand-in restarted");
+    MqttApp_Init();
+    TEST_ASSERT(wait_connected(), "Connected");
+
+    mqtt_broker_stub_get_stats(&before);
+    TEST_ASSERT(MqttApp_SubscribeCtx("hq/multi/+/temp", 0, on_sink, &a, WAIT_MS), "First subscriber on a filter");
+    TEST_ASSERT(MqttApp_SubscribeCtx("hq/multi/+/temp", 0, on_sink, &b, WAIT_MS), "Second subscriber on the same filter");
+    TEST_ASSERT(MqttApp_SubscribeCtx("hq/multi/+/temp", 0, on_sink, &b, WAIT_MS), "Repeated subscriber is a no-op");
+    mqtt_broker_stub_get_stats(&after);
+    TEST_ASSERT(after.subscribes - before.subscribes == 1U, "Shared filter sent one SUBSCRIBE");
+
+    TEST_ASSERT(MqttApp_SubscribeCtx("hq/multi/#", 1, on_sink, &all, WAIT_MS), "Overlapping '#' subscriber");
+    for (int i = 0; i < 16; i++)
+    {
+        snprintf(filter, sizeof(filter), "hq/multi/dev/%d", i);
+        ok &= MqttApp_SubscribeCtx(filter, 0, on_sink, &dev[i], WAIT_MS);
+    }
+    TEST_ASSERT(ok, "16 more filters, beyond the old fixed table");
+
+    TEST_ASSERT(MqttApp_PostData("hq/multi/kitchen/temp", "21.5", 0), "Publish to overlapping filters");
+    TEST_ASSERT(wait_sink(&a, 1U, WAIT_MS) && wait_sink(&b, 1U, WAIT_MS) && wait_sink(&all, 1U, WAIT_MS),
+                "Every matching subscriber called");
+    TEST_ASSERT(strcmp(a.topic, "hq/multi/kitchen/temp") == 0, "Subscriber sees the full topic");
+
+    TEST_ASSERT(MqttApp_PostData("hq/multi/dev/11", "on", 0), "Publish to one of many filters");
+    TEST_ASSERT(wait_sink(&dev[11], 1U, WAIT_MS) && wait_sink(&all, 2U, WAIT_MS), "Literal and '#' filters called");
+    osal_task_delay_ms(100);
+    TEST_ASSERT(dev[10].count == 0U && dev[12].count == 0U && a.count == 1U && all.count == 2U,
+                "Nothing else called, nothing twice");
+
+    mqtt_broker_stub_get_stats(&before);
+    TEST_ASSERT(MqttApp_UnsubscribeCtx("hq/multi/+/temp", on_sink, &a, WAIT_MS), "First subscriber removed");
+    TEST_ASSERT(!MqttApp_UnsubscribeCtx("hq/multi/+/temp", on_sink, &a, WAIT_MS), "Removed subscriber is unknown");
+    mqtt_broker_stub_get_stats(&after);
+    TEST_ASSERT(after.unsubscribes == before.unsubscribes, "No UNSUBSCRIBE while a subscriber remains");
+
+    TEST_ASSERT(MqttApp_PostData("hq/multi/hall/temp", "19.0", 0), "Publish after removing one subscriber");
+    TEST_ASSERT(wait_sink(&b, 2U, WAIT_MS) && wait_sink(&all, 3U, WAIT_MS), "Remaining subscribers called");
+    osal_task_delay_ms(100);
+    TEST_ASSERT(a.count == 1U, "Removed subscriber not called");
+
+    TEST_ASSERT(MqttApp_SubscribeCtx("hq/multi/+/temp", 1, on_sink, &a, WAIT_MS), "Subscriber at a higher QoS");
+    TEST_ASSERT(MqttApp_UnsubscribeCtx("hq/multi/+/temp", on_sink, &a, WAIT_MS) &&
+                MqttApp_UnsubscribeCtx("hq/multi/+/temp", on_sink, &b, WAIT_MS), "Both subscribers removed");
+    mqtt_broker_stub_get_stats(&after);
+    TEST_ASSERT(after.subscribes - before.subscribes == 1U && after.unsubscribes - before.unsubscribes == 1U,
+                "QoS upgrade re-subscribed, last subscriber unsubscribed");
+
+    TEST_ASSERT(MqttApp_Unsubscribe("hq/multi/#", WAIT_MS), "Legacy unsubscribe drops a ctx filter");
+
+    MqttApp_Deinit();
+    mqtt_broker_stub_stop();
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 11: Asynchronous subscribe
+ * ========================================================================== */
+
+static void test_async_subscribe(void)
+{
+    static sub_sink_t sinks[8], joined;
+    mqtt_broker_stub_stats_t before, after;
+    char filter[32];
+    bool ok = true;
+
+    TEST_START("Asynchronous Subscribe");
+
+    TEST_ASSERT(mqtt_broker_stub_start(BROKER_URL), "Broker stand-in restarted");
+    MqttApp_Init();
+    TEST_ASSERT(wait_connected(), "Connected");
+
+    g_done_ok = 0;
+    g_done_failed = 0;
+    mqtt_broker_stub_get_stats(&before);
+    for (int i = 0; i < 8; i++)
+    {
+        snprintf(filter, sizeof(filter), "hq/async/%d", i);
+        ok &= MqttApp_SubscribeAsync(filter, 1, on_sink, &sinks[i], on_done, NULL);
+    }
+    TEST_ASSERT(ok, "8 subscribes in flight at once");
+    TEST_ASSERT(MqttApp_SubscribeAsync("hq/async/0", 0, on_sink, &joined, on_done, NULL),
+                "Subscriber joins the SUBSCRIBE already in flight");
+    TEST_ASSERT(!MqttApp_SubscribeAsync("hq/#/async", 0, on_sink, &joined, on_done, NULL), "Invalid filter rejected");
+    TEST_ASSERT(wait_done(9U, WAIT_MS) && g_done_ok == 9U, "Every request completed successfully");
+    mqtt_broker_stub_get_stats(&after);
+    TEST_ASSERT(after.subscribes - before.subscribes == 8U, "One SUBSCRIBE per filter");
+
+    TEST_ASSERT(MqttApp_PostData("hq/async/0", "x", 0), "Publish to the shared filter");
+    TEST_ASSERT(wait_sink(&sinks[0], 1U, WAIT_MS) && wait_sink(&joined, 1U, WAIT_MS), "Both subscribers called");
+
+    /* Reconnect: every filter goes back in one SUBSCRIBE */
+    mqtt_broker_stub_get_stats(&before);
+    MqttApp_Reconnect();
+    for (uint32_t waited = 0; waited < WAIT_MS; waited += 10U)
+    {
+        mqtt_broker_stub_get_stats(&after);
+        if (after.connects > before.connects && after.subscribes > before.subscribes)
+        {
+            break;
+        }
+        osal_task_delay_ms(10);
+    }
+    osal_task_delay_ms(100);
+    mqtt_broker_stub_get_stats(&after);
+    TEST_ASSERT(after.connects - before.connects == 1U && after.subscribes - before.subscribes == 1U,
+                "8 filters resubscribed in a single SUBSCRIBE");
+    TEST_ASSERT(MqttApp_PostData("hq/async/5", "y", 1), "Publish after reconnect");
+    TEST_ASSERT(wait_sink(&sinks[5], 1U, WAIT_MS), "Resubscribed filter delivers");
+
+    g_done_ok = 0;
+    g_done_failed = 0;
+    ok = true;
+    mqtt_broker_stub_get_stats(&before);
+    for (int i = 0; i < 8; i++)
+    {
+        snprintf(filter, sizeof(filter), "hq/async/%d", i);
+        ok &= MqttApp_UnsubscribeAsync(filter, NULL, NULL, on_done, NULL);
+    }
+    TEST_ASSERT(ok, "8 unsubscribes in flight at once");
+    TEST_ASSERT(wait_done(8U, WAIT_MS) && g_done_ok == 8U, "Every unsubscribe acknowledged");
+    mqtt_broker_stub_get_stats(&after);
+    TEST_ASSERT(after.unsubscribes - before.unsubscribes == 8U, "One UNSUBSCRIBE per filter");
+
+    /* A request cut off by a disconnect still completes */
+    g_done_ok = 0;
+    g_done_failed = 0;
+    TEST_ASSERT(MqttApp_SubscribeAsync("hq/async/late", 1, on_sink, &joined, on_done, NULL), "Subscribe before deinit");
+    MqttApp_Deinit();
+    TEST_ASSERT(g_done_ok + g_done_failed == 1U, "Completion called by the time deinit returns");
+
+    mqtt_broker_stub_stop();
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 12: Reconnect backoff
+ * ========================================================================== */
+
+static void test_reconnect(void)
+{
+    mqtt_conn_stats_t conn;
+    mqtt_conn_stats_t second = { 0 };
+    mqtt_conn_stats_t third = { 0 };
+    uint32_t waited;
+
+    TEST_START("Reconnect Backoff");
+
+    TEST_ASSERT(mqtt_broker_stub_start(BROKER_URL), "Broker stand-in restarted");
+    MqttApp_Init();
+    TEST_ASSERT(wait_connected(), "Connected");
+    MqttApp_GetConnStats(&conn);
+    TEST_ASSERT(conn.state == MQTT_STATE_CONNECTED && conn.connects == 1U && conn.failures == 0U,
+                "Connected state after the first attempt");
+
+    /* The first retry is immediate and refused, later ones back off */
+    osal_task_delay_ms(20);    /* So the first session lasts a measurable time */
+    mqtt_broker_stub_stop();
+    for (waited = 0; waited < 5000U && third.failures == 0U; waited += 10U)
+    {
+        MqttApp_GetConnStats(&conn);
+        if (conn.state == MQTT_STATE_BACKOFF && conn.failures == 2U)
+        {
+            second = conn;
+        }
+        if (conn.state == MQTT_STATE_BACKOFF && conn.failures == 3U)
+        {
+            third = conn;
+        }
+        osal_task_delay_ms(10);
+    }
+    TEST_ASSERT(second.failures == 2U && third.failures == 3U, "Retries continue while the broker is down");
+    TEST_ASSERT(second.retry_delay_ms > 0U && third.retry_delay_ms >= second.retry_delay_ms,
+                "Backoff delay grows");
+    TEST_ASSERT(third.reconnects >= 2U && third.last_error[0] != '\0', "Reconnect count and last error recorded");
+
+    TEST_ASSERT(mqtt_broker_stub_start(BROKER_URL), "Broker back");
+    for (waited = 0; !MqttApp_IsConnected() && waited < 5000U; waited += 10U)
+    {
+        osal_task_delay_ms(10);
+    }
+    TEST_ASSERT(MqttApp_IsConnected(), "Reconnected on its own within the backoff");
+    MqttApp_GetConnStats(&conn);
+    TEST_ASSERT(conn.state == MQTT_STATE_CONNECTED && conn.connects == 2U && conn.connected_ms > 0U,
+                "Second session counted, connected time accumulated");
+
+    MqttApp_Deinit();
+    MqttApp_GetConnStats(&conn);
+    TEST_ASSERT(conn.state == MQTT_STATE_STOPPED, "Stopped after deinit");
+    mqtt_broker_stub_stop();
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 13: QoS 2 and persistent session
+ * ========================================================================== */
+
+/* Waits for a reconnect started by MqttApp_Reconnect() or a saved setting */
+static bool wait_reconnected(uint32_t connects_before)
+{
+    mqtt_broker_stub_stats_t stats = { 0 };
+
+    for (uint32_t waited = 0; waited < WAIT_MS; waited += 10U)
+    {
+        mqtt_broker_stub_get_stats(&stats);
+        if (stats.connects > connects_before && MqttApp_IsConnected())
+        {
+            return true;
+        }
+        osal_task_delay_ms(10);
+    }
+    return false;
+}
+
+static void test_qos2_session(void)
+{
+    static sub_sink_t sink;
+    mqtt_broker_stub_stats_t before, after;
+    mqtt_session_t saved;
+    uint16_t rx_ids[1] = { 4242 };
+    mqtt_session_msg_t restored = {
+        .id = 500, .qos = 2, .released = false, .topic = "hq/qos2/restored", .payload = "r", .len = 1 };
+    bool ok = true;
+
+    TEST_START("QoS 2 and Persistent Session");
+
+    setup_test_fs();
+    TEST_ASSERT(mqtt_broker_stub_start(BROKER_URL), "Broker stand-in restarted");
+    TEST_ASSERT(MQTTConfig_SetString("hq_session_test", MQTT_CONFIG_VALUE_CLIENT_ID) &&
+                MQTTConfig_SetBool(false, MQTT_CONFIG_VALUE_CLEAN), "Fixed client id, clean session off");
+    MqttApp_Init();
+    TEST_ASSERT(wait_connected(), "Connected");
+
+    TEST_ASSERT(MqttApp_SubscribeCtx("hq/qos2/#", 2, on_sink, &sink, WAIT_MS), "Subscribed at QoS 2");
+    for (int i = 0; i < 20 && ok; i++)
+    {
+        /* The queue is short; wait for the window to drain it */
+        uint32_t waited = 0;
+        while (!(ok = MqttApp_PostData("hq/qos2/seq", "x", 2)) && waited < WAIT_MS)
+        {
+            osal_task_delay_ms(5);
+            waited += 5U;
+        }
+    }
+    TEST_ASSERT(ok, "20 QoS 2 messages posted");
+    TEST_ASSERT(wait_sink(&sink, 20U, WAIT_MS), "Delivered through PUBREC/PUBREL/PUBCOMP");
+    osal_task_delay_ms(500);
+    TEST_ASSERT(sink.count == 20U, "Each delivered exactly once");
+    TEST_ASSERT(MqttSession_Load(CONFIG_MQTT_SESSION_PATH, &saved) && saved.msg_count == 0U && saved.rx_count == 0U,
+                "Saved session is empty once every handshake completed");
+    MqttSession_Free(&saved);
+
+    /* Forced reconnect: the broker still has the session */
+    mqtt_broker_stub_get_stats(&before);
+    MqttApp_Reconnect();
+    TEST_ASSERT(wait_reconnected(before.connects), "Reconnected");
+    mqtt_broker_stub_get_stats(&after);
+    TEST_ASSERT(after.sessions_resumed == before.sessions_resumed + 1U && after.subscribes == before.subscribes,
+                "Session resumed without resubscribing");
+    TEST_ASSERT(MqttApp_PostData("hq/qos2/seq", "y", 2) && wait_sink(&sink, 21U, WAIT_MS),
+                "Filter kept by the broker still delivers");
+
+    /* Restart with an unfinished publish and receipt left in the session file */
+    MqttApp_Deinit();
+    saved = (mqtt_session_t){ .next_id = 600, .msg_count = 1, .msgs = &restored, .rx_count = 1, .rx_ids = rx_ids };
+    TEST_ASSERT(MqttSession_Save(CONFIG_MQTT_SESSION_PATH, &saved), "Session file written");
+    mqtt_broker_stub_get_stats(&before);
+    MqttApp_Init();
+    TEST_ASSERT(wait_connected(), "Connected after restart");
+    after = before;
+    for (uint32_t waited = 0; waited < WAIT_MS && after.publishes == before.publishes; waited += 10U)
+    {
+        mqtt_broker_stub_get_stats(&after);
+        osal_task_delay_ms(10);
+    }
+    TEST_ASSERT(after.publishes == before.publishes + 1U && after.sessions_resumed == before.sessions_resumed + 1U,
+                "Restored publish sent again into the resumed session");
+    osal_task_delay_ms(500);
+    TEST_ASSERT(MqttSession_Load(CONFIG_MQTT_SESSION_PATH, &saved) && saved.msg_count == 0U &&
+                saved.rx_count == 1U && saved.rx_ids[0] == 4242U,
+                "Restored publish completed, unreleased receipt kept");
+    MqttSession_Free(&saved);
+
+    /* Back to clean sessions: the broker forgets, filters are sent again */
+    TEST_ASSERT(MqttApp_SubscribeCtx("hq/qos2/#", 2, on_sink, &sink, WAIT_MS), "Subscribed again after restart");
+    MQTTConfig_SetBool(true, MQTT_CONFIG_VALUE_CLEAN);
+    mqtt_broker_stub_get_stats(&before);
+    MQTTConfig_Save();
+    TEST_ASSERT(wait_reconnected(before.connects), "Reconnected with a clean session");
+    osal_task_delay_ms(100);
+    mqtt_broker_stub_get_stats(&after);
+    TEST_ASSERT(after.sessions_resumed == before.sessions_resumed && after.subscribes == before.subscribes + 1U,
+                "Clean session resubscribed");
+    TEST_ASSERT(!MqttSession_Load(CONFIG_MQTT_SESSION_PATH, &saved), "Session file removed");
+
+    MqttApp_Deinit();
+    MQTTConfig_SetString("", MQTT_CONFIG_VALUE_CLIENT_ID);
+    mqtt_broker_stub_stop();
+    cleanup_test_fs();
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 14: MQTT 5 properties
+ * ========================================================================== */
+
+static void test_mqtt5(void)
+{
+    static sub_sink_t sink;
+    static const char topic[] = "hq/v5/a/rather/long/telemetry/topic/name";
+    static const mqtt_user_prop_t user[] = { { "unit", "C" }, { "sensor", "t1" } };
+    const mqtt_publish_props_t props = { .expiry_s = 60, .user_props = user, .user_prop_count = 2 };
+    const mqtt_user_prop_t bad[] = { { "unit", NULL } };
+    const mqtt_publish_props_t bad_props = { .user_props = bad, .user_prop_count = 1 };
+    mqtt_broker_stub_stats_t before, after;
+    bool ok = true;
+
+    TEST_START("MQTT 5 Topic Aliases and Properties");
+
+    TEST_ASSERT(mqtt_broker_stub_start(BROKER_URL), "Broker stand-in restarted");
+    TEST_ASSERT(MQTTConfig_SetInt(5, MQTT_CONFIG_VALUE_VERSION), "Protocol version 5");
+    mqtt_broker_stub_get_stats(&before);
+    MqttApp_Init();
+    TEST_ASSERT(wait_connected(), "Connected");
+    TEST_ASSERT(MqttApp_SubscribeCtx("hq/v5/#", 1, on_sink, &sink, WAIT_MS), "Subscribed with MQTT 5 SUBSCRIBE");
+    mqtt_broker_stub_get_stats(&after);
+    TEST_ASSERT(after.connects_v5 == before.connects_v5 + 1U, "CONNECT sent as MQTT 5");
+
+    TEST_ASSERT(!MqttApp_PublishProps(topic, "x", 1, 1, &bad_props, NULL, NULL), "Invalid user property refused");
+
+    for (int i = 0; i < 10 && ok; i++)
+    {
+        uint32_t waited = 0;
+        while (!(ok = MqttApp_PublishProps(topic, "x", 1, 1, &props, NULL, NULL)) && waited < WAIT_MS)
+        {
+            osal_task_delay_ms(5);
+            waited += 5U;
+        }
+    }
+    TEST_ASSERT(ok, "10 publishes with properties queued");
+    TEST_ASSERT(wait_sink(&sink, 10U, WAIT_MS), "All delivered back through the broker");
+    TEST_ASSERT(strcmp(sink.topic, topic) == 0, "Aliased topic resolved by the broker");
+    mqtt_broker_stub_get_stats(&after);
+    TEST_ASSERT(after.aliased == before.aliased + 9U, "Topic sent once, then the alias alone");
+    TEST_ASSERT(after.last_expiry_s >= 1U && after.last_expiry_s <= 60U, "Remaining expiry interval sent");
+    TEST_ASSERT(after.last_user_props == 2U, "User properties sent");
+
+    /* Reconnect: aliases start over on the new connection */
+    mqtt_broker_stub_get_stats(&before);
+    MqttApp_Reconnect();
+    TEST_ASSERT(wait_reconnected(before.connects), "Reconnected");
+    TEST_ASSERT(MqttApp_PublishProps(topic, "y", 1, 0, NULL, NULL, NULL) && wait_sink(&sink, 11U, WAIT_MS),
+                "QoS 0 publish without properties delivered");
+    mqtt_broker_stub_get_stats(&after);
+    TEST_ASSERT(after.aliased == before.aliased && after.last_user_props == 0U,
+                "Topic sent again after the reconnect");
+
+    MqttApp_Deinit();
+    MQTTConfig_SetInt(4, MQTT_CONFIG_VALUE_VERSION);
+    mqtt_broker_stub_stop();
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 15: Payload compression
+ * ========================================================================== */
+
+/* Keeps the whole payload of the last message, unlike on_message() */
+static char g_big[4096];
+static size_t g_big_len;
+static volatile uint32_t g_big_count;
+
+static void on_big(const char *topic, size_t topic_len, const char *message, size_t message_len, void *ctx)
+{
+    (void)topic;
+    (void)topic_len;
+    (void)ctx;
+    g_big_len = message_len;
+    memcpy(g_big, message, (message_len < sizeof(g_big)) ? message_len : sizeof(g_big));
+    __atomic_add_fetch(&g_big_count, 1U, __ATOMIC_RELEASE);
+}
+
+static bool wait_big(uint32_t count)
+{
+    for (uint32_t waited = 0; waited < WAIT_MS; waited += 10U)
+    {
+        if (__atomic_load_n(&g_big_count, __ATOMIC_ACQUIRE) >= count)
+        {
+            return true;
+        }
+        osal_task_delay_ms(10);
+    }
+    return false;
+}
+
+static uint32_t publish_bytes_for(const char *topic, const char *payload, size_t len, uint32_t count)
+{
+    mqtt_broker_stub_stats_t before, after;
+
+    mqtt_broker_stub_get_stats(&before);
+    if (!MqttApp_Publish(topic, payload, len, 1, NULL, NULL) || !wait_big(count))
+    {
+        return 0;
+    }
+    mqtt_broker_stub_get_stats(&after);
+    return after.publish_bytes - before.publish_bytes;
+}
+
+static void test_compression(void)
+{
+    static char json[2048];
+    static uint8_t frame[2048];
+    static uint32_t work[MQTT_COMPRESS_WORK_SIZE / sizeof(uint32_t)];
+    size_t len = 0;
+    size_t frame_len;
+    uint32_t plain_bytes;
+    uint32_t packed_bytes;
+
+    TEST_START("Payload Compression");
+
+    for (int i = 0; len < 1500U; i++)
+    {
+        len += (size_t)snprintf(json + len, sizeof(json) - len, "%s{\"t\":%d,\"v\":%d}", i ? "," : "[", 1000 + i, i % 7);
+    }
+    json[len++] = ']';
+    json[len] = '\0';
+
+    TEST_ASSERT(mqtt_broker_stub_start(BROKER_URL), "Broker stand-in restarted");
+    MqttApp_Init();
+    TEST_ASSERT(wait_connected(), "Connected");
+    TEST_ASSERT(MqttApp_SubscribeCtx("hq/z/#", 1, on_big, NULL, WAIT_MS), "Subscribed");
+    __atomic_store_n(&g_big_count, 0U, __ATOMIC_RELEASE);
+
+    plain_bytes = publish_bytes_for("hq/z/plain", json, len, 1U);
+    TEST_ASSERT(plain_bytes > len && g_big_len == len, "Uncompressed topic sent as is");
+
+    TEST_ASSERT(!MqttApp_SetCompression("hq/z/#/bad", 0), "Invalid filter refused");
+    TEST_ASSERT(MqttApp_SetCompression("hq/z/+/packed", 0) && MqttApp_SetCompression("hq/z/t/#", 4096),
+                "Compression rules added");
+    packed_bytes = publish_bytes_for("hq/z/t/packed", json, len, 2U);
+    TEST_ASSERT(packed_bytes > 0U && packed_bytes * 2U < plain_bytes, "Payload compressed more than 2x on the wire");
+    TEST_ASSERT(g_big_len == len && memcmp(g_big, json, len) == 0, "Subscriber got the original payload back");
+
+    TEST_ASSERT(publish_bytes_for("hq/z/t/packed", json, 100, 3U) > 100U && g_big_len == 100U,
+                "Payload below the threshold sent as is");
+    TEST_ASSERT(MqttApp_SetCompression("hq/z/+/packed", 4096), "Threshold raised");
+    TEST_ASSERT(publish_bytes_for("hq/z/t/packed", json, len, 4U) > len, "Raised threshold applies");
+
+    /* Frames published by someone else are inflated too */
+    frame_len = MqttCompress_Encode(json, len, frame, sizeof(frame), work);
+    TEST_ASSERT(MqttApp_ClearCompression("hq/z/+/packed") && !MqttApp_ClearCompression("hq/z/none"),
+                "Rule removed");
+    TEST_ASSERT(publish_bytes_for("hq/z/raw", (const char *)frame, frame_len, 5U) > 0U && g_big_len == len &&
+                memcmp(g_big, json, len) == 0, "Received frame inflated before delivery");
+    frame[frame_len - 1U] ^= 0x5A;
+    frame[frame_len - 2U] ^= 0x5A;
+    frame[5] = 0xF0;
+    TEST_ASSERT(publish_bytes_for("hq/z/raw", (const char *)frame, frame_len, 6U) > 0U && g_big_len == frame_len,
+                "Damaged frame delivered as it came");
+
+    MqttApp_Deinit();
+    mqtt_broker_stub_stop();
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 16: QoS 2 exactly once over a faulty link
+ * ========================================================================== */
+
+#define EO_MESSAGES 200U
+
+/* Subscriber connected straight to the broker, outside the faulty path */
+static struct mg_connection *g_observer;
+static volatile bool g_observer_ready;
+static uint8_t g_eo_seen[EO_MESSAGES];
+static volatile uint32_t g_eo_count;
+static volatile uint32_t g_eo_dups;
+
+static void observer_fn(struct mg_connection *c, int ev, void *ev_data)
+{
+    if (ev == MG_EV_MQTT_OPEN)
+    {
+        struct mg_mqtt_opts opts = { .topic = mg_str("hq/eo/#"), .qos = 2 };
+
+        mg_mqtt_sub(c, &opts);
+    }
+    else if (ev == MG_EV_MQTT_CMD && ((struct mg_mqtt_message *)ev_data)->cmd == MQTT_CMD_SUBACK)
+    {
+        g_observer_ready = true;
+    }
+    else if (ev == MG_EV_MQTT_MSG)
+    {
+        struct mg_mqtt_message *mm = (struct mg_mqtt_message *)ev_data;
+        uint32_t seq = 0;
+
+        for (size_t i = 0; i < mm->data.len; i++)
+        {
+            seq = seq * 10U + (uint32_t)(mm->data.buf[i] - '0');
+        }
+        if (seq < EO_MESSAGES && g_eo_seen[seq]++ == 0U)
+        {
+            __atomic_add_fetch(&g_eo_count, 1U, __ATOMIC_RELEASE);
+        }
+        else
+        {
+            __atomic_add_fetch(&g_eo_dups, 1U, __ATOMIC_RELEASE);
+        }
+    }
+    else if (ev == MG_EV_CLOSE)
+    {
+        g_observer = NULL;
+    }
+}
+
+static void observer_open_on_loop(void *arg)
+{
+    struct mg_mqtt_opts opts = { .client_id = mg_str("hq_observer"), .clean = true };
+
+    (void)arg;
+    g_observer_ready = false;
+    g_observer = mg_mqtt_connect(&mgr, BROKER_URL, &opts, observer_fn, NULL);
+}
+
+static void observer_close_on_loop(void *arg)
+{
+    (void)arg;
+    if (g_observer != NULL)
+    {
+        g_observer->is_closing = 1;
+    }
+}
+
+static void test_exactly_once(void)
+{
+    mqtt_broker_stub_stats_t stats;
+    mqtt_conn_stats_t conn;
+    char payload[16];
+    bool ok = true;
+
+    TEST_START("QoS 2 Exactly Once over a Faulty Link");
+
+    setup_test_fs();
+    memset(g_eo_seen, 0, sizeof(g_eo_seen));
+    TEST_ASSERT(mqtt_broker_stub_start(BROKER_URL), "Broker stand-in restarted");
+    TEST_ASSERT(net_delay_proxy_start(RELAY_LISTEN_URL, "tcp://127.0.0.1:18830", 2U), "Relay in front of the broker");
+    net_delay_proxy_set_loss(10U);
+    MongooseProcess_CallWait(observer_open_on_loop, NULL);
+    for (uint32_t waited = 0; !g_observer_ready && waited < WAIT_MS; waited += 10U)
+    {
+        osal_task_delay_ms(10);
+    }
+    TEST_ASSERT(g_observer_ready, "Observer subscribed directly at QoS 2");
+
+    MQTTConfig_SetString(RELAY_URL, MQTT_CONFIG_VALUE_ADDRESS);
+    MQTTConfig_SetString("hq_eo_test", MQTT_CONFIG_VALUE_CLIENT_ID);
+    MQTTConfig_SetBool(false, MQTT_CONFIG_VALUE_CLEAN);
+    MqttApp_Init();
+    TEST_ASSERT(wait_connected(), "Connected through the relay");
+
+    /* The connection drops every 40 messages, wherever the handshakes are */
+    for (uint32_t i = 0; i < EO_MESSAGES && ok; i++)
+    {
+        uint32_t waited = 0;
+
+        if (i > 0U && i % 40U == 0U)
+        {
+            wait_connected();
+            net_delay_proxy_disconnect();
+        }
+        snprintf(payload, sizeof(payload), "%u", (unsigned)i);
+        /* The queue backs up while a lost packet stalls the link */
+        while (!(ok = MqttApp_PostData("hq/eo/seq", payload, 2)) && waited < 5U * WAIT_MS)
+        {
+            osal_task_delay_ms(10);
+            waited += 10U;
+        }
+    }
+    TEST_ASSERT(ok, "All messages posted");
+
+    for (uint32_t waited = 0; g_eo_count < EO_MESSAGES && waited < 20000U; waited += 10U)
+    {
+        osal_task_delay_ms(10);
+    }
+    osal_task_delay_ms(200);
+    mqtt_broker_stub_get_stats(&stats);
+    MqttApp_GetConnStats(&conn);
+    printf("  %u connections dropped, %u QoS 2 resends absorbed by the broker\n",
+           (unsigned)net_delay_proxy_disconnects(), (unsigned)stats.duplicates);
+    TEST_ASSERT(net_delay_proxy_disconnects() >= 4U && conn.connects >= 5U, "Reconnected after every drop");
+    TEST_ASSERT(g_eo_count == EO_MESSAGES, "Every message delivered");
+    TEST_ASSERT(g_eo_dups == 0U, "None delivered twice");
+
+    MqttApp_Deinit();
+    MQTTConfig_SetBool(true, MQTT_CONFIG_VALUE_CLEAN);
+    MQTTConfig_SetString("", MQTT_CONFIG_VALUE_CLIENT_ID);
+    MQTTConfig_SetString(BROKER_URL, MQTT_CONFIG_VALUE_ADDRESS);
+    MongooseProcess_CallWait(observer_close_on_loop, NULL);
+    net_delay_proxy_stop();
+    mqtt_broker_stub_stop();
+    cleanup_test_fs();
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 17: Saved settings
+ * ========================================================================== */
+
+static bool file_contains(const char *path, const char *text)
+{
+    char buf[1024];
+    int32_t len;
+    osal_file_id_t fd = osal_open_create(path, OSAL_FILE_FLAG_NONE, OSAL_READ_ONLY);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+    len = osal_read(fd, buf, sizeof(buf) - 1U);
+    osal_close(fd);
+    if (len < 0)
+    {
+        return false;
+    }
+    buf[len] = '\0';
+    return strstr(buf, text) != NULL;
+}
+
+/* True if no new connection shows up within a while */
+static bool stays_connected(uint32_t connects_before)
+{
+    mqtt_broker_stub_stats_t stats;
+
+    osal_task_delay_ms(300);
+    mqtt_broker_stub_get_stats(&stats);
+    return stats.connects == connects_before && MqttApp_IsConnected();
+}
+
+static void test_saved_settings(void)
+{
+    static sub_sink_t sink;
+    mqtt_broker_stub_stats_t before;
+    osal_fstat_t st;
+    bool ok = true;
+
+    TEST_START("Saved Settings");
+
+    setup_test_fs();
+    TEST_ASSERT(mqtt_broker_stub_start(BROKER_URL), "Broker stand-in restarted");
+    /* Earlier tests set values back without saving them */
+    MQTTConfig_Save();
+    MqttApp_Init();
+    TEST_ASSERT(wait_connected(), "Connected");
+    TEST_ASSERT(MqttApp_SubscribeCtx("hq/cfg/#", 1, on_sink, &sink, WAIT_MS), "Subscribed");
+
+    mqtt_broker_stub_get_stats(&before);
+    TEST_ASSERT(MQTTConfig_SetString("/post_test/", MQTT_CONFIG_VALUE_POST_DATA_TOPIC) && MQTTConfig_Save(),
+                "Topic setting saved");
+    TEST_ASSERT(stays_connected(before.connects), "Topic change applied without reconnecting");
+    TEST_ASSERT(file_contains(CONFIG_MQTT_CONFIG_PATH, "post=/post_test/\n"), "Written to the settings file");
+    TEST_ASSERT(!MQTTConfig_SetString("two\nlines", MQTT_CONFIG_VALUE_USERNAME), "Line breaks refused");
+
+    /* The window shrinks and grows in place */
+    TEST_ASSERT(MQTTConfig_SetInt(2, MQTT_CONFIG_VALUE_INFLIGHT) && MQTTConfig_Save(), "Window of 2 saved");
+    for (int i = 0; i < 20 && ok; i++)
+    {
+        uint32_t waited = 0;
+        while (!(ok = MqttApp_PostData("hq/cfg/seq", "x", 1)) && waited < WAIT_MS)
+        {
+            osal_task_delay_ms(5);
+            waited += 5U;
+        }
+    }
+    TEST_ASSERT(ok && wait_sink(&sink, 20U, WAIT_MS), "Delivered through the smaller window");
+    TEST_ASSERT(MQTTConfig_SetInt(CONFIG_MQTT_INFLIGHT_MAX, MQTT_CONFIG_VALUE_INFLIGHT) && MQTTConfig_Save(),
+                "Window restored");
+    TEST_ASSERT(stays_connected(before.connects), "Window changes applied without reconnecting");
+
+    TEST_ASSERT(MQTTConfig_Save() && stays_connected(before.connects), "Saving nothing new changes nothing");
+
+    /* The certificate file is only written once one is set */
+    TEST_ASSERT(strcmp(MQTTConfig_GetCert(MQTT_CONFIG_VALUE_CERT), "") == 0, "No certificate by default");
+    TEST_ASSERT(osal_stat(CONFIG_MQTT_CERT_PATH, &st) != OSAL_SUCCESS, "No certificate file");
+    TEST_ASSERT(MQTTConfig_SetCert("-----PEM-----", 13, 0, MQTT_CONFIG_VALUE_CERT) &&
+                MQTTConfig_SetString("hq_user", MQTT_CONFIG_VALUE_USERNAME) && MQTTConfig_Save(),
+                "Certificate and user saved");
+    TEST_ASSERT(file_contains(CONFIG_MQTT_CERT_PATH, "-----PEM-----"), "Certificate in its own file");
+    TEST_ASSERT(wait_reconnected(before.connects), "Credential change reconnects");
+
+    MQTTConfig_SetCert("", 1, 0, MQTT_CONFIG_VALUE_CERT);
+    MQTTConfig_SetString("", MQTT_CONFIG_VALUE_USERNAME);
+    MQTTConfig_SetString("/post_data/", MQTT_CONFIG_VALUE_POST_DATA_TOPIC);
+    TEST_ASSERT(MQTTConfig_Save() && osal_stat(CONFIG_MQTT_CERT_PATH, &st) != OSAL_SUCCESS,
+                "Empty certificate removes the file");
+
+    MqttApp_Deinit();
+    mqtt_broker_stub_stop();
+    cleanup_test_fs();
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 18: TLS
+ * ========================================================================== */
+
+static void test_tls(void)
+{
+    static sub_sink_t sink;
+    static const char ca[] = MQTT_BROKER_STUB_TLS_CA;
+    hq_metric_t *handshake = hq_metrics_histogram("hq_mqtt_tls_handshake_ms", NULL, NULL, NULL, 0);
+    int64_t handshakes_before = hq_metrics_value(handshake);
+    mqtt_broker_stub_stats_t before;
+    mqtt_broker_stub_stats_t after;
+
+    TEST_START("TLS");
+
+    setup_test_fs();
+    TEST_ASSERT(mqtt_broker_stub_start(TLS_BROKER_URL), "TLS broker stand-in started");
+    TEST_ASSERT(MQTTConfig_SetString(TLS_BROKER_URL, MQTT_CONFIG_VALUE_ADDRESS) &&
+                MQTTConfig_SetCert(ca, sizeof(ca), 0, MQTT_CONFIG_VALUE_CERT) && MQTTConfig_Save(),
+                "TLS address and CA saved");
+    MqttApp_Init();
+    TEST_ASSERT(wait_connected(), "Connected over TLS");
+    TEST_ASSERT(MqttApp_SubscribeCtx("hq/tls/#", 1, on_sink, &sink, WAIT_MS), "Subscribed");
+    TEST_ASSERT(MqttApp_PostData("hq/tls/a", "secret", 1) && wait_sink(&sink, 1U, WAIT_MS),
+                "Publish looped back through TLS");
+    TEST_ASSERT(hq_metrics_value(handshake) == handshakes_before + 1, "Handshake time observed");
+
+    mqtt_broker_stub_get_stats(&before);
+    MqttApp_Reconnect();
+    TEST_ASSERT(wait_reconnected(before.connects), "Reconnected");
+    mqtt_broker_stub_get_stats(&after);
+    TEST_ASSERT(after.tls_accepts == before.tls_accepts + 1 &&
+                hq_metrics_value(handshake) == handshakes_before + 2, "New handshake for the new connection");
+    TEST_ASSERT(MqttApp_PostData("hq/tls/b", "again", 1) && wait_sink(&sink, 2U, WAIT_MS),
+                "Publish after reconnecting");
+
+    MqttApp_Deinit();
+    MQTTConfig_SetString(BROKER_URL, MQTT_CONFIG_VALUE_ADDRESS);
+    MQTTConfig_SetCert("", 1, 0, MQTT_CONFIG_VALUE_CERT);
+    MQTTConfig_Save();
+    mqtt_broker_stub_stop();
+    cleanup_test_fs();
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 19: Command API
+ * ========================================================================== */
+
+/* "mqtt_echo <text>" prints its arguments back */
+static void echo_handler(hq_cmd_cli_t *cli, char *args, void *context)
+{
+    (void)cli;
+    (void)context;
+    hq_cmd_print((args != NULL) ? args : "");
+}
+
+static void test_cmd_api(void)
+{
+    hq_cmd_binding_t echo_binding = {
+        .name = "mqtt_echo",
+        .help = "Print the arguments",
+        .handler = echo_handler,
+    };
+    uint32_t received;
+
+    TEST_START("Command API");
+
+    TEST_ASSERT(hq_cmd_register(&echo_binding) == 0, "Command registered");
+    TEST_ASSERT(mqtt_broker_stub_start(BROKER_URL), "Broker stand-in restarted");
+    MqttApp_Init();
+    TEST_ASSERT(wait_connected(), "Connected");
+    TEST_ASSERT(CmdApi_SubscribeMqtt(WAIT_MS), "Control topic subscribed");
+    TEST_ASSERT(MqttApp_Subscribe("hq/cmd/+/+", 0, on_message, WAIT_MS), "Reply topics subscribed");
+
+    received = __atomic_load_n(&g_received, __ATOMIC_ACQUIRE);
+    TEST_ASSERT(MqttApp_PostData("hq/cmd/42", "mqtt_echo over mqtt", 0), "Command line published");
+    TEST_ASSERT(wait_received(received + 1U, WAIT_MS), "Reply published");
+    TEST_ASSERT(strcmp(g_last_topic, "hq/cmd/42/reply") == 0 && strcmp(g_last_message, "over mqtt\n") == 0,
+                "Output on the reply topic of the request");
+
+    TEST_ASSERT(MqttApp_PostData("hq/cmd/43", "nosuch", 0), "Unknown command published");
+    TEST_ASSERT(wait_received(received + 2U, WAIT_MS), "Error published");
+    TEST_ASSERT(strcmp(g_last_topic, "hq/cmd/43/error") == 0 && strcmp(g_last_message, "Unknown command: nosuch\n") == 0,
+                "Error on the error topic");
+
+    TEST_ASSERT(CmdApi_UnsubscribeMqtt(WAIT_MS), "Control topic unsubscribed");
+    TEST_ASSERT(MqttApp_PostData("hq/cmd/44", "mqtt_echo late", 0), "Command line published after");
+    TEST_ASSERT(!wait_received(received + 3U, 300U), "No reply after unsubscribing");
+
+    MqttApp_Deinit();
+    mqtt_broker_stub_stop();
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Main Test Runner
+ * ========================================================================== */
+
+static void mqtt_app_tests_reset(void)
+{
+    tests_run = 0;
+    tests_passed = 0;
+    tests_failed = 0;
+    g_received = 0;
+}
+
+int mqtt_app_tests_run(void)
+{
+    mqtt_app_tests_reset();
+
+    printf("\n");
+    printf("==================================================\n");
+    printf("              MQTT Application Tests              \n");
+    printf("==================================================\n");
+    printf("\n");
+
+    MongooseProcess_Init();
+
+    test_connect();
+    test_publish();
+    test_zero_copy();
+    test_unsubscribe();
+    test_restart();
+    test_window();
+    test_store_and_forward();
+    test_spool_limits();
+    test_batch();
+    test_subscribers();
+    test_async_subscribe();
+    test_reconnect();
+    test_qos2_session();
+    test_mqtt5();
+    test_compression();
+    test_exactly_once();
+    test_saved_settings();
+    test_tls();
+    test_cmd_api();
+
+    MongooseProcess_Deinit();
+
+    printf("\n");
+    printf("==================================================\n");
+    printf("                  TEST SUMMARY                    \n");
+    printf("==================================================\n");
+    printf("  Total tests:  %d\n", tests_run);
+    printf("  Passed:       %d\n", tests_passed);
+    printf("  Failed:       %d\n", tests_failed);
+    printf("  Success rate: %.1f%%\n",
+           (tests_run > 0) ? (100.0 * tests_passed / tests_run) : 0.0);
+    printf("==================================================\n");
+
+    if (tests_failed == 0) {
+        printf("\n✓ ALL TESTS PASSED!\n\n");
+    } else {
+        printf("\n✗ SOME TESTS FAILED!\n\n");
+    }
+
+    return tests_failed;
+}
@@ -0,0 +1,69 @@
+/*
+ * Minimal in-process MQTT 3.1.1 and MQTT 5 broker for tests and benchmarks.
+ *
+ * Runs on the shared Mongoose manager (MongooseProcess_Init() must have been
+ * called). Handles CONNECT, SUBSCRIBE, UNSUBSCRIBE, PUBLISH and PINGREQ and
+ * forwards publishes to matching subscribers, once per session, at up to
+ * QoS 2 (Mongoose answers the PUBREC/PUBREL handshakes; a QoS 2 publish sent
+ * again before its PUBREL is not forwarded twice). Sessions of clients
+ * connecting with clean session off keep their subscriptions until the
+ * broker is stopped, but messages are not queued while the client is away.
+ * No retained messages.
+ *
+ * MQTT 5 clients get a Topic Alias Maximum of MQTT_BROKER_STUB_ALIAS_MAX;
+ * message expiry and user properties are passed on to MQTT 5 subscribers.
+ *
+ * An "mqtts://" URL makes the broker speak TLS with a test certificate for
+ * localhost and 127.0.0.1, issued by MQTT_BROKER_STUB_TLS_CA. Never use these
+ * keys outside of tests.
+ */
+
+#ifndef MQTT_BROKER_STUB_H
+#define MQTT_BROKER_STUB_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MQTT_BROKER_STUB_ALIAS_MAX 8
+
+/* CA that issued the broker certificate, for the client trust store */
+#define MQTT_BROKER_STUB_TLS_CA \
+    "-----BEGIN CERTIFICATE-----\n" \
+    "MIIBgTCCASegAwIBAgIUGUnlkZjFXVL+zJSVjDPn/pL5+ZcwCgYIKoZIzj0EAwIw\n" \
+    "FTETMBEGA1UEAwwKaHEgdGVzdCBDQTAgFw0yNjEwMTgyMDQ3MTZaGA8yMTI2MDky\n" \
+    "NDIwNDcxNlowFTETMBEGA1UEAwwKaHEgdGVzdCBDQTBZMBMGByqGSM49AgEGCCqG\n" \
+    "SM49AwEHA0IABNa8dviApECEc6twysmymeLrbcnt4ee6whdPjS9hbrhQ7itjmCb1\n" \
+    "VV1vGWc7IpWZf3dwEKPQ26YqxFdacQKdDBujUzBRMB0GA1UdDgQWBBSZ2MlVRFsk\n" \
+    "iKugufmJR78xBlg/WzAfBgNVHSMEGDAWgBSZ2MlVRFskiKugufmJR78xBlg/WzAP\n" \
+    "BgNVHRMBAf8EBTADAQH/MAoGCCqGSM49BAMCA0gAMEUCIGlx8QdHYkP0dnDzXBGV\n" \
+    "whUL6HPZZtOGjXo44ol2nFRSAiEAkrR+Wt6/6xK+gjIcOrfWMtG5YKidMBMIyED5\n" \
+    "BKEKapo=\n" \
+    "-----END CERTIFICATE-----\n"
+
+typedef struct
+{
+    uint32_t connects;
+    uint32_t connects_v5;
+    uint32_t subscribes;
+    uint32_t unsubscribes;
+    uint32_t publishes;
+    uint32_t forwarded;
+    uint32_t sessions_resumed;
+    uint32_t duplicates;        /* QoS 2 resends not forwarded again */
+    uint32_t aliased;           /* Publishes that carried only a topic alias */
+    uint32_t publish_bytes;     /* Size of every PUBLISH received, headers included */
+    uint32_t last_expiry_s;     /* Message Expiry Interval of the last publish, 0 if none */
+    uint32_t last_user_props;   /* User properties on the last publish */
+    uint32_t tls_accepts;       /* Connections accepted with TLS */
+} mqtt_broker_stub_stats_t;
+
+/** Start listening on @p url, e.g. "mqtt://127.0.0.1:18830". */
+bool mqtt_broker_stub_start(const char *url);
+
+/** Close the listener and every client connection. */
+void mqtt_broker_stub_stop(void);
+
+/** Snapshot of the broker counters. */
+void mqtt_broker_stub_get_stats(mqtt_broker_stub_stats_t *stats);
+
+#endif /* MQTT_BROKER_STUB_H */
@@ -0,0 +1,228 @@
+/*
+ * MQTT Payload Compression Tests
+ *
+ * Tests:
+ * 1. Round trips: empty, short, repetitive, long runs, JSON-like text
+ * 2. Incompressible data and output limits
+ * 3. Frame detection and damaged frames
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mqtt_compress.h"
+
+/* Test results tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test macros */
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_START(name) \
+    printf("\n==================================================\n"); \
+    printf("TEST: %s\n", name); \
+    printf("==================================================\n")
+
+#define TEST_END() \
+    printf("--------------------------------------------------\n")
+
+static uint32_t g_work[MQTT_COMPRESS_WORK_SIZE / sizeof(uint32_t)];
+static uint8_t g_frame[80000];
+static uint8_t g_out[70000];
+
+/* Compresses and inflates data; returns the frame length, 0 on any mismatch */
+static size_t round_trip(const void *data, size_t len)
+{
+    size_t frame_len = MqttCompress_Encode(data, len, g_frame, sizeof(g_frame), g_work);
+    size_t raw_len = 0;
+
+    if (frame_len == 0 || frame_len > MqttCompress_Bound(len) || !MqttCompress_Peek(g_frame, frame_len, &raw_len) ||
+        raw_len != len || !MqttCompress_Decode(g_frame, frame_len, g_out, raw_len) ||
+        memcmp(data, g_out, len) != 0)
+    {
+        return 0;
+    }
+    return frame_len;
+}
+
+static size_t make_json(char *buf, size_t size, int samples)
+{
+    size_t len = (size_t)snprintf(buf, size, "{\"id\":\"hq-0042\",\"samples\":[");
+
+    for (int i = 0; i < samples && len < size; i++)
+    {
+        len += (size_t)snprintf(buf + len, size - len, "%s{\"t\":%d,\"temp\":%d.%d,\"ok\":true}", i ? "," : "",
+                                1700000000 + i * 30, 20 + i % 5, i % 10);
+    }
+    len += (size_t)snprintf(buf + len, size - len, "]}");
+    return len;
+}
+
+/* ============================================================================
+ * Test 1: Round trips
+ * ========================================================================== */
+
+static void test_round_trip(void)
+{
+    static char json[65536];
+    static uint8_t run[65536];
+    size_t len;
+    size_t frame_len;
+
+    TEST_START("Round Trips");
+
+    TEST_ASSERT(round_trip("", 0) > 0, "Empty payload");
+    TEST_ASSERT(round_trip("hello", 5) > 0, "Payload shorter than a match");
+    TEST_ASSERT(round_trip("abcabcabcabcabcabcabcabc", 24) > 0, "Short repetitive payload");
+
+    memset(run, 'x', sizeof(run));
+    frame_len = round_trip(run, sizeof(run));
+    TEST_ASSERT(frame_len > 0 && frame_len < 400, "64 KB run with overlapping matches and long lengths");
+
+    len = make_json(json, sizeof(json), 40);
+    frame_len = round_trip(json, len);
+    TEST_ASSERT(frame_len > 0 && frame_len * 3 < len, "1.5 KB of telemetry JSON shrinks more than 3x");
+
+    len = make_json(json, sizeof(json), 1500);
+    frame_len = round_trip(json, len);
+    TEST_ASSERT(len > 65536 / 2 && frame_len > 0 && frame_len * 4 < len, "Large JSON with offsets near the limit");
+
+    /* Repeats further back than the 64 KB window must be sent as literals */
+    for (size_t i = 0; i < sizeof(run); i++)
+    {
+        run[i] = (uint8_t)((i * 2654435761U) >> 13);
+    }
+    memcpy(run + 60000, run, 5000);
+    TEST_ASSERT(round_trip(run, sizeof(run)) > 0, "Repeats near and beyond the window");
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 2: Limits
+ * ========================================================================== */
+
+static void test_limits(void)
+{
+    static uint8_t noise[4096];
+    static char json[2048];
+    size_t len = make_json(json, sizeof(json), 40);
+    uint32_t seed = 1U;
+
+    TEST_START("Incompressible Data and Output Limits");
+
+    for (size_t i = 0; i < sizeof(noise); i++)
+    {
+        seed = seed * 1103515245U + 12345U;
+        noise[i] = (uint8_t)(seed >> 16);
+    }
+    TEST_ASSERT(round_trip(noise, sizeof(noise)) > 0, "Random data still round trips");
+    TEST_ASSERT(MqttCompress_Encode(noise, sizeof(noise), g_frame, sizeof(noise) - 1U, g_work) == 0,
+                "Random data does not fit below its own size");
+    TEST_ASSERT(MqttCompress_Encode(json, len, g_frame, 20, g_work) == 0, "Too small an output is refused");
+    TEST_ASSERT(MqttCompress_Encode(json, len, g_frame, len - 1U, g_work) > 0, "JSON fits below its own size");
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 3: Frames
+ * ========================================================================== */
+
+static void test_frames(void)
+{
+    static char json[2048];
+    size_t len = make_json(json, sizeof(json), 40);
+    size_t frame_len = MqttCompress_Encode(json, len, g_frame, sizeof(g_frame), g_work);
+    size_t raw_len = 0;
+    bool all_rejected = true;
+
+    TEST_START("Frame Detection and Damaged Frames");
+
+    TEST_ASSERT(!MqttCompress_Peek(json, len, NULL), "Plain JSON is not a frame");
+    TEST_ASSERT(!MqttCompress_Peek("\x01\x05", 2, NULL), "Batch frame is not a compressed frame");
+    TEST_ASSERT(!MqttCompress_Peek(g_frame, 4, NULL), "Frame cut inside the header");
+    TEST_ASSERT(MqttCompress_Peek(g_frame, frame_len, &raw_len) && raw_len == len, "Raw length read from the header");
+    TEST_ASSERT(!MqttCompress_Decode(g_frame, frame_len, g_out, len - 1U), "Wrong raw length refused");
+
+    /* Every truncation must fail cleanly, never overrun */
+    for (size_t cut = 5; cut < frame_len; cut++)
+    {
+        if (MqttCompress_Decode(g_frame, cut, g_out, len))
+        {
+            all_rejected = false;
+        }
+    }
+    TEST_ASSERT(all_rejected, "Every truncated frame refused");
+
+    /* A match offset pointing before the start of the output */
+    const uint8_t bad_offset[] = { 0x00, 'H', 'Z', 8, 0x40, 'a', 'b', 'c', 'd', 0x10, 0x00, 'x' };
+    TEST_ASSERT(!MqttCompress_Decode(bad_offset, sizeof(bad_offset), g_out, 8), "Offset past the output refused");
+    const uint8_t zero_offset[] = { 0x00, 'H', 'Z', 8, 0x40, 'a', 'b', 'c', 'd', 0x00, 0x00 };
+    TEST_ASSERT(!MqttCompress_Decode(zero_offset, sizeof(zero_offset), g_out, 8), "Zero offset refused");
+    const uint8_t good[] = { 0x00, 'H', 'Z', 9, 0x40, 'a', 'b', 'c', 'd', 0x04, 0x00, 0x10, 'x' };
+    TEST_ASSERT(MqttCompress_Decode(good, sizeof(good), g_out, 9) && memcmp(g_out, "abcdabcdx", 9) == 0,
+                "Hand-made LZ4 block decodes");
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Main Test Runner
+ * ========================================================================== */
+
+static void mqtt_compress_tests_reset(void)
+{
+    tests_run = 0;
+    tests_passed = 0;
+    tests_failed = 0;
+}
+
+int mqtt_compress_tests_run(void)
+{
+    mqtt_compress_tests_reset();
+
+    printf("\n");
+    printf("==================================================\n");
+    printf("           MQTT Payload Compression Tests         \n");
+    printf("==================================================\n");
+    printf("\n");
+
+    test_round_trip();
+    test_limits();
+    test_frames();
+
+    printf("\n");
+    printf("==================================================\n");
+    printf("                  TEST SUMMARY                    \n");
+    printf("==================================================\n");
+    printf("  Total tests:  %d\n", tests_run);
+    printf("  Passed:       %d\n", tests_passed);
+    printf("  Failed:       %d\n", tests_failed);
+    printf("  Success rate: %.1f%%\n",
+           (tests_run > 0) ? (100.0 * tests_passed / tests_run) : 0.0);
+    printf("==================================================\n");
+
+    if (tests_failed == 0) {
+        printf("\n✓ ALL TESTS PASSED!\n\n");
+    } else {
+        printf("\n✗ SOME TESTS FAILED!\n\n");
+    }
+
+    return tests_failed;
+}
@@ -0,0 +1,189 @@
+/*
+ * MQTT Topic Alias Tests
+ *
+ * Tests:
+ * 1. Assignment while aliases are free, reuse, reset
+ * 2. Hot topics take over the least recently used alias
+ * 3. Broker limit and capacity
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mqtt_topic_alias.h"
+
+/* Test results tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test macros */
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_START(name) \
+    printf("\n==================================================\n"); \
+    printf("TEST: %s\n", name); \
+    printf("==================================================\n")
+
+#define TEST_END() \
+    printf("--------------------------------------------------\n")
+
+/* ============================================================================
+ * Test 1: Assignment and reuse
+ * ========================================================================== */
+
+static void test_assign(void)
+{
+    TEST_START("Assignment and Reuse");
+
+    mqtt_alias_table_t *table = MqttAlias_Create(4, 2);
+    bool send = false;
+
+    TEST_ASSERT(MqttAlias_Resolve(table, "a/b", &send) == 0 && send, "No alias before the broker allows any");
+
+    MqttAlias_Reset(table, 4);
+    TEST_ASSERT(MqttAlias_Resolve(table, "a/b", &send) == 1 && send, "First topic takes alias 1 and sends the topic");
+    TEST_ASSERT(MqttAlias_Resolve(table, "a/b", &send) == 1 && !send, "Second publish sends the alias alone");
+    TEST_ASSERT(MqttAlias_Resolve(table, "a/c", &send) == 2 && send, "Next topic takes alias 2");
+    TEST_ASSERT(MqttAlias_Resolve(table, "", &send) == 0 && send, "Empty topic never gets an alias");
+    TEST_ASSERT(MqttAlias_Count(table) == 2, "Two aliases mapped");
+
+    MqttAlias_Reset(table, 4);
+    TEST_ASSERT(MqttAlias_Count(table) == 0, "Reset forgets the mappings");
+    TEST_ASSERT(MqttAlias_Resolve(table, "a/c", &send) == 1 && send, "Topic is sent again on the new connection");
+
+    MqttAlias_Destroy(table);
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 2: Eviction of the least recently used alias
+ * ========================================================================== */
+
+static void test_hot(void)
+{
+    TEST_START("Hot Topics Evict the Least Recently Used Alias");
+
+    mqtt_alias_table_t *table = MqttAlias_Create(8, 2);
+    bool send = false;
+
+    MqttAlias_Reset(table, 3);
+    MqttAlias_Resolve(table, "t/1", &send);
+    MqttAlias_Resolve(table, "t/2", &send);
+    MqttAlias_Resolve(table, "t/3", &send);
+    MqttAlias_Resolve(table, "t/1", &send);
+    MqttAlias_Resolve(table, "t/3", &send);
+
+    TEST_ASSERT(MqttAlias_Resolve(table, "t/4", &send) == 0 && send, "First miss on a full table sends without alias");
+    TEST_ASSERT(MqttAlias_Resolve(table, "t/2", &send) == 2 && !send, "Mapped topics are not disturbed by a miss");
+    TEST_ASSERT(MqttAlias_Resolve(table, "t/4", &send) == 1 && send, "Second miss takes over the least recently used alias");
+    TEST_ASSERT(MqttAlias_Resolve(table, "t/4", &send) == 1 && !send, "Reassigned alias is used alone afterwards");
+    TEST_ASSERT(MqttAlias_Resolve(table, "t/1", &send) == 0 && send, "Evicted topic starts counting misses again");
+    TEST_ASSERT(MqttAlias_Count(table) == 3, "Count stays at the limit");
+
+    MqttAlias_Destroy(table);
+
+    table = MqttAlias_Create(2, 0);
+    MqttAlias_Reset(table, 2);
+    MqttAlias_Resolve(table, "x", &send);
+    MqttAlias_Resolve(table, "y", &send);
+    TEST_ASSERT(MqttAlias_Resolve(table, "z", &send) == 1 && send, "Threshold 0 evicts on the first miss");
+    MqttAlias_Destroy(table);
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 3: Limits
+ * ========================================================================== */
+
+static void test_limits(void)
+{
+    TEST_START("Broker Limit and Capacity");
+
+    mqtt_alias_table_t *table = MqttAlias_Create(4, 1);
+    char topic[16];
+    bool send = false;
+    uint16_t highest = 0;
+
+    MqttAlias_Reset(table, 1000);
+    for (int i = 0; i < 10; i++)
+    {
+        snprintf(topic, sizeof(topic), "dev/%d", i);
+        uint16_t alias = MqttAlias_Resolve(table, topic, &send);
+        highest = (alias > highest) ? alias : highest;
+    }
+    TEST_ASSERT(highest == 4 && MqttAlias_Count(table) == 4, "Capacity caps a generous broker limit");
+
+    MqttAlias_Reset(table, 2);
+    for (int i = 0; i < 10; i++)
+    {
+        snprintf(topic, sizeof(topic), "dev/%d", i);
+        MqttAlias_Resolve(table, topic, &send);
+    }
+    TEST_ASSERT(MqttAlias_Count(table) == 2, "Broker limit below capacity is honoured");
+    TEST_ASSERT(MqttAlias_Resolve(table, "dev/9", &send) <= 2 && !send, "Aliases stay within the broker limit");
+
+    MqttAlias_Destroy(table);
+    TEST_ASSERT(MqttAlias_Resolve(NULL, "a", &send) == 0 && send, "NULL table never aliases");
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Main Test Runner
+ * ========================================================================== */
+
+static void mqtt_topic_alias_tests_reset(void)
+{
+    tests_run = 0;
+    tests_passed = 0;
+    tests_failed = 0;
+}
+
+int mqtt_topic_alias_tests_run(void)
+{
+    mqtt_topic_alias_tests_reset();
+
+    printf("\n");
+    printf("==================================================\n");
+    printf("             MQTT Topic Alias Tests               \n");
+    printf("==================================================\n");
+    printf("\n");
+
+    test_assign();
+    test_hot();
+    test_limits();
+
+    printf("\n");
+    printf("==================================================\n");
+    printf("                  TEST SUMMARY                    \n");
+    printf("==================================================\n");
+    printf("  Total tests:  %d\n", tests_run);
+    printf("  Passed:       %d\n", tests_passed);
+    printf("  Failed:       %d\n", tests_failed);
+    printf("  Success rate: %.1f%%\n",
+           (tests_run > 0) ? (100.0 * tests_passed / tests_run) : 0.0);
+    printf("==================================================\n");
+
+    if (tests_failed == 0) {
+        printf("\n✓ ALL TESTS PASSED!\n\n");
+    } else {
+        printf("\n✗ SOME TESTS FAILED!\n\n");
+    }
+
+    return tests_failed;
+}
@@ -0,0 +1,237 @@
+/*
+ * MQTT Topic Trie Tests
+ *
+ * Tests:
+ * 1. Filter validation
+ * 2. Exact, '+' and '#' matching, '$' topics
+ * 3. Insert, lookup and remove with node pruning
+ * 4. Many filters
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mqtt_topic_trie.h"
+
+/* Test results tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+/* Test macros */
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_START(name) \
+    printf("\n==================================================\n"); \
+    printf("TEST: %s\n", name); \
+    printf("==================================================\n")
+
+#define TEST_END() \
+    printf("--------------------------------------------------\n")
+
+/* Collects the values visited by MqttTrie_Match() as a bit set */
+static void collect(void *value, void *arg)
+{
+    *(uint32_t *)arg |= 1U << (uint32_t)(uintptr_t)value;
+}
+
+static uint32_t match(const mqtt_trie_t *trie, const char *topic)
+{
+    uint32_t seen = 0;
+
+    MqttTrie_Match(trie, topic, strlen(topic), collect, &seen);
+    return seen;
+}
+
+/* ============================================================================
+ * Test 1: Filter validation
+ * ========================================================================== */
+
+static void test_validation(void)
+{
+    TEST_START("Filter Validation");
+
+    TEST_ASSERT(MqttTrie_IsValidFilter("a/b/c"), "Plain filter is valid");
+    TEST_ASSERT(MqttTrie_IsValidFilter("+/b/#"), "Wildcards on whole levels are valid");
+    TEST_ASSERT(MqttTrie_IsValidFilter("#"), "Lone '#' is valid");
+    TEST_ASSERT(MqttTrie_IsValidFilter("a//b"), "Empty level is valid");
+    TEST_ASSERT(!MqttTrie_IsValidFilter(""), "Empty filter is rejected");
+    TEST_ASSERT(!MqttTrie_IsValidFilter(NULL), "NULL filter is rejected");
+    TEST_ASSERT(!MqttTrie_IsValidFilter("a/b+"), "'+' inside a level is rejected");
+    TEST_ASSERT(!MqttTrie_IsValidFilter("a/#/b"), "'#' before the last level is rejected");
+    TEST_ASSERT(!MqttTrie_IsValidFilter("a#"), "'#' inside a level is rejected");
+
+    mqtt_trie_t *trie = MqttTrie_Create();
+    TEST_ASSERT(!MqttTrie_Insert(trie, "a/#/b", (void *)1), "Insert rejects an invalid filter");
+    TEST_ASSERT(MqttTrie_Count(trie) == 0, "Nothing stored after rejected insert");
+    MqttTrie_Destroy(trie);
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 2: Matching
+ * ========================================================================== */
+
+static void test_matching(void)
+{
+    TEST_START("Wildcard Matching");
+
+    mqtt_trie_t *trie = MqttTrie_Create();
+
+    MqttTrie_Insert(trie, "home/kitchen/temp", (void *)0);
+    MqttTrie_Insert(trie, "home/+/temp", (void *)1);
+    MqttTrie_Insert(trie, "home/#", (void *)2);
+    MqttTrie_Insert(trie, "#", (void *)3);
+    MqttTrie_Insert(trie, "+/+/+", (void *)4);
+    MqttTrie_Insert(trie, "$SYS/#", (void *)5);
+    MqttTrie_Insert(trie, "home/+", (void *)6);
+
+    TEST_ASSERT(match(trie, "home/kitchen/temp") == 0x1F, "Exact, '+', '#' and '+/+/+' all match");
+    TEST_ASSERT(match(trie, "home/hall/temp") == 0x1E, "'+' matches any level");
+    TEST_ASSERT(match(trie, "home") == 0x0C, "'home/#' matches its parent level");
+    TEST_ASSERT(match(trie, "home/hall") == 0x4C, "'home/+' matches one level only");
+    TEST_ASSERT(match(trie, "home/a/b/c") == 0x0C, "'#' matches several levels");
+    TEST_ASSERT(match(trie, "home//temp") == 0x1E, "'+' matches an empty level");
+    TEST_ASSERT(match(trie, "$SYS/uptime") == 0x20, "Leading wildcards skip '$' topics");
+    TEST_ASSERT(match(trie, "office") == 0x08, "Only '#' matches an unrelated topic");
+
+    uint32_t seen = 0;
+    TEST_ASSERT(MqttTrie_Match(trie, "home/kitchen/temp/x", 17, collect, &seen) == 5 && seen == 0x1F,
+                "Match honours the length of an unterminated topic");
+
+    MqttTrie_Destroy(trie);
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 3: Insert, lookup and remove
+ * ========================================================================== */
+
+static void test_insert_remove(void)
+{
+    TEST_START("Insert, Lookup and Remove");
+
+    mqtt_trie_t *trie = MqttTrie_Create();
+    int a = 0;
+    int b = 0;
+
+    TEST_ASSERT(MqttTrie_Insert(trie, "a/b", &a), "Insert a/b");
+    TEST_ASSERT(!MqttTrie_Insert(trie, "a/b", &b), "Duplicate insert is rejected");
+    TEST_ASSERT(MqttTrie_Insert(trie, "a/b/c", &b), "Insert a/b/c below it");
+    TEST_ASSERT(MqttTrie_Count(trie) == 2, "Count is 2");
+    TEST_ASSERT(MqttTrie_Lookup(trie, "a/b") == &a, "Lookup finds a/b");
+    TEST_ASSERT(MqttTrie_Lookup(trie, "a") == NULL, "Intermediate level has no value");
+    TEST_ASSERT(MqttTrie_Lookup(trie, "a/+") == NULL, "Lookup is literal, not a match");
+
+    TEST_ASSERT(MqttTrie_Remove(trie, "a/b") == &a, "Remove returns the value");
+    TEST_ASSERT(MqttTrie_Remove(trie, "a/b") == NULL, "Second remove finds nothing");
+    TEST_ASSERT(MqttTrie_Lookup(trie, "a/b/c") == &b, "Child survives removing its parent");
+
+    uint32_t seen = 0;
+    TEST_ASSERT(MqttTrie_Match(trie, "a/b", 3, collect, &seen) == 0, "Removed filter no longer matches");
+
+    TEST_ASSERT(MqttTrie_Remove(trie, "a/b/c") == &b, "Remove a/b/c");
+    TEST_ASSERT(MqttTrie_Count(trie) == 0, "Trie is empty");
+    TEST_ASSERT(MqttTrie_Insert(trie, "a/b", &a), "Pruned path can be inserted again");
+
+    MqttTrie_Destroy(trie);
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Test 4: Many filters
+ * ========================================================================== */
+
+static void test_many(void)
+{
+    TEST_START("Many Filters");
+
+    mqtt_trie_t *trie = MqttTrie_Create();
+    char filter[32];
+    bool ok = true;
+
+    for (int i = 0; i < 1000; i++)
+    {
+        snprintf(filter, sizeof(filter), "dev/%d/cmd", i);
+        ok = ok && MqttTrie_Insert(trie, filter, (void *)0);
+    }
+    MqttTrie_Insert(trie, "dev/+/cmd", (void *)1);
+    TEST_ASSERT(ok && MqttTrie_Count(trie) == 1001, "1001 filters stored");
+
+    TEST_ASSERT(match(trie, "dev/517/cmd") == 0x3, "Literal and '+' filter match among 1000 siblings");
+    TEST_ASSERT(match(trie, "dev/1000/cmd") == 0x2, "Unknown level only matches '+'");
+
+    for (int i = 0; i < 1000; i += 2)
+    {
+        snprintf(filter, sizeof(filter), "dev/%d/cmd", i);
+        MqttTrie_Remove(trie, filter);
+    }
+    TEST_ASSERT(MqttTrie_Count(trie) == 501, "Half the filters removed");
+    TEST_ASSERT(match(trie, "dev/516/cmd") == 0x2 && match(trie, "dev/517/cmd") == 0x3,
+                "Siblings stay sorted after removals");
+
+    MqttTrie_Destroy(trie);
+
+    TEST_END();
+}
+
+/* ============================================================================
+ * Main Test Runner
+ * ========================================================================== */
+
+static void mqtt_topic_trie_tests_reset(void)
+{
+    tests_run = 0;
+    tests_passed = 0;
+    tests_failed = 0;
+}
+
+int mqtt_topic_trie_tests_run(void)
+{
+    mqtt_topic_trie_tests_reset();
+
+    printf("\n");
+    printf("==================================================\n");
+    printf("             MQTT Topic Trie Tests                \n");
+    printf("==================================================\n");
+    printf("\n");
+
+    test_validation();
+    test_matching();
+    test_insert_remove();
+    test_many();
+
+    printf("\n");
+    printf("==================================================\n");
+    printf("                  TEST SUMMARY                    \n");
+    printf("==================================================\n");
+    printf("  Total tests:  %d\n", tests_run);
+    printf("  Passed:       %d\n", tests_passed);
+    printf("  Failed:       %d\n", tests_failed);
+    printf("  Success rate: %.1f%%\n",
+           (tests_run > 0) ? (100.0 * tests_passed / tests_run) : 0.0);
+    printf("==================================================\n");
+
+    if (tests_failed == 0) {
+        printf("\n✓ ALL TESTS PASSED!\n\n");
+    } else {
+        printf("\n✗ SOME TESTS FAILED!\n\n");
+    }
+
+    return tests_failed;
+}
@@ -0,0 +1,292 @@
+/*
+ * TCP relay that adds a fixed one-way delay in both directions.
+ *
+ * Every read is stored as a timestamped chunk on the opposite side and sent
+ * once it is due, so packet boundaries and ordering are preserved. A lost
+ * chunk is due later, and the chunks queued behind it wait for it.
+ */
+
+#include "net_delay_proxy.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mongoose.h"
+#include "osal_bin_sem.h"
+#include "osal_task.h"
+
+#define PROXY_TASK_STACK_SIZE 65536
+#define PROXY_TASK_PRIORITY   5
+
+typedef struct chunk
+{
+    struct chunk *next;
+    uint64_t due;
+    size_t len;
+    uint8_t data[];
+} chunk_t;
+
+/* One end of a relayed connection and the data waiting to be sent to it */
+typedef struct
+{
+    struct mg_connection *c;
+    chunk_t *head;
+    chunk_t *tail;
+} side_t;
+
+typedef struct pair
+{
+    struct pair *next;
+    side_t side[2];
+} pair_t;
+
+static struct mg_mgr g_proxy_mgr;
+static osal_task_id_t g_task;
+static osal_bin_sem_id_t g_stopped;
+static volatile bool g_stop;
+static bool g_running;
+static pair_t *g_pairs;
+static char g_target[64];
+static uint32_t g_delay_ms;
+static uint32_t g_loss_percent;     /* Written by other tasks */
+static uint32_t g_kick;             /* Disconnect requests not yet served */
+static uint32_t g_disconnects;
+
+static void side_free(side_t *side)
+{
+    while (side->head != NULL)
+    {
+        chunk_t *next = side->head->next;
+        free(side->head);
+        side->head = next;
+    }
+    side->tail = NULL;
+}
+
+static void pair_unlink(pair_t *pair)
+{
+    for (pair_t **p = &g_pairs; *p != NULL; p = &(*p)->next)
+    {
+        if (*p == pair)
+        {
+            *p = pair->next;
+            break;
+        }
+    }
+    side_free(&pair->side[0]);
+    side_free(&pair->side[1]);
+    free(pair);
+}
+
+static void flush_due(void)
+{
+    uint64_t now = mg_millis();
+
+    for (pair_t *pair = g_pairs; pair != NULL; pair = pair->next)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            side_t *side = &pair->side[i];
+
+            while (side->c != NULL && side->head != NULL && side->head->due <= now)
+            {
+                chunk_t *chunk = side->head;
+
+                mg_send(side->c, chunk->data, chunk->len);
+                side->head = chunk->next;
+                if (side->head == NULL)
+                {
+                    side->tail = NULL;
+                }
+                free(chunk);
+            }
+        }
+    }
+}
+
+static void proxy_fn(struct mg_connection *c, int ev, void *ev_data)
+{
+    pair_t *pair = (pair_t *)c->fn_data;
+
+    (void)ev_data;
+
+    if (ev == MG_EV_ACCEPT)
+    {
+        pair = (pair_t *)calloc(1, sizeof(*pair));
+        if (pair == NULL)
+        {
+            c->is_closing = 1;
+            return;
+        }
+        c->fn_data = pair;
+        pair->side[0].c = c;
+        pair->side[1].c = mg_connect(&g_proxy_mgr, g_target, proxy_fn, pair);
+        if (pair->side[1].c == NULL)
+        {
+            c->is_closing = 1;
+        }
+        pair->next = g_pairs;
+        g_pairs = pair;
+    }
+    else if (ev == MG_EV_READ && pair != NULL)
+    {
+        side_t *peer = (pair->side[0].c == c) ? &pair->side[1] : &pair->side[0];
+        chunk_t *chunk = (chunk_t *)malloc(sizeof(*chunk) + c->recv.len);
+
+        if (chunk != NULL)
+        {
+            uint32_t loss = __atomic_load_n(&g_loss_percent, __ATOMIC_RELAXED);
+            uint32_t roll = 0;
+
+            mg_random(&roll, sizeof(roll));
+            chunk->next = NULL;
+            chunk->due = mg_millis() + g_delay_ms + ((roll % 100U < loss) ? NET_DELAY_PROXY_RTO_MS : 0U);
+            if (peer->tail != NULL && chunk->due < peer->tail->due)
+            {
+                chunk->due = peer->tail->due;
+            }
+            chunk->len = c->recv.len;
+            memcpy(chunk->data, c->recv.buf, c->recv.len);
+            if (peer->tail != NULL)
+            {
+                peer->tail->next = chunk;
+            }
+            else
+            {
+                peer->head = chunk;
+            }
+            peer->tail = chunk;
+        }
+        c->recv.len = 0;
+    }
+    else if (ev == MG_EV_CLOSE && pair != NULL)
+    {
+        side_t *self = (pair->side[0].c == c) ? &pair->side[0] : &pair->side[1];
+        side_t *peer = (self == &pair->side[0]) ? &pair->side[1] : &pair->side[0];
+
+        self->c = NULL;
+        if (peer->c != NULL)
+        {
+            peer->c->is_draining = 1;
+        }
+        else
+        {
+            pair_unlink(pair);
+        }
+    }
+}
+
+/* Both ends close at once; data still waiting in the relay is lost */
+static void kick_all(void)
+{
+    for (pair_t *pair = g_pairs; pair != NULL; pair = pair->next)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            if (pair->side[i].c != NULL)
+            {
+                pair->side[i].c->is_closing = 1;
+            }
+        }
+        side_free(&pair->side[0]);
+        side_free(&pair->side[1]);
+        __atomic_add_fetch(&g_disconnects, 1U, __ATOMIC_RELEASE);
+    }
+}
+
+static void proxy_task(void *arg)
+{
+    (void)arg;
+
+    while (!g_stop)
+    {
+        mg_mgr_poll(&g_proxy_mgr, 1);
+        flush_due();
+        if (__atomic_load_n(&g_kick, __ATOMIC_ACQUIRE) > 0U)
+        {
+            kick_all();
+            __atomic_store_n(&g_kick, 0U, __ATOMIC_RELEASE);
+        }
+    }
+
+    mg_mgr_free(&g_proxy_mgr);
+    osal_bin_sem_give(g_stopped);
+    while (1)
+    {
+        osal_task_delay_ms(1000);
+    }
+}
+
+bool net_delay_proxy_start(const char *listen_url, const char *target_url, uint32_t delay_ms)
+{
+    if (g_running || strlen(target_url) >= sizeof(g_target))
+    {
+        return false;
+    }
+
+    strcpy(g_target, target_url);
+    g_delay_ms = delay_ms;
+    g_loss_percent = 0;
+    g_kick = 0;
+    g_disconnects = 0;
+    g_stop = false;
+    g_pairs = NULL;
+
+    /* Nothing else touches the manager until the task starts */
+    mg_mgr_init(&g_proxy_mgr);
+    if (mg_listen(&g_proxy_mgr, listen_url, proxy_fn, NULL) == NULL ||
+        osal_bin_sem_create(&g_stopped, "proxy_stop", 0) != OSAL_SUCCESS)
+    {
+        mg_mgr_free(&g_proxy_mgr);
+        return false;
+    }
+
+    if (osal_task_create(&g_task, "net_proxy", proxy_task, NULL, NULL,
+                         PROXY_TASK_STACK_SIZE, PROXY_TASK_PRIORITY, NULL) != OSAL_SUCCESS)
+    {
+        osal_bin_sem_delete(g_stopped);
+        mg_mgr_free(&g_proxy_mgr);
+        return false;
+    }
+
+    g_running = true;
+    return true;
+}
+
+void net_delay_proxy_stop(void)
+{
+    if (!g_running)
+    {
+        return;
+    }
+
+    g_stop = true;
+    osal_bin_sem_take(g_stopped);
+    osal_task_delete(g_task);
+    osal_bin_sem_delete(g_stopped);
+    g_running = false;
+}
+
+void net_delay_proxy_set_loss(uint32_t percent)
+{
+    __atomic_store_n(&g_loss_percent, (percent < 100U) ? percent : 100U, __ATOMIC_RELAXED);
+}
+
+void net_delay_proxy_disconnect(void)
+{
+    if (!g_running)
+    {
+        return;
+    }
+
+    __atomic_store_n(&g_kick, 1U, __ATOMIC_RELEASE);
+    while (__atomic_load_n(&g_kick, __ATOMIC_ACQUIRE) > 0U)
+    {
+        osal_task_delay_ms(1);
+    }
+}
+
+uint32_t net_delay_proxy_disconnects(void)
+{
+    return __atomic_load_n(&g_disconnects, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,42 @@
+/*
+ * TCP relay that adds a fixed one-way delay in both directions.
+ *
+ * Put it between a client and the broker stand-in to emulate a WAN round
+ * trip (RTT = 2 * delay). Runs on its own Mongoose manager and task so the
+ * delay does not depend on the shared poll loop.
+ *
+ * Faults can be injected while it runs: packet loss, seen over TCP as a
+ * retransmission stall, and dropped connections.
+ */
+
+#ifndef NET_DELAY_PROXY_H
+#define NET_DELAY_PROXY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define NET_DELAY_PROXY_RTO_MS 200
+
+/**
+ * Listen on @p listen_url and relay every accepted connection to
+ * @p target_url, holding each chunk of data for @p delay_ms.
+ */
+bool net_delay_proxy_start(const char *listen_url, const char *target_url, uint32_t delay_ms);
+
+/** Close all relayed connections and stop the proxy task. */
+void net_delay_proxy_stop(void);
+
+/**
+ * Lose @p percent of the chunks read on either side. TCP would resend
+ * them, so the stream stays intact: a lost chunk and everything behind it
+ * arrive NET_DELAY_PROXY_RTO_MS late.
+ */
+void net_delay_proxy_set_loss(uint32_t percent);
+
+/** Close every relayed connection now, as a network failure would. */
+void net_delay_proxy_disconnect(void);
+
+/** Connections closed by net_delay_proxy_disconnect() so far. */
+uint32_t net_delay_proxy_disconnects(void);
+
+#endif /* NET_DELAY_PROXY_H */